@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Convert the PEM certificates and keys in certs.h to DER byte arrays.
+
+Run by the build (CMakeLists.txt, K3S_TLS=ON):
+
+    certs_to_der.py include/certs.h <build>/generated/certs_der.h
+
+Every PEM string `const char name[]` in the input becomes
+`static const unsigned char name_der[]` in the output, so the firmware
+parses the binary form straight from flash and mbedtls needs neither PEM
+nor base64 support. Unreferenced arrays are dropped by the compiler.
+"""
+
+import base64
+import re
+import sys
+
+PEM_STRING = re.compile(
+    r'(?://\s*(?P<comment>[^\n]*)\n)?'
+    r'\s*const\s+char\s+(?P<name>\w+)\s*\[\]\s*=\s*'
+    r'(?P<literal>(?:\s*"(?:[^"\\]|\\.)*")+)\s*;')
+PEM_BLOCK = re.compile(
+    r'-----BEGIN (?P<label>[A-Z0-9 ]+)-----\n(?P<body>.*?)-----END (?P=label)-----',
+    re.S)
+
+
+def unquote(literal):
+    text = ''.join(re.findall(r'"((?:[^"\\]|\\.)*)"', literal))
+    return text.replace('\\n', '\n').replace('\\"', '"').replace('\\\\', '\\')
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 12):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 12]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: certs_to_der.py <certs.h> <certs_der.h>')
+
+    with open(sys.argv[1]) as f:
+        source = f.read()
+
+    out = [
+        '// Generated from certs.h by certs/certs_to_der.py - do not edit',
+        '#ifndef CERTS_DER_H',
+        '#define CERTS_DER_H',
+        '',
+    ]
+    pem_total = der_total = 0
+
+    for match in PEM_STRING.finditer(source):
+        pem = unquote(match.group('literal'))
+        block = PEM_BLOCK.search(pem)
+        if block is None:
+            sys.exit('%s: %s is not PEM' % (sys.argv[1], match.group('name')))
+        der = base64.b64decode(''.join(block.group('body').split()))
+
+        pem_size = len(pem) + 1     # NUL included, as the PEM parser needs
+        pem_total += pem_size
+        der_total += len(der)
+        comment = match.group('comment') or match.group('name')
+        out += [
+            '// %s: %s, %d bytes (%d as PEM)' % (comment.strip(), block.group('label'),
+                                                len(der), pem_size),
+            'static const unsigned char %s_der[] = {' % match.group('name'),
+            c_array(der),
+            '};',
+            '',
+        ]
+
+    if pem_total == 0:
+        sys.exit('%s: no PEM strings found' % sys.argv[1])
+
+    out.append('#endif // CERTS_DER_H')
+    with open(sys.argv[2], 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+    print('certs_to_der: %d bytes of PEM -> %d bytes of DER' % (pem_total, der_total))
+
+
+if __name__ == '__main__':
+    main()
@@ -79,6 +79,8 @@ sudo cp ${SERVER_CA_CERT} ${OUT_DIR}/server-ca.crt
 sudo chown -R ${USER}:${USER} ${OUT_DIR}
 
 # Convert to C header file
+# (with K3S_TLS=ON the firmware build converts these PEM strings to DER,
+# see certs_to_der.py)
 echo ""
 echo "4. Converting certificates to C header file..."
 cat > ${OUT_DIR}/certs.h <<'HEADER_START'
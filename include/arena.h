@@ -0,0 +1,65 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Fixed-Size Arena Allocator
+ *
+ * Bump allocator over a caller-provided static buffer. Everything
+ * allocated from an arena is released at once with arena_reset(), which
+ * suits per-request buffers: no heap traffic and no fragmentation no
+ * matter how long the node stays up.
+ */
+
+typedef struct {
+    uint8_t *base;          // Backing storage
+    size_t size;            // Capacity in bytes
+    size_t used;            // Bytes handed out since the last reset
+    size_t last;            // Offset of the most recent allocation
+    size_t high_water;      // Peak usage, see arena_high_water()
+    uint32_t failures;      // Allocations that didn't fit
+} arena_t;
+
+/**
+ * Initialize an arena over static storage
+ * @param arena Arena to initialize
+ * @param memory Backing buffer (should be 4-byte aligned)
+ * @param size Size of backing buffer
+ */
+void arena_init(arena_t *arena, void *memory, size_t size);
+
+/**
+ * Allocate from the arena (4-byte aligned)
+ * @param arena Arena to allocate from
+ * @param size Number of bytes
+ * @return Pointer to the block, or NULL if the arena is full
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * Shrink the most recent allocation, returning the tail to the arena
+ * Lets a worst-case sized buffer give back what it didn't use.
+ * @param arena Arena the block came from
+ * @param block Most recent allocation
+ * @param size New size (no larger than the original)
+ */
+void arena_shrink(arena_t *arena, void *block, size_t size);
+
+/**
+ * Release every allocation in the arena
+ * @param arena Arena to reset
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * Get the peak number of bytes the arena has held
+ * Blocks count with their size after arena_shrink(), not the size
+ * originally requested.
+ * @param arena Arena to query
+ * @return High-water mark in bytes
+ */
+size_t arena_high_water(arena_t *arena);
+
+#endif // ARENA_H
@@ -7,7 +7,20 @@
 #include "config_local.h"
 
 // K3s Configuration
+#ifndef K3S_USE_TLS
+#define K3S_USE_TLS              0     // mTLS straight to the API server, no proxy
+#endif                                 // (cmake -DK3S_TLS=ON, see tls_context.h)
+#if K3S_USE_TLS
+#define K3S_SERVER_PORT          6443  // k3s API server
+#ifndef K3S_TLS_HEAP_SIZE
+#define K3S_TLS_HEAP_SIZE        (56 * 1024)  // Static mbedtls pool (size it with
+#endif                                        // the k3s_tls_*heap* metrics, see tls_heap.h)
+#ifndef K3S_TLS_OFFLOAD
+#define K3S_TLS_OFFLOAD          0     // Handshake EC math on core1 (cmake
+#endif                                 // -DK3S_TLS_OFFLOAD=ON, see crypto_worker.h)
+#else
 #define K3S_SERVER_PORT          6080  // nginx proxy port (not 6443)
+#endif
 #define K3S_NODE_NAME            "pico-node-1"
 
 // Node configuration
@@ -18,6 +31,36 @@
 #define CONFIGMAP_POLL_INTERVAL_MS 30000    // Poll ConfigMaps every 30s
 #define HEALTH_CHECK_INTERVAL_MS 5000       // Internal health check
 
+// K3s client connection pool (HTTP/1.1 keep-alive to the nginx proxy)
+#define K3S_CONN_POOL_SIZE       2           // Persistent connections (MEMP_NUM_TCP_PCB is 5)
+#define K3S_CONN_IDLE_TIMEOUT_MS 30000       // Close pooled connections idle this long
+                                             // (must stay below nginx keepalive_timeout, 75s)
+#define K3S_MAX_PENDING_REQUESTS 4           // Async requests in flight or queued
+#if K3S_USE_TLS
+#define K3S_ACCEPT_GZIP          0           // No proxy: the API server's gzip uses a 32k window
+#else
+#define K3S_ACCEPT_GZIP          1           // Ask for gzip on GETs (proxy gzip_window <= 8k)
+#endif
+#ifndef K3S_USE_PROTOBUF
+#define K3S_USE_PROTOBUF         0           // Node status and ConfigMap as Kubernetes protobuf
+#endif                                       // (cmake -DK3S_PROTOBUF=ON, see k8s_protobuf.h)
+
+// K3s API retry policy (per endpoint, see retry_policy.h)
+#define K3S_RETRY_BASE_MS        2000        // Backoff after the first failure
+#define K3S_RETRY_MAX_MS         120000      // Backoff cap
+#define K3S_BREAKER_THRESHOLD    5           // Consecutive failures that open the circuit
+#define K3S_BREAKER_OPEN_MS      30000       // Open time before a half-open probe
+#define K3S_RETRY_BUDGET         10          // Retries allowed in a burst, all endpoints
+#define K3S_RETRY_BUDGET_REFILL_MS 6000      // One retry token back per interval
+
+// Resolver cache in front of lwIP DNS (see dns_cache.h)
+#define DNS_CACHE_SIZE           4           // Hostnames cached
+#define DNS_CACHE_NAME_MAX       64          // Longest hostname cached, including NUL
+#define DNS_CACHE_TTL_MS         300000      // Answers are fresh this long
+#define DNS_CACHE_REFRESH_MS     30000       // Re-resolve this long before they expire
+#define DNS_CACHE_STALE_MS       3600000     // Serve an expired answer this long if refreshing fails
+#define DNS_CACHE_RETRY_MS       10000       // Between failed refresh attempts
+
 // Memory regions for ConfigMap updates
 // Using a safe region in SRAM - adjust as needed
 #define MEMORY_REGION_START      0x20040000  // Start of configurable region
@@ -28,12 +71,14 @@
 #define CONFIGMAP_NAME           "pico-config"
 
 // Buffer sizes
-#define HTTP_REQUEST_BUFFER_SIZE 2048
-#define HTTP_RESPONSE_BUFFER_SIZE 4096
-#define JSON_PARSE_BUFFER_SIZE   4096
+#define HTTP_REQUEST_HEADER_SIZE 512    // Request bodies are sent in place, only headers are built
+#define HTTP_RESPONSE_HEADER_SIZE 1024  // Response bodies are streamed, only headers are buffered
+#define K3S_REQUEST_ARENA_SIZE   (HTTP_REQUEST_HEADER_SIZE + HTTP_RESPONSE_HEADER_SIZE)  // Static, per request slot
 
 // Debug configuration
+#ifndef DEBUG_ENABLE
 #define DEBUG_ENABLE             1           // Enable debug output via USB serial
+#endif
 
 #if DEBUG_ENABLE
 #define DEBUG_PRINT(fmt, ...) printf("[DEBUG] " fmt "\n", ##__VA_ARGS__)
@@ -16,14 +16,16 @@ int configmap_watcher_init(void);
 
 /**
  * Poll for ConfigMap updates
- * Fetches the specified ConfigMap and processes changes
+ * Queues a non-blocking fetch of the specified ConfigMap; changes are
+ * applied from the completion callback
  * Should be called every CONFIGMAP_POLL_INTERVAL_MS
- * Returns 0 on success, -1 on error
+ * Returns 0 if the fetch was queued, -1 on error
  */
 int configmap_watcher_poll(void);
 
 /**
  * Force an immediate ConfigMap check
+ * Blocks until the ConfigMap has been fetched and applied
  * Returns 0 on success, -1 on error
  */
 int configmap_watcher_check_now(void);
@@ -0,0 +1,78 @@
+#ifndef CRYPTO_WORKER_H
+#define CRYPTO_WORKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Crypto Worker on Core 1
+ *
+ * The firmware runs on core0. With K3S_TLS_OFFLOAD the elliptic-curve
+ * operations of a TLS handshake (ECDHE key generation and shared secret,
+ * ECDSA verification, see tls_offload.c) are handed to a worker on core1
+ * through the multicore FIFO. Each takes hundreds of milliseconds on a
+ * Cortex-M0+; meanwhile core0 keeps polling the network, so the kubelet
+ * server and lwIP timers don't stall.
+ *
+ * One operation runs at a time and core0 waits for it, so mbedtls is never
+ * called from both cores at once: while waiting core0 only runs lwIP
+ * callbacks, which don't call mbedtls. They can read mbedtls' pool
+ * counters, though (the kubelet server's /metrics), so tls_heap reports a
+ * snapshot while crypto_worker_busy(). This module's own counters are only
+ * written by core0.
+ */
+
+typedef struct {
+    uint32_t jobs;              // Operations run on core1
+    uint32_t inline_jobs;       // Run on the calling core (worker not started)
+    uint64_t busy_us;           // core1 time spent on them
+    uint32_t longest_us;        // Longest single operation
+    uint64_t waited_us;         // core0 time spent servicing the network meanwhile
+} crypto_worker_stats_t;
+
+/**
+ * Start the worker on core1
+ * Call once, from core0, before the first crypto_worker_run().
+ */
+void crypto_worker_init(void);
+
+/**
+ * Run an operation on core1 and wait for it, polling the network
+ * Runs it on the calling core instead if the worker isn't started, the
+ * caller isn't core0, or another operation is already in flight.
+ * @param fn Operation; must not touch lwIP
+ * @param arg Argument for fn
+ * @return What fn returned
+ */
+int crypto_worker_run(int (*fn)(void *arg), void *arg);
+
+/**
+ * Check whether core1 is running an operation
+ * Meanwhile it may allocate from the mbedtls pool.
+ * @return true from the hand-off until crypto_worker_run() has the result
+ */
+bool crypto_worker_busy(void);
+
+/**
+ * Get the time core0 has spent waiting on the worker
+ * Subtract it from the duration of a call that may offload to see how
+ * long that call kept core0 from the network.
+ * @return Microseconds since crypto_worker_init()
+ */
+uint64_t crypto_worker_waited_us(void);
+
+/**
+ * Get operation counters and timings
+ */
+void crypto_worker_get_stats(crypto_worker_stats_t *stats);
+
+/**
+ * Export operation counters and timings in the Prometheus text format
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @return Bytes written (0 if they don't fit)
+ */
+int crypto_worker_format_metrics(char *buffer, size_t size);
+
+#endif // CRYPTO_WORKER_H
@@ -0,0 +1,81 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include "lwip/ip_addr.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * DNS Cache
+ *
+ * Resolver cache in front of lwIP's DNS client, so naming the proxy by
+ * hostname doesn't put a resolution on every request:
+ * - answers stay fresh for DNS_CACHE_TTL_MS
+ * - DNS_CACHE_REFRESH_MS before they expire they are re-resolved in the
+ *   background, while lookups keep getting the cached address
+ * - if re-resolving fails, the expired answer is still served (stale
+ *   while revalidate) for up to DNS_CACHE_STALE_MS
+ *
+ * lwIP's callback doesn't report record TTLs, so ours is fixed; lwIP's
+ * own table (DNS_TABLE_SIZE entries) does honor them, and answers a
+ * refresh from memory while the record is still valid.
+ *
+ * Literal IP addresses are parsed and never cached.
+ */
+
+// Lookup results
+typedef enum {
+    DNS_CACHE_PENDING = 1,          // Resolution in progress; look up again later
+    DNS_CACHE_OK = 0,
+    DNS_CACHE_ERR_NAME = -1,        // Name too long to cache
+    DNS_CACHE_ERR_FULL = -2,        // Every entry is busy resolving
+    DNS_CACHE_ERR_FAILED = -3       // Resolution failed and there is no answer to fall back on
+} dns_cache_result_t;
+
+// Counters (since dns_cache_init())
+typedef struct {
+    uint32_t hits;          // Answered with a fresh address
+    uint32_t stale_hits;    // Answered with an expired address while it refreshes
+    uint32_t misses;        // Had to wait for a resolution
+    uint32_t refreshes;     // Background re-resolutions started
+    uint32_t failures;      // Resolutions that failed or timed out
+} dns_cache_stats_t;
+
+/**
+ * Clear the cache and its counters
+ */
+void dns_cache_init(void);
+
+/**
+ * Resolve a hostname without blocking
+ * A cached address is returned at once, starting a background refresh if
+ * it is due. Otherwise a query is started (if one isn't already running)
+ * and DNS_CACHE_PENDING returned; call again until it settles.
+ * A failure is reported to one lookup, the next one tries again.
+ * @param hostname Name or literal IP address
+ * @param addr Set to the address on DNS_CACHE_OK
+ * @return DNS_CACHE_OK, DNS_CACHE_PENDING or a negative error
+ */
+int dns_cache_lookup(const char *hostname, ip_addr_t *addr);
+
+/**
+ * Start refreshes that are due for names in use
+ * Call from the main loop so answers are renewed before they expire even
+ * if no lookup happens to land in the refresh window.
+ */
+void dns_cache_poll(void);
+
+/**
+ * Get the cache counters
+ */
+const dns_cache_stats_t *dns_cache_get_stats(void);
+
+/**
+ * Export the counters in the Prometheus text format
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @return Bytes written (0 if they don't fit)
+ */
+int dns_cache_format_metrics(char *buffer, size_t size);
+
+#endif // DNS_CACHE_H
@@ -9,16 +9,39 @@
  * HTTP Client Layer
  *
  * Simple HTTP/1.1 client for Kubernetes API communication.
- * Supports GET, POST, and PATCH methods with JSON bodies.
+ * Supports GET, POST, PATCH and PUT methods with JSON (or protobuf) bodies.
  */
 
 // HTTP methods
 typedef enum {
     HTTP_METHOD_GET,
     HTTP_METHOD_POST,
-    HTTP_METHOD_PATCH
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_PUT
 } http_method_t;
 
+// Response headers indexed while parsing
+typedef enum {
+    HTTP_HEADER_DATE,
+    HTTP_HEADER_CONTENT_LENGTH,
+    HTTP_HEADER_TRANSFER_ENCODING,
+    HTTP_HEADER_CONNECTION,
+    HTTP_HEADER_ETAG,
+    HTTP_HEADER_CONTENT_ENCODING,
+    HTTP_HEADER_CONTENT_TYPE,
+    HTTP_HEADER_COUNT,
+    HTTP_HEADER_UNKNOWN = HTTP_HEADER_COUNT
+} http_header_id_t;
+
+// Where each indexed header's value sits in the response buffer
+// Spans run from after the colon to the end of the line; the first of
+// repeated headers wins
+typedef struct {
+    uint16_t offset[HTTP_HEADER_COUNT];  // From the start of the response
+    uint16_t length[HTTP_HEADER_COUNT];
+    uint8_t present;                     // Bit per http_header_id_t
+} http_header_index_t;
+
 // HTTP response structure
 typedef struct {
     int status_code;           // HTTP status code (e.g., 200, 404)
@@ -26,6 +49,7 @@ typedef struct {
     size_t body_length;        // Length of response body
     size_t content_length;     // Content-Length from header
     bool chunked;              // True if Transfer-Encoding: chunked
+    http_header_index_t headers;  // Indexed headers (offsets into the response buffer)
 } http_response_t;
 
 /**
@@ -41,6 +65,7 @@ typedef struct {
  * @param path Request path (e.g., "/api/v1/nodes")
  * @param body Request body (NULL for GET, JSON string for POST/PATCH)
  * @param content_type Content-Type header value (NULL for GET)
+ * @param keep_alive Request a persistent connection instead of Connection: close
  * @return Length of request on success, -1 on error
  */
 int http_build_request(char *buffer, size_t buffer_size,
@@ -48,13 +73,94 @@ int http_build_request(char *buffer, size_t buffer_size,
                       const char *host, uint16_t port,
                       const char *path,
                       const char *body,
-                      const char *content_type);
+                      const char *content_type,
+                      bool keep_alive);
+
+/**
+ * Build the request line and headers of an HTTP request
+ *
+ * Same headers as http_build_request(), without the body, so the body can
+ * be sent from the caller's memory instead of being copied after them.
+ * Callers that can inflate a gzip body may also ask for one.
+ *
+ * @param buffer Buffer to store the request head
+ * @param buffer_size Size of buffer
+ * @param method HTTP method (GET, POST, PATCH, PUT)
+ * @param host Hostname (for Host header)
+ * @param port Port number
+ * @param path Request path (e.g., "/api/v1/nodes")
+ * @param content_type Content-Type header value (NULL for application/json)
+ * @param accept Accept header value (NULL for application/json)
+ * @param content_length Body length, or -1 for a request without a body
+ * @param keep_alive Request a persistent connection instead of Connection: close
+ * @param accept_gzip Send Accept-Encoding: gzip
+ * @return Length of request head on success, -1 on error
+ */
+int http_build_request_head(char *buffer, size_t buffer_size,
+                           http_method_t method,
+                           const char *host, uint16_t port,
+                           const char *path,
+                           const char *content_type,
+                           const char *accept,
+                           long content_length,
+                           bool keep_alive,
+                           bool accept_gzip);
+
+// Room for "Host: <host>:<port>" and the User-Agent line
+#define HTTP_HEADER_BLOCK_SIZE 128
+
+// Request headers that are identical on every request to one server,
+// rendered once so each request only copies them
+typedef struct {
+    char data[HTTP_HEADER_BLOCK_SIZE];  // Host and User-Agent lines, CRLF-terminated
+    size_t length;                      // 0 if not initialized
+} http_header_block_t;
+
+/**
+ * Render the constant request headers for a server
+ *
+ * @param block Block to fill
+ * @param host Hostname (for Host header)
+ * @param port Port number
+ * @return 0 on success, -1 if the host doesn't fit
+ */
+int http_header_block_init(http_header_block_t *block, const char *host, uint16_t port);
+
+/**
+ * Build the request line and headers of an HTTP request from a header block
+ *
+ * Same output as http_build_request_head() for the block's host and port,
+ * but only the request line, Accept, Connection, Content-Type and
+ * Content-Length are written per call, without going through printf.
+ *
+ * @param buffer Buffer to store the request head
+ * @param buffer_size Size of buffer
+ * @param headers Block from http_header_block_init()
+ * @param method HTTP method (GET, POST, PATCH, PUT)
+ * @param path Request path (e.g., "/api/v1/nodes")
+ * @param content_type Content-Type header value (NULL for application/json)
+ * @param accept Accept header value (NULL for application/json)
+ * @param content_length Body length, or -1 for a request without a body
+ * @param keep_alive Request a persistent connection instead of Connection: close
+ * @param accept_gzip Send Accept-Encoding: gzip
+ * @return Length of request head on success, -1 on error
+ */
+int http_build_request_head_cached(char *buffer, size_t buffer_size,
+                                  const http_header_block_t *headers,
+                                  http_method_t method,
+                                  const char *path,
+                                  const char *content_type,
+                                  const char *accept,
+                                  long content_length,
+                                  bool keep_alive,
+                                  bool accept_gzip);
 
 /**
  * Parse HTTP response
  *
  * Parses an HTTP response and extracts status code, headers, and body.
- * This modifies the response buffer (inserts null terminators).
+ * This modifies the response buffer (inserts null terminators). A chunked
+ * body is decoded in place, so body/body_length cover only the payload.
  *
  * @param response_buffer Raw response data
  * @param response_length Length of response data
@@ -84,4 +190,162 @@ const char* http_status_string(int status_code);
 int http_get_header(const char *response_buffer, const char *header_name,
                    char *value_buffer, size_t value_buffer_size);
 
+/**
+ * Identify an indexed header by name
+ *
+ * One hash of the length and first/last characters picks the only
+ * candidate, which is then confirmed with a case-insensitive compare.
+ *
+ * @param name Header name (case-insensitive, need not be NUL-terminated)
+ * @param length Length of name
+ * @return Header id, or HTTP_HEADER_UNKNOWN
+ */
+http_header_id_t http_header_lookup(const char *name, size_t length);
+
+/**
+ * Find an indexed header value
+ *
+ * @param index Index filled by http_parse_response() or the framer
+ * @param response_buffer Buffer the index was built over
+ * @param id Header to find
+ * @param length Set to the value length, surrounding whitespace trimmed
+ * @return Start of the value in response_buffer, or NULL if not present
+ */
+const char *http_header_find(const http_header_index_t *index, const char *response_buffer,
+                             http_header_id_t id, size_t *length);
+
+/**
+ * Copy an indexed header value, like http_get_header() without the scan
+ *
+ * @param index Index filled by http_parse_response() or the framer
+ * @param response_buffer Buffer the index was built over
+ * @param id Header to copy
+ * @param value_buffer Buffer to store header value (truncated to fit)
+ * @param value_buffer_size Size of value buffer
+ * @return 0 on success, -1 if header not found
+ */
+int http_header_copy(const http_header_index_t *index, const char *response_buffer,
+                     http_header_id_t id, char *value_buffer, size_t value_buffer_size);
+
+// Incremental response framer state
+typedef enum {
+    HTTP_FRAMER_STATUS_VERSION,     // "HTTP/1.1"
+    HTTP_FRAMER_STATUS_CODE,        // "200"
+    HTTP_FRAMER_STATUS_REASON,      // " OK\r\n"
+    HTTP_FRAMER_HEADER_START,       // Start of a header line, or the blank line
+    HTTP_FRAMER_HEADER_NAME,
+    HTTP_FRAMER_HEADER_VALUE,
+    HTTP_FRAMER_HEADERS_END,        // CR of the blank line seen
+    HTTP_FRAMER_BODY_LENGTH,        // Content-Length delimited body
+    HTTP_FRAMER_BODY_CLOSE,         // Body runs until the connection closes
+    HTTP_FRAMER_CHUNK_SIZE,
+    HTTP_FRAMER_CHUNK_EXT,          // Chunk extension, skipped up to LF
+    HTTP_FRAMER_CHUNK_DATA,
+    HTTP_FRAMER_CHUNK_DATA_END,     // CRLF after chunk data
+    HTTP_FRAMER_TRAILER_START,
+    HTTP_FRAMER_TRAILER_LINE,
+    HTTP_FRAMER_DONE,
+    HTTP_FRAMER_ERROR
+} http_framer_state_t;
+
+// Result of one http_framer_feed() call
+typedef enum {
+    HTTP_FRAME_NEED_MORE,   // All input consumed, message not finished
+    HTTP_FRAME_HEADERS,     // Status line and headers are complete
+    HTTP_FRAME_BODY,        // A span of body bytes is available
+    HTTP_FRAME_COMPLETE,    // The message is complete
+    HTTP_FRAME_ERROR        // Malformed response
+} http_frame_event_t;
+
+/**
+ * Resumable HTTP/1.1 response framer
+ *
+ * Looks at each received byte exactly once, whatever the read sizes, and
+ * finds end of headers, Content-Length and the end of the body without
+ * rescanning earlier data. Chunked framing is stripped, so body spans
+ * contain only payload bytes.
+ */
+typedef struct {
+    http_framer_state_t state;
+    int status_code;
+    long content_length;        // -1 if not sent
+    bool chunked;               // Transfer-Encoding: chunked
+    bool connection_close;      // Connection: close
+    bool gzip;                  // Content-Encoding: gzip (body left compressed)
+    size_t header_length;       // Bytes of status line and headers
+    size_t remaining;           // Bytes left in the body or current chunk
+    http_header_index_t headers;  // Indexed headers, offsets into the bytes fed
+    uint16_t value_start;       // Offset of the current header's value
+    uint8_t header_id;          // Header currently being parsed (http_header_id_t)
+    uint8_t name_len;
+    uint8_t value_len;
+    bool size_digits;           // At least one chunk-size digit seen
+    char name[24];              // Header name, truncated
+    char value[16];             // Value of a tracked header, truncated
+} http_framer_t;
+
+/**
+ * Reset a framer for a new response
+ *
+ * @param framer Framer to initialize
+ */
+void http_framer_init(http_framer_t *framer);
+
+/**
+ * Feed received bytes to the framer
+ *
+ * Consumes input up to the next event. Call again with the remaining
+ * bytes until it returns HTTP_FRAME_NEED_MORE, HTTP_FRAME_COMPLETE or
+ * HTTP_FRAME_ERROR.
+ *
+ * @param framer Framer state
+ * @param data Received bytes
+ * @param length Number of bytes
+ * @param consumed Set to the number of input bytes used
+ * @param body Set to the body span for HTTP_FRAME_BODY (points into data)
+ * @param body_length Set to the length of the body span
+ * @return Event describing what was found
+ */
+http_frame_event_t http_framer_feed(http_framer_t *framer,
+                                    const char *data, size_t length,
+                                    size_t *consumed,
+                                    const char **body, size_t *body_length);
+
+/**
+ * Reset a framer to decode a chunked body directly
+ *
+ * For callers that parsed the headers themselves; the first byte fed is
+ * the first chunk-size digit.
+ *
+ * @param framer Framer to initialize
+ */
+void http_framer_init_chunked(http_framer_t *framer);
+
+/**
+ * Strip body framing in place
+ *
+ * Runs data through the framer and moves the payload down over the
+ * framing (chunk-size lines, chunk CRLFs, trailers), so data[0..*decoded)
+ * holds only body bytes. Resumable: state carries over between calls, so
+ * a chunk-size line or CRLF split across two reads decodes correctly.
+ * Response headers, if the framer starts at the status line, are dropped.
+ *
+ * @param framer Framer state
+ * @param data Received bytes, overwritten with the decoded payload
+ * @param length Number of bytes
+ * @param decoded Set to the number of payload bytes now at data
+ * @return HTTP_FRAME_COMPLETE at the end of the message (bytes after it are
+ *         left undecoded), HTTP_FRAME_NEED_MORE, or HTTP_FRAME_ERROR
+ */
+http_frame_event_t http_framer_dechunk(http_framer_t *framer, char *data, size_t length,
+                                       size_t *decoded);
+
+/**
+ * Finish a response whose connection was closed by the server
+ *
+ * @param framer Framer state
+ * @return true if the close ends a complete message
+ */
+bool http_framer_finish(http_framer_t *framer);
+
 #endif // HTTP_CLIENT_H
@@ -0,0 +1,118 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Streaming gzip Inflater
+ *
+ * Compact DEFLATE decoder for Content-Encoding: gzip responses. Input is
+ * pushed in whatever pieces the network delivers and inflated output is
+ * handed to a callback, so neither side is ever buffered whole. Memory is
+ * fixed: the history window plus about 1KB of Huffman tables, with no
+ * allocation.
+ *
+ * The window is smaller than DEFLATE's 32KB maximum. Streams must be
+ * compressed with at most INFLATE_WINDOW_BITS of history (nginx:
+ * gzip_window); a back-reference beyond it fails with INFLATE_ERR_WINDOW
+ * so the caller can stop asking for gzip.
+ */
+
+#ifndef INFLATE_WINDOW_BITS
+#define INFLATE_WINDOW_BITS 13      // 8KB history (nginx gzip_window 8k)
+#endif
+#define INFLATE_WINDOW_SIZE (1u << INFLATE_WINDOW_BITS)
+
+// Inflate progress and errors
+typedef enum {
+    INFLATE_DONE = 1,               // Stream complete and verified
+    INFLATE_NEED_MORE = 0,          // All input consumed, stream not finished
+    INFLATE_ERR_DATA = -1,          // Corrupt or unsupported stream
+    INFLATE_ERR_WINDOW = -2,        // Back-reference beyond INFLATE_WINDOW_SIZE
+    INFLATE_ERR_CHECKSUM = -3,      // CRC32 or length mismatch in the trailer
+    INFLATE_ERR_ABORTED = -4        // Output callback asked to stop
+} inflate_result_t;
+
+/**
+ * Output callback for inflated data
+ * @param data Inflated bytes (valid only during the call)
+ * @param length Number of bytes
+ * @param user_data Pointer passed to gzip_inflate_init()
+ * @return 0 to continue, nonzero to abort
+ */
+typedef int (*inflate_output_fn)(const uint8_t *data, size_t length, void *user_data);
+
+// Canonical Huffman decoding table
+typedef struct {
+    uint16_t counts[16];            // Codes of each bit length
+    uint16_t symbols[288];          // Symbols ordered by code
+} inflate_huffman_t;
+
+// Distance and code-length tables need far fewer symbols
+typedef struct {
+    uint16_t counts[16];
+    uint16_t symbols[32];
+} inflate_huffman_small_t;
+
+// Inflater state (treat as opaque)
+typedef struct {
+    uint8_t state;
+    uint8_t gzip_flags;
+    uint16_t count;                 // Progress within the current state
+    uint16_t remaining;             // Bytes left in a stored block or header field
+    bool final_block;
+    bool fixed_tables;              // Tables currently hold the fixed code
+
+    // Bit reader; holds at most a few bytes between feeds
+    uint64_t bitbuf;
+    uint8_t bitcount;
+    const uint8_t *in;
+    const uint8_t *in_end;
+
+    // Dynamic block header
+    uint16_t hlit;
+    uint16_t hdist;
+    uint16_t hclen;
+    uint8_t lengths[288 + 32];
+
+    inflate_huffman_t litlen;
+    inflate_huffman_small_t dist;   // Also holds the code-length code
+
+    // History window; doubles as the output buffer
+    uint8_t window[INFLATE_WINDOW_SIZE];
+    uint32_t total_out;
+    uint32_t flushed;
+    uint32_t crc;
+
+    inflate_output_fn output;
+    void *user_data;
+} gzip_inflater_t;
+
+/**
+ * Prepare an inflater for a new gzip stream
+ * @param z Inflater state
+ * @param output Receives inflated data
+ * @param user_data Passed to output
+ */
+void gzip_inflate_init(gzip_inflater_t *z, inflate_output_fn output, void *user_data);
+
+/**
+ * Feed compressed bytes
+ * Inflated data is delivered to the output callback before this returns.
+ * @param z Inflater state
+ * @param data Compressed bytes
+ * @param length Number of bytes
+ * @return INFLATE_NEED_MORE, INFLATE_DONE or an error
+ */
+inflate_result_t gzip_inflate_feed(gzip_inflater_t *z, const uint8_t *data, size_t length);
+
+/**
+ * Get error description
+ * @param result Inflate result
+ * @return Human-readable description
+ */
+const char *inflate_result_string(inflate_result_t result);
+
+#endif // INFLATE_H
@@ -9,9 +9,97 @@
  *
  * Architecture: Pico (HTTP) -> nginx proxy (TLS) -> k3s API
  *
+ * Built with K3S_USE_TLS (cmake -DK3S_TLS=ON) it skips the proxy and talks
+ * mTLS to the API server itself. The handshake and record I/O run in the
+ * same non-blocking state machine, one handshake serves every request on a
+ * pooled connection, and reconnects resume the cached TLS session (see
+ * tls_context.h).
+ *
+ * Requests share a small pool of HTTP/1.1 keep-alive connections to the
+ * proxy, so the periodic heartbeat doesn't pay a TCP handshake every time.
+ *
+ * Requests run as a non-blocking state machine advanced by k3s_client_poll()
+ * from the main loop. k3s_client_submit() queues a request and reports the
+ * outcome through a completion callback; k3s_client_get/post/patch are
+ * blocking wrappers for startup code.
+ *
+ * Only response headers are buffered. Body bytes are handed to a consumer
+ * callback as they come off the socket, so response size isn't bounded by
+ * a fixed buffer. Request bodies go to lwIP by reference next to the
+ * serialized headers, so their size isn't limited by a request buffer.
+ *
+ * Request and response-header buffers come from a static per-slot arena
+ * rather than the heap; k3s_client_get_memory_stats() reports how much of
+ * it is actually used.
+ *
+ * Each API endpoint has its own retry policy (backoff, circuit breaker)
+ * and all of them share a retry budget. While an endpoint is failing,
+ * k3s_client_submit() refuses requests until the policy allows the next
+ * attempt, instead of reconnecting on every main loop tick.
+ *
+ * GETs ask for gzip (K3S_ACCEPT_GZIP) and are inflated on the fly, so body
+ * callbacks always see plain JSON. The proxy must compress with an 8KB
+ * window (see inflate.h and docs/k3s-proxy.conf). With K3S_USE_TLS there
+ * is no proxy, and Go's gzip needs a 32KB window, so gzip is off.
+ *
+ * Every request that gets a response is timed phase by phase (DNS,
+ * connect, send, time to first byte, body) into per-endpoint histograms,
+ * see latency.h; k3s_client_format_latency() exports them for /metrics.
+ *
+ * Callers may name a media type per request (k3s_client_submit_media()),
+ * e.g. the Kubernetes protobuf encoding; it is sent as both Content-Type
+ * and Accept. Without one, requests and responses are JSON.
+ *
  * Provides functions to interact with Kubernetes API
  */
 
+#include "http_client.h"
+#include "retry_policy.h"
+#include "latency.h"
+#include "pico/stdlib.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Request memory usage, for monitoring
+typedef struct {
+    size_t arena_size;          // Static bytes reserved per request slot
+    size_t arena_high_water;    // Most bytes any request has needed
+    int slots_total;
+    int slots_in_use;
+    int slots_high_water;       // Most requests in flight at once
+    uint32_t alloc_failures;    // Arena allocations that didn't fit
+} k3s_memory_stats_t;
+
+// API endpoints with separate retry policies
+typedef enum {
+    K3S_ENDPOINT_NODE_STATUS,   // PATCH or PUT /api/v1/nodes/{name}/status
+    K3S_ENDPOINT_CONFIGMAP,     // GET .../configmaps/{name}
+    K3S_ENDPOINT_REGISTER,      // POST /api/v1/nodes
+    K3S_ENDPOINT_OTHER,
+    K3S_ENDPOINT_COUNT
+} k3s_endpoint_t;
+
+// Handle for an asynchronous request
+typedef int k3s_handle_t;
+#define K3S_INVALID_HANDLE (-1)
+
+/**
+ * Body consumer callback, called for each piece of a successful response body
+ * @param data Body bytes (not NUL-terminated, valid only during the callback)
+ * @param length Number of bytes
+ * @param user_data Pointer passed to k3s_client_submit()
+ * @return 0 to continue, nonzero to abort the request
+ */
+typedef int (*k3s_body_cb_t)(const char *data, size_t length, void *user_data);
+
+/**
+ * Completion callback for asynchronous requests
+ * @param result 0 on success, -1 on transport or HTTP error
+ * @param status_code HTTP status code, or 0 if no response was received
+ * @param user_data Pointer passed to k3s_client_submit()
+ */
+typedef void (*k3s_response_cb_t)(int result, int status_code, void *user_data);
+
 /**
  * Initialize the k3s client
  * Returns 0 on success, -1 on error
@@ -19,16 +107,79 @@
 int k3s_client_init(void);
 
 /**
- * Send a GET request to k3s API server
+ * Queue an asynchronous request to the k3s API server
+ * The body is sent from the caller's memory without being copied, so it
+ * must stay valid and unchanged until on_complete runs (or the request is
+ * cancelled). The path is serialized immediately.
+ * @param method HTTP method
+ * @param path API path
+ * @param body JSON body (NULL for GET)
+ * @param on_body Receives the response body as it arrives (NULL to discard)
+ * @param on_complete Called once when the request completes or fails
+ * @param user_data Passed through to both callbacks
+ * @return Request handle, or K3S_INVALID_HANDLE if it couldn't be queued
+ *         or the endpoint's retry policy is holding it back
+ */
+k3s_handle_t k3s_client_submit(http_method_t method, const char *path, const char *body,
+                               k3s_body_cb_t on_body, k3s_response_cb_t on_complete,
+                               void *user_data);
+
+/**
+ * Queue an asynchronous request with an explicit media type and body length
+ * Same as k3s_client_submit(), for bodies that aren't NUL-terminated JSON.
+ * @param method HTTP method
+ * @param path API path
+ * @param media_type Content-Type of the body and Accept of the response
+ *                   (NULL for the JSON defaults of k3s_client_submit())
+ * @param body Request body (NULL for GET)
+ * @param body_len Length of body in bytes
+ * @param on_body Receives the response body as it arrives (NULL to discard)
+ * @param on_complete Called once when the request completes or fails
+ * @param user_data Passed through to both callbacks
+ * @return Request handle, or K3S_INVALID_HANDLE if it couldn't be queued
+ *         or the endpoint's retry policy is holding it back
+ */
+k3s_handle_t k3s_client_submit_media(http_method_t method, const char *path,
+                                     const char *media_type,
+                                     const void *body, size_t body_len,
+                                     k3s_body_cb_t on_body, k3s_response_cb_t on_complete,
+                                     void *user_data);
+
+/**
+ * Check whether an asynchronous request is still in flight
+ * @param handle Handle from k3s_client_submit()
+ * @return true until the completion callback has run
+ */
+bool k3s_client_is_pending(k3s_handle_t handle);
+
+/**
+ * Abandon an asynchronous request without running its callback
+ * @param handle Handle from k3s_client_submit()
+ */
+void k3s_client_cancel(k3s_handle_t handle);
+
+/**
+ * Send a GET request to k3s API server (blocking)
  * @param path API path (e.g., "/api/v1/nodes")
- * @param response Buffer to store response
+ * @param response Buffer to store response (truncated if too small)
  * @param response_size Size of response buffer
  * @return 0 on success, -1 on error
  */
 int k3s_client_get(const char *path, char *response, int response_size);
 
 /**
- * Send a POST request to k3s API server
+ * Send a GET request and stream the body to a callback (blocking)
+ * @param path API path
+ * @param media_type Accept header value (NULL for application/json)
+ * @param on_body Receives the response body as it arrives
+ * @param user_data Passed through to on_body
+ * @return 0 on success, -1 on error
+ */
+int k3s_client_get_stream(const char *path, const char *media_type,
+                          k3s_body_cb_t on_body, void *user_data);
+
+/**
+ * Send a POST request to k3s API server (blocking)
  * @param path API path
  * @param body JSON body to send
  * @return 0 on success, -1 on error
@@ -36,13 +187,82 @@ int k3s_client_get(const char *path, char *response, int response_size);
 int k3s_client_post(const char *path, const char *body);
 
 /**
- * Send a PATCH request to k3s API server
+ * Send a PATCH request to k3s API server (blocking)
  * @param path API path
  * @param body JSON body to send
  * @return 0 on success, -1 on error
  */
 int k3s_client_patch(const char *path, const char *body);
 
+/**
+ * Send a PUT request to k3s API server (blocking)
+ * @param path API path
+ * @param media_type Content-Type of the body (NULL for application/json)
+ * @param body Body to send
+ * @param body_len Length of body in bytes
+ * @return 0 on success, -1 on error
+ */
+int k3s_client_put(const char *path, const char *media_type, const void *body, size_t body_len);
+
+/**
+ * Advance asynchronous requests and service the connection pool
+ * Runs completion callbacks and closes keep-alive connections that went
+ * idle or were closed by the proxy. Call on every main loop iteration.
+ */
+void k3s_client_poll(void);
+
+/**
+ * Time by which k3s_client_poll() must run again
+ * Request and connect timeouts and the keep-alive idle timeout; progress
+ * on the network itself wakes the caller through net_wait_until().
+ * @return Earliest deadline, or at_the_end_of_time if nothing is pending
+ */
+absolute_time_t k3s_client_next_deadline(void);
+
+/**
+ * Report request memory usage
+ * @param stats Filled with arena and slot usage
+ */
+void k3s_client_get_memory_stats(k3s_memory_stats_t *stats);
+
+/**
+ * Get the retry policy state of an endpoint, for monitoring
+ * @param endpoint Endpoint to query
+ * @return Policy state (circuit, next attempt, failure counts)
+ */
+const retry_policy_t *k3s_client_get_retry_state(k3s_endpoint_t endpoint);
+
+/**
+ * Get the retry budget shared by all endpoints, for monitoring
+ * @return Budget state
+ */
+const retry_budget_t *k3s_client_get_retry_budget(void);
+
+/**
+ * Get the latency histogram of one phase of an endpoint's requests
+ * @param endpoint Endpoint to query
+ * @param phase Request phase
+ * @return Histogram, or NULL if either argument is out of range
+ */
+const latency_histogram_t *k3s_client_get_latency(k3s_endpoint_t endpoint, latency_phase_t phase);
+
+// Cursor value once k3s_client_format_latency() has written everything
+#define K3S_LATENCY_DONE 0xFFFFFFFFu
+
+/**
+ * Export the latency histograms in the Prometheus text format, in pieces
+ * Writes as many whole lines as fit and advances the cursor past them, so
+ * the output can be streamed through a small buffer. Histograms that are
+ * still empty are left out. A request finishing mid-export can leave one
+ * histogram a sample out of step with itself; the next scrape catches up.
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @param cursor Position to resume from; start at 0, K3S_LATENCY_DONE
+ *               once everything has been written
+ * @return Bytes written (0 if not even the next line fits)
+ */
+int k3s_client_format_latency(char *buffer, size_t size, uint32_t *cursor);
+
 /**
  * Cleanup k3s client resources
  */
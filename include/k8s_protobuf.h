@@ -0,0 +1,265 @@
+#ifndef K8S_PROTOBUF_H
+#define K8S_PROTOBUF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Kubernetes Protobuf Wire Format
+ *
+ * Just enough protobuf for the objects this node exchanges with the API
+ * server (Content-Type application/vnd.kubernetes.protobuf):
+ *
+ * - A writer that serializes straight into a caller buffer, with nested
+ *   message lengths patched in afterwards (no sizing pass, no allocation)
+ * - An encoder for the Node status update
+ * - A streaming decoder that walks any object as it arrives and hands the
+ *   fields the caller asks for to callbacks (used for ConfigMap and Lease)
+ *
+ * Every body is the 4-byte magic "k8s\0" followed by a runtime.Unknown
+ * whose raw field holds the serialized object. Field numbers below come
+ * from k8s.io/api/core/v1, coordination/v1 and apimachinery generated.proto.
+ */
+
+#define K8S_PROTOBUF_MEDIA_TYPE "application/vnd.kubernetes.protobuf"
+#define K8S_PROTOBUF_MAGIC      "k8s\0"
+#define K8S_PROTOBUF_MAGIC_LEN  4
+
+// --- Field numbers (generated.proto) ---
+
+// runtime.Unknown / runtime.TypeMeta
+#define K8S_PB_UNKNOWN_TYPE_META         1
+#define K8S_PB_UNKNOWN_RAW               2
+#define K8S_PB_TYPE_META_API_VERSION     1
+#define K8S_PB_TYPE_META_KIND            2
+
+// meta/v1 ObjectMeta, Time, MicroTime
+#define K8S_PB_META_NAME                 1
+#define K8S_PB_META_NAMESPACE            3
+#define K8S_PB_META_RESOURCE_VERSION     6
+#define K8S_PB_TIME_SECONDS              1
+#define K8S_PB_TIME_NANOS                2
+
+// map<K, V> entries
+#define K8S_PB_MAP_KEY                   1
+#define K8S_PB_MAP_VALUE                 2
+
+// core/v1 Node, NodeStatus and friends
+#define K8S_PB_NODE_METADATA             1
+#define K8S_PB_NODE_STATUS               3
+#define K8S_PB_NODE_STATUS_CAPACITY      1
+#define K8S_PB_NODE_STATUS_ALLOCATABLE   2
+#define K8S_PB_NODE_STATUS_CONDITIONS    4
+#define K8S_PB_NODE_STATUS_ADDRESSES     5
+#define K8S_PB_NODE_STATUS_DAEMON_EP     6
+#define K8S_PB_NODE_STATUS_NODE_INFO     7
+#define K8S_PB_CONDITION_TYPE            1
+#define K8S_PB_CONDITION_STATUS          2
+#define K8S_PB_CONDITION_HEARTBEAT       3
+#define K8S_PB_CONDITION_TRANSITION      4
+#define K8S_PB_CONDITION_REASON          5
+#define K8S_PB_CONDITION_MESSAGE         6
+#define K8S_PB_ADDRESS_TYPE              1
+#define K8S_PB_ADDRESS_ADDRESS           2
+#define K8S_PB_DAEMON_EP_KUBELET         1
+#define K8S_PB_DAEMON_EP_PORT            1
+#define K8S_PB_QUANTITY_STRING           1
+#define K8S_PB_NODE_INFO_MACHINE_ID      1   // Fields 1-10 in order, see encoder
+
+// core/v1 ConfigMap
+#define K8S_PB_CONFIGMAP_METADATA        1
+#define K8S_PB_CONFIGMAP_DATA            2
+
+// coordination/v1 Lease
+#define K8S_PB_LEASE_METADATA            1
+#define K8S_PB_LEASE_SPEC                2
+#define K8S_PB_LEASE_HOLDER_IDENTITY     1
+#define K8S_PB_LEASE_DURATION_SECONDS    2
+#define K8S_PB_LEASE_ACQUIRE_TIME        3
+#define K8S_PB_LEASE_RENEW_TIME          4
+#define K8S_PB_LEASE_TRANSITIONS         5
+
+// --- Writer ---
+
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t length;
+    bool overflow;              // Ran out of space; length is meaningless
+} pb_writer_t;
+
+/**
+ * Start writing into a buffer
+ * @param w Writer
+ * @param buffer Output buffer
+ * @param size Size of buffer
+ */
+void pb_writer_init(pb_writer_t *w, uint8_t *buffer, size_t size);
+
+/**
+ * Write a varint field (int32, int64, bool, enum)
+ * @param w Writer
+ * @param field Field number
+ * @param value Value (negative int32/int64 values are sign-extended)
+ */
+void pb_write_varint(pb_writer_t *w, uint32_t field, uint64_t value);
+
+/**
+ * Write a string or bytes field
+ * @param w Writer
+ * @param field Field number
+ * @param data Bytes to write
+ * @param length Number of bytes
+ */
+void pb_write_bytes(pb_writer_t *w, uint32_t field, const void *data, size_t length);
+
+/**
+ * Write a NUL-terminated string field
+ * @param w Writer
+ * @param field Field number
+ * @param value String (NULL writes nothing)
+ */
+void pb_write_string(pb_writer_t *w, uint32_t field, const char *value);
+
+/**
+ * Open a nested message field
+ * @param w Writer
+ * @param field Field number
+ * @return Mark to pass to pb_end_message()
+ */
+size_t pb_begin_message(pb_writer_t *w, uint32_t field);
+
+/**
+ * Close the most recently opened nested message
+ * A one-byte length is reserved up front; longer messages are moved up
+ * to make room for their length.
+ * @param w Writer
+ * @param mark Value returned by pb_begin_message()
+ */
+void pb_end_message(pb_writer_t *w, size_t mark);
+
+// --- Node status ---
+
+// Per-node values of the status update; everything else is fixed
+typedef struct {
+    const char *name;
+    const char *internal_ip;
+    const char *hostname;
+    int64_t heartbeat_time;     // Unix seconds
+    int64_t transition_time;    // Unix seconds
+    int32_t kubelet_port;
+} k8s_node_status_t;
+
+/**
+ * Encode the Node sent with PUT /api/v1/nodes/{name}/status
+ * Carries the same status as the JSON patch in node_status.c. The API
+ * server keeps spec and metadata from the stored Node on a status update.
+ * @param buffer Output buffer
+ * @param size Size of buffer
+ * @param status Per-node values
+ * @return Encoded length, or -1 if the buffer is too small
+ */
+int k8s_pb_encode_node_status(uint8_t *buffer, size_t size, const k8s_node_status_t *status);
+
+// --- Streaming decoder ---
+
+#define K8S_PB_MAX_DEPTH 8
+
+// Decoder results
+#define K8S_PB_OK        0
+#define K8S_PB_ERROR    -1      // Malformed, or nested too deep
+#define K8S_PB_ABORTED  -2      // A callback returned nonzero
+
+typedef struct k8s_pb_decoder k8s_pb_decoder_t;
+
+// Field callbacks; d->path[0..d->depth-1] holds the enclosing fields
+typedef struct {
+    // A length-delimited field starts: return true to decode it as a
+    // nested message, false to receive it through bytes()
+    bool (*enter)(k8s_pb_decoder_t *d, uint32_t field);
+
+    // A piece of a string/bytes field; last is set on the final piece
+    // (an empty field gets one call with length 0)
+    int (*bytes)(k8s_pb_decoder_t *d, uint32_t field,
+                 const uint8_t *data, size_t length, bool last);
+
+    // A varint field
+    int (*varint)(k8s_pb_decoder_t *d, uint32_t field, uint64_t value);
+} k8s_pb_handlers_t;
+
+struct k8s_pb_decoder {
+    const k8s_pb_handlers_t *handlers;
+    void *user_data;
+
+    uint8_t state;
+    uint8_t depth;
+    uint8_t shift;
+    uint8_t wire_type;
+    uint32_t field;
+    uint64_t varint;
+    uint32_t offset;            // Bytes consumed after the magic
+    uint32_t remaining;         // Bytes left in the current field
+    uint32_t path[K8S_PB_MAX_DEPTH];
+    uint32_t ends[K8S_PB_MAX_DEPTH];
+};
+
+/**
+ * Prepare a decoder for a new object (magic prefix expected)
+ * @param d Decoder
+ * @param handlers Field callbacks (any may be NULL)
+ * @param user_data Available to callbacks as d->user_data
+ */
+void k8s_pb_decoder_init(k8s_pb_decoder_t *d, const k8s_pb_handlers_t *handlers,
+                         void *user_data);
+
+/**
+ * Feed the next piece of the body
+ * @param d Decoder
+ * @param data Body bytes
+ * @param length Number of bytes
+ * @return K8S_PB_OK, K8S_PB_ERROR or K8S_PB_ABORTED
+ */
+int k8s_pb_feed(k8s_pb_decoder_t *d, const uint8_t *data, size_t length);
+
+/**
+ * Check that the body ended on a field boundary with no message left open
+ * @param d Decoder
+ * @return true if the object was complete
+ */
+bool k8s_pb_finish(const k8s_pb_decoder_t *d);
+
+// --- ConfigMap ---
+
+// Pulls one data[key] value out of a streamed ConfigMap
+typedef struct {
+    k8s_pb_decoder_t decoder;
+    const char *key;
+    size_t key_matched;         // Bytes of the current entry's key matched
+    bool key_match;             // Current entry's key is the one wanted
+    char *value;
+    size_t value_size;
+    size_t value_len;
+    bool found;
+} k8s_pb_configmap_t;
+
+/**
+ * Prepare to extract data[key] from a ConfigMap
+ * @param cm Extractor state
+ * @param key Data key to look for
+ * @param value Receives the value, NUL-terminated and truncated to fit
+ * @param value_size Size of value
+ */
+void k8s_pb_configmap_init(k8s_pb_configmap_t *cm, const char *key,
+                           char *value, size_t value_size);
+
+/**
+ * Feed the next piece of a protobuf ConfigMap body
+ * @param cm Extractor state
+ * @param data Body bytes
+ * @param length Number of bytes
+ * @return K8S_PB_OK or K8S_PB_ERROR
+ */
+int k8s_pb_configmap_feed(k8s_pb_configmap_t *cm, const uint8_t *data, size_t length);
+
+#endif // K8S_PROTOBUF_H
@@ -6,7 +6,7 @@
  *
  * Implements minimal kubelet endpoints required for k3s:
  * - GET /healthz - Health check endpoint
- * - GET /metrics - Prometheus metrics endpoint (minimal)
+ * - GET /metrics - Prometheus metrics endpoint (k3s API request latency)
  *
  * Runs on port 10250 (KUBELET_PORT)
  */
@@ -0,0 +1,91 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Latency Histograms
+ *
+ * Fixed-bucket histograms of how long each phase of an API request takes
+ * (DNS, TCP connect, send, time to first byte, body transfer), so a slow
+ * heartbeat can be pinned on the phase that was slow. Recording is a
+ * bucket search and three adds; nothing is allocated.
+ *
+ * Histograms export in the Prometheus text format one line at a time, so
+ * the kubelet server can stream them as send buffer space frees up.
+ *
+ * Pure logic: durations are passed in, so it runs on the host.
+ */
+
+// Request phases
+typedef enum {
+    LATENCY_PHASE_DNS,          // Resolving the proxy address (new connections)
+    LATENCY_PHASE_CONNECT,      // TCP handshake (new connections)
+    LATENCY_PHASE_SEND,         // Connection ready until the request is queued
+    LATENCY_PHASE_TTFB,         // Request queued until the first response byte
+    LATENCY_PHASE_BODY,         // First response byte until the response ends
+    LATENCY_PHASE_TOTAL,        // Submitted until completed
+    LATENCY_PHASE_COUNT
+} latency_phase_t;
+
+// Bucket upper bounds in ms; the last bucket (+Inf) catches the rest
+#define LATENCY_BUCKET_BOUNDS_MS { 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 }
+#define LATENCY_BUCKETS 12
+
+// Lines per histogram in the text format: buckets, _sum and _count
+#define LATENCY_LINES (LATENCY_BUCKETS + 2)
+
+typedef struct {
+    uint32_t buckets[LATENCY_BUCKETS];  // Samples per bucket (not cumulative)
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+} latency_histogram_t;
+
+/**
+ * Empty a histogram
+ * @param h Histogram
+ */
+void latency_reset(latency_histogram_t *h);
+
+/**
+ * Add one sample
+ * @param h Histogram
+ * @param duration_us Duration in microseconds
+ */
+void latency_record(latency_histogram_t *h, uint32_t duration_us);
+
+/**
+ * Estimate a percentile from the buckets
+ * @param h Histogram
+ * @param percent Percentile (1-100)
+ * @return Upper bound in ms of the bucket holding the percentile (the
+ *         maximum seen if it falls in the +Inf bucket), 0 if empty
+ */
+uint32_t latency_percentile_ms(const latency_histogram_t *h, unsigned percent);
+
+/**
+ * Get the name of a phase, as used in the "phase" label
+ * @param phase Phase
+ * @return Name string
+ */
+const char *latency_phase_name(latency_phase_t phase);
+
+/**
+ * Format one line of a histogram in the Prometheus text format
+ * Lines 0 to LATENCY_BUCKETS-1 are the cumulative buckets, followed by
+ * _sum (seconds) and _count.
+ * @param buffer Output buffer
+ * @param size Size of buffer
+ * @param metric Metric name, e.g. "k3s_request_duration_seconds"
+ * @param labels Label pairs without braces, e.g. "endpoint=\"configmap\""
+ * @param h Histogram
+ * @param line Line number (0 to LATENCY_LINES-1)
+ * @return Length written (excluding the NUL), or -1 if the line doesn't
+ *         fit or is out of range
+ */
+int latency_format_line(char *buffer, size_t size, const char *metric, const char *labels,
+                        const latency_histogram_t *h, int line);
+
+#endif // LATENCY_H
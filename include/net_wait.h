@@ -0,0 +1,24 @@
+#ifndef NET_WAIT_H
+#define NET_WAIT_H
+
+#include "pico/stdlib.h"
+
+/**
+ * Event-Driven Network Waiting
+ *
+ * lwIP runs in poll mode: its callbacks only fire from cyw43_arch_poll().
+ * Rather than polling and then sleeping a fixed quantum, loops that wait
+ * for a connection to change state call net_wait_until(). It sleeps
+ * until the WiFi chip raises an interrupt, an lwIP timer falls due or the
+ * caller's deadline passes, then polls once so callbacks can update state
+ * before the loop checks it again.
+ */
+
+/**
+ * Wait for network work or a deadline, then let lwIP process it
+ * Returns without sleeping if work arrived since the last poll.
+ * @param deadline Latest time to return; at_the_end_of_time waits for work only
+ */
+void net_wait_until(absolute_time_t deadline);
+
+#endif // NET_WAIT_H
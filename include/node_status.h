@@ -18,11 +18,20 @@ int node_status_register(void);
 /**
  * Report node status to k3s API server
  * Updates node conditions, capacity, and addresses
- * Should be called every NODE_STATUS_INTERVAL_MS
+ * Blocks until the API server responds
  * Returns 0 on success, -1 on error
  */
 int node_status_report(void);
 
+/**
+ * Queue a node status report without blocking
+ * The outcome is logged from the completion callback. Skips the report
+ * if the previous one is still in flight.
+ * Should be called every NODE_STATUS_INTERVAL_MS from the main loop
+ * Returns 0 if queued, -1 on error
+ */
+int node_status_report_async(void);
+
 /**
  * Get the current node's IP address
  * @param ip_buffer Buffer to store IP address string
@@ -0,0 +1,124 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Retry Policy
+ *
+ * Decides when a failing API endpoint may be tried again:
+ * - jittered exponential backoff between attempts after a failure
+ * - a circuit breaker that opens after repeated failures and lets a single
+ *   half-open probe through once its timeout expires
+ * - a retry budget shared by all endpoints, so an outage can't turn into
+ *   a burst of reconnects when the server comes back
+ *
+ * Pure logic: time and randomness are passed in, so it runs on the host.
+ */
+
+// Circuit breaker state
+typedef enum {
+    CIRCUIT_CLOSED,         // Normal operation (with backoff after failures)
+    CIRCUIT_OPEN,           // Rejecting attempts until the open timeout expires
+    CIRCUIT_HALF_OPEN       // One probe allowed; its outcome closes or reopens
+} circuit_state_t;
+
+// Tuning for one endpoint
+typedef struct {
+    uint32_t base_delay_ms;         // Backoff after the first failure
+    uint32_t max_delay_ms;          // Backoff cap
+    uint32_t failure_threshold;     // Consecutive failures that open the circuit
+    uint32_t open_ms;               // How long the circuit stays open at first
+} retry_config_t;
+
+// Per-endpoint state (read it for monitoring, change it only via the API)
+typedef struct {
+    const char *name;
+    retry_config_t config;
+    circuit_state_t state;
+    uint32_t consecutive_failures;
+    uint32_t backoff_ms;            // Current delay before jitter
+    uint32_t next_attempt_ms;       // Earliest time of the next attempt
+    bool probe_in_flight;           // Half-open probe outstanding
+    uint32_t successes;
+    uint32_t failures;
+    uint32_t rejected;              // Attempts refused by backoff, breaker or budget
+} retry_policy_t;
+
+// Token bucket limiting retries across all endpoints
+typedef struct {
+    uint32_t tokens;
+    uint32_t max_tokens;
+    uint32_t refill_ms;             // One token per interval
+    uint32_t last_refill_ms;
+    uint32_t exhausted;             // Retries refused for lack of tokens
+} retry_budget_t;
+
+/**
+ * Initialize an endpoint policy (circuit closed, no backoff)
+ * @param policy Policy to initialize
+ * @param name Endpoint name for logs and monitoring
+ * @param config Tuning, copied into the policy
+ */
+void retry_policy_init(retry_policy_t *policy, const char *name, const retry_config_t *config);
+
+/**
+ * Ask whether an attempt may start now
+ * A request made while the endpoint is failing counts as a retry and
+ * takes a token from the budget. In the half-open state the allowed
+ * attempt becomes the probe.
+ * @param policy Endpoint policy
+ * @param budget Shared retry budget (NULL for none)
+ * @param now_ms Current time in milliseconds
+ * @return true if the attempt may go ahead
+ */
+bool retry_policy_allow(retry_policy_t *policy, retry_budget_t *budget, uint32_t now_ms);
+
+/**
+ * Record a successful attempt; closes the circuit and clears backoff
+ * @param policy Endpoint policy
+ * @param now_ms Current time in milliseconds
+ */
+void retry_policy_success(retry_policy_t *policy, uint32_t now_ms);
+
+/**
+ * Record a failed attempt and schedule the next one
+ * @param policy Endpoint policy
+ * @param now_ms Current time in milliseconds
+ * @param random Random value used for jitter
+ */
+void retry_policy_failure(retry_policy_t *policy, uint32_t now_ms, uint32_t random);
+
+/**
+ * Forget an attempt that was cancelled before it finished
+ * @param policy Endpoint policy
+ */
+void retry_policy_abandon(retry_policy_t *policy);
+
+/**
+ * Time until the next attempt is allowed
+ * @param policy Endpoint policy
+ * @param now_ms Current time in milliseconds
+ * @return Milliseconds to wait, 0 if an attempt may start now
+ */
+uint32_t retry_policy_wait_ms(const retry_policy_t *policy, uint32_t now_ms);
+
+/**
+ * Initialize a full retry budget
+ * @param budget Budget to initialize
+ * @param max_tokens Largest burst of retries
+ * @param refill_ms Interval at which one token is returned
+ * @param now_ms Current time in milliseconds
+ */
+void retry_budget_init(retry_budget_t *budget, uint32_t max_tokens, uint32_t refill_ms,
+                       uint32_t now_ms);
+
+/**
+ * Get circuit state name
+ * @param state Circuit state
+ * @return "closed", "open" or "half-open"
+ */
+const char *circuit_state_string(circuit_state_t state);
+
+#endif // RETRY_POLICY_H
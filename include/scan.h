@@ -0,0 +1,46 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+/**
+ * Delimiter Scanning
+ *
+ * Finds HTTP delimiters (CR, LF, ':', space) four bytes per iteration
+ * instead of one. Each aligned 32-bit word is tested with the classic
+ * SWAR has-zero-byte trick, XORed against the wanted byte repeated in every
+ * lane; only a word that reports a hit is walked byte by byte.
+ *
+ * The Cortex-M0+ faults on unaligned word loads, so the leading bytes up
+ * to the first word boundary are checked one at a time. Inputs are
+ * bounded by length and need not be NUL-terminated.
+ */
+
+/**
+ * Find the first occurrence of a byte
+ * @param data Bytes to scan
+ * @param length Number of bytes
+ * @param c Byte to find
+ * @return Pointer to the byte, or NULL if not present
+ */
+const char *scan_byte(const char *data, size_t length, char c);
+
+/**
+ * Find the first occurrence of either of two bytes
+ * @param data Bytes to scan
+ * @param length Number of bytes
+ * @param a First byte to find
+ * @param b Second byte to find
+ * @return Pointer to the first match, or NULL if neither is present
+ */
+const char *scan_byte2(const char *data, size_t length, char a, char b);
+
+/**
+ * Find the first CRLF
+ * @param data Bytes to scan
+ * @param length Number of bytes
+ * @return Pointer to the CR of the first "\r\n", or NULL if none
+ */
+const char *scan_crlf(const char *data, size_t length);
+
+#endif // SCAN_H
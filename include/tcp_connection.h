@@ -17,7 +17,6 @@
 typedef enum {
     TCP_STATE_IDLE = 0,
     TCP_STATE_DNS_RESOLVING,
-    TCP_STATE_DNS_RESOLVED,
     TCP_STATE_CONNECTING,
     TCP_STATE_CONNECTED,
     TCP_STATE_ERROR,
@@ -26,6 +25,7 @@ typedef enum {
 
 // Error codes
 typedef enum {
+    TCP_PENDING = 1,            // Non-blocking operation still in progress
     TCP_OK = 0,
     TCP_ERR_INVALID_PARAM = -1,
     TCP_ERR_DNS = -2,
@@ -37,31 +37,100 @@ typedef enum {
     TCP_ERR_CLOSED = -9
 } tcp_error_t;
 
+// Receive path: 1 keeps lwIP's pbufs queued and reads from their payloads;
+// 0 copies incoming data into a per-connection ring buffer
+#ifndef TCP_RECV_ZERO_COPY
+#define TCP_RECV_ZERO_COPY 1
+#endif
+
 // Ring buffer size for incoming data (must be power of 2)
+#ifndef TCP_RECV_RING_SIZE
 #define TCP_RECV_RING_SIZE 2048
+#endif
+
+// Default receive window: most unread bytes a connection holds
+// Window space is only handed back to lwIP as bytes are consumed; with the
+// ring buffer it is capped at the ring's capacity. Connections that share
+// the pbuf pool can set a smaller one (tcp_connection_set_recv_window())
+#ifndef TCP_RECV_WINDOW
+#define TCP_RECV_WINDOW TCP_WND
+#endif
+
+// Pool pbufs a receive window of full-sized segments takes: the WiFi driver
+// copies each frame, headers included, into PBUF_POOL_BUFSIZE buffers, so
+// the window is counted in bytes but pins pbufs. With TCP_RECV_ZERO_COPY=1
+// a connection queues at most this many for its window before lwIP is
+// told to hold off.
+#define TCP_RECV_SEGMENT_PBUFS \
+    ((TCP_MSS + PBUF_LINK_HLEN + PBUF_IP_HLEN + PBUF_TCP_HLEN + PBUF_POOL_BUFSIZE - 1) / \
+     PBUF_POOL_BUFSIZE)
+#define TCP_RECV_WINDOW_PBUFS(window) \
+    ((((window) + TCP_MSS - 1) / TCP_MSS) * TCP_RECV_SEGMENT_PBUFS)
 
 // Connection context structure
+// One piece of a scatter-gather send
+typedef struct {
+    const void *data;
+    size_t length;
+} tcp_iovec_t;
+
 typedef struct {
     // lwIP TCP control block
     struct tcp_pcb *pcb;
 
+#if TCP_RECV_ZERO_COPY
+    // Received pbufs not yet read; the head's payload starts at the next byte
+    struct pbuf *recv_queue;
+    uint16_t recv_queued;   // Unread bytes in recv_queue
+#else
     // Ring buffer for incoming data
     uint8_t recv_ring[TCP_RECV_RING_SIZE];
     uint16_t recv_head;  // Write position
     uint16_t recv_tail;  // Read position
 
+    // Delivered data that didn't fit in the ring yet, copied in as the
+    // ring drains
+    struct pbuf *recv_pending;
+    uint16_t recv_pending_offset;
+#endif
+
+    // Flow control: the window the PCB opens with, and the pbufs that
+    // window is allowed to queue (TCP_RECV_WINDOW_PBUFS())
+    uint16_t recv_window;
+    uint16_t recv_queue_pbufs;
+
     // Connection state
     tcp_conn_state_t state;
     int error_code;
+    bool peer_closed;    // FIN received from server
 
-    // DNS resolution
+    // DNS resolution (through dns_cache)
+    const char *hostname;
     ip_addr_t resolved_ip;
+    uint16_t port;
 
     // Timeouts
     absolute_time_t timeout;
 
+    // Connect phase timestamps (time_us_64(), 0 until reached)
+    uint64_t connect_start_us;
+    uint64_t resolved_us;       // Server address known
+    uint64_t connected_us;      // Handshake completed
+
 } tcp_connection_t;
 
+// TCP PCB usage across the whole stack (kubelet server included) and
+// lifecycle counters for tcp_connection's own connections
+typedef struct {
+    uint16_t active;            // Open, connecting or closing (MEMP_NUM_TCP_PCB pool)
+    uint16_t time_wait;         // Closed by this side, held for 2*MSL (same pool)
+    uint16_t listen;            // Listening (MEMP_NUM_TCP_PCB_LISTEN pool)
+    uint16_t capacity;          // MEMP_NUM_TCP_PCB
+    uint32_t alloc_failures;    // Connects that found no free PCB
+    uint32_t closed_by_peer;    // Closed after the peer's FIN (no TIME_WAIT)
+    uint32_t closed_reset;      // Reset rather than closed first (no TIME_WAIT)
+} tcp_pcb_stats_t;
+
 /**
  * Initialize TCP connection context
  */
@@ -73,23 +142,123 @@ int tcp_connection_init(tcp_connection_t *conn);
  */
 int tcp_connection_connect(tcp_connection_t *conn, const char *hostname, uint16_t port, uint32_t timeout_ms);
 
+/**
+ * Start connecting without blocking (DNS + TCP)
+ * Returns TCP_OK if the connect is under way, error code on failure.
+ * Drive it to completion with tcp_connection_connect_poll(); hostname must
+ * stay valid until then.
+ */
+int tcp_connection_connect_start(tcp_connection_t *conn, const char *hostname, uint16_t port, uint32_t timeout_ms);
+
+/**
+ * Advance a connect started with tcp_connection_connect_start()
+ * Returns TCP_OK once connected, TCP_PENDING while in progress,
+ * or an error code (the PCB has been released)
+ */
+int tcp_connection_connect_poll(tcp_connection_t *conn);
+
 /**
  * Send data over connection
  * Returns number of bytes sent, or negative error code
  */
 int tcp_connection_send(tcp_connection_t *conn, const uint8_t *data, size_t len, uint32_t timeout_ms);
 
+/**
+ * Queue as much data as the send buffer accepts, without blocking
+ * Returns number of bytes queued (possibly 0), or negative error code
+ */
+int tcp_connection_write(tcp_connection_t *conn, const uint8_t *data, size_t len);
+
+/**
+ * Queue a scatter-gather list without copying it, without blocking
+ * lwIP references the caller's memory until the peer acknowledges it, so
+ * every piece must stay valid until tcp_connection_send_done() returns
+ * true or the connection is closed.
+ * @param iov Pieces to send, in order
+ * @param iovcnt Number of pieces
+ * @param offset Bytes of the list already queued by earlier calls
+ * Returns number of bytes queued by this call (possibly 0), or negative error code
+ */
+int tcp_connection_writev(tcp_connection_t *conn, const tcp_iovec_t *iov, int iovcnt,
+                          size_t offset);
+
+/**
+ * Check whether everything queued has been acknowledged by the peer
+ * Returns true once no sent data is still referenced by lwIP
+ */
+bool tcp_connection_send_done(tcp_connection_t *conn);
+
 /**
  * Receive data from connection
- * Returns number of bytes received, 0 for connection closed, or negative error code
+ * Returns number of bytes received, 0 for connection closed, TCP_ERR_TIMEOUT if
+ * no data arrived within timeout_ms, or another negative error code
  */
 int tcp_connection_recv(tcp_connection_t *conn, uint8_t *buffer, size_t buffer_size, uint32_t timeout_ms);
 
+/**
+ * Read buffered data without blocking
+ * Returns number of bytes read, 0 if nothing is buffered yet,
+ * or TCP_ERR_CLOSED once the peer closed and the buffer is drained
+ */
+int tcp_connection_read(tcp_connection_t *conn, uint8_t *buffer, size_t buffer_size);
+
+/**
+ * Set how many unread bytes this connection may hold
+ * The peer is only allowed to send as much as fits; consuming data opens
+ * the window again. Call after tcp_connection_init(), before connecting:
+ * the window is applied to the PCB as the connection is made, so it is in
+ * force from the handshake's final ACK on.
+ * @param window Bytes, at most TCP_WND (and the ring capacity with
+ *               TCP_RECV_ZERO_COPY=0); larger values are clamped
+ */
+void tcp_connection_set_recv_window(tcp_connection_t *conn, uint16_t window);
+
+/**
+ * Look at received data without copying it
+ * Points data at the next unread bytes (inside an lwIP pbuf, or the ring
+ * buffer) and returns how many are contiguous there. They stay valid
+ * until tcp_connection_consume() or tcp_connection_close().
+ * Returns number of bytes available (possibly 0), or TCP_ERR_CLOSED once
+ * the peer closed and everything has been read
+ */
+int tcp_connection_peek(tcp_connection_t *conn, const uint8_t **data);
+
+/**
+ * Mark bytes returned by tcp_connection_peek() as read
+ * Frees pbufs once all their bytes are consumed and opens the receive
+ * window by the same amount
+ * @param length Bytes to drop, at most what the last peek returned
+ */
+void tcp_connection_consume(tcp_connection_t *conn, size_t length);
+
+/**
+ * Check whether an idle connection can carry another request
+ * Returns false if the peer closed, lwIP reported an error, or unread
+ * bytes are pending (the HTTP stream would be out of sync)
+ */
+bool tcp_connection_is_alive(tcp_connection_t *conn);
+
 /**
  * Close connection and cleanup resources
+ * Closes gracefully only if the peer already did; otherwise the
+ * connection is reset, so it doesn't hold a PCB in TIME_WAIT. Only close
+ * once nothing more needs to be exchanged.
  */
 void tcp_connection_close(tcp_connection_t *conn);
 
+/**
+ * Get PCB pool occupancy and lifecycle counters
+ */
+void tcp_connection_get_pcb_stats(tcp_pcb_stats_t *stats);
+
+/**
+ * Export PCB occupancy and counters in the Prometheus text format
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @return Bytes written (0 if they don't fit)
+ */
+int tcp_connection_format_pcb_metrics(char *buffer, size_t size);
+
 /**
  * Convert error code to human-readable string
  */
@@ -1,7 +1,8 @@
 #ifndef TLS_CONNECTION_H
 #define TLS_CONNECTION_H
 
-#include "lwip/tcp.h"
+#include "tcp_connection.h"
+#include "tls_heap.h"
 #include "mbedtls/ssl.h"
 #include "pico/stdlib.h"
 #include <stdint.h>
@@ -10,20 +11,31 @@
 /**
  * TLS Connection Layer
  *
- * Bridges lwIP's asynchronous raw API with mbedtls's synchronous API using
- * a quasi-blocking state machine approach. This provides simple linear control
- * flow while remaining compatible with NO_SYS polling architecture.
+ * A long-lived TLS channel driven from the main loop. Nothing blocks:
+ * - tls_connection_connect_start()/_poll() run DNS, the TCP connect and
+ *   the handshake one step at a time, as lwIP delivers records
+ * - tls_connection_write()/_read() return TLS_WANT_WRITE/TLS_WANT_READ
+ *   when mbedtls has to wait for the network; call again with the same
+ *   arguments once net_wait_until() returns
+ * - a HelloRequest from the server is answered inside _read() (with a
+ *   no_renegotiation alert unless MBEDTLS_SSL_RENEGOTIATION is enabled, in
+ *   which case the renegotiation runs there, WANT by WANT)
+ * - tls_connection_shutdown() sends close_notify and waits for it to be
+ *   acknowledged, again without blocking
+ * tls_connection_connect/send/recv are blocking wrappers for simple callers.
+ *
+ * Records travel over a tcp_connection_t, which does the DNS lookup, holds
+ * received pbufs until mbedtls reads them and opens the TCP window only as
+ * it does.
  */
 
 // Connection states
 typedef enum {
     TLS_STATE_IDLE = 0,
-    TLS_STATE_DNS_RESOLVING,
-    TLS_STATE_DNS_RESOLVED,
-    TLS_STATE_CONNECTING,
-    TLS_STATE_CONNECTED,
+    TLS_STATE_CONNECTING,       // DNS and TCP handshake (tcp_connection)
     TLS_STATE_HANDSHAKING,
     TLS_STATE_READY,
+    TLS_STATE_CLOSING,          // close_notify sent, waiting for the ACK
     TLS_STATE_ERROR,
     TLS_STATE_CLOSED
 } tls_conn_state_t;
@@ -40,21 +52,37 @@ typedef enum {
     TLS_ERR_TIMEOUT = -7,
     TLS_ERR_MEMORY = -8,
     TLS_ERR_CLOSED = -9,
-    TLS_ERR_MBEDTLS = -10
+    TLS_ERR_MBEDTLS = -10,
+    TLS_WANT_READ = -11,        // Waiting for records from the server; try again
+    TLS_WANT_WRITE = -12        // Waiting for TCP send space; try again
 } tls_error_t;
 
-// Ring buffer size for incoming data (must be power of 2 for efficiency)
-#define TLS_RECV_RING_SIZE 2048
+// Handshake and shutdown time limits
+#define TLS_HANDSHAKE_TIMEOUT_MS 15000
+#define TLS_SHUTDOWN_TIMEOUT_MS  1000
 
-// Connection context structure
+// Session kept from the last handshake with a server, so reconnects can
+// resume it (session ID or RFC 5077 ticket) instead of repeating the
+// ECDHE key exchange and certificate checks
 typedef struct {
-    // lwIP TCP connection
-    struct tcp_pcb *pcb;
+    mbedtls_ssl_session session;
+    bool valid;                     // session holds a completed handshake
 
-    // Receive ring buffer for bridging async TCP to sync mbedtls
-    uint8_t recv_ring[TLS_RECV_RING_SIZE];
-    volatile uint16_t recv_head;  // Write position (updated by TCP callback)
-    volatile uint16_t recv_tail;  // Read position (updated by mbedtls)
+    // Handshake counters and timings (since tls_session_cache_init())
+    uint32_t full_handshakes;
+    uint32_t resumed_handshakes;
+    uint32_t failed_handshakes;
+    uint32_t last_full_ms;          // Duration of the latest full handshake
+    uint32_t last_resumed_ms;       // Duration of the latest resumed handshake
+    uint32_t first_handshake_ms;    // Uptime when the first one completed (0 until then)
+    uint32_t last_stall_ms;         // Longest handshake step of the latest handshake,
+                                    // less time spent polling the network meanwhile
+} tls_session_cache_t;
+
+// Connection context structure
+typedef struct {
+    // Transport
+    tcp_connection_t tcp;
 
     // Connection state
     tls_conn_state_t state;
@@ -63,12 +91,20 @@ typedef struct {
     // Timeouts
     absolute_time_t timeout;
 
-    // DNS resolution
-    ip_addr_t resolved_ip;
-
     // TLS context (provided externally)
     mbedtls_ssl_context *ssl;
 
+    // Session resumption (optional, provided externally)
+    tls_session_cache_t *session_cache;
+    bool session_offered;   // Cached session sent in the ClientHello
+    bool peer_verified;     // Server certificate checked: a full handshake
+    bool resumed;           // Last handshake resumed the cached session
+    uint64_t handshake_start_us;
+    uint32_t handshake_stall_us;    // Longest the main loop was held up so far
+
+    // mbedtls pool use, from tls_context_setup() on
+    tls_heap_meter_t heap;
+
     // Statistics
     uint32_t bytes_sent;
     uint32_t bytes_received;
@@ -76,6 +112,7 @@ typedef struct {
     // Flags
     bool connection_closed;
     bool handshake_complete;
+    bool close_notify_sent;
 } tls_connection_t;
 
 /**
@@ -88,7 +125,65 @@ typedef struct {
 int tls_connection_init(tls_connection_t *conn, mbedtls_ssl_context *ssl);
 
 /**
- * Connect to a remote host with TLS
+ * Resume sessions from a cache when connecting
+ * The cached session is offered in the handshake; if the server accepts
+ * it the handshake is abbreviated. Every successful handshake refreshes
+ * the cache, a failed one empties it. Call before connecting.
+ *
+ * @param conn Connection context
+ * @param cache Session cache, shared by connections to the same server
+ */
+void tls_connection_set_session_cache(tls_connection_t *conn, tls_session_cache_t *cache);
+
+/**
+ * Start connecting without blocking (DNS, TCP, then the TLS handshake)
+ * Drive it with tls_connection_connect_poll(); hostname must stay valid
+ * until then.
+ *
+ * @param conn Connection context
+ * @param hostname Remote hostname or IP address
+ * @param port Remote port
+ * @param timeout_ms Timeout for DNS and the TCP connect; the handshake
+ *                   then gets TLS_HANDSHAKE_TIMEOUT_MS
+ * @return TLS_OK if the connect is under way, error code otherwise
+ */
+int tls_connection_connect_start(tls_connection_t *conn, const char *hostname,
+                                 uint16_t port, uint32_t timeout_ms);
+
+/**
+ * Advance a connect started with tls_connection_connect_start()
+ *
+ * @param conn Connection context
+ * @return TLS_OK once the handshake is done, TLS_WANT_READ/TLS_WANT_WRITE
+ *         while in progress, or an error code (the connection is closed)
+ */
+int tls_connection_connect_poll(tls_connection_t *conn);
+
+/**
+ * Encrypt and queue data without blocking
+ * After TLS_WANT_WRITE/TLS_WANT_READ, call again with the same data.
+ *
+ * @param conn Connection context
+ * @param data Data to send
+ * @param len Length of data
+ * @return Bytes sent (possibly fewer than len, one record at a time),
+ *         TLS_WANT_WRITE/TLS_WANT_READ, or an error code
+ */
+int tls_connection_write(tls_connection_t *conn, const uint8_t *data, size_t len);
+
+/**
+ * Read decrypted data without blocking
+ *
+ * @param conn Connection context
+ * @param buffer Buffer to store received data
+ * @param buffer_size Size of buffer
+ * @return Bytes read, TLS_WANT_READ/TLS_WANT_WRITE if none yet,
+ *         TLS_ERR_CLOSED once the server closed, or another error code
+ */
+int tls_connection_read(tls_connection_t *conn, uint8_t *buffer, size_t buffer_size);
+
+/**
+ * Connect to a remote host with TLS (blocking)
  *
  * This function performs DNS resolution, TCP connection, and TLS handshake.
  * It uses a polling approach with bounded timeouts.
@@ -130,18 +225,45 @@ int tls_connection_send(tls_connection_t *conn, const uint8_t *data,
 int tls_connection_recv(tls_connection_t *conn, uint8_t *buffer,
                        size_t buffer_size, uint32_t timeout_ms);
 
+/**
+ * Check whether an idle connection can carry another request
+ *
+ * @param conn Connection context
+ * @return false if the peer closed, an error occurred, or unread data is pending
+ */
+bool tls_connection_is_alive(tls_connection_t *conn);
+
+/**
+ * Close gracefully without blocking: send close_notify and wait for the
+ * server to acknowledge it (at most TLS_SHUTDOWN_TIMEOUT_MS), then close
+ *
+ * @param conn Connection context
+ * @return TLS_OK once closed, TLS_WANT_WRITE while still waiting
+ */
+int tls_connection_shutdown(tls_connection_t *conn);
+
 /**
  * Close TLS connection and cleanup resources
+ * Sends close_notify if it wasn't sent yet, but doesn't wait for it.
  *
  * @param conn Connection context
  */
 void tls_connection_close(tls_connection_t *conn);
 
+/**
+ * Free the mbedtls context of a closed connection
+ * Its memory goes back to the pool and is charged to the connection's
+ * meter. tls_context_setup() sets the context up again.
+ *
+ * @param conn Connection context
+ */
+void tls_connection_free(tls_connection_t *conn);
+
 /**
  * Check if data is available to read
  *
  * @param conn Connection context
- * @return Number of bytes available in ring buffer
+ * @return Number of decrypted bytes mbedtls holds for tls_connection_recv()
  */
 uint16_t tls_connection_available(tls_connection_t *conn);
 
@@ -161,6 +283,20 @@ tls_conn_state_t tls_connection_get_state(tls_connection_t *conn);
  */
 int tls_connection_get_error(tls_connection_t *conn);
 
+/**
+ * Initialize an empty session cache
+ *
+ * @param cache Session cache
+ */
+void tls_session_cache_init(tls_session_cache_t *cache);
+
+/**
+ * Forget the cached session; the next handshake is a full one
+ *
+ * @param cache Session cache
+ */
+void tls_session_cache_clear(tls_session_cache_t *cache);
+
 /**
  * Convert error code to string
  *
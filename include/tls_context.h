@@ -0,0 +1,59 @@
+#ifndef TLS_CONTEXT_H
+#define TLS_CONTEXT_H
+
+#include "tls_connection.h"
+#include "mbedtls/ssl.h"
+#include <stddef.h>
+
+/**
+ * TLS Context for the k3s API Server
+ *
+ * With K3S_USE_TLS (cmake -DK3S_TLS=ON) k3s_client skips the nginx proxy
+ * and talks mTLS to the API server on port 6443. This module holds what
+ * every connection shares:
+ * - the client configuration: server CA, kubelet client certificate and
+ *   key (certs.h, converted to DER at build time and parsed in place
+ *   from flash), CTR-DRBG seeded from the hardware entropy source
+ * - the session of the last handshake, which reconnects resume by session
+ *   ID or RFC 5077 ticket (k3s offers tickets), so only the first
+ *   connection pays for ECDHE and the ECDSA signature
+ *
+ * Per-connection state (mbedtls_ssl_context and its 2 x 8KB record
+ * buffers) is set up on connect and freed on close. Everything comes from
+ * the static mbedtls pool (tls_heap.h), installed by tls_context_init().
+ */
+
+/**
+ * Parse the credentials and build the client configuration
+ * Call once at startup, before any connection.
+ * @return 0 on success, -1 on failure
+ */
+int tls_context_init(void);
+
+/**
+ * Set up a new connection to the API server
+ * Initializes conn over ssl, with the shared session cache, and charges
+ * the SSL context to the connection's pool meter. Release it with
+ * tls_connection_free() once the connection is closed, so the free is
+ * charged to the same meter.
+ * @param conn Connection to initialize
+ * @param ssl SSL context to set up
+ * @return 0 on success, -1 on failure (out of memory)
+ */
+int tls_context_setup(tls_connection_t *conn, mbedtls_ssl_context *ssl);
+
+/**
+ * Get the session cache connections to the API server share
+ * @return Session cache (NULL before tls_context_init())
+ */
+tls_session_cache_t *tls_context_session_cache(void);
+
+/**
+ * Export handshake counters and timings in the Prometheus text format
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @return Bytes written (0 if they don't fit)
+ */
+int tls_context_format_metrics(char *buffer, size_t size);
+
+#endif // TLS_CONTEXT_H
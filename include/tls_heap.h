@@ -0,0 +1,115 @@
+#ifndef TLS_HEAP_H
+#define TLS_HEAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * mbedtls Memory Pool
+ *
+ * With K3S_USE_TLS every mbedtls allocation comes from a static pool of
+ * K3S_TLS_HEAP_SIZE bytes (mbedtls_memory_buffer_alloc), never from the
+ * heap lwIP and the rest of the firmware use. A handshake can't fragment
+ * their heap, and they can't starve a handshake.
+ *
+ * To size the pool, usage is accounted:
+ * - pool-wide: bytes and blocks in use now and at most, and allocations
+ *   that failed, with how much was free at the time (a lot free means
+ *   the pool was fragmented rather than full)
+ * - per connection, with a meter charged for what mbedtls allocates and
+ *   frees on its behalf: how much it holds once established, and the most
+ *   it held during a handshake and over the whole session
+ *
+ * While crypto_worker runs an operation on core1 (K3S_TLS_OFFLOAD), the
+ * pool-wide figures are the ones sampled when the offloaded mbedtls call
+ * began: the allocator's counters can't be read while core1 updates them.
+ *
+ * Roughly: K3S_TLS_HEAP_SIZE >= credentials (used right after
+ * tls_context_init()) + K3S_CONN_POOL_SIZE x session peak, plus a block
+ * header per block.
+ */
+
+// Bytes a connection has allocated from the pool
+typedef struct {
+    uint32_t current;       // Held now
+    uint32_t peak;          // Most held at once
+} tls_heap_meter_t;
+
+// Charges one mbedtls call to a meter (see tls_heap_enter())
+typedef struct {
+    tls_heap_meter_t *meter;
+    uint32_t used;          // Pool bytes in use when the call started
+    uint32_t charged;       // meter->current when the call started
+} tls_heap_scope_t;
+
+typedef struct {
+    uint32_t size;                  // K3S_TLS_HEAP_SIZE
+    uint32_t used;                  // Bytes in blocks now (headers not included)
+    uint32_t peak;                  // Most bytes in blocks at once
+    uint32_t blocks;                // Blocks allocated now
+    uint32_t peak_blocks;           // Most blocks at once
+    uint32_t alloc_failures;        // mbedtls calls that ran out of pool
+    uint32_t free_at_failure;       // Pool bytes free at the latest failure
+    uint32_t established_peak;      // Most a connection held once established
+    uint32_t handshake_peak;        // Most a connection held during a handshake
+    uint32_t session_peak;          // Most a connection held over a session
+} tls_heap_stats_t;
+
+/**
+ * Route mbedtls allocations to the static pool
+ * Call before anything else in mbedtls allocates.
+ */
+void tls_heap_init(void);
+
+/**
+ * Start charging a meter for an mbedtls call
+ * Everything the call allocates or frees counts against the meter. The
+ * main loop is single-threaded, so nothing else allocates in between.
+ * @param scope Scope to pass to tls_heap_leave()
+ * @param meter Meter to charge
+ */
+void tls_heap_enter(tls_heap_scope_t *scope, tls_heap_meter_t *meter);
+
+/**
+ * Finish charging a meter for an mbedtls call
+ * @param scope Scope from tls_heap_enter()
+ * @param ret Return code of the call; allocation failures are counted
+ * @return ret
+ */
+int tls_heap_leave(tls_heap_scope_t *scope, int ret);
+
+/**
+ * Record a connection that just completed its handshake
+ * @param meter Connection's meter (its peak covers the handshake)
+ */
+void tls_heap_record_handshake(const tls_heap_meter_t *meter);
+
+/**
+ * Record a connection that is closing
+ * @param meter Connection's meter (its peak covers the session)
+ */
+void tls_heap_record_session(const tls_heap_meter_t *meter);
+
+/**
+ * Get pool usage and the per-connection peaks
+ */
+void tls_heap_get_stats(tls_heap_stats_t *stats);
+
+/**
+ * Export pool bytes and blocks in use in the Prometheus text format
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @return Bytes written (0 if they don't fit)
+ */
+int tls_heap_format_metrics(char *buffer, size_t size);
+
+/**
+ * Export allocation failures and the per-connection peaks in the
+ * Prometheus text format
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param size Size of buffer
+ * @return Bytes written (0 if they don't fit)
+ */
+int tls_heap_format_sizing_metrics(char *buffer, size_t size);
+
+#endif // TLS_HEAP_H
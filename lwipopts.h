@@ -27,7 +27,10 @@
 #define MEMP_NUM_NETCONN           0     // Not using netconn API
 
 // Packet buffer pool
-#define PBUF_POOL_SIZE             16    // Number of buffers in pool
+// A full-sized segment takes three buffers, so a connection's full TCP_WND
+// pins twelve: 32 holds both pooled API server connections' windows with
+// room left for the WiFi driver and the kubelet server's clients
+#define PBUF_POOL_SIZE             32    // Number of buffers in pool
 #define PBUF_POOL_BUFSIZE          512   // Size of each buffer
 
 // TCP Options
@@ -4,14 +4,22 @@
 // Minimal TLS configuration for RP2040's memory constraints
 // This enables only essential features for TLS 1.2 client with RSA
 
+// Written for mbedtls 3.x (pico-sdk 2.x ships 3.6): tls_context.c and
+// tls_offload.c use its API. mbedtls 3 defines the version before it
+// includes this file; 2.28 (pico-sdk 1.5) does not
+#if !defined(MBEDTLS_VERSION_MAJOR) || MBEDTLS_VERSION_MAJOR < 3
+#error "K3S_TLS needs mbedtls 3.x: build against pico-sdk 2.x"
+#endif
+
 // System support
 #define MBEDTLS_PLATFORM_C
 #define MBEDTLS_PLATFORM_MEMORY
 #define MBEDTLS_MEMORY_BUFFER_ALLOC_C
 
-// Enable platform-specific memory allocation
-#define MBEDTLS_PLATFORM_CALLOC_MACRO   calloc
-#define MBEDTLS_PLATFORM_FREE_MACRO     free
+// Allocations come from a static pool (tls_heap.c installs it with
+// mbedtls_memory_buffer_alloc_init()), not calloc/free. MEMORY_DEBUG
+// keeps the usage counters tls_heap exports.
+#define MBEDTLS_MEMORY_DEBUG
 
 // Core cryptographic features
 #define MBEDTLS_CIPHER_MODE_CBC
@@ -32,6 +40,14 @@
 #define MBEDTLS_ECDH_C             // ECDH key exchange
 #define MBEDTLS_ECP_DP_SECP256R1_ENABLED  // P-256 curve (most common)
 
+// ECDHE and ECDSA verification run on core1 (cmake -DK3S_TLS_OFFLOAD=ON,
+// see tls_offload.c)
+#if K3S_TLS_OFFLOAD
+#define MBEDTLS_ECDH_GEN_PUBLIC_ALT
+#define MBEDTLS_ECDH_COMPUTE_SHARED_ALT
+#define MBEDTLS_ECDSA_VERIFY_ALT
+#endif
+
 // Hash functions
 #define MBEDTLS_SHA256_C
 #define MBEDTLS_SHA1_C             // Still needed by some CAs
@@ -50,8 +66,9 @@
 // X.509 certificate support
 #define MBEDTLS_X509_CRT_PARSE_C
 #define MBEDTLS_X509_USE_C
-#define MBEDTLS_PEM_PARSE_C        // Parse PEM format certificates
-#define MBEDTLS_BASE64_C           // Needed for PEM parsing
+// No PEM: certificates and keys are embedded as DER (certs/certs_to_der.py)
+#undef MBEDTLS_PEM_PARSE_C
+#undef MBEDTLS_BASE64_C
 #define MBEDTLS_OID_C              // Object Identifier support
 #define MBEDTLS_ASN1_PARSE_C       // ASN.1 parsing
 #define MBEDTLS_ASN1_WRITE_C       // ASN.1 writing
@@ -100,10 +117,13 @@
 // Enable Extended Master Secret (RFC 7627) - required by modern TLS servers like Go
 #define MBEDTLS_SSL_EXTENDED_MASTER_SECRET
 
+// Session resumption: session IDs are always supported by the client,
+// tickets (RFC 5077) are what Go's TLS server (k3s) resumes with
+#define MBEDTLS_SSL_SESSION_TICKETS
+
 // Disable additional features
 #undef MBEDTLS_SSL_RENEGOTIATION
 #undef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
-#undef MBEDTLS_SSL_SESSION_TICKETS
 #undef MBEDTLS_SSL_EXPORT_KEYS
 #undef MBEDTLS_SSL_TRUNCATED_HMAC
 #undef MBEDTLS_SSL_SERVER_NAME_INDICATION  // Disable SNI (causes issues with Go TLS servers)
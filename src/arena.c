@@ -0,0 +1,59 @@
+#include "arena.h"
+
+#define ARENA_ALIGN(n) (((n) + 3u) & ~(size_t)3u)
+
+void arena_init(arena_t *arena, void *memory, size_t size) {
+    arena->base = (uint8_t *)memory;
+    arena->size = size;
+    arena->used = 0;
+    arena->last = 0;
+    arena->high_water = 0;
+    arena->failures = 0;
+}
+
+// Fold the current usage into the high-water mark
+// Done lazily (not at allocation time) so a block that is shrunk right
+// after allocation only counts with its final size
+static void arena_note_usage(arena_t *arena) {
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    arena_note_usage(arena);
+
+    size_t offset = ARENA_ALIGN(arena->used);
+
+    if (size > arena->size || offset > arena->size - size) {
+        arena->failures++;
+        return NULL;
+    }
+
+    arena->last = offset;
+    arena->used = offset + size;
+
+    return arena->base + offset;
+}
+
+void arena_shrink(arena_t *arena, void *block, size_t size) {
+    size_t offset = (uint8_t *)block - arena->base;
+
+    // Only the block at the top of the arena can give memory back
+    if (block == NULL || offset != arena->last || offset + size > arena->used) {
+        return;
+    }
+
+    arena->used = offset + size;
+}
+
+void arena_reset(arena_t *arena) {
+    arena_note_usage(arena);
+    arena->used = 0;
+    arena->last = 0;
+}
+
+size_t arena_high_water(arena_t *arena) {
+    arena_note_usage(arena);
+    return arena->high_water;
+}
@@ -2,83 +2,165 @@
 #include "k3s_client.h"
 #include "memory_manager.h"
 #include "config.h"
+#if K3S_USE_PROTOBUF
+#include "k8s_protobuf.h"
+#endif
 #include <stdio.h>
 #include <string.h>
 
-// Simple JSON value extractor (minimal parser)
-// Finds "key": "value" patterns in JSON
-static const char *find_json_string_value(const char *json, const char *key) {
-    static char value_buffer[512];
-    char search_pattern[128];
-
-    // Build search pattern: "key":"
-    snprintf(search_pattern, sizeof(search_pattern), "\"%s\":\"", key);
-
-    const char *start = strstr(json, search_pattern);
-    if (start == NULL) {
-        // Try without space: "key": "
-        snprintf(search_pattern, sizeof(search_pattern), "\"%s\": \"", key);
-        start = strstr(json, search_pattern);
-        if (start == NULL) {
-            return NULL;
-        }
-    }
+// Key whose string value holds the memory assignments
+#define MEMORY_VALUES_KEY "memory_values"
+
+#if K3S_USE_PROTOBUF
+
+// Requested encoding of the ConfigMap
+#define CONFIGMAP_MEDIA_TYPE K8S_PROTOBUF_MEDIA_TYPE
+
+// Incremental extractor for data["memory_values"] in a streamed protobuf
+// ConfigMap (see k8s_pb_configmap_t)
+typedef struct {
+    k8s_pb_configmap_t pb;
+    char value[512];
+} configmap_extract_t;
 
-    // Move past the pattern to the value
-    start = strchr(start + strlen(search_pattern) - 1, '"');
-    if (start == NULL) {
-        return NULL;
+static void extract_init(configmap_extract_t *ex) {
+    k8s_pb_configmap_init(&ex->pb, MEMORY_VALUES_KEY, ex->value, sizeof(ex->value));
+}
+
+// Body consumer: feed the next piece of the ConfigMap protobuf
+static int extract_feed(const char *data, size_t length, void *user_data) {
+    configmap_extract_t *ex = (configmap_extract_t *)user_data;
+
+    if (k8s_pb_configmap_feed(&ex->pb, (const uint8_t *)data, length) != K8S_PB_OK) {
+        printf("ERROR: Malformed ConfigMap protobuf\n");
+        return -1;
     }
-    start++; // Skip opening quote
+    return 0;
+}
+
+// The extracted value, or NULL if the key wasn't found
+static const char *extract_result(const configmap_extract_t *ex) {
+    return (ex->pb.found && ex->pb.value_len > 0) ? ex->value : NULL;
+}
 
-    // Find closing quote
-    const char *end = strchr(start, '"');
-    if (end == NULL) {
-        return NULL;
+#else
+
+// Requested encoding of the ConfigMap
+#define CONFIGMAP_MEDIA_TYPE NULL   // application/json
+
+// Incremental extractor for "memory_values": "..." in a streamed response
+// The ConfigMap JSON arrives in arbitrary pieces, so matching state is
+// carried across calls instead of searching a fully buffered document.
+typedef enum {
+    EXTRACT_KEY,        // Looking for the quoted key
+    EXTRACT_COLON,      // Skipping whitespace and ':' up to the value
+    EXTRACT_VALUE,      // Copying the string value
+    EXTRACT_ESCAPE,     // Backslash seen inside the value
+    EXTRACT_DONE,
+} extract_state_t;
+
+typedef struct {
+    extract_state_t state;
+    size_t matched;     // Characters of the key matched so far
+    char value[512];
+    size_t value_len;
+} configmap_extract_t;
+
+static void extract_init(configmap_extract_t *ex) {
+    ex->state = EXTRACT_KEY;
+    ex->matched = 0;
+    ex->value_len = 0;
+    ex->value[0] = '\0';
+}
+
+static void extract_value_char(configmap_extract_t *ex, char c) {
+    // Truncate overlong values like the old buffered parser did
+    if (ex->value_len < sizeof(ex->value) - 1) {
+        ex->value[ex->value_len++] = c;
+        ex->value[ex->value_len] = '\0';
     }
+}
 
-    // Copy value to buffer
-    int len = end - start;
-    if (len >= sizeof(value_buffer)) {
-        len = sizeof(value_buffer) - 1;
+// Body consumer: feed the next piece of the ConfigMap JSON
+static int extract_feed(const char *data, size_t length, void *user_data) {
+    configmap_extract_t *ex = (configmap_extract_t *)user_data;
+    static const char key[] = "\"" MEMORY_VALUES_KEY "\"";
+
+    for (size_t i = 0; i < length && ex->state != EXTRACT_DONE; i++) {
+        char c = data[i];
+
+        switch (ex->state) {
+        case EXTRACT_KEY:
+            if (c == key[ex->matched]) {
+                if (++ex->matched == sizeof(key) - 1) {
+                    ex->state = EXTRACT_COLON;
+                }
+            } else {
+                // The key has no repeated prefix, so only a quote can
+                // start a new match
+                ex->matched = (c == '"') ? 1 : 0;
+            }
+            break;
+
+        case EXTRACT_COLON:
+            if (c == '"') {
+                ex->state = EXTRACT_VALUE;
+            } else if (c != ':' && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                // Not a string value (or the key appeared as a value)
+                ex->state = EXTRACT_KEY;
+                ex->matched = 0;
+            }
+            break;
+
+        case EXTRACT_VALUE:
+            if (c == '"') {
+                ex->state = EXTRACT_DONE;
+            } else if (c == '\\') {
+                ex->state = EXTRACT_ESCAPE;
+            } else {
+                extract_value_char(ex, c);
+            }
+            break;
+
+        case EXTRACT_ESCAPE:
+            extract_value_char(ex, c);
+            ex->state = EXTRACT_VALUE;
+            break;
+
+        case EXTRACT_DONE:
+            break;
+        }
     }
 
-    strncpy(value_buffer, start, len);
-    value_buffer[len] = '\0';
+    return 0;
+}
 
-    return value_buffer;
+// The extracted value, or NULL if the key wasn't found
+static const char *extract_result(const configmap_extract_t *ex) {
+    return (ex->state == EXTRACT_DONE && ex->value_len > 0) ? ex->value : NULL;
 }
 
+#endif // K3S_USE_PROTOBUF
+
 int configmap_watcher_init(void) {
     DEBUG_PRINT("ConfigMap watcher initialized");
     DEBUG_PRINT("  Watching: %s/%s", CONFIGMAP_NAMESPACE, CONFIGMAP_NAME);
     return 0;
 }
 
-int configmap_watcher_poll(void) {
-    char url[256];
-    char response[JSON_PARSE_BUFFER_SIZE];
-
-    DEBUG_PRINT("Polling ConfigMap %s/%s", CONFIGMAP_NAMESPACE, CONFIGMAP_NAME);
-
-    // Build URL: /api/v1/namespaces/{namespace}/configmaps/{name}
-    snprintf(url, sizeof(url),
+// Build URL: /api/v1/namespaces/{namespace}/configmaps/{name}
+static void configmap_url(char *url, size_t url_size) {
+    snprintf(url, url_size,
             "/api/v1/namespaces/%s/configmaps/%s",
             CONFIGMAP_NAMESPACE, CONFIGMAP_NAME);
+}
 
-    // Fetch ConfigMap from API server
-    int result = k3s_client_get(url, response, sizeof(response));
-
-    if (result != 0) {
-        // ConfigMap might not exist yet, or network error
-        DEBUG_PRINT("Failed to fetch ConfigMap (may not exist yet)");
-        return -1;
-    }
-
+// Apply a fetched ConfigMap to the memory region
+static int configmap_apply(const configmap_extract_t *ex) {
     DEBUG_PRINT("ConfigMap fetched, parsing...");
 
-    // Parse JSON to extract data.memory_values
-    // The response looks like:
+    // Extract data.memory_values
+    // The response looks like (in JSON; protobuf carries the same fields):
     // {
     //   "kind": "ConfigMap",
     //   "metadata": {...},
@@ -87,12 +169,11 @@ int configmap_watcher_poll(void) {
     //   }
     // }
 
-    // Simple approach: find "memory_values": "..."
-    const char *memory_values = find_json_string_value(response, "memory_values");
-
-    if (memory_values != NULL && strlen(memory_values) > 0) {
-        printf("ConfigMap update detected: %s\n", memory_values);
-        memory_manager_update_from_string(memory_values);
+    // Extracted while streaming
+    const char *value = extract_result(ex);
+    if (value != NULL) {
+        printf("ConfigMap update detected: %s\n", value);
+        memory_manager_update_from_string(value);
         return 0;
     } else {
         DEBUG_PRINT("No memory_values field found in ConfigMap");
@@ -100,6 +181,62 @@ int configmap_watcher_poll(void) {
     }
 }
 
+// Handle of the poll currently in flight
+static k3s_handle_t poll_handle = K3S_INVALID_HANDLE;
+
+// Extractor state for the poll in flight
+static configmap_extract_t poll_extract;
+
+// Completion callback for asynchronous polls
+static void poll_complete(int result, int status_code, void *user_data) {
+    poll_handle = K3S_INVALID_HANDLE;
+
+    if (result != 0) {
+        // ConfigMap might not exist yet, or network error
+        DEBUG_PRINT("Failed to fetch ConfigMap (may not exist yet)");
+        return;
+    }
+
+    configmap_apply(&poll_extract);
+}
+
+int configmap_watcher_poll(void) {
+    char url[256];
+
+    if (k3s_client_is_pending(poll_handle)) {
+        DEBUG_PRINT("Previous ConfigMap poll still in flight, skipping");
+        return -1;
+    }
+
+    DEBUG_PRINT("Polling ConfigMap %s/%s", CONFIGMAP_NAMESPACE, CONFIGMAP_NAME);
+
+    configmap_url(url, sizeof(url));
+
+    // Fetch ConfigMap from API server; the body is parsed as it streams in
+    // and poll_complete() applies the result
+    extract_init(&poll_extract);
+    poll_handle = k3s_client_submit_media(HTTP_METHOD_GET, url, CONFIGMAP_MEDIA_TYPE, NULL, 0,
+                                          extract_feed, poll_complete, &poll_extract);
+    return (poll_handle == K3S_INVALID_HANDLE) ? -1 : 0;
+}
+
 int configmap_watcher_check_now(void) {
-    return configmap_watcher_poll();
+    char url[256];
+    configmap_extract_t extract;
+
+    DEBUG_PRINT("Checking ConfigMap %s/%s", CONFIGMAP_NAMESPACE, CONFIGMAP_NAME);
+
+    configmap_url(url, sizeof(url));
+
+    // Fetch ConfigMap from API server
+    extract_init(&extract);
+    int result = k3s_client_get_stream(url, CONFIGMAP_MEDIA_TYPE, extract_feed, &extract);
+
+    if (result != 0) {
+        // ConfigMap might not exist yet, or network error
+        DEBUG_PRINT("Failed to fetch ConfigMap (may not exist yet)");
+        return -1;
+    }
+
+    return configmap_apply(&extract);
 }
@@ -0,0 +1,110 @@
+#include "crypto_worker.h"
+#include "config.h"
+#include "net_wait.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Longest core0 sleeps between checks for the result; core1's FIFO push
+// (SEV) normally wakes it sooner
+#define CRYPTO_WORKER_POLL_MS 50
+
+// ECP arithmetic needs more than the SDK's default 2KB core1 stack
+#define CRYPTO_WORKER_STACK_SIZE 8192
+
+// Passed to core1 by address through the FIFO, and back when done
+typedef struct {
+    int (*fn)(void *arg);
+    void *arg;
+    int result;
+    uint32_t elapsed_us;
+} crypto_job_t;
+
+static uint32_t worker_stack[CRYPTO_WORKER_STACK_SIZE / sizeof(uint32_t)];
+static crypto_worker_stats_t stats;
+static bool worker_started = false;
+static bool job_in_flight = false;
+
+static void worker_main(void) {
+    while (true) {
+        crypto_job_t *job = (crypto_job_t *)(uintptr_t)multicore_fifo_pop_blocking();
+        uint64_t start = time_us_64();
+        job->result = job->fn(job->arg);
+        job->elapsed_us = (uint32_t)(time_us_64() - start);
+        multicore_fifo_push_blocking((uint32_t)(uintptr_t)job);
+    }
+}
+
+void crypto_worker_init(void) {
+    if (worker_started) {
+        return;
+    }
+    memset(&stats, 0, sizeof(stats));
+    multicore_launch_core1_with_stack(worker_main, worker_stack, sizeof(worker_stack));
+    worker_started = true;
+    DEBUG_PRINT("Crypto worker started on core1");
+}
+
+int crypto_worker_run(int (*fn)(void *arg), void *arg) {
+    if (!worker_started || job_in_flight || get_core_num() != 0) {
+        stats.inline_jobs++;
+        return fn(arg);
+    }
+
+    crypto_job_t job = { fn, arg, 0, 0 };
+    job_in_flight = true;
+    uint64_t start = time_us_64();
+    multicore_fifo_push_blocking((uint32_t)(uintptr_t)&job);
+
+    // Keep lwIP (and with it the kubelet server) going until core1 is done
+    while (!multicore_fifo_rvalid()) {
+        net_wait_until(make_timeout_time_ms(CRYPTO_WORKER_POLL_MS));
+    }
+    multicore_fifo_pop_blocking();
+    job_in_flight = false;
+
+    stats.jobs++;
+    stats.busy_us += job.elapsed_us;
+    stats.waited_us += time_us_64() - start;
+    if (job.elapsed_us > stats.longest_us) {
+        stats.longest_us = job.elapsed_us;
+    }
+    return job.result;
+}
+
+bool crypto_worker_busy(void) {
+    return job_in_flight;
+}
+
+uint64_t crypto_worker_waited_us(void) {
+    return stats.waited_us;
+}
+
+void crypto_worker_get_stats(crypto_worker_stats_t *out) {
+    *out = stats;
+}
+
+int crypto_worker_format_metrics(char *buffer, size_t size) {
+    int n = snprintf(buffer, size,
+                     "# HELP k3s_crypto_worker_jobs_total Handshake public-key operations by core.\n"
+                     "# TYPE k3s_crypto_worker_jobs_total counter\n"
+                     "k3s_crypto_worker_jobs_total{core=\"1\"} %lu\n"
+                     "k3s_crypto_worker_jobs_total{core=\"0\"} %lu\n"
+                     "# HELP k3s_crypto_worker_busy_seconds_total core1 time spent on them.\n"
+                     "# TYPE k3s_crypto_worker_busy_seconds_total counter\n"
+                     "k3s_crypto_worker_busy_seconds_total %lu.%03lu\n"
+                     "# HELP k3s_crypto_worker_longest_job_seconds Longest operation on core1.\n"
+                     "# TYPE k3s_crypto_worker_longest_job_seconds gauge\n"
+                     "k3s_crypto_worker_longest_job_seconds %lu.%03lu\n",
+                     (unsigned long)stats.jobs, (unsigned long)stats.inline_jobs,
+                     (unsigned long)(stats.busy_us / 1000000),
+                     (unsigned long)((stats.busy_us / 1000) % 1000),
+                     (unsigned long)(stats.longest_us / 1000000),
+                     (unsigned long)((stats.longest_us / 1000) % 1000));
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
@@ -0,0 +1,205 @@
+#include "dns_cache.h"
+#include "config.h"
+#include "lwip/dns.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    char name[DNS_CACHE_NAME_MAX];  // Empty if the slot is free
+    ip_addr_t addr;
+    bool valid;                     // addr holds an answer
+    bool resolving;                 // lwIP query outstanding
+    bool failed;                    // Query failed with nothing to fall back on
+    bool used;                      // Looked up since the last answer
+    absolute_time_t expires;        // Fresh until
+    absolute_time_t refresh_at;     // Start re-resolving from here
+    absolute_time_t last_used;      // For eviction
+} dns_cache_entry_t;
+
+static dns_cache_entry_t entries[DNS_CACHE_SIZE];
+static dns_cache_stats_t stats;
+
+void dns_cache_init(void) {
+    memset(entries, 0, sizeof(entries));
+    memset(&stats, 0, sizeof(stats));
+}
+
+// Record a fresh answer
+static void entry_store(dns_cache_entry_t *entry, const ip_addr_t *addr) {
+    entry->addr = *addr;
+    entry->valid = true;
+    entry->failed = false;
+    entry->used = false;
+    entry->expires = make_timeout_time_ms(DNS_CACHE_TTL_MS);
+    entry->refresh_at = delayed_by_ms(get_absolute_time(),
+                                      DNS_CACHE_TTL_MS - DNS_CACHE_REFRESH_MS);
+}
+
+// lwIP DNS callback (entries aren't reused while resolving)
+static void dns_cache_found(const char *name, const ip_addr_t *ipaddr, void *arg) {
+    dns_cache_entry_t *entry = (dns_cache_entry_t *)arg;
+    entry->resolving = false;
+
+    if (ipaddr != NULL) {
+        DEBUG_PRINT("DNS resolved: %s -> %s", name, ipaddr_ntoa(ipaddr));
+        entry_store(entry, ipaddr);
+        return;
+    }
+
+    stats.failures++;
+    if (entry->valid) {
+        // Keep serving the old answer; try again a little later
+        DEBUG_PRINT("DNS refresh failed for %s, serving cached address", name);
+        entry->refresh_at = make_timeout_time_ms(DNS_CACHE_RETRY_MS);
+    } else {
+        DEBUG_PRINT("DNS lookup failed for %s", name);
+        entry->failed = true;
+    }
+}
+
+// Ask lwIP; its own table may answer at once
+static int entry_query(dns_cache_entry_t *entry) {
+    ip_addr_t addr;
+    err_t err = dns_gethostbyname(entry->name, &addr, dns_cache_found, entry);
+    if (err == ERR_OK) {
+        entry_store(entry, &addr);
+        return DNS_CACHE_OK;
+    } else if (err == ERR_INPROGRESS) {
+        entry->resolving = true;
+        return DNS_CACHE_PENDING;
+    }
+
+    DEBUG_PRINT("DNS error for %s: %d", entry->name, err);
+    stats.failures++;
+    if (entry->valid) {
+        entry->refresh_at = make_timeout_time_ms(DNS_CACHE_RETRY_MS);
+    }
+    return DNS_CACHE_ERR_FAILED;
+}
+
+// Re-resolve an answer in the background
+static void entry_refresh(dns_cache_entry_t *entry) {
+    DEBUG_PRINT("DNS refreshing %s", entry->name);
+    stats.refreshes++;
+    entry_query(entry);
+}
+
+// Find the entry for a name, or claim one (free, else least recently used)
+static dns_cache_entry_t *entry_get(const char *hostname) {
+    dns_cache_entry_t *victim = NULL;
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_cache_entry_t *entry = &entries[i];
+        if (strcmp(entry->name, hostname) == 0) {
+            return entry;
+        }
+        if (entry->resolving) {
+            continue;
+        }
+        if (victim == NULL || entry->name[0] == '\0' ||
+            (victim->name[0] != '\0' &&
+             absolute_time_diff_us(entry->last_used, victim->last_used) > 0)) {
+            victim = entry;
+        }
+    }
+
+    if (victim != NULL) {
+        memset(victim, 0, sizeof(*victim));
+        strcpy(victim->name, hostname);
+    }
+    return victim;
+}
+
+int dns_cache_lookup(const char *hostname, ip_addr_t *addr) {
+    if (ipaddr_aton(hostname, addr)) {
+        return DNS_CACHE_OK;
+    }
+
+    if (hostname[0] == '\0' || strlen(hostname) >= DNS_CACHE_NAME_MAX) {
+        DEBUG_PRINT("DNS name too long to cache: %s", hostname);
+        return DNS_CACHE_ERR_NAME;
+    }
+
+    dns_cache_entry_t *entry = entry_get(hostname);
+    if (entry == NULL) {
+        return DNS_CACHE_ERR_FULL;
+    }
+
+    absolute_time_t now = get_absolute_time();
+    entry->last_used = now;
+
+    if (entry->valid &&
+        absolute_time_diff_us(now, delayed_by_ms(entry->expires, DNS_CACHE_STALE_MS)) < 0) {
+        // Too old to trust even while refreshing
+        entry->valid = false;
+    }
+
+    if (entry->valid) {
+        *addr = entry->addr;
+        entry->used = true;
+        if (absolute_time_diff_us(now, entry->expires) > 0) {
+            stats.hits++;
+        } else {
+            stats.stale_hits++;
+        }
+        if (!entry->resolving && time_reached(entry->refresh_at)) {
+            entry_refresh(entry);
+        }
+        return DNS_CACHE_OK;
+    }
+
+    if (entry->failed) {
+        // Report the failure once; the next lookup starts over
+        entry->failed = false;
+        return DNS_CACHE_ERR_FAILED;
+    }
+
+    if (entry->resolving) {
+        return DNS_CACHE_PENDING;
+    }
+
+    stats.misses++;
+    int result = entry_query(entry);
+    if (result == DNS_CACHE_OK) {
+        *addr = entry->addr;
+    }
+    return result;
+}
+
+void dns_cache_poll(void) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_cache_entry_t *entry = &entries[i];
+        // Names nobody asked for since the last answer are left to expire
+        if (entry->valid && entry->used && !entry->resolving &&
+            time_reached(entry->refresh_at)) {
+            entry_refresh(entry);
+        }
+    }
+}
+
+const dns_cache_stats_t *dns_cache_get_stats(void) {
+    return &stats;
+}
+
+int dns_cache_format_metrics(char *buffer, size_t size) {
+    int n = snprintf(buffer, size,
+                     "# HELP dns_cache_lookups_total Hostname lookups by cache outcome.\n"
+                     "# TYPE dns_cache_lookups_total counter\n"
+                     "dns_cache_lookups_total{result=\"hit\"} %lu\n"
+                     "dns_cache_lookups_total{result=\"stale\"} %lu\n"
+                     "dns_cache_lookups_total{result=\"miss\"} %lu\n"
+                     "# HELP dns_cache_refreshes_total Background re-resolutions started.\n"
+                     "# TYPE dns_cache_refreshes_total counter\n"
+                     "dns_cache_refreshes_total %lu\n"
+                     "# HELP dns_cache_failures_total Resolutions that failed.\n"
+                     "# TYPE dns_cache_failures_total counter\n"
+                     "dns_cache_failures_total %lu\n",
+                     (unsigned long)stats.hits, (unsigned long)stats.stale_hits,
+                     (unsigned long)stats.misses, (unsigned long)stats.refreshes,
+                     (unsigned long)stats.failures);
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
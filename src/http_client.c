@@ -1,5 +1,6 @@
 #include "http_client.h"
 #include "config.h"
+#include "scan.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,123 +12,204 @@ static const char* method_to_string(http_method_t method) {
         case HTTP_METHOD_GET: return "GET";
         case HTTP_METHOD_POST: return "POST";
         case HTTP_METHOD_PATCH: return "PATCH";
+        case HTTP_METHOD_PUT: return "PUT";
         default: return "GET";
     }
 }
 
-// Build HTTP request
-int http_build_request(char *buffer, size_t buffer_size,
-                      http_method_t method,
-                      const char *host, uint16_t port,
-                      const char *path,
-                      const char *body,
-                      const char *content_type) {
-    if (buffer == NULL || host == NULL || path == NULL) {
-        return -1;
+// Write value in decimal; returns the number of digits
+// Digits come out backwards two at a time from a pair table, no division
+// by a variable and no format parsing
+static size_t format_decimal(char *out, unsigned long value) {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char digits[20];
+    size_t n = sizeof(digits);
+
+    while (value >= 100) {
+        unsigned int pair = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        digits[--n] = pairs[pair + 1];
+        digits[--n] = pairs[pair];
+    }
+    if (value >= 10) {
+        digits[--n] = pairs[value * 2 + 1];
+        digits[--n] = pairs[value * 2];
+    } else {
+        digits[--n] = (char)('0' + value);
     }
 
-    int written = 0;
-    const char *method_str = method_to_string(method);
+    size_t length = sizeof(digits) - n;
+    memcpy(out, digits + n, length);
+    return length;
+}
 
-    // Request line: METHOD /path HTTP/1.1
-    written = snprintf(buffer, buffer_size,
-                      "%s %s HTTP/1.1\r\n",
-                      method_str, path);
+// Append length bytes, keeping room for the terminating NUL
+static bool append(char *buffer, size_t buffer_size, size_t *written,
+                   const char *data, size_t length) {
+    if (*written + length >= buffer_size) {
+        return false;
+    }
+    memcpy(buffer + *written, data, length);
+    *written += length;
+    return true;
+}
+
+static bool append_str(char *buffer, size_t buffer_size, size_t *written, const char *str) {
+    return append(buffer, buffer_size, written, str, strlen(str));
+}
+
+// Append a string literal without measuring it at run time
+#define APPEND_LITERAL(buffer, size, written, literal) \
+    append((buffer), (size), (written), (literal), sizeof(literal) - 1)
 
-    if (written < 0 || (size_t)written >= buffer_size) {
+// Render the headers that never change for a server
+int http_header_block_init(http_header_block_t *block, const char *host, uint16_t port) {
+    if (block == NULL || host == NULL) {
         return -1;
     }
 
-    // Host header
-    int n = snprintf(buffer + written, buffer_size - written,
-                    "Host: %s:%d\r\n", host, port);
-    if (n < 0 || written + n >= (int)buffer_size) {
+    size_t written = 0;
+    char port_str[8];
+    size_t port_len = format_decimal(port_str, port);
+
+    if (!APPEND_LITERAL(block->data, sizeof(block->data), &written, "Host: ") ||
+        !append_str(block->data, sizeof(block->data), &written, host) ||
+        !APPEND_LITERAL(block->data, sizeof(block->data), &written, ":") ||
+        !append(block->data, sizeof(block->data), &written, port_str, port_len) ||
+        !APPEND_LITERAL(block->data, sizeof(block->data), &written,
+                        "\r\nUser-Agent: k3s-pico-node/1.0\r\n")) {
+        block->length = 0;
         return -1;
     }
-    written += n;
 
-    // User-Agent header
-    n = snprintf(buffer + written, buffer_size - written,
-                "User-Agent: k3s-pico-node/1.0\r\n");
-    if (n < 0 || written + n >= (int)buffer_size) {
+    block->data[written] = '\0';
+    block->length = written;
+    return 0;
+}
+
+// Build HTTP request line and headers around a prebuilt header block
+int http_build_request_head_cached(char *buffer, size_t buffer_size,
+                                  const http_header_block_t *headers,
+                                  http_method_t method,
+                                  const char *path,
+                                  const char *content_type,
+                                  const char *accept,
+                                  long content_length,
+                                  bool keep_alive,
+                                  bool accept_gzip) {
+    if (buffer == NULL || headers == NULL || headers->length == 0 || path == NULL) {
         return -1;
     }
-    written += n;
+
+    size_t written = 0;
+    bool ok;
+
+    // Request line: METHOD /path HTTP/1.1
+    ok = append_str(buffer, buffer_size, &written, method_to_string(method)) &&
+         APPEND_LITERAL(buffer, buffer_size, &written, " ") &&
+         append_str(buffer, buffer_size, &written, path) &&
+         APPEND_LITERAL(buffer, buffer_size, &written, " HTTP/1.1\r\n");
+
+    // Host and User-Agent
+    ok = ok && append(buffer, buffer_size, &written, headers->data, headers->length);
 
     // Accept header
-    n = snprintf(buffer + written, buffer_size - written,
-                "Accept: application/json\r\n");
-    if (n < 0 || written + n >= (int)buffer_size) {
-        return -1;
+    if (accept != NULL) {
+        ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "Accept: ") &&
+             append_str(buffer, buffer_size, &written, accept) &&
+             APPEND_LITERAL(buffer, buffer_size, &written, "\r\n");
+    } else {
+        ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "Accept: application/json\r\n");
     }
-    written += n;
 
-    // Connection header (close for simplicity)
-    n = snprintf(buffer + written, buffer_size - written,
-                "Connection: close\r\n");
-    if (n < 0 || written + n >= (int)buffer_size) {
-        return -1;
+    // Accept-Encoding header (only for callers that can inflate the body)
+    if (accept_gzip) {
+        ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "Accept-Encoding: gzip\r\n");
     }
-    written += n;
 
-    // For POST/PATCH requests, add Content-Type and Content-Length
-    if (body != NULL) {
-        size_t body_len = strlen(body);
+    // Connection header (HTTP/1.1 defaults to keep-alive, but be explicit)
+    if (keep_alive) {
+        ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "Connection: keep-alive\r\n");
+    } else {
+        ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "Connection: close\r\n");
+    }
 
-        // Content-Type
-        const char *ct = content_type ? content_type : "application/json";
-        n = snprintf(buffer + written, buffer_size - written,
-                    "Content-Type: %s\r\n", ct);
-        if (n < 0 || written + n >= (int)buffer_size) {
-            return -1;
-        }
-        written += n;
+    // For POST/PATCH/PUT requests, add Content-Type and Content-Length
+    if (content_length >= 0) {
+        char length_str[20];
+        size_t length_len = format_decimal(length_str, (unsigned long)content_length);
+
+        ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "Content-Type: ") &&
+             append_str(buffer, buffer_size, &written,
+                        content_type ? content_type : "application/json") &&
+             APPEND_LITERAL(buffer, buffer_size, &written, "\r\nContent-Length: ") &&
+             append(buffer, buffer_size, &written, length_str, length_len) &&
+             APPEND_LITERAL(buffer, buffer_size, &written, "\r\n");
+    }
 
-        // Content-Length
-        n = snprintf(buffer + written, buffer_size - written,
-                    "Content-Length: %zu\r\n", body_len);
-        if (n < 0 || written + n >= (int)buffer_size) {
-            return -1;
-        }
-        written += n;
+    // End of headers
+    ok = ok && APPEND_LITERAL(buffer, buffer_size, &written, "\r\n");
+    if (!ok) {
+        return -1;
+    }
 
-        // End of headers
-        n = snprintf(buffer + written, buffer_size - written, "\r\n");
-        if (n < 0 || written + n >= (int)buffer_size) {
-            return -1;
-        }
-        written += n;
+    buffer[written] = '\0';
+    return (int)written;
+}
+
+// Build HTTP request line and headers
+int http_build_request_head(char *buffer, size_t buffer_size,
+                           http_method_t method,
+                           const char *host, uint16_t port,
+                           const char *path,
+                           const char *content_type,
+                           const char *accept,
+                           long content_length,
+                           bool keep_alive,
+                           bool accept_gzip) {
+    http_header_block_t headers;
+
+    if (http_header_block_init(&headers, host, port) != 0) {
+        return -1;
+    }
+    return http_build_request_head_cached(buffer, buffer_size, &headers, method, path,
+                                          content_type, accept, content_length,
+                                          keep_alive, accept_gzip);
+}
 
-        // Body
+// Build HTTP request
+int http_build_request(char *buffer, size_t buffer_size,
+                      http_method_t method,
+                      const char *host, uint16_t port,
+                      const char *path,
+                      const char *body,
+                      const char *content_type,
+                      bool keep_alive) {
+    size_t body_len = (body != NULL) ? strlen(body) : 0;
+
+    int written = http_build_request_head(buffer, buffer_size, method, host, port, path,
+                                          content_type, NULL,
+                                          (body != NULL) ? (long)body_len : -1,
+                                          keep_alive, false);
+    if (written < 0) {
+        return -1;
+    }
+
+    // Body
+    if (body != NULL) {
         if (written + body_len >= buffer_size) {
             return -1;
         }
         memcpy(buffer + written, body, body_len);
         written += body_len;
-    } else {
-        // Just end of headers for GET
-        n = snprintf(buffer + written, buffer_size - written, "\r\n");
-        if (n < 0 || written + n >= (int)buffer_size) {
-            return -1;
-        }
-        written += n;
     }
 
     return written;
 }
 
-// Case-insensitive string comparison
-static int strcasecmp_custom(const char *s1, const char *s2) {
-    while (*s1 && *s2) {
-        if (tolower((unsigned char)*s1) != tolower((unsigned char)*s2)) {
-            return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-        }
-        s1++;
-        s2++;
-    }
-    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-}
-
 // Case-insensitive string prefix comparison
 static int strncasecmp_custom(const char *s1, const char *s2, size_t n) {
     while (n > 0 && *s1 && *s2) {
@@ -150,9 +232,10 @@ int http_get_header(const char *response_buffer, const char *header_name,
 
     // Find the header line
     const char *line = response_buffer;
+    const char *end = response_buffer + strlen(response_buffer);
     size_t header_name_len = strlen(header_name);
 
-    while (*line != '\0') {
+    while (line < end) {
         // Check if this line starts with the header name
         if (strncasecmp_custom(line, header_name, header_name_len) == 0 &&
             line[header_name_len] == ':') {
@@ -166,9 +249,9 @@ int http_get_header(const char *response_buffer, const char *header_name,
             }
 
             // Find end of line
-            const char *value_end = value_start;
-            while (*value_end != '\r' && *value_end != '\n' && *value_end != '\0') {
-                value_end++;
+            const char *value_end = scan_byte2(value_start, end - value_start, '\r', '\n');
+            if (value_end == NULL) {
+                value_end = end;
             }
 
             // Copy value
@@ -183,17 +266,111 @@ int http_get_header(const char *response_buffer, const char *header_name,
         }
 
         // Move to next line
-        while (*line != '\n' && *line != '\0') {
-            line++;
-        }
-        if (*line == '\n') {
-            line++;
+        const char *lf = scan_byte(line, end - line, '\n');
+        if (lf == NULL) {
+            break;
         }
+        line = lf + 1;
     }
 
     return -1;  // Header not found
 }
 
+// Indexed header names, and the hash slot each one lands in:
+// (length + first char + last char) & 15, lowercased, is collision-free
+static const char *const header_names[HTTP_HEADER_COUNT] = {
+    "date", "content-length", "transfer-encoding", "connection",
+    "etag", "content-encoding", "content-type"
+};
+
+#define HEADER_EMPTY HTTP_HEADER_UNKNOWN
+
+static const uint8_t header_slots[16] = {
+    HTTP_HEADER_ETAG, HEADER_EMPTY, HEADER_EMPTY, HEADER_EMPTY,
+    HTTP_HEADER_CONTENT_TYPE, HEADER_EMPTY, HEADER_EMPTY, HEADER_EMPTY,
+    HEADER_EMPTY, HTTP_HEADER_CONTENT_LENGTH, HTTP_HEADER_CONTENT_ENCODING,
+    HTTP_HEADER_CONNECTION, HTTP_HEADER_TRANSFER_ENCODING, HTTP_HEADER_DATE,
+    HEADER_EMPTY, HEADER_EMPTY
+};
+
+// Identify an indexed header by name
+http_header_id_t http_header_lookup(const char *name, size_t length) {
+    if (name == NULL || length == 0) {
+        return HTTP_HEADER_UNKNOWN;
+    }
+
+    unsigned int slot = (unsigned int)(length + ((unsigned char)name[0] | 0x20) +
+                                       ((unsigned char)name[length - 1] | 0x20)) & 15;
+    http_header_id_t id = (http_header_id_t)header_slots[slot];
+    if (id == HTTP_HEADER_UNKNOWN || strlen(header_names[id]) != length ||
+        strncasecmp_custom(name, header_names[id], length) != 0) {
+        return HTTP_HEADER_UNKNOWN;
+    }
+    return id;
+}
+
+// Record a value span; offsets past 64KB can't be indexed and are dropped
+static void header_index_add(http_header_index_t *index, http_header_id_t id,
+                             size_t offset, size_t length) {
+    if (id >= HTTP_HEADER_COUNT || (index->present & (1u << id)) ||
+        offset + length > UINT16_MAX) {
+        return;
+    }
+    index->offset[id] = (uint16_t)offset;
+    index->length[id] = (uint16_t)length;
+    index->present |= (uint8_t)(1u << id);
+}
+
+// Find an indexed header value
+const char *http_header_find(const http_header_index_t *index, const char *response_buffer,
+                             http_header_id_t id, size_t *length) {
+    if (index == NULL || response_buffer == NULL || id >= HTTP_HEADER_COUNT ||
+        !(index->present & (1u << id))) {
+        return NULL;
+    }
+
+    const char *value = response_buffer + index->offset[id];
+    size_t n = index->length[id];
+    while (n > 0 && (*value == ' ' || *value == '\t')) {
+        value++;
+        n--;
+    }
+    while (n > 0 && (value[n - 1] == ' ' || value[n - 1] == '\t' || value[n - 1] == '\r')) {
+        n--;
+    }
+
+    *length = n;
+    return value;
+}
+
+// Copy an indexed header value
+int http_header_copy(const http_header_index_t *index, const char *response_buffer,
+                     http_header_id_t id, char *value_buffer, size_t value_buffer_size) {
+    size_t length;
+    const char *value = http_header_find(index, response_buffer, id, &length);
+    if (value == NULL || value_buffer == NULL || value_buffer_size == 0) {
+        return -1;
+    }
+
+    if (length >= value_buffer_size) {
+        length = value_buffer_size - 1;
+    }
+    memcpy(value_buffer, value, length);
+    value_buffer[length] = '\0';
+    return 0;
+}
+
+// Case-insensitive search for token within a header value
+static bool value_has_token(const char *value, size_t length, const char *token) {
+    size_t token_len = strlen(token);
+    for (size_t i = 0; i + token_len <= length; i++) {
+        if (strncasecmp_custom(value + i, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Parse HTTP response
 int http_parse_response(char *response_buffer, size_t response_length,
                        http_response_t *response) {
@@ -205,15 +382,16 @@ int http_parse_response(char *response_buffer, size_t response_length,
     memset(response, 0, sizeof(http_response_t));
 
     // Parse status line: HTTP/1.1 200 OK
+    const char *end = response_buffer + response_length;
     char *line = response_buffer;
-    char *line_end = strstr(line, "\r\n");
+    char *line_end = (char *)scan_crlf(line, end - line);
     if (line_end == NULL) {
         DEBUG_PRINT("Invalid HTTP response: no CRLF found");
         return -1;
     }
 
     // Extract status code
-    char *status_start = strchr(line, ' ');
+    const char *status_start = scan_byte(line, line_end - line, ' ');
     if (status_start == NULL) {
         DEBUG_PRINT("Invalid HTTP status line");
         return -1;
@@ -228,7 +406,7 @@ int http_parse_response(char *response_buffer, size_t response_length,
 
     // Parse headers until blank line
     while (true) {
-        line_end = strstr(line, "\r\n");
+        line_end = (char *)scan_crlf(line, end - line);
         if (line_end == NULL) {
             DEBUG_PRINT("Malformed headers");
             return -1;
@@ -241,24 +419,33 @@ int http_parse_response(char *response_buffer, size_t response_length,
             break;
         }
 
-        // Check for Content-Length header
-        if (strncasecmp_custom(line, "Content-Length:", 15) == 0) {
-            response->content_length = atoi(line + 15);
-            DEBUG_PRINT("Content-Length: %zu", response->content_length);
-        }
-
-        // Check for Transfer-Encoding: chunked
-        if (strncasecmp_custom(line, "Transfer-Encoding:", 18) == 0) {
-            if (strstr(line, "chunked") != NULL) {
-                response->chunked = true;
-                DEBUG_PRINT("Transfer-Encoding: chunked");
-            }
+        // Index known headers; their values are read back from the index
+        const char *colon = scan_byte(line, line_end - line, ':');
+        if (colon != NULL) {
+            header_index_add(&response->headers,
+                             http_header_lookup(line, colon - line),
+                             (colon + 1) - response_buffer, line_end - (colon + 1));
         }
 
         // Move to next line
         line = line_end + 2;
     }
 
+    size_t value_len;
+    const char *value = http_header_find(&response->headers, response_buffer,
+                                         HTTP_HEADER_CONTENT_LENGTH, &value_len);
+    if (value != NULL) {
+        response->content_length = atoi(value);
+        DEBUG_PRINT("Content-Length: %zu", response->content_length);
+    }
+
+    value = http_header_find(&response->headers, response_buffer,
+                             HTTP_HEADER_TRANSFER_ENCODING, &value_len);
+    if (value != NULL && value_has_token(value, value_len, "chunked")) {
+        response->chunked = true;
+        DEBUG_PRINT("Transfer-Encoding: chunked");
+    }
+
     // Calculate body length
     if (response->body != NULL) {
         size_t header_length = response->body - response_buffer;
@@ -268,6 +455,28 @@ int http_parse_response(char *response_buffer, size_t response_length,
         }
     }
 
+    // Strip chunk-size lines and trailers so the body is just the payload
+    if (response->chunked && response->body_length > 0) {
+        http_framer_t framer;
+        size_t decoded;
+
+        http_framer_init_chunked(&framer);
+        http_frame_event_t event = http_framer_dechunk(&framer, response->body,
+                                                       response->body_length, &decoded);
+        if (event == HTTP_FRAME_ERROR) {
+            DEBUG_PRINT("Malformed chunked body");
+            return -1;
+        }
+        if (event != HTTP_FRAME_COMPLETE) {
+            DEBUG_PRINT("Chunked body incomplete, %zu bytes decoded", decoded);
+        }
+
+        // Decoding only shrinks the body, so the terminator stays in bounds
+        response->body_length = decoded;
+        response->body[decoded] = '\0';
+        DEBUG_PRINT("Dechunked body length: %zu bytes", decoded);
+    }
+
     return 0;
 }
 
@@ -289,3 +498,344 @@ const char* http_status_string(int status_code) {
         default: return "Unknown";
     }
 }
+
+// Largest chunk size accepted (7 hex digits, well beyond any real chunk)
+#define FRAMER_MAX_CHUNK_DIGITS          7
+
+// Headers whose values the framer reads byte by byte; other values are
+// skipped to the end of the line and only indexed
+static bool framer_reads_value(uint8_t header_id) {
+    return header_id == HTTP_HEADER_CONTENT_LENGTH ||
+           header_id == HTTP_HEADER_TRANSFER_ENCODING ||
+           header_id == HTTP_HEADER_CONNECTION ||
+           header_id == HTTP_HEADER_CONTENT_ENCODING;
+}
+
+void http_framer_init(http_framer_t *framer) {
+    memset(framer, 0, sizeof(*framer));
+    framer->state = HTTP_FRAMER_STATUS_VERSION;
+    framer->content_length = -1;
+}
+
+// Identify a header once its name is complete
+static void framer_header_name_done(http_framer_t *framer) {
+    framer->header_id = HTTP_HEADER_UNKNOWN;
+    framer->value_len = 0;
+    framer->value[0] = '\0';
+
+    if (framer->name_len >= sizeof(framer->name) || framer->header_length > UINT16_MAX) {
+        return;  // Truncated or out of index range, not one we track
+    }
+
+    framer->header_id = http_header_lookup(framer->name, framer->name_len);
+    framer->value_start = (uint16_t)framer->header_length;
+    if (framer->header_id == HTTP_HEADER_CONTENT_LENGTH) {
+        framer->content_length = 0;
+    }
+}
+
+// Apply a tracked header once its line is complete
+static void framer_header_line_done(http_framer_t *framer) {
+    // header_length already counts the LF
+    if (framer->header_id != HTTP_HEADER_UNKNOWN) {
+        header_index_add(&framer->headers, framer->header_id, framer->value_start,
+                         framer->header_length - 1 - framer->value_start);
+    }
+
+    switch (framer->header_id) {
+        case HTTP_HEADER_TRANSFER_ENCODING:
+            if (strstr(framer->value, "chunked") != NULL) {
+                framer->chunked = true;
+            }
+            break;
+        case HTTP_HEADER_CONNECTION:
+            if (strstr(framer->value, "close") != NULL) {
+                framer->connection_close = true;
+            }
+            break;
+        case HTTP_HEADER_CONTENT_ENCODING:
+            if (strstr(framer->value, "gzip") != NULL) {
+                framer->gzip = true;
+            }
+            break;
+        default:
+            break;
+    }
+    framer->header_id = HTTP_HEADER_UNKNOWN;
+}
+
+// Choose how the body is delimited once the headers are complete
+static void framer_headers_done(http_framer_t *framer) {
+    if (framer->chunked) {
+        // Transfer-Encoding overrides Content-Length (RFC 7230 3.3.3)
+        framer->state = HTTP_FRAMER_CHUNK_SIZE;
+        framer->remaining = 0;
+        framer->size_digits = false;
+    } else if (framer->content_length >= 0) {
+        framer->remaining = (size_t)framer->content_length;
+        framer->state = (framer->remaining > 0) ? HTTP_FRAMER_BODY_LENGTH : HTTP_FRAMER_DONE;
+    } else if (framer->status_code == 204 || framer->status_code == 304) {
+        framer->state = HTTP_FRAMER_DONE;
+    } else {
+        framer->state = HTTP_FRAMER_BODY_CLOSE;
+    }
+}
+
+void http_framer_init_chunked(http_framer_t *framer) {
+    http_framer_init(framer);
+    framer->chunked = true;
+    framer_headers_done(framer);
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Feed received bytes to the framer
+http_frame_event_t http_framer_feed(http_framer_t *framer,
+                                    const char *data, size_t length,
+                                    size_t *consumed,
+                                    const char **body, size_t *body_length) {
+    size_t i = 0;
+
+    *consumed = 0;
+    *body = NULL;
+    *body_length = 0;
+
+    while (i < length) {
+        http_framer_state_t state = framer->state;
+
+        // Body bytes are passed through as one span, not byte by byte
+        if (state == HTTP_FRAMER_BODY_LENGTH || state == HTTP_FRAMER_CHUNK_DATA ||
+            state == HTTP_FRAMER_BODY_CLOSE) {
+            size_t span = length - i;
+            if (state != HTTP_FRAMER_BODY_CLOSE) {
+                if (span > framer->remaining) {
+                    span = framer->remaining;
+                }
+                framer->remaining -= span;
+                if (framer->remaining == 0) {
+                    framer->state = (state == HTTP_FRAMER_BODY_LENGTH) ?
+                                    HTTP_FRAMER_DONE : HTTP_FRAMER_CHUNK_DATA_END;
+                }
+            }
+            *body = data + i;
+            *body_length = span;
+            *consumed = i + span;
+            return HTTP_FRAME_BODY;
+        }
+
+        if (state == HTTP_FRAMER_DONE || state == HTTP_FRAMER_ERROR) {
+            break;
+        }
+
+        // Nothing in other header values, the reason phrase or trailers
+        // matters until the end of the line, so skip straight to the LF
+        if ((state == HTTP_FRAMER_HEADER_VALUE && !framer_reads_value(framer->header_id)) ||
+            state == HTTP_FRAMER_STATUS_REASON || state == HTTP_FRAMER_TRAILER_LINE) {
+            const char *lf = scan_byte(data + i, length - i, '\n');
+            size_t skip = (lf != NULL) ? (size_t)(lf - (data + i)) : length - i;
+            if (state != HTTP_FRAMER_TRAILER_LINE) {
+                framer->header_length += skip;
+            }
+            i += skip;
+            if (lf == NULL) {
+                break;
+            }
+        }
+
+        char c = data[i++];
+        if (state < HTTP_FRAMER_BODY_LENGTH) {
+            framer->header_length++;
+        }
+
+        switch (state) {
+            case HTTP_FRAMER_STATUS_VERSION:
+                if (c == ' ') {
+                    framer->state = HTTP_FRAMER_STATUS_CODE;
+                } else if (c == '\r' || c == '\n') {
+                    framer->state = HTTP_FRAMER_ERROR;
+                }
+                break;
+
+            case HTTP_FRAMER_STATUS_CODE:
+                if (c >= '0' && c <= '9' && framer->status_code < 100) {
+                    framer->status_code = framer->status_code * 10 + (c - '0');
+                } else if (c == ' ' || c == '\r') {
+                    framer->state = HTTP_FRAMER_STATUS_REASON;
+                } else if (c == '\n') {
+                    framer->state = HTTP_FRAMER_HEADER_START;
+                } else {
+                    framer->state = HTTP_FRAMER_ERROR;
+                }
+                if (framer->state != HTTP_FRAMER_STATUS_CODE && framer->status_code < 100) {
+                    framer->state = HTTP_FRAMER_ERROR;
+                }
+                break;
+
+            case HTTP_FRAMER_STATUS_REASON:
+                if (c == '\n') {
+                    framer->state = HTTP_FRAMER_HEADER_START;
+                }
+                break;
+
+            case HTTP_FRAMER_HEADER_START:
+                if (c == '\r') {
+                    framer->state = HTTP_FRAMER_HEADERS_END;
+                    break;
+                } else if (c == '\n') {
+                    framer_headers_done(framer);
+                    *consumed = i;
+                    return HTTP_FRAME_HEADERS;
+                }
+                framer->name_len = 0;
+                framer->state = HTTP_FRAMER_HEADER_NAME;
+                // fall through
+            case HTTP_FRAMER_HEADER_NAME:
+                if (c == ':') {
+                    framer_header_name_done(framer);
+                    framer->state = HTTP_FRAMER_HEADER_VALUE;
+                } else if (c == '\r' || c == '\n') {
+                    framer->state = HTTP_FRAMER_ERROR;
+                } else if (framer->name_len < sizeof(framer->name)) {
+                    framer->name[framer->name_len++] = c;
+                }
+                break;
+
+            case HTTP_FRAMER_HEADER_VALUE:
+                if (c == '\n') {
+                    framer_header_line_done(framer);
+                    framer->state = HTTP_FRAMER_HEADER_START;
+                } else if (c == '\r' || c == ' ' || c == '\t') {
+                    // Whitespace around values is not significant here
+                } else if (framer->header_id == HTTP_HEADER_CONTENT_LENGTH) {
+                    if (c < '0' || c > '9' || framer->content_length > 99999999L) {
+                        framer->state = HTTP_FRAMER_ERROR;
+                    } else {
+                        framer->content_length = framer->content_length * 10 + (c - '0');
+                    }
+                } else if (framer->value_len < sizeof(framer->value) - 1) {
+                    framer->value[framer->value_len++] = tolower((unsigned char)c);
+                    framer->value[framer->value_len] = '\0';
+                }
+                break;
+
+            case HTTP_FRAMER_HEADERS_END:
+                if (c != '\n') {
+                    framer->state = HTTP_FRAMER_ERROR;
+                    break;
+                }
+                framer_headers_done(framer);
+                *consumed = i;
+                return HTTP_FRAME_HEADERS;
+
+            case HTTP_FRAMER_CHUNK_SIZE: {
+                int digit = hex_value(c);
+                if (digit >= 0) {
+                    if (framer->remaining >> (4 * (FRAMER_MAX_CHUNK_DIGITS - 1)) != 0) {
+                        framer->state = HTTP_FRAMER_ERROR;
+                        break;
+                    }
+                    framer->remaining = (framer->remaining << 4) | (size_t)digit;
+                    framer->size_digits = true;
+                    break;
+                }
+                if (!framer->size_digits) {
+                    framer->state = HTTP_FRAMER_ERROR;
+                    break;
+                }
+                if (c != '\n') {
+                    // ";ext=value", trailing whitespace or the CR
+                    framer->state = HTTP_FRAMER_CHUNK_EXT;
+                    break;
+                }
+            }
+                // fall through
+            case HTTP_FRAMER_CHUNK_EXT:
+                if (c == '\n') {
+                    framer->size_digits = false;
+                    framer->state = (framer->remaining > 0) ?
+                                    HTTP_FRAMER_CHUNK_DATA : HTTP_FRAMER_TRAILER_START;
+                }
+                break;
+
+            case HTTP_FRAMER_CHUNK_DATA_END:
+                if (c == '\n') {
+                    framer->state = HTTP_FRAMER_CHUNK_SIZE;
+                } else if (c != '\r') {
+                    framer->state = HTTP_FRAMER_ERROR;
+                }
+                break;
+
+            case HTTP_FRAMER_TRAILER_START:
+                if (c == '\n') {
+                    framer->state = HTTP_FRAMER_DONE;
+                } else if (c != '\r') {
+                    framer->state = HTTP_FRAMER_TRAILER_LINE;
+                }
+                break;
+
+            case HTTP_FRAMER_TRAILER_LINE:
+                if (c == '\n') {
+                    framer->state = HTTP_FRAMER_TRAILER_START;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    *consumed = i;
+    if (framer->state == HTTP_FRAMER_DONE) {
+        return HTTP_FRAME_COMPLETE;
+    }
+    if (framer->state == HTTP_FRAMER_ERROR) {
+        DEBUG_PRINT("Malformed HTTP response framing");
+        return HTTP_FRAME_ERROR;
+    }
+    return HTTP_FRAME_NEED_MORE;
+}
+
+// Strip body framing in place, resumable across calls
+http_frame_event_t http_framer_dechunk(http_framer_t *framer, char *data, size_t length,
+                                       size_t *decoded) {
+    http_frame_event_t event = HTTP_FRAME_NEED_MORE;
+    size_t offset = 0;
+    size_t out = 0;
+
+    while (offset < length) {
+        size_t used;
+        const char *body;
+        size_t body_length;
+
+        event = http_framer_feed(framer, data + offset, length - offset,
+                                 &used, &body, &body_length);
+        offset += used;
+
+        if (event == HTTP_FRAME_BODY) {
+            // Payload never moves up: out only trails the read position
+            memmove(data + out, body, body_length);
+            out += body_length;
+        } else if (event != HTTP_FRAME_HEADERS) {
+            break;
+        }
+    }
+
+    *decoded = out;
+    if (event == HTTP_FRAME_ERROR) {
+        return HTTP_FRAME_ERROR;
+    }
+    return (framer->state == HTTP_FRAMER_DONE) ? HTTP_FRAME_COMPLETE : HTTP_FRAME_NEED_MORE;
+}
+
+// Finish a response whose connection was closed by the server
+bool http_framer_finish(http_framer_t *framer) {
+    if (framer->state == HTTP_FRAMER_BODY_CLOSE) {
+        framer->state = HTTP_FRAMER_DONE;
+    }
+    return framer->state == HTTP_FRAMER_DONE;
+}
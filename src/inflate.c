@@ -0,0 +1,677 @@
+#include "inflate.h"
+#include <string.h>
+
+// Decoder states
+enum {
+    ST_GZIP_HEADER,     // Fixed 10-byte member header
+    ST_GZIP_EXTRA_LEN,
+    ST_GZIP_EXTRA,
+    ST_GZIP_NAME,
+    ST_GZIP_COMMENT,
+    ST_GZIP_HCRC,
+    ST_BLOCK_HEADER,
+    ST_STORED_LEN,
+    ST_STORED_DATA,
+    ST_DYNAMIC_COUNTS,
+    ST_DYNAMIC_CODE_LENGTHS,
+    ST_DYNAMIC_LENGTHS,
+    ST_BLOCK_DATA,
+    ST_TRAILER,
+    ST_DONE,
+    ST_ERROR
+};
+
+// gzip header flags (RFC 1952)
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+#define WINDOW_MASK (INFLATE_WINDOW_SIZE - 1)
+
+// Step results besides 0 (progress) and the negative inflate_result_t
+// errors. NEED_INPUT: the step ran out of input part way and is rolled
+// back to be retried once more bytes arrive. PAUSE: out of input, but
+// everything read so far has been committed.
+#define NEED_INPUT (-100)
+#define PAUSE      (-101)
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// CRC-32 (IEEE) four bits at a time: 64 bytes of table instead of 1KB
+static const uint32_t crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+// Running CRC is kept inverted; finalise with ~crc
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+    }
+    return crc;
+}
+
+// --- Bit reader ---
+
+// Make at least n bits available (n <= 56)
+static int need_bits(gzip_inflater_t *z, unsigned n) {
+    while (z->bitcount < n) {
+        if (z->in == z->in_end) {
+            return NEED_INPUT;
+        }
+        z->bitbuf |= (uint64_t)*z->in++ << z->bitcount;
+        z->bitcount += 8;
+    }
+    return 0;
+}
+
+// Read n bits, LSB first; NEED_INPUT if they haven't arrived yet
+static int32_t get_bits(gzip_inflater_t *z, unsigned n) {
+    if (need_bits(z, n) != 0) {
+        return NEED_INPUT;
+    }
+    int32_t value = (int32_t)(z->bitbuf & ((1u << n) - 1));
+    z->bitbuf >>= n;
+    z->bitcount -= n;
+    return value;
+}
+
+// Decode one symbol (canonical Huffman, as in zlib's puff.c). Code bits
+// are walked in a local copy and only dropped from the reader once a
+// symbol matches. Returns the symbol, NEED_INPUT or -2 for an invalid code.
+static int decode_symbol(gzip_inflater_t *z, const uint16_t *counts, const uint16_t *symbols) {
+    need_bits(z, 15);   // Best effort; a short code may fit in fewer
+
+    uint32_t bits = (uint32_t)z->bitbuf;
+    unsigned available = z->bitcount;
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (unsigned len = 1; len < 16; len++) {
+        if (len > available) {
+            return NEED_INPUT;
+        }
+        code |= bits & 1;
+        bits >>= 1;
+        int count = counts[len];
+        if (code - count < first) {
+            z->bitbuf >>= len;
+            z->bitcount -= len;
+            return symbols[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -2;
+}
+
+// Build a decoding table from code lengths
+// Returns 0 for a complete code, >0 for an incomplete one, <0 if
+// over-subscribed
+static int build_huffman(uint16_t *counts, uint16_t *symbols,
+                         const uint8_t *lengths, int n) {
+    uint16_t offsets[16];
+
+    memset(counts, 0, 16 * sizeof(uint16_t));
+    for (int sym = 0; sym < n; sym++) {
+        counts[lengths[sym]]++;
+    }
+    if (counts[0] == n) {
+        return 0;
+    }
+
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= counts[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++) {
+        offsets[len + 1] = offsets[len] + counts[len];
+    }
+    for (int sym = 0; sym < n; sym++) {
+        if (lengths[sym] != 0) {
+            symbols[offsets[lengths[sym]]++] = sym;
+        }
+    }
+    return left;
+}
+
+static void build_fixed_tables(gzip_inflater_t *z) {
+    int sym = 0;
+    for (; sym < 144; sym++) z->lengths[sym] = 8;
+    for (; sym < 256; sym++) z->lengths[sym] = 9;
+    for (; sym < 280; sym++) z->lengths[sym] = 7;
+    for (; sym < 288; sym++) z->lengths[sym] = 8;
+    build_huffman(z->litlen.counts, z->litlen.symbols, z->lengths, 288);
+
+    memset(z->lengths, 5, 30);
+    build_huffman(z->dist.counts, z->dist.symbols, z->lengths, 30);
+    z->fixed_tables = true;
+}
+
+// --- Output window ---
+
+// Hand everything written since the last flush to the consumer
+// Flushes happen at least once per trip around the window, so the
+// pending span never wraps
+static int flush_window(gzip_inflater_t *z) {
+    uint32_t pending = z->total_out - z->flushed;
+    if (pending == 0) {
+        return 0;
+    }
+
+    const uint8_t *span = z->window + (z->flushed & WINDOW_MASK);
+    z->crc = crc32_update(z->crc, span, pending);
+    z->flushed = z->total_out;
+    return z->output(span, pending, z->user_data);
+}
+
+static int put_byte(gzip_inflater_t *z, uint8_t byte) {
+    z->window[z->total_out & WINDOW_MASK] = byte;
+    z->total_out++;
+    if ((z->total_out & WINDOW_MASK) == 0) {
+        return flush_window(z);
+    }
+    return 0;
+}
+
+// --- Decode steps ---
+// Each step either completes, or returns NEED_INPUT having changed no
+// state other than the bit reader, which gzip_inflate_feed() restores.
+// Steps that commit as they go return PAUSE instead.
+
+// Move to the next optional header field, skipping absent ones
+static void enter_header_field(gzip_inflater_t *z, uint8_t state) {
+    if (state == ST_GZIP_EXTRA_LEN && (z->gzip_flags & GZIP_FEXTRA) == 0) {
+        state = ST_GZIP_NAME;
+    }
+    if (state == ST_GZIP_NAME && (z->gzip_flags & GZIP_FNAME) == 0) {
+        state = ST_GZIP_COMMENT;
+    }
+    if (state == ST_GZIP_COMMENT && (z->gzip_flags & GZIP_FCOMMENT) == 0) {
+        state = ST_GZIP_HCRC;
+    }
+    if (state == ST_GZIP_HCRC && (z->gzip_flags & GZIP_FHCRC) == 0) {
+        state = ST_BLOCK_HEADER;
+    }
+    z->state = state;
+    z->count = 0;
+    z->remaining = 0;
+}
+
+static int step_gzip_header(gzip_inflater_t *z) {
+    int32_t byte = get_bits(z, 8);
+    if (byte < 0) {
+        return NEED_INPUT;
+    }
+
+    switch (z->count) {
+        case 0:
+            if (byte != 0x1F) return INFLATE_ERR_DATA;
+            break;
+        case 1:
+            if (byte != 0x8B) return INFLATE_ERR_DATA;
+            break;
+        case 2:
+            if (byte != 8) return INFLATE_ERR_DATA;     // Only DEFLATE exists
+            break;
+        case 3:
+            if (byte & 0xE0) return INFLATE_ERR_DATA;  // Reserved flags
+            z->gzip_flags = (uint8_t)byte;
+            break;
+        default:
+            break;                                      // MTIME, XFL, OS
+    }
+
+    if (++z->count == 10) {
+        enter_header_field(z, ST_GZIP_EXTRA_LEN);
+    }
+    return 0;
+}
+
+static int step_gzip_field(gzip_inflater_t *z) {
+    if (z->state == ST_GZIP_EXTRA && z->remaining == 0) {
+        enter_header_field(z, ST_GZIP_NAME);
+        return 0;
+    }
+
+    int32_t byte = get_bits(z, 8);
+    if (byte < 0) {
+        return NEED_INPUT;
+    }
+
+    switch (z->state) {
+        case ST_GZIP_EXTRA_LEN:
+            z->remaining |= (uint16_t)(byte << (8 * z->count));
+            if (++z->count == 2) {
+                z->count = 0;
+                z->state = ST_GZIP_EXTRA;
+            }
+            break;
+        case ST_GZIP_EXTRA:
+            z->remaining--;
+            break;
+        case ST_GZIP_NAME:
+        case ST_GZIP_COMMENT:
+            if (byte == 0) {
+                enter_header_field(z, z->state + 1);
+            }
+            break;
+        case ST_GZIP_HCRC:
+            if (++z->count == 2) {
+                z->state = ST_BLOCK_HEADER;
+            }
+            break;
+    }
+    return 0;
+}
+
+static int step_block_header(gzip_inflater_t *z) {
+    int32_t header = get_bits(z, 3);
+    if (header < 0) {
+        return NEED_INPUT;
+    }
+
+    z->final_block = (header & 1) != 0;
+    switch (header >> 1) {
+        case 0:
+            z->state = ST_STORED_LEN;
+            break;
+        case 1:
+            if (!z->fixed_tables) {
+                build_fixed_tables(z);
+            }
+            z->state = ST_BLOCK_DATA;
+            break;
+        case 2:
+            z->state = ST_DYNAMIC_COUNTS;
+            break;
+        default:
+            return INFLATE_ERR_DATA;
+    }
+    return 0;
+}
+
+static int step_stored_len(gzip_inflater_t *z) {
+    // Stored data starts on a byte boundary
+    if (get_bits(z, z->bitcount & 7) < 0) {
+        return NEED_INPUT;
+    }
+    int32_t len = get_bits(z, 16);
+    if (len < 0) {
+        return NEED_INPUT;
+    }
+    int32_t nlen = get_bits(z, 16);
+    if (nlen < 0) {
+        return NEED_INPUT;
+    }
+    if (len != (~nlen & 0xFFFF)) {
+        return INFLATE_ERR_DATA;
+    }
+
+    z->remaining = (uint16_t)len;
+    z->state = ST_STORED_DATA;
+    return 0;
+}
+
+// Copy a stored block straight through; whole bytes already in the bit
+// buffer go first, then the input is used directly
+static int step_stored_data(gzip_inflater_t *z) {
+    while (z->remaining > 0) {
+        if (z->bitcount == 0) {
+            size_t n = z->in_end - z->in;
+            if (n == 0) {
+                return PAUSE;
+            }
+            if (n > z->remaining) {
+                n = z->remaining;
+            }
+            z->remaining -= n;
+            while (n-- > 0) {
+                if (put_byte(z, *z->in++) != 0) {
+                    return INFLATE_ERR_ABORTED;
+                }
+            }
+            continue;
+        }
+
+        int32_t byte = get_bits(z, 8);
+        if (byte < 0) {
+            return PAUSE;
+        }
+        z->remaining--;
+        if (put_byte(z, (uint8_t)byte) != 0) {
+            return INFLATE_ERR_ABORTED;
+        }
+    }
+
+    z->state = z->final_block ? ST_TRAILER : ST_BLOCK_HEADER;
+    z->count = 0;
+    return 0;
+}
+
+static int step_dynamic_counts(gzip_inflater_t *z) {
+    int32_t counts = get_bits(z, 14);
+    if (counts < 0) {
+        return NEED_INPUT;
+    }
+
+    z->hlit = (counts & 0x1F) + 257;
+    z->hdist = ((counts >> 5) & 0x1F) + 1;
+    z->hclen = (counts >> 10) + 4;
+    if (z->hlit > 286 || z->hdist > 30) {
+        return INFLATE_ERR_DATA;
+    }
+
+    z->fixed_tables = false;
+    memset(z->lengths, 0, 19);
+    z->count = 0;
+    z->state = ST_DYNAMIC_CODE_LENGTHS;
+    return 0;
+}
+
+static int step_dynamic_code_lengths(gzip_inflater_t *z) {
+    int32_t len = get_bits(z, 3);
+    if (len < 0) {
+        return NEED_INPUT;
+    }
+
+    z->lengths[code_length_order[z->count]] = (uint8_t)len;
+    if (++z->count < z->hclen) {
+        return 0;
+    }
+
+    // The code-length code lives in the distance table until the real
+    // distance code replaces it
+    if (build_huffman(z->dist.counts, z->dist.symbols, z->lengths, 19) != 0) {
+        return INFLATE_ERR_DATA;
+    }
+    z->count = 0;
+    z->state = ST_DYNAMIC_LENGTHS;
+    return 0;
+}
+
+static int step_dynamic_lengths(gzip_inflater_t *z) {
+    uint16_t total = z->hlit + z->hdist;
+
+    int symbol = decode_symbol(z, z->dist.counts, z->dist.symbols);
+    if (symbol == NEED_INPUT) {
+        return NEED_INPUT;
+    }
+    if (symbol < 0) {
+        return INFLATE_ERR_DATA;
+    }
+
+    if (symbol < 16) {
+        z->lengths[z->count++] = (uint8_t)symbol;
+    } else {
+        uint8_t value = 0;
+        int32_t repeat;
+
+        if (symbol == 16) {
+            if (z->count == 0) {
+                return INFLATE_ERR_DATA;
+            }
+            value = z->lengths[z->count - 1];
+            repeat = get_bits(z, 2);
+            repeat = (repeat < 0) ? repeat : 3 + repeat;
+        } else if (symbol == 17) {
+            repeat = get_bits(z, 3);
+            repeat = (repeat < 0) ? repeat : 3 + repeat;
+        } else {
+            repeat = get_bits(z, 7);
+            repeat = (repeat < 0) ? repeat : 11 + repeat;
+        }
+        if (repeat < 0) {
+            return NEED_INPUT;
+        }
+        if (z->count + repeat > total) {
+            return INFLATE_ERR_DATA;
+        }
+        while (repeat-- > 0) {
+            z->lengths[z->count++] = value;
+        }
+    }
+
+    if (z->count < total) {
+        return 0;
+    }
+
+    if (z->lengths[256] == 0) {
+        return INFLATE_ERR_DATA;    // No end-of-block code
+    }
+
+    // Incomplete codes are only allowed for a lone distance code
+    int left = build_huffman(z->litlen.counts, z->litlen.symbols, z->lengths, z->hlit);
+    if (left < 0 || (left > 0 && z->hlit - z->litlen.counts[0] != 1)) {
+        return INFLATE_ERR_DATA;
+    }
+    left = build_huffman(z->dist.counts, z->dist.symbols, z->lengths + z->hlit, z->hdist);
+    if (left < 0 || (left > 0 && z->hdist - z->dist.counts[0] != 1)) {
+        return INFLATE_ERR_DATA;
+    }
+
+    z->state = ST_BLOCK_DATA;
+    return 0;
+}
+
+// Decode one literal or one length/distance pair
+static int step_block_data(gzip_inflater_t *z) {
+    int symbol = decode_symbol(z, z->litlen.counts, z->litlen.symbols);
+    if (symbol == NEED_INPUT) {
+        return NEED_INPUT;
+    }
+    if (symbol < 0) {
+        return INFLATE_ERR_DATA;
+    }
+
+    if (symbol < 256) {
+        return (put_byte(z, (uint8_t)symbol) != 0) ? INFLATE_ERR_ABORTED : 0;
+    }
+
+    if (symbol == 256) {
+        z->state = z->final_block ? ST_TRAILER : ST_BLOCK_HEADER;
+        z->count = 0;
+        return 0;
+    }
+
+    symbol -= 257;
+    if (symbol >= 29) {
+        return INFLATE_ERR_DATA;
+    }
+    int32_t extra = get_bits(z, length_extra[symbol]);
+    if (extra < 0) {
+        return NEED_INPUT;
+    }
+    uint32_t length = length_base[symbol] + extra;
+
+    symbol = decode_symbol(z, z->dist.counts, z->dist.symbols);
+    if (symbol == NEED_INPUT) {
+        return NEED_INPUT;
+    }
+    if (symbol < 0 || symbol >= 30) {
+        return INFLATE_ERR_DATA;
+    }
+    extra = get_bits(z, dist_extra[symbol]);
+    if (extra < 0) {
+        return NEED_INPUT;
+    }
+    uint32_t distance = dist_base[symbol] + extra;
+
+    if (distance > z->total_out) {
+        return INFLATE_ERR_DATA;
+    }
+    if (distance > INFLATE_WINDOW_SIZE) {
+        return INFLATE_ERR_WINDOW;
+    }
+
+    // The copy needs no more input, so it always runs to completion
+    while (length-- > 0) {
+        uint8_t byte = z->window[(z->total_out - distance) & WINDOW_MASK];
+        if (put_byte(z, byte) != 0) {
+            return INFLATE_ERR_ABORTED;
+        }
+    }
+    return 0;
+}
+
+// CRC32 and ISIZE, little-endian, after the last block
+static int step_trailer(gzip_inflater_t *z) {
+    if (z->count == 0) {
+        // Trailer starts on a byte boundary; flush so the CRC is current.
+        // Both are no-ops if repeated after a pause.
+        get_bits(z, z->bitcount & 7);
+        if (flush_window(z) != 0) {
+            return INFLATE_ERR_ABORTED;
+        }
+    }
+
+    while (z->count < 8) {
+        int32_t byte = get_bits(z, 8);
+        if (byte < 0) {
+            return PAUSE;
+        }
+        z->lengths[z->count++] = (uint8_t)byte;
+    }
+
+    uint32_t crc = 0;
+    uint32_t size = 0;
+    for (int i = 3; i >= 0; i--) {
+        crc = (crc << 8) | z->lengths[i];
+        size = (size << 8) | z->lengths[4 + i];
+    }
+    if (crc != ~z->crc || size != z->total_out) {
+        return INFLATE_ERR_CHECKSUM;
+    }
+
+    z->state = ST_DONE;
+    return 0;
+}
+
+void gzip_inflate_init(gzip_inflater_t *z, inflate_output_fn output, void *user_data) {
+    z->state = ST_GZIP_HEADER;
+    z->gzip_flags = 0;
+    z->count = 0;
+    z->remaining = 0;
+    z->final_block = false;
+    z->fixed_tables = false;
+    z->bitbuf = 0;
+    z->bitcount = 0;
+    z->total_out = 0;
+    z->flushed = 0;
+    z->crc = 0xFFFFFFFF;
+    z->output = output;
+    z->user_data = user_data;
+}
+
+inflate_result_t gzip_inflate_feed(gzip_inflater_t *z, const uint8_t *data, size_t length) {
+    if (z->state == ST_DONE) {
+        return INFLATE_DONE;
+    }
+    if (z->state == ST_ERROR) {
+        return INFLATE_ERR_DATA;
+    }
+
+    z->in = data;
+    z->in_end = data + length;
+
+    int result = 0;
+    while (z->state != ST_DONE) {
+        // Snapshot the reader so a step that runs dry can be undone
+        uint64_t bitbuf = z->bitbuf;
+        uint8_t bitcount = z->bitcount;
+        const uint8_t *in = z->in;
+
+        switch (z->state) {
+            case ST_GZIP_HEADER:          result = step_gzip_header(z); break;
+            case ST_GZIP_EXTRA_LEN:
+            case ST_GZIP_EXTRA:
+            case ST_GZIP_NAME:
+            case ST_GZIP_COMMENT:
+            case ST_GZIP_HCRC:            result = step_gzip_field(z); break;
+            case ST_BLOCK_HEADER:         result = step_block_header(z); break;
+            case ST_STORED_LEN:           result = step_stored_len(z); break;
+            case ST_STORED_DATA:          result = step_stored_data(z); break;
+            case ST_DYNAMIC_COUNTS:       result = step_dynamic_counts(z); break;
+            case ST_DYNAMIC_CODE_LENGTHS: result = step_dynamic_code_lengths(z); break;
+            case ST_DYNAMIC_LENGTHS:      result = step_dynamic_lengths(z); break;
+            case ST_BLOCK_DATA:           result = step_block_data(z); break;
+            case ST_TRAILER:              result = step_trailer(z); break;
+            default:                      result = INFLATE_ERR_DATA; break;
+        }
+
+        if (result == PAUSE) {
+            break;
+        }
+        if (result == NEED_INPUT) {
+            // Roll back, then hold the tail of the input in the bit buffer.
+            // A step needs at most 48 bits, so what it could not complete
+            // on always fits.
+            z->bitbuf = bitbuf;
+            z->bitcount = bitcount;
+            z->in = in;
+            need_bits(z, (unsigned)(bitcount + 8 * (z->in_end - in)));
+            break;
+        }
+        if (result < 0) {
+            z->state = ST_ERROR;
+            return (inflate_result_t)result;
+        }
+    }
+
+    if (z->state == ST_DONE) {
+        return INFLATE_DONE;
+    }
+
+    // Deliver what this input produced instead of waiting for the window
+    // to fill
+    if (flush_window(z) != 0) {
+        z->state = ST_ERROR;
+        return INFLATE_ERR_ABORTED;
+    }
+    return INFLATE_NEED_MORE;
+}
+
+const char *inflate_result_string(inflate_result_t result) {
+    switch (result) {
+        case INFLATE_DONE:         return "Done";
+        case INFLATE_NEED_MORE:    return "Need more input";
+        case INFLATE_ERR_DATA:     return "Corrupt stream";
+        case INFLATE_ERR_WINDOW:   return "Window too large";
+        case INFLATE_ERR_CHECKSUM: return "Checksum mismatch";
+        case INFLATE_ERR_ABORTED:  return "Aborted";
+        default:                   return "Unknown";
+    }
+}
@@ -2,8 +2,15 @@
 #include "tcp_connection.h"
 #include "http_client.h"
 #include "time_sync.h"
+#include "arena.h"
+#include "inflate.h"
+#include "latency.h"
 #include "config.h"
-#include "pico/cyw43_arch.h"
+#include "net_wait.h"
+#if K3S_USE_TLS
+#include "tls_context.h"
+#endif
+#include "pico/rand.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -17,10 +24,445 @@ static bool client_initialized = false;
 // Connection timeout (10 seconds)
 #define CONNECT_TIMEOUT_MS 10000
 
+#if K3S_USE_TLS
+#define SERVER_DESCRIPTION "k3s API server"
+#else
+#define SERVER_DESCRIPTION "nginx proxy"
+#endif
+
+// Pooled keep-alive connection to the nginx proxy (or, with K3S_USE_TLS,
+// the API server)
+typedef struct {
+#if K3S_USE_TLS
+    tls_connection_t tls;
+    mbedtls_ssl_context ssl;    // Set up on connect, freed on close
+#else
+    tcp_connection_t conn;
+#endif
+    bool in_use;                // Checked out by an in-flight request
+    bool connected;             // Holds an established connection
+    bool closing;               // Closed, but the TLS close_notify isn't acked yet
+    absolute_time_t last_used;  // When the last response completed
+    uint32_t requests;          // Requests served on this connection
+} k3s_pooled_conn_t;
+
+static k3s_pooled_conn_t conn_pool[K3S_CONN_POOL_SIZE];
+
+// Asynchronous request states
+typedef enum {
+    K3S_REQ_FREE = 0,
+    K3S_REQ_QUEUED,             // Waiting for a pooled connection
+    K3S_REQ_CONNECTING,         // DNS / TCP (and TLS) handshake in progress
+    K3S_REQ_SENDING,            // Writing the request
+    K3S_REQ_RECEIVING           // Reading and framing the response
+} k3s_req_state_t;
+
+// In-flight request
+typedef struct {
+    k3s_req_state_t state;
+    uint8_t generation;         // Bumped on completion so stale handles don't match
+    k3s_body_cb_t on_body;
+    k3s_response_cb_t on_complete;
+    void *user_data;
+    k3s_endpoint_t endpoint;    // Retry policy the outcome is charged to
+
+    k3s_pooled_conn_t *entry;   // Connection while in flight
+    bool reused;                // Entry came from the keep-alive pool
+    bool retried;               // Already resent after a stale connection
+    bool idempotent;            // GET: safe to send again once it was written
+    absolute_time_t deadline;
+
+    arena_t arena;              // Buffers below, released when the slot frees
+    char *request;              // Serialized request line and headers
+    tcp_iovec_t iov[2];         // Head from the arena, body from the caller
+    int iovcnt;
+    int request_len;            // Head plus body
+    int request_sent;
+
+    char *response;             // Header buffer, reused as body scratch
+    int response_len;           // Header bytes buffered so far
+    bool headers_done;
+    int status_code;
+    size_t body_received;       // Decoded body bytes
+    size_t body_wire;           // Body bytes as received
+    http_framer_t framer;       // Resumable response framing state
+
+    bool accept_gzip;           // Asked for gzip; holds the inflater
+    bool inflating;             // Response body is gzip
+    bool inflate_done;          // gzip trailer seen and verified
+
+    // Phase timestamps for the latency histograms (time_us_64())
+    uint64_t submit_us;
+    uint64_t ready_us;          // Connection available
+    uint64_t sent_us;           // Whole request queued to lwIP
+    uint64_t first_byte_us;     // First response byte read, 0 until then
+} k3s_request_t;
+
+static k3s_request_t requests[K3S_MAX_PENDING_REQUESTS];
+
+// Static backing memory for the per-request arenas
+// Each slot owns a fixed region, so steady-state requests never touch the heap
+static uint8_t request_memory[K3S_MAX_PENDING_REQUESTS][K3S_REQUEST_ARENA_SIZE]
+    __attribute__((aligned(4)));
+
+// Most request slots ever in use at once
+static int slots_high_water = 0;
+
+// Host and User-Agent headers, rendered once at init
+static http_header_block_t request_headers;
+
+// Retry policy per endpoint, and the budget they share
+static retry_policy_t retry_policies[K3S_ENDPOINT_COUNT];
+static retry_budget_t retry_budget;
+
+// One inflater (window plus tables, ~9KB) shared by GETs one at a time;
+// a GET submitted while it is taken just asks for an identity body
+static gzip_inflater_t inflater;
+static k3s_request_t *inflater_owner = NULL;
+
+// Cleared if the proxy sends a stream the bounded window can't inflate
+static bool gzip_enabled = K3S_ACCEPT_GZIP;
+
+static const char *const endpoint_names[K3S_ENDPOINT_COUNT] = {
+    "node-status", "configmap", "register", "other"
+};
+
+// Request phase latency per endpoint
+static latency_histogram_t latency[K3S_ENDPOINT_COUNT][LATENCY_PHASE_COUNT];
+
+#define LATENCY_METRIC "k3s_request_duration_seconds"
+
+// Receive window of a pooled connection: the full TCP_WND, so large
+// responses stream at the full rate. lwipopts.h sizes the PBUF_POOL for
+// K3S_CONN_POOL_SIZE such windows, leaving CONN_POOL_PBUF_HEADROOM buffers
+// to the WiFi driver and the kubelet server's clients.
+#define CONN_RECV_WINDOW TCP_WND
+#define CONN_POOL_PBUF_HEADROOM 8
+
+#if K3S_CONN_POOL_SIZE * TCP_RECV_WINDOW_PBUFS(CONN_RECV_WINDOW) > \
+    PBUF_POOL_SIZE - CONN_POOL_PBUF_HEADROOM
+#error "PBUF_POOL_SIZE can't hold K3S_CONN_POOL_SIZE receive windows of CONN_RECV_WINDOW"
+#endif
+
+// Transport of a pooled connection: plain TCP to the proxy, or TLS over
+// TCP to the API server. Both report tcp_error_t codes.
+
+static tcp_connection_t *link_tcp(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    return &entry->tls.tcp;
+#else
+    return &entry->conn;
+#endif
+}
+
+// Deadline of the connect in progress (DNS, TCP, then the TLS handshake),
+// or of a TLS close
+static absolute_time_t link_deadline(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    return entry->tls.timeout;
+#else
+    return entry->conn.timeout;
+#endif
+}
+
+static int link_connect_start(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    if (tls_context_setup(&entry->tls, &entry->ssl) != 0) {
+        return TCP_ERR_MEMORY;
+    }
+    tcp_connection_set_recv_window(&entry->tls.tcp, CONN_RECV_WINDOW);
+    int ret = tls_connection_connect_start(&entry->tls, K3S_SERVER_IP, K3S_SERVER_PORT,
+                                           CONNECT_TIMEOUT_MS);
+    if (ret != TLS_OK) {
+        printf("ERROR: TLS connect failed: %s\n", tls_error_to_string(ret));
+        return (ret == TLS_ERR_DNS) ? TCP_ERR_DNS : TCP_ERR_CONNECT;
+    }
+    return TCP_OK;
+#else
+    tcp_connection_init(&entry->conn);
+    tcp_connection_set_recv_window(&entry->conn, CONN_RECV_WINDOW);
+    return tcp_connection_connect_start(&entry->conn, K3S_SERVER_IP, K3S_SERVER_PORT,
+                                        CONNECT_TIMEOUT_MS);
+#endif
+}
+
+static int link_connect_poll(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    // One handshake step per call, as the server's flights arrive; after
+    // the first connection it resumes the cached session
+    int ret = tls_connection_connect_poll(&entry->tls);
+    if (ret == TLS_OK) {
+        return TCP_OK;
+    } else if (ret == TLS_WANT_READ || ret == TLS_WANT_WRITE) {
+        return TCP_PENDING;
+    }
+    printf("ERROR: TLS connect failed: %s\n", tls_error_to_string(ret));
+    return (ret == TLS_ERR_TIMEOUT) ? TCP_ERR_TIMEOUT : TCP_ERR_CONNECT;
+#else
+    return tcp_connection_connect_poll(&entry->conn);
+#endif
+}
+
+static int link_writev(k3s_pooled_conn_t *entry, const tcp_iovec_t *iov, int iovcnt,
+                       size_t offset) {
+#if K3S_USE_TLS
+    // mbedtls encrypts into its own record buffer, so nothing is held by
+    // reference. After a WANT the next call passes mbedtls the same bytes
+    // again, as it requires.
+    int sent = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (offset >= iov[i].length) {
+            offset -= iov[i].length;
+            continue;
+        }
+        while (offset < iov[i].length) {
+            int n = tls_connection_write(&entry->tls, (const uint8_t *)iov[i].data + offset,
+                                         iov[i].length - offset);
+            if (n == TLS_WANT_WRITE || n == TLS_WANT_READ) {
+                return sent;
+            } else if (n < 0) {
+                return TCP_ERR_SEND;
+            }
+            sent += n;
+            offset += n;
+        }
+        offset = 0;
+    }
+    return sent;
+#else
+    return tcp_connection_writev(&entry->conn, iov, iovcnt, offset);
+#endif
+}
+
+static bool link_send_done(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    return true;
+#else
+    return tcp_connection_send_done(&entry->conn);
+#endif
+}
+
+// Read without blocking: bytes read, 0 if none yet, or TCP_ERR_CLOSED
+static int link_read(k3s_pooled_conn_t *entry, uint8_t *buffer, size_t size) {
+#if K3S_USE_TLS
+    int n = tls_connection_read(&entry->tls, buffer, size);
+    if (n == TLS_WANT_READ || n == TLS_WANT_WRITE) {
+        return 0;
+    } else if (n == TLS_ERR_CLOSED) {
+        return TCP_ERR_CLOSED;
+    } else if (n < 0) {
+        return TCP_ERR_RECV;
+    }
+    return n;
+#else
+    return tcp_connection_read(&entry->conn, buffer, size);
+#endif
+}
+
+static bool link_is_alive(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    return tls_connection_is_alive(&entry->tls);
+#else
+    return tcp_connection_is_alive(&entry->conn);
+#endif
+}
+
+// Close right away
+static void link_abort(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    tls_connection_close(&entry->tls);
+    tls_connection_free(&entry->tls);
+#else
+    tcp_connection_close(&entry->conn);
+#endif
+}
+
+// Close gracefully; returns false while a TLS close_notify is still on its
+// way (call again later)
+static bool link_close(k3s_pooled_conn_t *entry) {
+#if K3S_USE_TLS
+    if (tls_connection_shutdown(&entry->tls) != TLS_OK) {
+        return false;
+    }
+#endif
+    link_abort(entry);
+    return true;
+}
+
+static uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Map a request to the endpoint whose policy governs it
+static k3s_endpoint_t classify_endpoint(http_method_t method, const char *path) {
+    if (strstr(path, "/configmaps/") != NULL) {
+        return K3S_ENDPOINT_CONFIGMAP;
+    }
+    if ((method == HTTP_METHOD_PATCH || method == HTTP_METHOD_PUT) &&
+        strstr(path, "/status") != NULL) {
+        return K3S_ENDPOINT_NODE_STATUS;
+    }
+    if (method == HTTP_METHOD_POST) {
+        return K3S_ENDPOINT_REGISTER;
+    }
+    return K3S_ENDPOINT_OTHER;
+}
+
+// Charge a finished request to its endpoint's policy
+// Only failures that say the server side is unhealthy count: no response,
+// 5xx or 429. A 404 or 409 is a healthy server answering.
+static void retry_record(k3s_endpoint_t endpoint, int result, int status_code) {
+    retry_policy_t *policy = &retry_policies[endpoint];
+    circuit_state_t before = policy->state;
+    uint32_t now = now_ms();
+
+    bool server_failure = (result != 0) &&
+                          (status_code == 0 || status_code >= 500 || status_code == 429);
+    if (server_failure) {
+        retry_policy_failure(policy, now, get_rand_32());
+    } else {
+        retry_policy_success(policy, now);
+    }
+
+    if (policy->state != before) {
+        printf("K3s %s circuit %s -> %s\n", policy->name,
+               circuit_state_string(before), circuit_state_string(policy->state));
+    }
+    if (server_failure) {
+        DEBUG_PRINT("K3s %s failure %u, next attempt in %u ms", policy->name,
+                    (unsigned)policy->consecutive_failures,
+                    (unsigned)retry_policy_wait_ms(policy, now));
+    }
+}
+
+// Microseconds from one timestamp to another, saturated to 32 bits
+static uint32_t elapsed_us(uint64_t from, uint64_t to) {
+    if (to <= from) {
+        return 0;
+    }
+    return (to - from > UINT32_MAX) ? UINT32_MAX : (uint32_t)(to - from);
+}
+
+// Charge a finished request's phases to its endpoint's histograms
+// Only requests that got a response are timed; the others show up in the
+// retry policy's failure counts instead
+static void latency_record_request(const k3s_request_t *req) {
+    if (req->first_byte_us == 0) {
+        return;
+    }
+
+    latency_histogram_t *h = latency[req->endpoint];
+    uint64_t now = time_us_64();
+
+    // DNS and connect only happen on a fresh connection
+    if (!req->reused && req->entry != NULL) {
+        const tcp_connection_t *conn = link_tcp(req->entry);
+        if (conn->resolved_us != 0 && conn->connected_us != 0) {
+            latency_record(&h[LATENCY_PHASE_DNS],
+                           elapsed_us(conn->connect_start_us, conn->resolved_us));
+            latency_record(&h[LATENCY_PHASE_CONNECT],
+                           elapsed_us(conn->resolved_us, conn->connected_us));
+        }
+    }
+
+    latency_record(&h[LATENCY_PHASE_SEND], elapsed_us(req->ready_us, req->sent_us));
+    latency_record(&h[LATENCY_PHASE_TTFB], elapsed_us(req->sent_us, req->first_byte_us));
+    latency_record(&h[LATENCY_PHASE_BODY], elapsed_us(req->first_byte_us, now));
+    latency_record(&h[LATENCY_PHASE_TOTAL], elapsed_us(req->submit_us, now));
+}
+
+// Close a pooled connection and mark the slot empty
+static void pool_discard(k3s_pooled_conn_t *entry) {
+    if (entry->connected) {
+        DEBUG_PRINT("Closing pooled connection (%lu requests served)",
+                    (unsigned long)entry->requests);
+    }
+    entry->closing = !link_close(entry);
+    entry->connected = false;
+    entry->requests = 0;
+}
+
+// Drop idle connections that timed out or were closed by the proxy
+static void pool_reap(void) {
+    absolute_time_t now = get_absolute_time();
+
+    for (int i = 0; i < K3S_CONN_POOL_SIZE; i++) {
+        k3s_pooled_conn_t *entry = &conn_pool[i];
+        if (entry->closing) {
+            // The slot frees once the server has our close_notify
+            entry->closing = !link_close(entry);
+            continue;
+        }
+        if (entry->in_use || !entry->connected) {
+            continue;
+        }
+
+        if (absolute_time_diff_us(entry->last_used, now) >
+            (K3S_CONN_IDLE_TIMEOUT_MS * 1000LL)) {
+            DEBUG_PRINT("Pooled connection %d idle timeout", i);
+            pool_discard(entry);
+        } else if (!link_is_alive(entry)) {
+            DEBUG_PRINT("Pooled connection %d closed by proxy", i);
+            pool_discard(entry);
+        }
+    }
+}
+
+// Return a connection to the pool, or close it if it can't be reused
+static void pool_release(k3s_pooled_conn_t *entry, bool reusable) {
+    entry->in_use = false;
+    entry->last_used = get_absolute_time();
+    if (!reusable) {
+        pool_discard(entry);
+    }
+}
+
 int k3s_client_init(void) {
+#if K3S_USE_TLS
+    DEBUG_PRINT("Initializing k3s API client (mTLS mode)...");
+    DEBUG_PRINT("Will connect to k3s API at %s:%d", K3S_SERVER_IP, K3S_SERVER_PORT);
+    if (tls_context_init() != 0) {
+        printf("ERROR: Failed to set up TLS for the k3s API\n");
+        return -1;
+    }
+#else
     DEBUG_PRINT("Initializing k3s API client (HTTP-only mode)...");
     DEBUG_PRINT("Will connect to nginx proxy at %s:%d", K3S_SERVER_IP, K3S_SERVER_PORT);
     DEBUG_PRINT("Proxy will forward to k3s API with TLS termination");
+#endif
+
+    memset(conn_pool, 0, sizeof(conn_pool));
+    memset(requests, 0, sizeof(requests));
+    for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+        arena_init(&requests[i].arena, request_memory[i], K3S_REQUEST_ARENA_SIZE);
+    }
+    DEBUG_PRINT("Request arenas: %d x %d bytes (static)",
+                K3S_MAX_PENDING_REQUESTS, K3S_REQUEST_ARENA_SIZE);
+    DEBUG_PRINT("Keep-alive pool: %d connections, %d ms idle timeout",
+                K3S_CONN_POOL_SIZE, K3S_CONN_IDLE_TIMEOUT_MS);
+
+    retry_config_t retry_config = {
+        .base_delay_ms = K3S_RETRY_BASE_MS,
+        .max_delay_ms = K3S_RETRY_MAX_MS,
+        .failure_threshold = K3S_BREAKER_THRESHOLD,
+        .open_ms = K3S_BREAKER_OPEN_MS
+    };
+    for (int i = 0; i < K3S_ENDPOINT_COUNT; i++) {
+        retry_policy_init(&retry_policies[i], endpoint_names[i], &retry_config);
+    }
+    retry_budget_init(&retry_budget, K3S_RETRY_BUDGET, K3S_RETRY_BUDGET_REFILL_MS, now_ms());
+
+    // Host and User-Agent are the same on every request
+    if (http_header_block_init(&request_headers, K3S_SERVER_IP, K3S_SERVER_PORT) != 0) {
+        printf("ERROR: K3s server address too long for the request headers\n");
+        return -1;
+    }
+
+    for (int i = 0; i < K3S_ENDPOINT_COUNT; i++) {
+        for (int phase = 0; phase < LATENCY_PHASE_COUNT; phase++) {
+            latency_reset(&latency[i][phase]);
+        }
+    }
 
     client_initialized = true;
     DEBUG_PRINT("K3s client initialized successfully");
@@ -28,253 +470,851 @@ int k3s_client_init(void) {
     return 0;
 }
 
-// Helper function to send HTTP request and receive response
-// This implements the full HTTP communication flow
-static int k3s_request(const char *method, const char *path, const char *body,
-                      char *response, int response_size) {
+// Handles encode the slot index and its generation
+static k3s_handle_t make_handle(int slot) {
+    return (requests[slot].generation << 8) | slot;
+}
+
+static k3s_request_t *handle_to_request(k3s_handle_t handle) {
+    if (handle < 0 || (handle & 0xFF) >= K3S_MAX_PENDING_REQUESTS) {
+        return NULL;
+    }
+
+    k3s_request_t *req = &requests[handle & 0xFF];
+    if (req->state == K3S_REQ_FREE || req->generation != ((handle >> 8) & 0xFF)) {
+        return NULL;
+    }
+    return req;
+}
+
+// Release everything a request holds and free its slot
+static void request_release(k3s_request_t *req, bool reusable) {
+    if (req->entry != NULL) {
+        // lwIP still references the request buffers until they are acked;
+        // dropping the connection is the only way to make it let go
+        if (!link_send_done(req->entry)) {
+            reusable = false;
+        }
+        req->entry->requests++;
+        pool_release(req->entry, reusable);
+        req->entry = NULL;
+    }
+
+    if (inflater_owner == req) {
+        inflater_owner = NULL;
+    }
+
+    // Request and response buffers both live in the slot's arena
+    arena_reset(&req->arena);
+    req->request = NULL;
+    req->response = NULL;
+
+    req->state = K3S_REQ_FREE;
+    req->generation++;
+}
+
+// Deliver the outcome to the caller and free the slot
+static void request_finish(k3s_request_t *req, int result, int status_code, bool reusable) {
+    k3s_response_cb_t on_complete = req->on_complete;
+    void *user_data = req->user_data;
+
+    retry_record(req->endpoint, result, status_code);
+    latency_record_request(req);
+
+    if (result == 0) {
+        DEBUG_PRINT("Request completed successfully");
+    } else {
+        DEBUG_PRINT("Request failed with error code %d", result);
+    }
+
+    // Free the slot and return the connection first, so the callback can
+    // submit a follow-up request
+    request_release(req, reusable);
+
+    if (on_complete != NULL) {
+        on_complete(result, status_code, user_data);
+    }
+}
+
+// Handle a transport error; a reused keep-alive connection that died before
+// any response bytes arrived is retried once on a fresh connection. Once any
+// of a POST, PATCH or PUT was written the server may have acted on it, so
+// only a GET is sent again then.
+static void request_fail(k3s_request_t *req, int error) {
+    if (req->reused && !req->retried && req->response_len == 0 && !req->headers_done &&
+        (req->request_sent == 0 || req->idempotent)) {
+        DEBUG_PRINT("Pooled connection went stale, reconnecting");
+        pool_release(req->entry, false);
+        req->entry = NULL;
+        req->retried = true;
+        req->request_sent = 0;
+        req->state = K3S_REQ_QUEUED;
+        return;
+    }
+
+    printf("ERROR: K3s request failed: %s\n", tcp_error_to_string(error));
+    request_finish(req, -1, req->status_code, false);
+}
+
+static int request_inflate_output(const uint8_t *data, size_t length, void *user_data);
+
+// Act on the status line and headers once the framer has seen them all
+// Returns false if the request was finished
+static bool request_on_headers(k3s_request_t *req) {
+    DEBUG_PRINT("Received %lu header bytes", (unsigned long)req->framer.header_length);
+
+    req->status_code = req->framer.status_code;
+    req->headers_done = true;
+    DEBUG_PRINT("HTTP %d %s", req->status_code, http_status_string(req->status_code));
+
+    // Extract and sync time from Date header
+    // The framer indexed it while scanning, so there is no rescan here
+    char date_header[64];
+    if (http_header_copy(&req->framer.headers, req->response, HTTP_HEADER_DATE,
+                         date_header, sizeof(date_header)) == 0) {
+        if (time_sync_update_from_header(date_header) == 0) {
+            if (!time_sync_is_synced()) {
+                DEBUG_PRINT("Time synchronized from server");
+            }
+        }
+    }
+
+    if (req->framer.gzip) {
+        if (req->accept_gzip) {
+            gzip_inflate_init(&inflater, request_inflate_output, req);
+            req->inflating = true;
+        } else {
+            // Consumers expect JSON; handing them compressed bytes would
+            // only fail further on, or worse, half-parse
+            printf("ERROR: Unrequested gzip body\n");
+            request_finish(req, -1, req->status_code, false);
+            return false;
+        }
+    }
+
+    // Check for HTTP errors
+    if (req->status_code >= 400) {
+        printf("ERROR: HTTP %d %s\n", req->status_code,
+               http_status_string(req->status_code));
+    }
+    return true;
+}
+
+// Pass body bytes to the consumer as they arrive
+// Returns false if the consumer aborted; the caller finishes the request
+static bool request_emit_body(k3s_request_t *req, const char *data, size_t length) {
+    bool first = (req->body_received == 0);
+    req->body_received += length;
+
+    if (req->status_code >= 400) {
+        // Error bodies only go to the log (truncated)
+        if (first) {
+            int error_preview = (length < 200) ? length : 200;
+            printf("Error response: %.*s%s\n",
+                   error_preview, data,
+                   (length > 200) ? "..." : "");
+        }
+        return true;
+    }
+
+    if (req->on_body != NULL && req->on_body(data, length, req->user_data) != 0) {
+        DEBUG_PRINT("Body consumer aborted the response");
+        return false;
+    }
+
+    return true;
+}
+
+// Inflater output goes down the same path as an identity body
+static int request_inflate_output(const uint8_t *data, size_t length, void *user_data) {
+    return request_emit_body((k3s_request_t *)user_data, (const char *)data, length) ? 0 : 1;
+}
+
+// Handle one span of body bytes from the framer
+// Returns false if the request was finished
+static bool request_body(k3s_request_t *req, const char *data, size_t length) {
+    req->body_wire += length;
+
+    if (!req->inflating) {
+        if (!request_emit_body(req, data, length)) {
+            request_finish(req, -1, req->status_code, false);
+            return false;
+        }
+        return true;
+    }
+
+    inflate_result_t result = gzip_inflate_feed(&inflater, (const uint8_t *)data, length);
+    if (result == INFLATE_DONE) {
+        req->inflate_done = true;
+    } else if (result < 0) {
+        if (result == INFLATE_ERR_WINDOW) {
+            // Compressed with more history than we keep; stop asking
+            printf("ERROR: gzip window exceeds %u bytes, disabling gzip\n",
+                   INFLATE_WINDOW_SIZE);
+            gzip_enabled = false;
+        } else if (result != INFLATE_ERR_ABORTED) {
+            printf("ERROR: gzip body: %s\n", inflate_result_string(result));
+        }
+        request_finish(req, -1, req->status_code, false);
+        return false;
+    }
+    return true;
+}
+
+// Report a fully received response
+static void request_complete(k3s_request_t *req, bool complete) {
+    if (req->inflating) {
+        DEBUG_PRINT("Received %lu body bytes (%lu gzip on the wire)",
+                    (unsigned long)req->body_received, (unsigned long)req->body_wire);
+        if (!req->inflate_done) {
+            printf("ERROR: gzip body ended early\n");
+            complete = false;
+        }
+    } else {
+        DEBUG_PRINT("Received %lu body bytes", (unsigned long)req->body_received);
+    }
+
+    // Only a completely consumed response leaves the stream in sync; with
+    // keep-alive the framer, not a close, decides where the message ends
+    bool reusable = complete && !req->framer.connection_close &&
+                    req->framer.state == HTTP_FRAMER_DONE;
+    int result = (complete && req->status_code < 400) ? 0 : -1;
+
+    request_finish(req, result, req->status_code, reusable);
+}
+
+// Run newly received bytes through the framer
+// Each byte is examined once, so a response costs O(n) however it is split
+// Returns false if the request was finished
+static bool request_frame(k3s_request_t *req, const char *data, size_t length) {
+    while (true) {
+        size_t used;
+        const char *body;
+        size_t body_length;
+        http_frame_event_t event = http_framer_feed(&req->framer, data, length,
+                                                    &used, &body, &body_length);
+        data += used;
+        length -= used;
+
+        switch (event) {
+            case HTTP_FRAME_HEADERS:
+                if (!request_on_headers(req)) {
+                    return false;
+                }
+                break;
+            case HTTP_FRAME_BODY:
+                if (!request_body(req, body, body_length)) {
+                    return false;
+                }
+                break;
+            case HTTP_FRAME_COMPLETE:
+                request_complete(req, true);
+                return false;
+            case HTTP_FRAME_ERROR:
+                printf("ERROR: Failed to parse HTTP response\n");
+                request_finish(req, -1, req->status_code, false);
+                return false;
+            case HTTP_FRAME_NEED_MORE:
+                return true;
+        }
+    }
+}
+
+// Find a connection for a queued request
+static bool step_queued(k3s_request_t *req) {
+    pool_reap();
+
+    k3s_pooled_conn_t *free_slot = NULL;
+    for (int i = 0; i < K3S_CONN_POOL_SIZE; i++) {
+        k3s_pooled_conn_t *entry = &conn_pool[i];
+        if (entry->in_use || entry->closing) {
+            continue;
+        }
+        if (entry->connected && !req->retried) {
+            DEBUG_PRINT("Reusing pooled connection %d", i);
+            entry->in_use = true;
+            req->entry = entry;
+            req->reused = true;
+            req->ready_us = time_us_64();
+            req->deadline = make_timeout_time_ms(REQUEST_TIMEOUT_MS);
+            req->state = K3S_REQ_SENDING;
+            return true;
+        }
+        if (free_slot == NULL && !entry->connected) {
+            free_slot = entry;
+        }
+    }
+
+    if (free_slot == NULL && req->retried) {
+        // A retry needs a fresh connection; recycle an idle one
+        for (int i = 0; i < K3S_CONN_POOL_SIZE && free_slot == NULL; i++) {
+            if (!conn_pool[i].in_use && !conn_pool[i].closing) {
+                pool_discard(&conn_pool[i]);
+                free_slot = &conn_pool[i];
+            }
+        }
+    }
+
+    if (free_slot == NULL) {
+        // Every connection is busy; wait for one to come back
+        return false;
+    }
+
+    DEBUG_PRINT("Connecting to " SERVER_DESCRIPTION " at %s:%d...", K3S_SERVER_IP, K3S_SERVER_PORT);
+    free_slot->in_use = true;
+    free_slot->requests = 0;
+    req->entry = free_slot;
+    req->reused = false;
+
+    int ret = link_connect_start(free_slot);
+    if (ret != TCP_OK) {
+        printf("ERROR: Failed to connect to " SERVER_DESCRIPTION ": %s\n", tcp_error_to_string(ret));
+        request_finish(req, -1, 0, false);
+        return true;
+    }
+
+    req->state = K3S_REQ_CONNECTING;
+    return true;
+}
+
+static bool step_connecting(k3s_request_t *req) {
+    int ret = link_connect_poll(req->entry);
+    if (ret == TCP_PENDING) {
+        return false;
+    }
+
+    if (ret != TCP_OK) {
+        printf("ERROR: Failed to connect to " SERVER_DESCRIPTION ": %s\n", tcp_error_to_string(ret));
+        request_finish(req, -1, 0, false);
+        return true;
+    }
+
+    DEBUG_PRINT("Connected to " SERVER_DESCRIPTION);
+    req->entry->connected = true;
+    req->ready_us = time_us_64();
+    req->deadline = make_timeout_time_ms(REQUEST_TIMEOUT_MS);
+    req->state = K3S_REQ_SENDING;
+    return true;
+}
+
+static bool step_sending(k3s_request_t *req) {
+    // Head and body go to lwIP by reference, without being concatenated
+    int n = link_writev(req->entry, req->iov, req->iovcnt, req->request_sent);
+    if (n < 0) {
+        request_fail(req, n);
+        return true;
+    }
+    req->request_sent += n;
+
+    if (req->request_sent < req->request_len) {
+        if (time_reached(req->deadline)) {
+            request_fail(req, TCP_ERR_TIMEOUT);
+            return true;
+        }
+        return n > 0;
+    }
+
+    DEBUG_PRINT("Request sent successfully");
+    req->sent_us = time_us_64();
+
+    // Allocate response header buffer (kept across a stale-connection retry)
+    // Only the headers are buffered; body bytes stream through it
+    if (req->response == NULL) {
+        req->response = arena_alloc(&req->arena, HTTP_RESPONSE_HEADER_SIZE);
+    }
+    if (req->response == NULL) {
+        printf("ERROR: Failed to allocate response buffer\n");
+        request_finish(req, -1, 0, false);
+        return true;
+    }
+    req->response[0] = '\0';
+    req->response_len = 0;
+    req->headers_done = false;
+    req->status_code = 0;
+    req->body_received = 0;
+    req->body_wire = 0;
+    req->inflating = false;
+    req->inflate_done = false;
+    http_framer_init(&req->framer);
+
+    DEBUG_PRINT("Receiving HTTP response...");
+    req->state = K3S_REQ_RECEIVING;
+    return true;
+}
+
+static bool step_receiving(k3s_request_t *req) {
+    // Saved up front: finishing the request clears req->entry
+    tcp_connection_t *conn = link_tcp(req->entry);
+    bool peeked = req->headers_done && !K3S_USE_TLS;
+    bool scratch = req->headers_done && K3S_USE_TLS;
+    const char *data;
+    int received;
+
+    if (peeked) {
+        // Body bytes are framed where lwIP received them, without a copy
+        received = tcp_connection_peek(conn, (const uint8_t **)&data);
+    } else if (scratch) {
+        // TLS body bytes are decrypted into our memory anyway; the header
+        // buffer is free for them once the headers are parsed
+        received = link_read(req->entry, (uint8_t *)req->response, HTTP_RESPONSE_HEADER_SIZE);
+        data = req->response;
+    } else {
+        // Until the blank line, append to the header buffer (kept for the
+        // Date header)
+        char *dest = req->response + req->response_len;
+        int space = HTTP_RESPONSE_HEADER_SIZE - 1 - req->response_len;
+        if (space <= 0) {
+            printf("ERROR: Response headers too large\n");
+            request_finish(req, -1, 0, false);
+            return true;
+        }
+        received = link_read(req->entry, (uint8_t *)dest, space);
+        data = dest;
+    }
+
+    if (received == TCP_ERR_CLOSED) {
+        // Connection closed by the proxy - the response ends here
+        DEBUG_PRINT("Connection closed by server");
+        if (!req->headers_done && req->response_len == 0) {
+            // Keep-alive connection timed out on the proxy side
+            request_fail(req, TCP_ERR_CLOSED);
+            return true;
+        }
+        request_complete(req, http_framer_finish(&req->framer));
+        return true;
+    } else if (received < 0) {
+        request_fail(req, received);
+        return true;
+    } else if (received == 0) {
+        if (time_reached(req->deadline)) {
+            printf("ERROR: Response timeout\n");
+            request_finish(req, -1, req->status_code, false);
+            return true;
+        }
+        return false;
+    }
+
+    if (req->first_byte_us == 0) {
+        req->first_byte_us = time_us_64();
+    }
+
+    if (peeked) {
+        // Peeked span: release it once the framer is done with it (a
+        // no-op if finishing the request closed the connection)
+        request_frame(req, data, received);
+        tcp_connection_consume(conn, received);
+        return true;
+    } else if (scratch) {
+        request_frame(req, data, received);
+        return true;
+    }
+
+    req->response_len += received;
+    req->response[req->response_len] = '\0';
+    request_frame(req, data, received);
+    return true;
+}
+
+// Advance one request; returns true if it made progress
+static bool request_step(k3s_request_t *req) {
+    switch (req->state) {
+        case K3S_REQ_QUEUED:     return step_queued(req);
+        case K3S_REQ_CONNECTING: return step_connecting(req);
+        case K3S_REQ_SENDING:    return step_sending(req);
+        case K3S_REQ_RECEIVING:  return step_receiving(req);
+        default:                 return false;
+    }
+}
+
+k3s_handle_t k3s_client_submit(http_method_t method, const char *path, const char *body,
+                               k3s_body_cb_t on_body, k3s_response_cb_t on_complete,
+                               void *user_data) {
+    return k3s_client_submit_media(method, path, NULL, body,
+                                   (body != NULL) ? strlen(body) : 0,
+                                   on_body, on_complete, user_data);
+}
+
+k3s_handle_t k3s_client_submit_media(http_method_t method, const char *path,
+                                     const char *media_type,
+                                     const void *body, size_t body_len,
+                                     k3s_body_cb_t on_body, k3s_response_cb_t on_complete,
+                                     void *user_data) {
     if (!client_initialized) {
         printf("ERROR: K3s client not initialized\n");
-        return -1;
+        return K3S_INVALID_HANDLE;
     }
 
     if (path == NULL) {
         printf("ERROR: Invalid parameters\n");
-        return -1;
+        return K3S_INVALID_HANDLE;
     }
 
-    DEBUG_PRINT("K3s %s request: %s", method, path);
-
-    int ret = -1;
-    tcp_connection_t conn;
-    char *request_buffer = NULL;
-    char *response_buffer = NULL;
-
-    // Initialize connection
-    if (tcp_connection_init(&conn) != 0) {
-        printf("ERROR: Failed to initialize TCP connection\n");
-        goto cleanup;
+    int slot = -1;
+    for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+        if (requests[i].state == K3S_REQ_FREE) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        printf("ERROR: Too many pending k3s requests\n");
+        return K3S_INVALID_HANDLE;
     }
 
-    // Connect to nginx proxy (not k3s API directly)
-    DEBUG_PRINT("Connecting to nginx proxy at %s:%d...", K3S_SERVER_IP, K3S_SERVER_PORT);
-    ret = tcp_connection_connect(&conn, K3S_SERVER_IP, K3S_SERVER_PORT, CONNECT_TIMEOUT_MS);
-    if (ret != TCP_OK) {
-        printf("ERROR: Failed to connect to nginx proxy: %s\n", tcp_error_to_string(ret));
-        goto cleanup;
+    // Hold back attempts against an endpoint that is backing off or whose
+    // circuit is open, before any buffers or connections are touched
+    k3s_endpoint_t endpoint = classify_endpoint(method, path);
+    retry_policy_t *policy = &retry_policies[endpoint];
+    circuit_state_t before = policy->state;
+    if (!retry_policy_allow(policy, &retry_budget, now_ms())) {
+        DEBUG_PRINT("K3s %s %s, next attempt in %u ms", policy->name,
+                    (policy->state == CIRCUIT_CLOSED) ? "backing off" : "circuit open",
+                    (unsigned)retry_policy_wait_ms(policy, now_ms()));
+        return K3S_INVALID_HANDLE;
+    }
+    if (policy->state != before) {
+        printf("K3s %s circuit %s -> %s (probing)\n", policy->name,
+               circuit_state_string(before), circuit_state_string(policy->state));
     }
-    DEBUG_PRINT("Connected to nginx proxy");
 
-    // Allocate request buffer
-    request_buffer = malloc(HTTP_REQUEST_BUFFER_SIZE);
-    if (request_buffer == NULL) {
+    k3s_request_t *req = &requests[slot];
+
+    // Allocate request head buffer
+    // Only the request line and headers are serialized; the body is sent
+    // straight from the caller's memory
+    arena_reset(&req->arena);
+    req->request = arena_alloc(&req->arena, HTTP_REQUEST_HEADER_SIZE);
+    if (req->request == NULL) {
         printf("ERROR: Failed to allocate request buffer\n");
-        ret = -1;
-        goto cleanup;
-    }
-
-    // Determine HTTP method
-    http_method_t http_method;
-    if (strcmp(method, "GET") == 0) {
-        http_method = HTTP_METHOD_GET;
-    } else if (strcmp(method, "POST") == 0) {
-        http_method = HTTP_METHOD_POST;
-    } else if (strcmp(method, "PATCH") == 0) {
-        http_method = HTTP_METHOD_PATCH;
-    } else {
-        printf("ERROR: Unsupported HTTP method: %s\n", method);
-        ret = -1;
-        goto cleanup;
+        retry_policy_abandon(policy);
+        return K3S_INVALID_HANDLE;
     }
 
     // Build HTTP request
     const char *content_type = NULL;
-    if (http_method == HTTP_METHOD_PATCH) {
+    if (media_type != NULL) {
+        content_type = media_type;
+    } else if (method == HTTP_METHOD_PATCH) {
         // K8s PATCH uses strategic merge patch by default
         content_type = "application/strategic-merge-patch+json";
     } else if (body != NULL) {
         content_type = "application/json";
     }
 
-    int request_len = http_build_request(
-        request_buffer, HTTP_REQUEST_BUFFER_SIZE,
-        http_method,
-        K3S_SERVER_IP, K3S_SERVER_PORT,
+    // Only a GET can take the inflater: its response is the one worth
+    // compressing, and it is claimed here so the head matches what we can decode
+    bool accept_gzip = gzip_enabled && method == HTTP_METHOD_GET && inflater_owner == NULL;
+
+    int head_len = http_build_request_head_cached(
+        req->request, HTTP_REQUEST_HEADER_SIZE,
+        &request_headers,
+        method,
         path,
-        body,
-        content_type
+        content_type,
+        media_type,
+        (body != NULL) ? (long)body_len : -1,
+        true,
+        accept_gzip
     );
 
-    if (request_len < 0) {
+    if (head_len < 0) {
         printf("ERROR: Failed to build HTTP request\n");
-        ret = -1;
-        goto cleanup;
+        arena_reset(&req->arena);
+        req->request = NULL;
+        retry_policy_abandon(policy);
+        return K3S_INVALID_HANDLE;
     }
 
-    DEBUG_PRINT("Sending HTTP request (%d bytes)...", request_len);
+    // Give the unused tail of the worst-case buffer back to the arena
+    arena_shrink(&req->arena, req->request, head_len);
+
+    req->iov[0].data = req->request;
+    req->iov[0].length = head_len;
+    req->iov[1].data = body;
+    req->iov[1].length = body_len;
+    req->iovcnt = (body_len > 0) ? 2 : 1;
+    req->request_len = head_len + body_len;
+
+    DEBUG_PRINT("K3s request queued (%d bytes): %s", req->request_len, path);
     if (DEBUG_ENABLE) {
         // Print first 200 chars of request for debugging
-        int preview_len = (request_len < 200) ? request_len : 200;
-        printf("[DEBUG] Request preview:\n%.200s%s\n",
-               request_buffer,
-               (request_len > 200) ? "..." : "");
+        printf("[DEBUG] Request preview:\n%.*s%s\n",
+               (head_len > 200) ? 200 : head_len,
+               req->request,
+               (req->request_len > 200) ? "..." : "");
     }
 
-    // Send request
-    ret = tcp_connection_send(&conn, (uint8_t *)request_buffer, request_len, REQUEST_TIMEOUT_MS);
-    if (ret < 0) {
-        printf("ERROR: Failed to send HTTP request: %s\n", tcp_error_to_string(ret));
-        goto cleanup;
+    req->on_body = on_body;
+    req->on_complete = on_complete;
+    req->user_data = user_data;
+    req->endpoint = endpoint;
+    req->entry = NULL;
+    req->reused = false;
+    req->retried = false;
+    req->idempotent = (method == HTTP_METHOD_GET);
+    req->request_sent = 0;
+    req->response = NULL;
+    req->response_len = 0;
+    req->headers_done = false;
+    req->status_code = 0;
+    req->accept_gzip = accept_gzip;
+    if (accept_gzip) {
+        inflater_owner = req;
     }
-    DEBUG_PRINT("Request sent successfully");
+    req->submit_us = time_us_64();
+    req->ready_us = 0;
+    req->sent_us = 0;
+    req->first_byte_us = 0;
+    req->state = K3S_REQ_QUEUED;
 
-    // Allocate response buffer
-    response_buffer = malloc(HTTP_RESPONSE_BUFFER_SIZE);
-    if (response_buffer == NULL) {
-        printf("ERROR: Failed to allocate response buffer\n");
-        ret = -1;
-        goto cleanup;
+    int in_use = 0;
+    for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+        if (requests[i].state != K3S_REQ_FREE) {
+            in_use++;
+        }
+    }
+    if (in_use > slots_high_water) {
+        slots_high_water = in_use;
     }
 
-    // Receive response
-    DEBUG_PRINT("Receiving HTTP response...");
-    int total_received = 0;
-    absolute_time_t start_time = get_absolute_time();
+    return make_handle(slot);
+}
 
-    while (total_received < HTTP_RESPONSE_BUFFER_SIZE - 1) {
-        // Check for timeout
-        if (absolute_time_diff_us(start_time, get_absolute_time()) > REQUEST_TIMEOUT_MS * 1000) {
-            printf("ERROR: Response timeout\n");
-            ret = TCP_ERR_TIMEOUT;
-            goto cleanup;
-        }
-
-        // Try to receive more data
-        int received = tcp_connection_recv(
-            &conn,
-            (uint8_t *)(response_buffer + total_received),
-            HTTP_RESPONSE_BUFFER_SIZE - total_received - 1,
-            1000  // 1 second timeout per recv
-        );
-
-        if (received < 0) {
-            printf("ERROR: Failed to receive response: %s\n", tcp_error_to_string(received));
-            ret = received;
-            goto cleanup;
-        } else if (received == 0) {
-            // Connection closed - this is expected with Connection: close
-            DEBUG_PRINT("Connection closed by server (received %d bytes total)", total_received);
-            break;
-        }
+bool k3s_client_is_pending(k3s_handle_t handle) {
+    return handle_to_request(handle) != NULL;
+}
+
+void k3s_client_cancel(k3s_handle_t handle) {
+    k3s_request_t *req = handle_to_request(handle);
+    if (req == NULL) {
+        return;
+    }
 
-        total_received += received;
+    DEBUG_PRINT("K3s request cancelled");
 
-        // Check if we have a complete HTTP response
-        // Look for end of headers + body
-        response_buffer[total_received] = '\0';
+    // A cancelled request says nothing about the server's health
+    retry_policy_abandon(&retry_policies[req->endpoint]);
 
-        // If we see "\r\n\r\n", we have headers
-        char *body_start = strstr(response_buffer, "\r\n\r\n");
-        if (body_start != NULL) {
-            // Check if we have Content-Length
-            char content_length_str[32];
-            if (http_get_header(response_buffer, "Content-Length",
-                              content_length_str, sizeof(content_length_str)) == 0) {
-                int content_length = atoi(content_length_str);
-                int headers_length = (body_start + 4) - response_buffer;
-                int expected_total = headers_length + content_length;
+    // A half-read response leaves the connection out of sync
+    request_release(req, false);
+}
 
-                if (total_received >= expected_total) {
-                    DEBUG_PRINT("Received complete response with Content-Length");
-                    break;
-                }
+void k3s_client_poll(void) {
+    if (!client_initialized) {
+        return;
+    }
+
+    // Repeat while anything moves: a request finishing late in a pass can
+    // free the connection an earlier queued request is waiting for, and
+    // the main loop won't come back until the network wakes it
+    bool progress;
+    do {
+        progress = false;
+        for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+            // Keep stepping while the state machine makes progress, so a
+            // request can go from queued to receiving in a single tick
+            while (requests[i].state != K3S_REQ_FREE && request_step(&requests[i])) {
+                progress = true;
             }
         }
+    } while (progress);
+
+    pool_reap();
+}
+
+absolute_time_t k3s_client_next_deadline(void) {
+    absolute_time_t next = at_the_end_of_time;
+    if (!client_initialized) {
+        return next;
+    }
+
+    // Everything else a request waits for arrives from the network
+    for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+        k3s_request_t *req = &requests[i];
+        switch (req->state) {
+            case K3S_REQ_CONNECTING:
+                next = absolute_time_min(next, link_deadline(req->entry));
+                break;
+            case K3S_REQ_SENDING:
+            case K3S_REQ_RECEIVING:
+                next = absolute_time_min(next, req->deadline);
+                break;
+            default:
+                break;
+        }
+    }
 
-        // Poll WiFi to keep connection alive
-        cyw43_arch_poll();
+    // Idle keep-alive connections expire
+    for (int i = 0; i < K3S_CONN_POOL_SIZE; i++) {
+        if (conn_pool[i].connected && !conn_pool[i].in_use) {
+            next = absolute_time_min(next, delayed_by_ms(conn_pool[i].last_used,
+                                                         K3S_CONN_IDLE_TIMEOUT_MS));
+        } else if (conn_pool[i].closing) {
+            // Gives up waiting for the close_notify ACK
+            next = absolute_time_min(next, link_deadline(&conn_pool[i]));
+        }
     }
+    return next;
+}
 
-    if (total_received == 0) {
-        printf("ERROR: No response received\n");
-        ret = -1;
-        goto cleanup;
+const retry_policy_t *k3s_client_get_retry_state(k3s_endpoint_t endpoint) {
+    if (endpoint < 0 || endpoint >= K3S_ENDPOINT_COUNT) {
+        return NULL;
     }
+    return &retry_policies[endpoint];
+}
 
-    // Null-terminate response
-    response_buffer[total_received] = '\0';
-    DEBUG_PRINT("Received %d bytes", total_received);
+const retry_budget_t *k3s_client_get_retry_budget(void) {
+    return &retry_budget;
+}
 
-    // Parse HTTP response
-    http_response_t http_response;
-    ret = http_parse_response(response_buffer, total_received, &http_response);
-    if (ret != 0) {
-        printf("ERROR: Failed to parse HTTP response\n");
-        goto cleanup;
+const latency_histogram_t *k3s_client_get_latency(k3s_endpoint_t endpoint, latency_phase_t phase) {
+    if (endpoint < 0 || endpoint >= K3S_ENDPOINT_COUNT ||
+        phase < 0 || phase >= LATENCY_PHASE_COUNT) {
+        return NULL;
     }
+    return &latency[endpoint][phase];
+}
 
-    DEBUG_PRINT("HTTP %d %s", http_response.status_code,
-                http_status_string(http_response.status_code));
+int k3s_client_format_latency(char *buffer, size_t size, uint32_t *cursor) {
+    static const char header[] =
+        "# HELP " LATENCY_METRIC " K3s API request latency by endpoint and phase.\n"
+        "# TYPE " LATENCY_METRIC " histogram\n";
+    const uint32_t lines = K3S_ENDPOINT_COUNT * LATENCY_PHASE_COUNT * LATENCY_LINES;
+    size_t used = 0;
 
-    // Extract and sync time from Date header
-    char date_header[64];
-    if (http_get_header(response_buffer, "Date", date_header, sizeof(date_header)) == 0) {
-        if (time_sync_update_from_header(date_header) == 0) {
-            if (!time_sync_is_synced()) {
-                DEBUG_PRINT("Time synchronized from server");
-            }
+    // Position 0 is the header, then one position per histogram line
+    if (*cursor == 0) {
+        if (size < sizeof(header)) {
+            return 0;
         }
+        memcpy(buffer, header, sizeof(header) - 1);
+        used = sizeof(header) - 1;
+        *cursor = 1;
     }
 
-    // Check for HTTP errors
-    if (http_response.status_code >= 400) {
-        printf("ERROR: HTTP %d %s\n", http_response.status_code,
-               http_status_string(http_response.status_code));
-        if (http_response.body != NULL && http_response.body_length > 0) {
-            // Print error body (truncated)
-            int error_preview = (http_response.body_length < 200) ?
-                               http_response.body_length : 200;
-            printf("Error response: %.*s%s\n",
-                   error_preview, http_response.body,
-                   (http_response.body_length > 200) ? "..." : "");
+    while (*cursor != K3S_LATENCY_DONE) {
+        uint32_t index = *cursor - 1;
+        if (index >= lines) {
+            *cursor = K3S_LATENCY_DONE;
+            break;
         }
-        ret = -1;
-        goto cleanup;
-    }
 
-    // Copy response body to output buffer if provided
-    if (response != NULL && response_size > 0) {
-        if (http_response.body != NULL && http_response.body_length > 0) {
-            int copy_len = (http_response.body_length < (size_t)(response_size - 1)) ?
-                          http_response.body_length : (response_size - 1);
-            memcpy(response, http_response.body, copy_len);
-            response[copy_len] = '\0';
-            DEBUG_PRINT("Copied %d bytes to response buffer", copy_len);
-        } else {
-            response[0] = '\0';
+        int series = index / LATENCY_LINES;
+        int line = index % LATENCY_LINES;
+        k3s_endpoint_t endpoint = (k3s_endpoint_t)(series / LATENCY_PHASE_COUNT);
+        latency_phase_t phase = (latency_phase_t)(series % LATENCY_PHASE_COUNT);
+        const latency_histogram_t *h = &latency[endpoint][phase];
+
+        // Leave out phases an endpoint never went through
+        if (h->count == 0) {
+            *cursor += LATENCY_LINES - line;
+            continue;
+        }
+
+        char labels[48];
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",phase=\"%s\"",
+                 endpoint_names[endpoint], latency_phase_name(phase));
+
+        int n = latency_format_line(buffer + used, size - used, LATENCY_METRIC, labels, h, line);
+        if (n < 0) {
+            // Out of room; resume at this line
+            break;
         }
+        used += n;
+        (*cursor)++;
     }
 
-    ret = 0;  // Success
+    return (int)used;
+}
 
-cleanup:
-    // Close connection
-    tcp_connection_close(&conn);
+void k3s_client_get_memory_stats(k3s_memory_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->arena_size = K3S_REQUEST_ARENA_SIZE;
+    stats->slots_total = K3S_MAX_PENDING_REQUESTS;
+    stats->slots_high_water = slots_high_water;
 
-    // Free buffers
-    if (request_buffer != NULL) {
-        free(request_buffer);
+    for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+        k3s_request_t *req = &requests[i];
+        if (req->state != K3S_REQ_FREE) {
+            stats->slots_in_use++;
+        }
+        size_t high_water = arena_high_water(&req->arena);
+        if (high_water > stats->arena_high_water) {
+            stats->arena_high_water = high_water;
+        }
+        stats->alloc_failures += req->arena.failures;
     }
-    if (response_buffer != NULL) {
-        free(response_buffer);
+}
+
+// Completion state for the blocking wrappers
+typedef struct {
+    bool done;
+    int result;
+    k3s_body_cb_t on_body;
+    void *body_user_data;
+} k3s_sync_ctx_t;
+
+static int sync_body(const char *data, size_t length, void *user_data) {
+    k3s_sync_ctx_t *ctx = (k3s_sync_ctx_t *)user_data;
+    return ctx->on_body ? ctx->on_body(data, length, ctx->body_user_data) : 0;
+}
+
+static void sync_complete(int result, int status_code, void *user_data) {
+    k3s_sync_ctx_t *ctx = (k3s_sync_ctx_t *)user_data;
+    ctx->result = result;
+    ctx->done = true;
+}
+
+// Helper function to send HTTP request and receive response
+// Blocking wrapper around the asynchronous engine: submits the request and
+// drives k3s_client_poll() until it completes. Must not be called from a
+// completion callback.
+static int k3s_request(http_method_t method, const char *path, const char *media_type,
+                      const void *body, size_t body_len,
+                      k3s_body_cb_t on_body, void *body_user_data) {
+    k3s_sync_ctx_t ctx = {
+        .done = false,
+        .result = -1,
+        .on_body = on_body,
+        .body_user_data = body_user_data
+    };
+
+    k3s_handle_t handle = k3s_client_submit_media(method, path, media_type, body, body_len,
+                                                  sync_body, sync_complete, &ctx);
+    if (handle == K3S_INVALID_HANDLE) {
+        return -1;
     }
 
-    if (ret == 0) {
-        DEBUG_PRINT("Request completed successfully");
-    } else {
-        DEBUG_PRINT("Request failed with error code %d", ret);
+    while (!ctx.done) {
+        k3s_client_poll();
+        if (!ctx.done) {
+            net_wait_until(k3s_client_next_deadline());
+        }
     }
 
-    return ret;
+    return ctx.result;
+}
+
+// Destination for k3s_client_get()
+typedef struct {
+    char *buffer;
+    int size;
+    int length;
+} k3s_copy_ctx_t;
+
+// Copy body chunks straight into the caller's buffer, truncating
+static int copy_body(const char *data, size_t length, void *user_data) {
+    k3s_copy_ctx_t *ctx = (k3s_copy_ctx_t *)user_data;
+
+    int space = ctx->size - 1 - ctx->length;
+    int copy_len = (length < (size_t)space) ? (int)length : space;
+    if (copy_len > 0) {
+        memcpy(ctx->buffer + ctx->length, data, copy_len);
+        ctx->length += copy_len;
+        ctx->buffer[ctx->length] = '\0';
+    }
+    return 0;
 }
 
 int k3s_client_get(const char *path, char *response, int response_size) {
@@ -283,7 +1323,24 @@ int k3s_client_get(const char *path, char *response, int response_size) {
         return -1;
     }
 
-    return k3s_request("GET", path, NULL, response, response_size);
+    k3s_copy_ctx_t ctx = { .buffer = response, .size = response_size, .length = 0 };
+    response[0] = '\0';
+
+    int result = k3s_request(HTTP_METHOD_GET, path, NULL, NULL, 0, copy_body, &ctx);
+    if (result == 0) {
+        DEBUG_PRINT("Copied %d bytes to response buffer", ctx.length);
+    }
+    return result;
+}
+
+int k3s_client_get_stream(const char *path, const char *media_type,
+                          k3s_body_cb_t on_body, void *user_data) {
+    if (on_body == NULL) {
+        printf("ERROR: Streaming GET requires a body callback\n");
+        return -1;
+    }
+
+    return k3s_request(HTTP_METHOD_GET, path, media_type, NULL, 0, on_body, user_data);
 }
 
 int k3s_client_post(const char *path, const char *body) {
@@ -292,7 +1349,7 @@ int k3s_client_post(const char *path, const char *body) {
         return -1;
     }
 
-    return k3s_request("POST", path, body, NULL, 0);
+    return k3s_request(HTTP_METHOD_POST, path, NULL, body, strlen(body), NULL, NULL);
 }
 
 int k3s_client_patch(const char *path, const char *body) {
@@ -301,7 +1358,16 @@ int k3s_client_patch(const char *path, const char *body) {
         return -1;
     }
 
-    return k3s_request("PATCH", path, body, NULL, 0);
+    return k3s_request(HTTP_METHOD_PATCH, path, NULL, body, strlen(body), NULL, NULL);
+}
+
+int k3s_client_put(const char *path, const char *media_type, const void *body, size_t body_len) {
+    if (body == NULL) {
+        printf("ERROR: PUT requires a body\n");
+        return -1;
+    }
+
+    return k3s_request(HTTP_METHOD_PUT, path, media_type, body, body_len, NULL, NULL);
 }
 
 void k3s_client_shutdown(void) {
@@ -309,6 +1375,21 @@ void k3s_client_shutdown(void) {
         return;
     }
 
+    for (int i = 0; i < K3S_MAX_PENDING_REQUESTS; i++) {
+        if (requests[i].state != K3S_REQ_FREE) {
+            request_release(&requests[i], false);
+        }
+    }
+
+    for (int i = 0; i < K3S_CONN_POOL_SIZE; i++) {
+        conn_pool[i].in_use = false;
+        pool_discard(&conn_pool[i]);
+        if (conn_pool[i].closing) {
+            link_abort(&conn_pool[i]);
+            conn_pool[i].closing = false;
+        }
+    }
+
     client_initialized = false;
     DEBUG_PRINT("K3s client shutdown");
 }
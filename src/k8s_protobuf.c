@@ -0,0 +1,471 @@
+#include "k8s_protobuf.h"
+#include <string.h>
+
+// Wire types
+#define PB_WIRE_VARINT   0
+#define PB_WIRE_FIXED64  1
+#define PB_WIRE_LEN      2
+#define PB_WIRE_FIXED32  5
+
+// --- Writer ---
+
+void pb_writer_init(pb_writer_t *w, uint8_t *buffer, size_t size) {
+    w->buffer = buffer;
+    w->size = size;
+    w->length = 0;
+    w->overflow = false;
+}
+
+static size_t varint_size(uint64_t value) {
+    size_t n = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static void put_raw_varint(pb_writer_t *w, uint64_t value) {
+    if (w->overflow || varint_size(value) > w->size - w->length) {
+        w->overflow = true;
+        return;
+    }
+    while (value >= 0x80) {
+        w->buffer[w->length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    w->buffer[w->length++] = (uint8_t)value;
+}
+
+static void put_tag(pb_writer_t *w, uint32_t field, uint8_t wire_type) {
+    put_raw_varint(w, ((uint64_t)field << 3) | wire_type);
+}
+
+void pb_write_varint(pb_writer_t *w, uint32_t field, uint64_t value) {
+    put_tag(w, field, PB_WIRE_VARINT);
+    put_raw_varint(w, value);
+}
+
+void pb_write_bytes(pb_writer_t *w, uint32_t field, const void *data, size_t length) {
+    put_tag(w, field, PB_WIRE_LEN);
+    put_raw_varint(w, length);
+    if (w->overflow || length > w->size - w->length) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buffer + w->length, data, length);
+    w->length += length;
+}
+
+void pb_write_string(pb_writer_t *w, uint32_t field, const char *value) {
+    if (value != NULL) {
+        pb_write_bytes(w, field, value, strlen(value));
+    }
+}
+
+size_t pb_begin_message(pb_writer_t *w, uint32_t field) {
+    put_tag(w, field, PB_WIRE_LEN);
+    put_raw_varint(w, 0);       // Placeholder, fixed up by pb_end_message()
+    return w->length;
+}
+
+void pb_end_message(pb_writer_t *w, size_t mark) {
+    if (w->overflow) {
+        return;
+    }
+
+    size_t length = w->length - mark;
+    size_t extra = varint_size(length) - 1;
+    if (extra > w->size - w->length) {
+        w->overflow = true;
+        return;
+    }
+    if (extra > 0) {
+        memmove(w->buffer + mark + extra, w->buffer + mark, length);
+        w->length += extra;
+    }
+
+    // Rewrite the length in place of the placeholder
+    size_t saved = w->length;
+    w->length = mark - 1;
+    put_raw_varint(w, length);
+    w->length = saved;
+}
+
+// --- Node status ---
+
+// Keep in sync with status_only_json_template in node_status.c
+static const struct {
+    const char *type;
+    const char *status;
+    const char *reason;
+    const char *message;
+} node_conditions[] = {
+    { "Ready",              "True",  "KubeletReady",               "Pico node is ready" },
+    { "MemoryPressure",     "False", "KubeletHasSufficientMemory", NULL },
+    { "DiskPressure",       "False", "KubeletHasNoDiskPressure",   NULL },
+    { "PIDPressure",        "False", "KubeletHasSufficientPID",    NULL },
+    { "NetworkUnavailable", "False", "RouteCreated",               NULL },
+};
+
+static const char *const node_resources[][2] = {
+    { "cpu", "1" }, { "memory", "256Ki" }, { "pods", "0" },
+};
+
+// NodeSystemInfo fields 1-10, in field order
+static const char *const node_info[] = {
+    "rp2040-pico-wh",       // machineID
+    "rp2040-pico-wh",       // systemUUID
+    "rp2040-pico-wh",       // bootID
+    "5.15.0-rp2040",        // kernelVersion
+    "Pico SDK",             // osImage
+    "mock://1.0.0",         // containerRuntimeVersion
+    "v1.34.0",              // kubeletVersion
+    "v1.34.0",              // kubeProxyVersion
+    "linux",                // operatingSystem
+    "arm",                  // architecture
+};
+
+static void write_time(pb_writer_t *w, uint32_t field, int64_t seconds) {
+    size_t mark = pb_begin_message(w, field);
+    pb_write_varint(w, K8S_PB_TIME_SECONDS, (uint64_t)seconds);
+    pb_end_message(w, mark);
+}
+
+// ResourceList is map<string, Quantity>
+static void write_resources(pb_writer_t *w, uint32_t field) {
+    for (size_t i = 0; i < sizeof(node_resources) / sizeof(node_resources[0]); i++) {
+        size_t entry = pb_begin_message(w, field);
+        pb_write_string(w, K8S_PB_MAP_KEY, node_resources[i][0]);
+        size_t quantity = pb_begin_message(w, K8S_PB_MAP_VALUE);
+        pb_write_string(w, K8S_PB_QUANTITY_STRING, node_resources[i][1]);
+        pb_end_message(w, quantity);
+        pb_end_message(w, entry);
+    }
+}
+
+static void write_address(pb_writer_t *w, const char *type, const char *address) {
+    size_t mark = pb_begin_message(w, K8S_PB_NODE_STATUS_ADDRESSES);
+    pb_write_string(w, K8S_PB_ADDRESS_TYPE, type);
+    pb_write_string(w, K8S_PB_ADDRESS_ADDRESS, address);
+    pb_end_message(w, mark);
+}
+
+int k8s_pb_encode_node_status(uint8_t *buffer, size_t size, const k8s_node_status_t *status) {
+    pb_writer_t w;
+
+    if (size < K8S_PROTOBUF_MAGIC_LEN) {
+        return -1;
+    }
+    memcpy(buffer, K8S_PROTOBUF_MAGIC, K8S_PROTOBUF_MAGIC_LEN);
+    pb_writer_init(&w, buffer + K8S_PROTOBUF_MAGIC_LEN, size - K8S_PROTOBUF_MAGIC_LEN);
+
+    // runtime.Unknown envelope
+    size_t type_meta = pb_begin_message(&w, K8S_PB_UNKNOWN_TYPE_META);
+    pb_write_string(&w, K8S_PB_TYPE_META_API_VERSION, "v1");
+    pb_write_string(&w, K8S_PB_TYPE_META_KIND, "Node");
+    pb_end_message(&w, type_meta);
+
+    size_t node = pb_begin_message(&w, K8S_PB_UNKNOWN_RAW);
+
+    size_t meta = pb_begin_message(&w, K8S_PB_NODE_METADATA);
+    pb_write_string(&w, K8S_PB_META_NAME, status->name);
+    pb_end_message(&w, meta);
+
+    size_t node_status = pb_begin_message(&w, K8S_PB_NODE_STATUS);
+
+    write_resources(&w, K8S_PB_NODE_STATUS_CAPACITY);
+    write_resources(&w, K8S_PB_NODE_STATUS_ALLOCATABLE);
+
+    for (size_t i = 0; i < sizeof(node_conditions) / sizeof(node_conditions[0]); i++) {
+        size_t condition = pb_begin_message(&w, K8S_PB_NODE_STATUS_CONDITIONS);
+        pb_write_string(&w, K8S_PB_CONDITION_TYPE, node_conditions[i].type);
+        pb_write_string(&w, K8S_PB_CONDITION_STATUS, node_conditions[i].status);
+        write_time(&w, K8S_PB_CONDITION_HEARTBEAT, status->heartbeat_time);
+        write_time(&w, K8S_PB_CONDITION_TRANSITION, status->transition_time);
+        pb_write_string(&w, K8S_PB_CONDITION_REASON, node_conditions[i].reason);
+        pb_write_string(&w, K8S_PB_CONDITION_MESSAGE, node_conditions[i].message);
+        pb_end_message(&w, condition);
+    }
+
+    write_address(&w, "InternalIP", status->internal_ip);
+    write_address(&w, "Hostname", status->hostname);
+
+    size_t daemon = pb_begin_message(&w, K8S_PB_NODE_STATUS_DAEMON_EP);
+    size_t kubelet = pb_begin_message(&w, K8S_PB_DAEMON_EP_KUBELET);
+    pb_write_varint(&w, K8S_PB_DAEMON_EP_PORT, (uint64_t)(int64_t)status->kubelet_port);
+    pb_end_message(&w, kubelet);
+    pb_end_message(&w, daemon);
+
+    size_t info = pb_begin_message(&w, K8S_PB_NODE_STATUS_NODE_INFO);
+    for (size_t i = 0; i < sizeof(node_info) / sizeof(node_info[0]); i++) {
+        pb_write_string(&w, K8S_PB_NODE_INFO_MACHINE_ID + i, node_info[i]);
+    }
+    pb_end_message(&w, info);
+
+    pb_end_message(&w, node_status);
+    pb_end_message(&w, node);
+
+    if (w.overflow) {
+        return -1;
+    }
+    return (int)(K8S_PROTOBUF_MAGIC_LEN + w.length);
+}
+
+// --- Streaming decoder ---
+
+enum {
+    DEC_MAGIC,
+    DEC_TAG,
+    DEC_VARINT,
+    DEC_LENGTH,
+    DEC_BYTES,
+    DEC_SKIP,
+    DEC_ERROR
+};
+
+void k8s_pb_decoder_init(k8s_pb_decoder_t *d, const k8s_pb_handlers_t *handlers,
+                         void *user_data) {
+    memset(d, 0, sizeof(*d));
+    d->handlers = handlers;
+    d->user_data = user_data;
+    d->state = DEC_MAGIC;
+}
+
+// Accumulate one varint byte; returns 1 when complete, 0 for more, -1 if too long
+static int varint_byte(k8s_pb_decoder_t *d, uint8_t byte) {
+    if (d->shift >= 64) {
+        return -1;
+    }
+    d->varint |= (uint64_t)(byte & 0x7F) << d->shift;
+    d->shift += 7;
+    if (byte & 0x80) {
+        return 0;
+    }
+    d->shift = 0;
+    return 1;
+}
+
+// Close the messages that end at the current offset
+static int field_done(k8s_pb_decoder_t *d) {
+    while (d->depth > 0 && d->offset == d->ends[d->depth - 1]) {
+        d->depth--;
+    }
+    if (d->depth > 0 && d->offset > d->ends[d->depth - 1]) {
+        return K8S_PB_ERROR;    // Field ran past its enclosing message
+    }
+    d->state = DEC_TAG;
+    d->varint = 0;
+    return K8S_PB_OK;
+}
+
+// A length-delimited field's length is known
+static int start_len_field(k8s_pb_decoder_t *d, uint64_t length) {
+    if (d->depth > 0 && length > d->ends[d->depth - 1] - d->offset) {
+        return K8S_PB_ERROR;
+    }
+    if (length > UINT32_MAX - d->offset) {
+        return K8S_PB_ERROR;
+    }
+
+    const k8s_pb_handlers_t *h = d->handlers;
+    if (h->enter != NULL && h->enter(d, d->field)) {
+        if (d->depth == K8S_PB_MAX_DEPTH) {
+            return K8S_PB_ERROR;
+        }
+        d->path[d->depth] = d->field;
+        d->ends[d->depth] = d->offset + (uint32_t)length;
+        d->depth++;
+        return field_done(d);   // An empty message closes at once
+    }
+
+    d->remaining = (uint32_t)length;
+    if (length == 0) {
+        if (h->bytes != NULL && h->bytes(d, d->field, NULL, 0, true) != 0) {
+            return K8S_PB_ABORTED;
+        }
+        return field_done(d);
+    }
+    d->state = DEC_BYTES;
+    return K8S_PB_OK;
+}
+
+static int decode_tag(k8s_pb_decoder_t *d, uint64_t tag) {
+    d->field = (uint32_t)(tag >> 3);
+    d->wire_type = tag & 7;
+    d->varint = 0;
+
+    if (d->field == 0) {
+        return K8S_PB_ERROR;
+    }
+
+    switch (d->wire_type) {
+        case PB_WIRE_VARINT:
+            d->state = DEC_VARINT;
+            break;
+        case PB_WIRE_LEN:
+            d->state = DEC_LENGTH;
+            break;
+        case PB_WIRE_FIXED64:
+        case PB_WIRE_FIXED32:
+            d->remaining = (d->wire_type == PB_WIRE_FIXED64) ? 8 : 4;
+            d->state = DEC_SKIP;
+            break;
+        default:
+            return K8S_PB_ERROR;    // Groups are not used by Kubernetes
+    }
+    return K8S_PB_OK;
+}
+
+int k8s_pb_feed(k8s_pb_decoder_t *d, const uint8_t *data, size_t length) {
+    const k8s_pb_handlers_t *h = d->handlers;
+    size_t i = 0;
+
+    while (i < length) {
+        int result = K8S_PB_OK;
+
+        switch (d->state) {
+            case DEC_MAGIC:
+                if (data[i++] != (uint8_t)K8S_PROTOBUF_MAGIC[d->shift]) {
+                    result = K8S_PB_ERROR;
+                } else if (++d->shift == K8S_PROTOBUF_MAGIC_LEN) {
+                    d->shift = 0;
+                    d->state = DEC_TAG;
+                }
+                break;
+
+            case DEC_TAG:
+            case DEC_VARINT:
+            case DEC_LENGTH: {
+                int done = varint_byte(d, data[i++]);
+                d->offset++;
+                if (done < 0) {
+                    result = K8S_PB_ERROR;
+                } else if (done > 0) {
+                    uint64_t value = d->varint;
+                    if (d->state == DEC_TAG) {
+                        result = decode_tag(d, value);
+                    } else if (d->state == DEC_LENGTH) {
+                        result = start_len_field(d, value);
+                    } else {
+                        if (h->varint != NULL && h->varint(d, d->field, value) != 0) {
+                            result = K8S_PB_ABORTED;
+                        } else {
+                            result = field_done(d);
+                        }
+                    }
+                }
+                break;
+            }
+
+            case DEC_BYTES:
+            case DEC_SKIP: {
+                size_t n = length - i;
+                if (n > d->remaining) {
+                    n = d->remaining;
+                }
+                d->remaining -= (uint32_t)n;
+                d->offset += (uint32_t)n;
+                if (d->state == DEC_BYTES && h->bytes != NULL &&
+                    h->bytes(d, d->field, data + i, n, d->remaining == 0) != 0) {
+                    result = K8S_PB_ABORTED;
+                }
+                i += n;
+                if (result == K8S_PB_OK && d->remaining == 0) {
+                    result = field_done(d);
+                }
+                break;
+            }
+
+            default:
+                result = K8S_PB_ERROR;
+                break;
+        }
+
+        if (result != K8S_PB_OK) {
+            d->state = DEC_ERROR;
+            return result;
+        }
+    }
+
+    return K8S_PB_OK;
+}
+
+bool k8s_pb_finish(const k8s_pb_decoder_t *d) {
+    return d->state == DEC_TAG && d->depth == 0 && d->shift == 0;
+}
+
+// --- ConfigMap ---
+
+// Descend into Unknown.raw, then into the data map entries
+static bool configmap_enter(k8s_pb_decoder_t *d, uint32_t field) {
+    k8s_pb_configmap_t *cm = (k8s_pb_configmap_t *)d->user_data;
+
+    if (d->depth == 0) {
+        return field == K8S_PB_UNKNOWN_RAW;
+    }
+    if (d->depth == 1 && field == K8S_PB_CONFIGMAP_DATA) {
+        cm->key_matched = 0;
+        cm->key_match = false;
+        return true;
+    }
+    return false;
+}
+
+static int configmap_bytes(k8s_pb_decoder_t *d, uint32_t field,
+                           const uint8_t *data, size_t length, bool last) {
+    k8s_pb_configmap_t *cm = (k8s_pb_configmap_t *)d->user_data;
+
+    if (d->depth != 2 || d->path[1] != K8S_PB_CONFIGMAP_DATA || cm->found) {
+        return 0;
+    }
+
+    if (field == K8S_PB_MAP_KEY) {
+        // Compare the key piece by piece; any mismatch parks key_matched
+        // past the end so later pieces can't match
+        size_t key_len = strlen(cm->key);
+        for (size_t i = 0; i < length; i++) {
+            if (cm->key_matched < key_len && data[i] == (uint8_t)cm->key[cm->key_matched]) {
+                cm->key_matched++;
+            } else {
+                cm->key_matched = key_len + 1;
+            }
+        }
+        if (last) {
+            cm->key_match = (cm->key_matched == key_len);
+        }
+    } else if (field == K8S_PB_MAP_VALUE && cm->key_match) {
+        size_t space = cm->value_size - 1 - cm->value_len;
+        size_t n = (length < space) ? length : space;
+        memcpy(cm->value + cm->value_len, data, n);
+        cm->value_len += n;
+        cm->value[cm->value_len] = '\0';
+        if (last) {
+            cm->found = true;
+        }
+    }
+    return 0;
+}
+
+static const k8s_pb_handlers_t configmap_handlers = {
+    .enter = configmap_enter,
+    .bytes = configmap_bytes,
+    .varint = NULL,
+};
+
+void k8s_pb_configmap_init(k8s_pb_configmap_t *cm, const char *key,
+                           char *value, size_t value_size) {
+    cm->key = key;
+    cm->key_matched = 0;
+    cm->key_match = false;
+    cm->value = value;
+    cm->value_size = value_size;
+    cm->value_len = 0;
+    cm->found = false;
+    value[0] = '\0';
+    k8s_pb_decoder_init(&cm->decoder, &configmap_handlers, cm);
+}
+
+int k8s_pb_configmap_feed(k8s_pb_configmap_t *cm, const uint8_t *data, size_t length) {
+    return k8s_pb_feed(&cm->decoder, data, length);
+}
@@ -1,9 +1,19 @@
 #include "kubelet_server.h"
 #include "config.h"
+#include "k3s_client.h"
+#include "dns_cache.h"
+#include "scan.h"
+#include "tcp_connection.h"
+#if K3S_USE_TLS
+#include "tls_context.h"
+#include "tls_heap.h"
+#include "crypto_worker.h"
+#endif
 #include "pico/cyw43_arch.h"
 #include "lwip/tcp.h"
 #include "lwip/pbuf.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // HTTP responses
@@ -15,10 +25,10 @@ static const char *healthz_response =
     "\r\n"
     "ok";
 
+// Metrics are streamed after this head; the close marks the end of the body
 static const char *metrics_response =
     "HTTP/1.1 200 OK\r\n"
     "Content-Type: text/plain; version=0.0.4\r\n"
-    "Content-Length: 0\r\n"
     "Connection: close\r\n"
     "\r\n";
 
@@ -39,13 +49,47 @@ typedef struct {
     char recv_buffer[512];
     int recv_len;
     bool response_sent;
+    bool streaming_metrics;     // Metrics body still being written
+    uint32_t metrics_cursor;    // Resume point for k3s_client_format_latency()
+    uint8_t metrics_section;    // Next of metrics_sections[] to write
+    uint8_t stream_stalls;      // Polls in a row the stream made no progress
 } kubelet_conn_t;
 
+// Staging buffer for metrics lines (tcp_write copies out of it); holds
+// the largest counter section with every value at its maximum
+static char metrics_chunk[1024];
+
+// Counter sections written after the latency histograms, each in one piece
+static int (*const metrics_sections[])(char *buffer, size_t size) = {
+    dns_cache_format_metrics,
+    tcp_connection_format_pcb_metrics,
+#if K3S_USE_TLS
+    tls_context_format_metrics,
+    tls_heap_format_metrics,
+    tls_heap_format_sizing_metrics,
+#endif
+#if K3S_TLS_OFFLOAD
+    crypto_worker_format_metrics,
+#endif
+};
+#define METRICS_SECTION_COUNT (sizeof(metrics_sections) / sizeof(metrics_sections[0]))
+
+// After a response with a Content-Length, the client closing first keeps
+// our PCB out of TIME_WAIT; give it this many lwIP poll intervals (500 ms)
+#define KUBELET_CLOSE_WAIT_POLLS 4
+
+// A metrics write that fails with nothing in flight gets no sent callback
+// to resume it; the stream is retried every poll interval (500 ms) instead,
+// and the connection aborted after this many retries without progress
+#define KUBELET_STREAM_STALL_POLLS 10
+
 // Forward declarations
 static err_t kubelet_accept(void *arg, struct tcp_pcb *newpcb, err_t err);
 static err_t kubelet_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err);
 static void kubelet_err(void *arg, err_t err);
 static err_t kubelet_sent(void *arg, struct tcp_pcb *pcb, u16_t len);
+static err_t kubelet_poll(void *arg, struct tcp_pcb *pcb);
+static err_t kubelet_stream_poll(void *arg, struct tcp_pcb *pcb);
 
 int kubelet_server_init(void) {
     DEBUG_PRINT("Initializing kubelet server on port %d", KUBELET_PORT);
@@ -113,14 +157,134 @@ static err_t kubelet_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
     return ERR_OK;
 }
 
+// Close a connection and free its state
+// Callbacks are detached first: lwIP may still deliver sent events for the
+// queued response after tcp_close()
+static void kubelet_close(struct tcp_pcb *pcb, kubelet_conn_t *conn) {
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_err(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_poll(pcb, NULL, 0);
+    tcp_close(pcb);
+    free(conn);
+}
+
+// The client hasn't closed after its response
+static err_t kubelet_poll(void *arg, struct tcp_pcb *pcb) {
+    kubelet_conn_t *conn = (kubelet_conn_t *)arg;
+
+    if (pcb->unsent != NULL || pcb->unacked != NULL) {
+        // Response still in flight; a reset would cut it off
+        kubelet_close(pcb, conn);
+        return ERR_OK;
+    }
+
+    // The client has everything; reset rather than park the PCB in TIME_WAIT
+    DEBUG_PRINT("Kubelet: Client kept connection open, resetting");
+    tcp_arg(pcb, NULL);
+    tcp_err(pcb, NULL);
+    free(conn);
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+// Write as much of the metrics body as the send buffer takes
+// Called again from the sent callback until everything is queued, so the
+// output isn't limited by TCP_SND_BUF
+// Returns true once the body is all queued and the connection closed
+static bool kubelet_stream_metrics(struct tcp_pcb *pcb, kubelet_conn_t *conn) {
+    while (conn->metrics_cursor != K3S_LATENCY_DONE) {
+        size_t space = tcp_sndbuf(pcb);
+        if (space > sizeof(metrics_chunk)) {
+            space = sizeof(metrics_chunk);
+        }
+
+        uint32_t cursor = conn->metrics_cursor;
+        int n = k3s_client_format_latency(metrics_chunk, space, &conn->metrics_cursor);
+        if (n == 0) {
+            if (conn->metrics_cursor == K3S_LATENCY_DONE) {
+                break;
+            }
+            // Wait for acknowledgements to free up send buffer
+            tcp_output(pcb);
+            return false;
+        }
+
+        err_t write_err = tcp_write(pcb, metrics_chunk, n, TCP_WRITE_FLAG_COPY);
+        if (write_err != ERR_OK) {
+            // Out of segments; retry these lines once some are acknowledged
+            conn->metrics_cursor = cursor;
+            tcp_output(pcb);
+            return false;
+        }
+    }
+
+    while (conn->metrics_section < METRICS_SECTION_COUNT) {
+        int n = metrics_sections[conn->metrics_section](metrics_chunk, sizeof(metrics_chunk));
+        if (n > 0) {
+            if (tcp_sndbuf(pcb) < n ||
+                tcp_write(pcb, metrics_chunk, n, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+                // Retry once more of the body is acknowledged
+                tcp_output(pcb);
+                return false;
+            }
+        }
+        conn->metrics_section++;
+    }
+
+    DEBUG_PRINT("Kubelet: Metrics sent");
+    conn->streaming_metrics = false;
+    tcp_output(pcb);
+    kubelet_close(pcb, conn);
+    return true;
+}
+
+// Resume a metrics stream no sent callback is coming for
+static err_t kubelet_stream_poll(void *arg, struct tcp_pcb *pcb) {
+    kubelet_conn_t *conn = (kubelet_conn_t *)arg;
+
+    if (pcb->unsent != NULL || pcb->unacked != NULL) {
+        // Still draining; kubelet_sent() resumes the stream
+        conn->stream_stalls = 0;
+        return ERR_OK;
+    }
+
+    uint32_t cursor = conn->metrics_cursor;
+    uint8_t section = conn->metrics_section;
+    if (kubelet_stream_metrics(pcb, conn)) {
+        return ERR_OK;
+    }
+    if (conn->metrics_cursor != cursor || conn->metrics_section != section) {
+        conn->stream_stalls = 0;
+        return ERR_OK;
+    }
+    if (++conn->stream_stalls < KUBELET_STREAM_STALL_POLLS) {
+        return ERR_OK;
+    }
+
+    printf("ERROR: Kubelet: Metrics stream stalled, aborting\n");
+    tcp_arg(pcb, NULL);
+    tcp_err(pcb, NULL);
+    free(conn);
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
 static err_t kubelet_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
     kubelet_conn_t *conn = (kubelet_conn_t *)arg;
 
     if (p == NULL) {
         // Connection closed
         DEBUG_PRINT("Kubelet: Connection closed");
-        tcp_close(pcb);
-        free(conn);
+        kubelet_close(pcb, conn);
+        return ERR_OK;
+    }
+
+    if (conn->response_sent) {
+        // Anything after the request we answered is ignored
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
         return ERR_OK;
     }
 
@@ -146,18 +310,32 @@ static err_t kubelet_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t
         conn->recv_buffer[sizeof(conn->recv_buffer) - 1] = '\0';
     }
 
-    // Simple HTTP parsing - look for GET requests
+    // Parse the request line (METHOD SP path SP version CRLF) once it is
+    // complete; only GET requests are answered
     const char *response = NULL;
-
-    if (strstr(conn->recv_buffer, "GET /healthz") != NULL) {
-        DEBUG_PRINT("Kubelet: GET /healthz");
-        response = healthz_response;
-    } else if (strstr(conn->recv_buffer, "GET /metrics") != NULL) {
-        DEBUG_PRINT("Kubelet: GET /metrics");
-        response = metrics_response;
-    } else if (strstr(conn->recv_buffer, "GET ") != NULL) {
-        DEBUG_PRINT("Kubelet: GET (unknown path)");
-        response = not_found_response;
+    const char *request = conn->recv_buffer;
+    size_t request_len = strlen(request);
+    const char *line_end = scan_crlf(request, request_len);
+    const char *method_end = (line_end != NULL) ?
+                             scan_byte(request, line_end - request, ' ') : NULL;
+
+    if (method_end != NULL && method_end - request == 3 && memcmp(request, "GET", 3) == 0) {
+        // Path up to the version or a query string
+        const char *path = method_end + 1;
+        const char *path_end = scan_byte2(path, line_end - path, ' ', '?');
+        size_t path_len = (path_end != NULL) ? (size_t)(path_end - path) :
+                                               (size_t)(line_end - path);
+
+        if (path_len == 8 && memcmp(path, "/healthz", 8) == 0) {
+            DEBUG_PRINT("Kubelet: GET /healthz");
+            response = healthz_response;
+        } else if (path_len == 8 && memcmp(path, "/metrics", 8) == 0) {
+            DEBUG_PRINT("Kubelet: GET /metrics");
+            response = metrics_response;
+        } else {
+            DEBUG_PRINT("Kubelet: GET (unknown path)");
+            response = not_found_response;
+        }
     }
 
     // Send response if we have one
@@ -172,9 +350,23 @@ static err_t kubelet_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t
             printf("ERROR: Failed to write response: %d\n", write_err);
         }
 
-        // Close connection after sending response
-        tcp_close(pcb);
-        free(conn);
+        if (write_err == ERR_OK && response == metrics_response) {
+            // The body follows as the send buffer drains
+            conn->streaming_metrics = true;
+            conn->metrics_cursor = 0;
+            conn->metrics_section = 0;
+            conn->stream_stalls = 0;
+            tcp_poll(pcb, kubelet_stream_poll, 1);
+            kubelet_stream_metrics(pcb, conn);
+        } else if (write_err == ERR_OK) {
+            // The response says Connection: close and has a length, so the
+            // client closes once it has read it; closing on its FIN leaves
+            // no TIME_WAIT PCB behind. kubelet_poll() cuts off clients
+            // that linger
+            tcp_poll(pcb, kubelet_poll, KUBELET_CLOSE_WAIT_POLLS);
+        } else {
+            kubelet_close(pcb, conn);
+        }
     }
 
     return ERR_OK;
@@ -190,7 +382,12 @@ static void kubelet_err(void *arg, err_t err) {
 }
 
 static err_t kubelet_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+    kubelet_conn_t *conn = (kubelet_conn_t *)arg;
+
     DEBUG_PRINT("Kubelet: Sent %d bytes", len);
+    if (conn != NULL && conn->streaming_metrics) {
+        kubelet_stream_metrics(pcb, conn);
+    }
     return ERR_OK;
 }
 
@@ -0,0 +1,90 @@
+#include "latency.h"
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t bucket_bounds_ms[LATENCY_BUCKETS - 1] = LATENCY_BUCKET_BOUNDS_MS;
+
+static const char *const phase_names[LATENCY_PHASE_COUNT] = {
+    "dns", "connect", "send", "ttfb", "body", "total"
+};
+
+void latency_reset(latency_histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void latency_record(latency_histogram_t *h, uint32_t duration_us) {
+    // Buckets are few and most samples land low, so a linear scan wins
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && duration_us > bucket_bounds_ms[bucket] * 1000) {
+        bucket++;
+    }
+
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum_us += duration_us;
+    if (duration_us > h->max_us) {
+        h->max_us = duration_us;
+    }
+}
+
+uint32_t latency_percentile_ms(const latency_histogram_t *h, unsigned percent) {
+    if (h->count == 0) {
+        return 0;
+    }
+
+    // Rank of the sample at the percentile, rounded up
+    uint64_t rank = ((uint64_t)h->count * percent + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            return bucket_bounds_ms[i];
+        }
+    }
+    return (h->max_us + 999) / 1000;
+}
+
+const char *latency_phase_name(latency_phase_t phase) {
+    return (phase < LATENCY_PHASE_COUNT) ? phase_names[phase] : "unknown";
+}
+
+int latency_format_line(char *buffer, size_t size, const char *metric, const char *labels,
+                        const latency_histogram_t *h, int line) {
+    int n;
+
+    if (line >= 0 && line < LATENCY_BUCKETS) {
+        uint32_t cumulative = 0;
+        for (int i = 0; i <= line; i++) {
+            cumulative += h->buckets[i];
+        }
+
+        if (line == LATENCY_BUCKETS - 1) {
+            n = snprintf(buffer, size, "%s_bucket{%s,le=\"+Inf\"} %lu\n",
+                         metric, labels, (unsigned long)cumulative);
+        } else {
+            // Bounds are whole milliseconds; print them as seconds
+            uint32_t ms = bucket_bounds_ms[line];
+            n = snprintf(buffer, size, "%s_bucket{%s,le=\"%lu.%03lu\"} %lu\n",
+                         metric, labels, (unsigned long)(ms / 1000),
+                         (unsigned long)(ms % 1000), (unsigned long)cumulative);
+        }
+    } else if (line == LATENCY_BUCKETS) {
+        n = snprintf(buffer, size, "%s_sum{%s} %lu.%06lu\n",
+                     metric, labels, (unsigned long)(h->sum_us / 1000000),
+                     (unsigned long)(h->sum_us % 1000000));
+    } else if (line == LATENCY_BUCKETS + 1) {
+        n = snprintf(buffer, size, "%s_count{%s} %lu\n",
+                     metric, labels, (unsigned long)h->count);
+    } else {
+        return -1;
+    }
+
+    if (n < 0 || (size_t)n >= size) {
+        return -1;
+    }
+    return n;
+}
@@ -13,6 +13,9 @@
 #include "configmap_watcher.h"
 #include "memory_manager.h"
 #include "time_sync.h"
+#include "net_wait.h"
+#include "dns_cache.h"
+#include "tcp_connection.h"
 
 // Timing tracking
 static absolute_time_t last_status_report;
@@ -77,8 +80,10 @@ int init_wifi(void) {
 
     // Give DHCP extra time to fully complete and get gateway info
     printf("Waiting for DHCP to complete...\n");
-    sleep_ms(2000);
-    cyw43_arch_poll();  // Poll once more
+    absolute_time_t dhcp_wait = make_timeout_time_ms(2000);
+    while (!time_reached(dhcp_wait)) {
+        net_wait_until(dhcp_wait);
+    }
     printf("DHCP wait complete\n");
 
     // WORKAROUND: Manually set gateway if DHCP didn't set it correctly
@@ -116,8 +121,9 @@ int init_subsystems(void) {
     printf("  [2/6] Time sync...\n");
     time_sync_init();
 
-    // Initialize k3s client
+    // Initialize k3s client (and the DNS cache its connections resolve through)
     printf("  [3/6] K3s API client...\n");
+    dns_cache_init();
     if (k3s_client_init() != 0) {
         printf("ERROR: Failed to initialize k3s client\n");
         return -1;
@@ -160,6 +166,54 @@ void perform_health_check(void) {
     }
 
     DEBUG_PRINT("Health check: OK (link status: %u)", status);
+
+    // Request memory is static; report how close it runs to its limits
+    k3s_memory_stats_t mem;
+    k3s_client_get_memory_stats(&mem);
+    DEBUG_PRINT("K3s request arena: %u/%u bytes peak, %d/%d slots peak",
+                (unsigned)mem.arena_high_water, (unsigned)mem.arena_size,
+                mem.slots_high_water, mem.slots_total);
+    if (mem.alloc_failures > 0) {
+        printf("WARNING: %u k3s request arena allocations failed\n",
+               (unsigned)mem.alloc_failures);
+    }
+
+    // TCP PCBs are shared by API connections and kubelet clients
+    tcp_pcb_stats_t pcbs;
+    tcp_connection_get_pcb_stats(&pcbs);
+    DEBUG_PRINT("TCP PCBs: %u active, %u TIME_WAIT of %u, %u listening",
+                pcbs.active, pcbs.time_wait, pcbs.capacity, pcbs.listen);
+    if (pcbs.alloc_failures > 0) {
+        printf("WARNING: %u connects found no free TCP PCB\n",
+               (unsigned)pcbs.alloc_failures);
+    }
+
+    // Surface endpoints that are failing or held back by their retry policy
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    for (int i = 0; i < K3S_ENDPOINT_COUNT; i++) {
+        const retry_policy_t *policy = k3s_client_get_retry_state((k3s_endpoint_t)i);
+        if (policy->consecutive_failures > 0 || policy->state != CIRCUIT_CLOSED) {
+            printf("WARNING: k3s %s circuit %s, %u consecutive failures, next attempt in %u ms\n",
+                   policy->name, circuit_state_string(policy->state),
+                   (unsigned)policy->consecutive_failures,
+                   (unsigned)retry_policy_wait_ms(policy, now));
+        }
+
+        // Request latency, full histograms are on the kubelet /metrics
+        const latency_histogram_t *total = k3s_client_get_latency((k3s_endpoint_t)i,
+                                                                  LATENCY_PHASE_TOTAL);
+        const latency_histogram_t *ttfb = k3s_client_get_latency((k3s_endpoint_t)i,
+                                                                 LATENCY_PHASE_TTFB);
+        if (total->count > 0) {
+            DEBUG_PRINT("K3s %s latency: %u requests, p50 <= %u ms, p99 <= %u ms "
+                        "(ttfb p99 <= %u ms), max %u ms",
+                        policy->name, (unsigned)total->count,
+                        (unsigned)latency_percentile_ms(total, 50),
+                        (unsigned)latency_percentile_ms(total, 99),
+                        (unsigned)latency_percentile_ms(ttfb, 99),
+                        (unsigned)((total->max_us + 999) / 1000));
+        }
+    }
 }
 
 int main() {
@@ -194,13 +248,15 @@ int main() {
 
     // Main loop
     while (1) {
-        // CRITICAL: Poll WiFi/lwIP stack
-        // This MUST be called regularly for network operation
-        cyw43_arch_poll();
-
         // Process kubelet server requests (non-blocking)
         kubelet_server_poll();
 
+        // Advance in-flight API requests and reap idle connections
+        k3s_client_poll();
+
+        // Re-resolve cached hostnames before they expire
+        dns_cache_poll();
+
         // Get current time
         absolute_time_t now = get_absolute_time();
 
@@ -209,9 +265,7 @@ int main() {
             (NODE_STATUS_INTERVAL_MS * 1000LL)) {
 
             DEBUG_PRINT("--- Status report interval ---");
-            if (node_status_report() == 0) {
-                node_registered = true;
-            }
+            node_status_report_async();
             last_status_report = now;
         }
 
@@ -232,8 +286,16 @@ int main() {
             last_health_check = now;
         }
 
-        // Small sleep to prevent busy-waiting and allow other processes
-        sleep_ms(10);
+        // Sleep until the network has work or the next periodic task or
+        // request timeout is due. CRITICAL: this also polls the WiFi/lwIP
+        // stack, which must run regularly for network operation
+        absolute_time_t wake = delayed_by_ms(last_status_report, NODE_STATUS_INTERVAL_MS);
+        wake = absolute_time_min(wake, delayed_by_ms(last_configmap_poll,
+                                                      CONFIGMAP_POLL_INTERVAL_MS));
+        wake = absolute_time_min(wake, delayed_by_ms(last_health_check,
+                                                      HEALTH_CHECK_INTERVAL_MS));
+        wake = absolute_time_min(wake, k3s_client_next_deadline());
+        net_wait_until(wake);
     }
 
     // Cleanup (never reached in normal operation)
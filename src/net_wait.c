@@ -0,0 +1,11 @@
+#include "net_wait.h"
+#include "pico/cyw43_arch.h"
+
+void net_wait_until(absolute_time_t deadline) {
+    // Sleeps (WFE) until the cyw43 interrupt, the next lwIP timeout or the
+    // deadline; anything that happened since the last poll ends it at once
+    cyw43_arch_wait_for_work_until(deadline);
+
+    // Run the callbacks for whatever woke us
+    cyw43_arch_poll();
+}
@@ -2,6 +2,9 @@
 #include "k3s_client.h"
 #include "time_sync.h"
 #include "config.h"
+#if K3S_USE_PROTOBUF
+#include "k8s_protobuf.h"
+#endif
 #include "pico/cyw43_arch.h"
 #include <stdio.h>
 #include <string.h>
@@ -166,16 +169,32 @@ static const char *status_only_json_template =
     "  }"
     "}";
 
-int node_status_report(void) {
-    char json_buffer[2048];
+// Handle of the heartbeat currently in flight
+static k3s_handle_t report_handle = K3S_INVALID_HANDLE;
+
+// Body of the heartbeat in flight; the k3s client sends it in place, so it
+// must outlive the request (only one report is in flight at a time)
+static char report_body[2048];
+
+#if K3S_USE_PROTOBUF
+// The API server only accepts JSON patches, so the protobuf status update
+// is a PUT of the Node; the status strategy keeps the stored spec and
+// metadata, so the body only needs to carry the status
+#define STATUS_METHOD     HTTP_METHOD_PUT
+#define STATUS_MEDIA_TYPE K8S_PROTOBUF_MEDIA_TYPE
+#else
+#define STATUS_METHOD     HTTP_METHOD_PATCH
+#define STATUS_MEDIA_TYPE NULL      // Strategic merge patch
+#endif
+
+// Format the status-only JSON (for PATCH /status endpoint)
+// Returns length on success, -1 on error
+static int build_status_json(char *json_buffer, size_t buffer_size) {
     char node_ip[16];
-    char url[128];
     char timestamp[32];
 
     node_status_get_ip(node_ip, sizeof(node_ip));
 
-    DEBUG_PRINT("Reporting node status for %s", K3S_NODE_NAME);
-
     // Get current timestamp for heartbeat
     if (time_sync_get_iso8601(timestamp, sizeof(timestamp)) != 0) {
         // Not synced yet - use placeholder
@@ -183,9 +202,8 @@ int node_status_report(void) {
         DEBUG_PRINT("Warning: Time not synced, using placeholder timestamp");
     }
 
-    // Format status-only JSON (for PATCH /status endpoint)
     // Using same timestamp for both lastHeartbeatTime and lastTransitionTime
-    int len = snprintf(json_buffer, sizeof(json_buffer),
+    int len = snprintf(json_buffer, buffer_size,
                       status_only_json_template,
                       timestamp,          // Ready.lastHeartbeatTime
                       timestamp,          // Ready.lastTransitionTime
@@ -201,15 +219,72 @@ int node_status_report(void) {
                       K3S_NODE_NAME,      // status.addresses[1].address
                       KUBELET_PORT);      // status.daemonEndpoints.kubeletEndpoint.Port
 
-    if (len < 0 || len >= sizeof(json_buffer)) {
+    if (len < 0 || len >= buffer_size) {
         printf("ERROR: Node status JSON too large or formatting error\n");
         return -1;
     }
 
-    // PATCH to /api/v1/nodes/{name}/status
+    return len;
+}
+
+#if K3S_USE_PROTOBUF
+// Encode the status update as a protobuf Node
+// Returns length on success, -1 on error
+static int build_status_protobuf(char *buffer, size_t buffer_size) {
+    char node_ip[16];
+
+    node_status_get_ip(node_ip, sizeof(node_ip));
+
+    int64_t now = (int64_t)time_sync_get_unix_time();
+    if (now == 0) {
+        DEBUG_PRINT("Warning: Time not synced, using placeholder timestamp");
+    }
+
+    k8s_node_status_t status = {
+        .name = K3S_NODE_NAME,
+        .internal_ip = node_ip,
+        .hostname = K3S_NODE_NAME,
+        .heartbeat_time = now,
+        .transition_time = now,
+        .kubelet_port = KUBELET_PORT,
+    };
+
+    int len = k8s_pb_encode_node_status((uint8_t *)buffer, buffer_size, &status);
+    if (len < 0) {
+        printf("ERROR: Node status protobuf too large\n");
+    }
+    return len;
+}
+#endif
+
+// Build the status update body in the configured encoding
+static int build_status_body(char *buffer, size_t buffer_size) {
+#if K3S_USE_PROTOBUF
+    return build_status_protobuf(buffer, buffer_size);
+#else
+    return build_status_json(buffer, buffer_size);
+#endif
+}
+
+int node_status_report(void) {
+    char body[2048];
+    char url[128];
+
+    DEBUG_PRINT("Reporting node status for %s", K3S_NODE_NAME);
+
+    int len = build_status_body(body, sizeof(body));
+    if (len < 0) {
+        return -1;
+    }
+
+    // PATCH (JSON) or PUT (protobuf) to /api/v1/nodes/{name}/status
     snprintf(url, sizeof(url), "/api/v1/nodes/%s/status", K3S_NODE_NAME);
 
-    int result = k3s_client_patch(url, json_buffer);
+#if K3S_USE_PROTOBUF
+    int result = k3s_client_put(url, STATUS_MEDIA_TYPE, body, len);
+#else
+    int result = k3s_client_patch(url, body);
+#endif
 
     if (result == 0) {
         DEBUG_PRINT("Node status reported successfully");
@@ -219,3 +294,39 @@ int node_status_report(void) {
 
     return result;
 }
+
+// Completion callback for asynchronous heartbeats
+static void report_complete(int result, int status_code, void *user_data) {
+    report_handle = K3S_INVALID_HANDLE;
+
+    if (result == 0) {
+        DEBUG_PRINT("Node status reported successfully");
+    } else {
+        printf("ERROR: Node status report failed (HTTP %d)\n", status_code);
+    }
+}
+
+int node_status_report_async(void) {
+    char url[128];
+
+    // Don't stack heartbeats behind a slow API server
+    if (k3s_client_is_pending(report_handle)) {
+        DEBUG_PRINT("Previous status report still in flight, skipping");
+        return -1;
+    }
+
+    DEBUG_PRINT("Reporting node status for %s", K3S_NODE_NAME);
+
+    int len = build_status_body(report_body, sizeof(report_body));
+    if (len < 0) {
+        return -1;
+    }
+
+    // PATCH (JSON) or PUT (protobuf) to /api/v1/nodes/{name}/status
+    snprintf(url, sizeof(url), "/api/v1/nodes/%s/status", K3S_NODE_NAME);
+
+    report_handle = k3s_client_submit_media(STATUS_METHOD, url, STATUS_MEDIA_TYPE,
+                                            report_body, len,
+                                            NULL, report_complete, NULL);
+    return (report_handle == K3S_INVALID_HANDLE) ? -1 : 0;
+}
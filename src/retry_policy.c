@@ -0,0 +1,143 @@
+#include "retry_policy.h"
+#include <string.h>
+
+// Wrap-safe "a is at or after b" for millisecond timestamps
+static bool time_at_or_after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+// Double a delay, saturating at the cap
+static uint32_t backoff_double(uint32_t delay, uint32_t max_delay) {
+    return (delay > max_delay / 2) ? max_delay : delay * 2;
+}
+
+// Equal jitter: half the delay is fixed, the other half random, so nodes
+// that failed together don't all come back in the same millisecond
+static uint32_t backoff_jitter(uint32_t delay, uint32_t random) {
+    uint32_t half = delay / 2;
+    return half + (random % (delay - half + 1));
+}
+
+void retry_policy_init(retry_policy_t *policy, const char *name, const retry_config_t *config) {
+    memset(policy, 0, sizeof(*policy));
+    policy->name = name;
+    policy->config = *config;
+    policy->state = CIRCUIT_CLOSED;
+}
+
+// Take a retry token if one is available
+static bool retry_budget_take(retry_budget_t *budget, uint32_t now_ms) {
+    if (budget->refill_ms > 0) {
+        uint32_t elapsed = now_ms - budget->last_refill_ms;
+        uint32_t earned = elapsed / budget->refill_ms;
+        if (earned > 0) {
+            budget->tokens = (budget->tokens + earned > budget->max_tokens) ?
+                             budget->max_tokens : budget->tokens + earned;
+            budget->last_refill_ms += earned * budget->refill_ms;
+        }
+    }
+
+    if (budget->tokens == 0) {
+        budget->exhausted++;
+        return false;
+    }
+
+    budget->tokens--;
+    return true;
+}
+
+bool retry_policy_allow(retry_policy_t *policy, retry_budget_t *budget, uint32_t now_ms) {
+    if (policy->state == CIRCUIT_OPEN) {
+        if (!time_at_or_after(now_ms, policy->next_attempt_ms)) {
+            policy->rejected++;
+            return false;
+        }
+        policy->state = CIRCUIT_HALF_OPEN;
+    }
+
+    if (policy->state == CIRCUIT_HALF_OPEN) {
+        if (policy->probe_in_flight) {
+            policy->rejected++;
+            return false;
+        }
+    } else if (policy->consecutive_failures > 0 &&
+               !time_at_or_after(now_ms, policy->next_attempt_ms)) {
+        // Closed, but still backing off after a failure
+        policy->rejected++;
+        return false;
+    }
+
+    // Only attempts against a failing endpoint spend the budget
+    if (policy->consecutive_failures > 0 && budget != NULL &&
+        !retry_budget_take(budget, now_ms)) {
+        policy->rejected++;
+        return false;
+    }
+
+    if (policy->state == CIRCUIT_HALF_OPEN) {
+        policy->probe_in_flight = true;
+    }
+    return true;
+}
+
+void retry_policy_success(retry_policy_t *policy, uint32_t now_ms) {
+    policy->successes++;
+    policy->consecutive_failures = 0;
+    policy->backoff_ms = 0;
+    policy->next_attempt_ms = now_ms;
+    policy->probe_in_flight = false;
+    policy->state = CIRCUIT_CLOSED;
+}
+
+void retry_policy_failure(retry_policy_t *policy, uint32_t now_ms, uint32_t random) {
+    const retry_config_t *config = &policy->config;
+
+    policy->failures++;
+    policy->consecutive_failures++;
+    policy->probe_in_flight = false;
+
+    if (policy->state == CIRCUIT_HALF_OPEN) {
+        // Probe failed: reopen for longer
+        uint32_t delay = backoff_double(policy->backoff_ms, config->max_delay_ms);
+        policy->backoff_ms = (delay < config->open_ms) ? config->open_ms : delay;
+        policy->state = CIRCUIT_OPEN;
+    } else if (policy->consecutive_failures >= config->failure_threshold) {
+        policy->backoff_ms = config->open_ms;
+        policy->state = CIRCUIT_OPEN;
+    } else if (policy->consecutive_failures == 1) {
+        policy->backoff_ms = config->base_delay_ms;
+    } else {
+        policy->backoff_ms = backoff_double(policy->backoff_ms, config->max_delay_ms);
+    }
+
+    policy->next_attempt_ms = now_ms + backoff_jitter(policy->backoff_ms, random);
+}
+
+void retry_policy_abandon(retry_policy_t *policy) {
+    policy->probe_in_flight = false;
+}
+
+uint32_t retry_policy_wait_ms(const retry_policy_t *policy, uint32_t now_ms) {
+    if (policy->consecutive_failures == 0 || time_at_or_after(now_ms, policy->next_attempt_ms)) {
+        return 0;
+    }
+    return policy->next_attempt_ms - now_ms;
+}
+
+void retry_budget_init(retry_budget_t *budget, uint32_t max_tokens, uint32_t refill_ms,
+                       uint32_t now_ms) {
+    budget->tokens = max_tokens;
+    budget->max_tokens = max_tokens;
+    budget->refill_ms = refill_ms;
+    budget->last_refill_ms = now_ms;
+    budget->exhausted = 0;
+}
+
+const char *circuit_state_string(circuit_state_t state) {
+    switch (state) {
+        case CIRCUIT_CLOSED: return "closed";
+        case CIRCUIT_OPEN: return "open";
+        case CIRCUIT_HALF_OPEN: return "half-open";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,97 @@
+#include "scan.h"
+#include <stdint.h>
+#include <string.h>
+
+#define SCAN_ONES   0x01010101u
+#define SCAN_HIGHS  0x80808080u
+
+// Non-zero if any byte of v is zero; the lowest flagged lane is exact
+static inline uint32_t has_zero(uint32_t v) {
+    return (v - SCAN_ONES) & ~v & SCAN_HIGHS;
+}
+
+// Non-zero if any byte of v equals the byte repeated in pattern
+static inline uint32_t has_byte(uint32_t v, uint32_t pattern) {
+    return has_zero(v ^ pattern);
+}
+
+static inline uint32_t load_word(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));   // Aligned by the caller, so a single load
+    return v;
+}
+
+const char *scan_byte(const char *data, size_t length, char c) {
+    const char *end = data + length;
+
+    // Bytes before the first word boundary
+    while (data < end && ((uintptr_t)data & 3) != 0) {
+        if (*data == c) {
+            return data;
+        }
+        data++;
+    }
+
+    uint32_t pattern = SCAN_ONES * (uint8_t)c;
+    while (end - data >= 4) {
+        if (has_byte(load_word(data), pattern)) {
+            break;  // The byte loop below finds which lane
+        }
+        data += 4;
+    }
+
+    while (data < end) {
+        if (*data == c) {
+            return data;
+        }
+        data++;
+    }
+    return NULL;
+}
+
+const char *scan_byte2(const char *data, size_t length, char a, char b) {
+    const char *end = data + length;
+
+    while (data < end && ((uintptr_t)data & 3) != 0) {
+        if (*data == a || *data == b) {
+            return data;
+        }
+        data++;
+    }
+
+    uint32_t pattern_a = SCAN_ONES * (uint8_t)a;
+    uint32_t pattern_b = SCAN_ONES * (uint8_t)b;
+    while (end - data >= 4) {
+        uint32_t v = load_word(data);
+        if (has_byte(v, pattern_a) | has_byte(v, pattern_b)) {
+            break;
+        }
+        data += 4;
+    }
+
+    while (data < end) {
+        if (*data == a || *data == b) {
+            return data;
+        }
+        data++;
+    }
+    return NULL;
+}
+
+const char *scan_crlf(const char *data, size_t length) {
+    const char *end = data + length;
+
+    // A lone CR is rare, so looking for CR and checking the next byte
+    // costs about one scan_byte()
+    while (data < end) {
+        const char *cr = scan_byte(data, end - data, '\r');
+        if (cr == NULL || cr + 1 >= end) {
+            return NULL;
+        }
+        if (cr[1] == '\n') {
+            return cr;
+        }
+        data = cr + 1;
+    }
+    return NULL;
+}
@@ -1,13 +1,117 @@
 #include "tcp_connection.h"
 #include "config.h"
-#include "lwip/dns.h"
+#include "net_wait.h"
+#include "dns_cache.h"
 #include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"
 #include "pico/cyw43_arch.h"
 #include <stdio.h>
 #include <string.h>
 
+// PCB lifecycle counters (see tcp_pcb_stats_t)
+static tcp_pcb_stats_t pcb_stats;
+
+// Hand consumed bytes back to lwIP as receive window
+static void recv_credit(tcp_connection_t *conn, size_t length) {
+    if (length > 0 && conn->pcb) {
+        tcp_recved(conn->pcb, (u16_t)length);
+    }
+}
+
+#if TCP_RECV_ZERO_COPY
+
+// Helper: Check if nothing is waiting to be read
+static inline bool recv_is_empty(tcp_connection_t *conn) {
+    return conn->recv_queued == 0;
+}
+
+// lwIP TCP receive callback
+// The pbuf chain is queued as is and read in place; nothing is copied.
+// The window isn't reopened until the data is consumed, but it only bounds
+// bytes: a run of small segments can still pin more pbufs than it implies.
+static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    tcp_connection_t *conn = (tcp_connection_t *)arg;
+
+    if (err != ERR_OK || p == NULL) {
+        // Connection closed or error
+        if (p) {
+            pbuf_free(p);
+        }
+        conn->peer_closed = true;
+        return ERR_OK;
+    }
+
+    // Past what its window takes in full-sized segments, refuse the chain:
+    // lwIP holds it and offers it again later, dropping further data
+    // meanwhile, so a connection pins at most that plus the one chain
+    if (conn->recv_queue != NULL &&
+        pbuf_clen(conn->recv_queue) + pbuf_clen(p) > conn->recv_queue_pbufs) {
+        return ERR_MEM;
+    }
+
+    if (conn->recv_queue == NULL) {
+        conn->recv_queue = p;
+    } else {
+        pbuf_cat(conn->recv_queue, p);
+    }
+    conn->recv_queued += p->tot_len;
+    return ERR_OK;
+}
+
+int tcp_connection_peek(tcp_connection_t *conn, const uint8_t **data) {
+    if (!conn || !data) {
+        return TCP_ERR_INVALID_PARAM;
+    }
+
+    // Free empty pbufs at the head of the chain: lwIP delivers some when it
+    // trims a retransmitted segment, and a consume can end at one.
+    // pbuf_free_header() frees nothing for a zero length, so detach them
+    while (conn->recv_queue != NULL && conn->recv_queue->len == 0) {
+        struct pbuf *head = conn->recv_queue;
+        conn->recv_queue = head->next;
+        head->next = NULL;
+        pbuf_free(head);
+    }
+
+    if (conn->recv_queue == NULL) {
+        // Buffered data is drained before a close is reported
+        if (conn->peer_closed || conn->state != TCP_STATE_CONNECTED) {
+            return TCP_ERR_CLOSED;
+        }
+        return 0;
+    }
+
+    *data = (const uint8_t *)conn->recv_queue->payload;
+    return conn->recv_queue->len;
+}
+
+void tcp_connection_consume(tcp_connection_t *conn, size_t length) {
+    if (!conn || conn->recv_queue == NULL) {
+        return;
+    }
+    if (length > conn->recv_queued) {
+        length = conn->recv_queued;
+    }
+
+    // Drops whole pbufs and moves the payload of the new head
+    conn->recv_queue = pbuf_free_header(conn->recv_queue, (u16_t)length);
+    conn->recv_queued -= length;
+    recv_credit(conn, length);
+}
+
+// Free anything still queued
+static void recv_discard(tcp_connection_t *conn) {
+    if (conn->recv_queue != NULL) {
+        pbuf_free(conn->recv_queue);
+        conn->recv_queue = NULL;
+    }
+    conn->recv_queued = 0;
+}
+
+#else // !TCP_RECV_ZERO_COPY
+
 // Helper: Check if ring buffer is empty
-static inline bool ring_is_empty(tcp_connection_t *conn) {
+static inline bool recv_is_empty(tcp_connection_t *conn) {
     return conn->recv_head == conn->recv_tail;
 }
 
@@ -21,7 +125,32 @@ static inline uint16_t ring_free_space(tcp_connection_t *conn) {
     return (TCP_RECV_RING_SIZE - 1) - ring_available(conn);
 }
 
+// Copy as much of a pbuf chain (from offset) as fits into the ring: at
+// most two memcpys, one up to the end of the ring and one for the
+// wrapped remainder. Returns bytes copied
+static uint16_t ring_store(tcp_connection_t *conn, struct pbuf *p, uint16_t offset) {
+    uint16_t len = p->tot_len - offset;
+    uint16_t free_space = ring_free_space(conn);
+    if (len > free_space) {
+        len = free_space;
+    }
+
+    uint16_t first = TCP_RECV_RING_SIZE - conn->recv_head;
+    if (first > len) {
+        first = len;
+    }
+    pbuf_copy_partial(p, conn->recv_ring + conn->recv_head, first, offset);
+    if (len > first) {
+        pbuf_copy_partial(p, conn->recv_ring, len - first, offset + first);
+    }
+    conn->recv_head = (conn->recv_head + len) & (TCP_RECV_RING_SIZE - 1);
+    return len;
+}
+
 // lwIP TCP receive callback
+// The window isn't reopened until the data is consumed; what doesn't fit
+// in the ring (only possible within the first TCP_WND bytes, before the
+// window has shrunk to the ring) is held until there is room
 static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
     tcp_connection_t *conn = (tcp_connection_t *)arg;
 
@@ -30,36 +159,77 @@ static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
         if (p) {
             pbuf_free(p);
         }
+        conn->peer_closed = true;
         return ERR_OK;
     }
 
-    // Copy data from pbuf chain to ring buffer
-    struct pbuf *q = p;
-    uint16_t copied = 0;
+    if (conn->recv_pending != NULL) {
+        // Still waiting to copy the last chain; lwIP keeps this one and
+        // offers it again later
+        return ERR_MEM;
+    }
 
-    for (; q != NULL; q = q->next) {
-        uint8_t *data = (uint8_t *)q->payload;
-        uint16_t len = q->len;
+    uint16_t stored = ring_store(conn, p, 0);
+    if (stored < p->tot_len) {
+        conn->recv_pending = p;
+        conn->recv_pending_offset = stored;
+    } else {
+        pbuf_free(p);
+    }
+    return ERR_OK;
+}
 
-        for (uint16_t i = 0; i < len && ring_free_space(conn) > 0; i++) {
-            conn->recv_ring[conn->recv_head] = data[i];
-            conn->recv_head = (conn->recv_head + 1) & (TCP_RECV_RING_SIZE - 1);
-            copied++;
-        }
+int tcp_connection_peek(tcp_connection_t *conn, const uint8_t **data) {
+    if (!conn || !data) {
+        return TCP_ERR_INVALID_PARAM;
+    }
 
-        if (ring_free_space(conn) == 0) {
-            DEBUG_PRINT("Ring buffer full, dropping remaining data");
-            break;
+    if (recv_is_empty(conn)) {
+        // Buffered data is drained before a close is reported
+        if (conn->peer_closed || conn->state != TCP_STATE_CONNECTED) {
+            return TCP_ERR_CLOSED;
         }
+        return 0;
     }
 
-    // Tell TCP stack we processed all the data
-    tcp_recved(tpcb, p->tot_len);
+    // Contiguous up to the head or the end of the ring, whichever is first
+    uint16_t available = ring_available(conn);
+    uint16_t to_end = TCP_RECV_RING_SIZE - conn->recv_tail;
+    *data = conn->recv_ring + conn->recv_tail;
+    return (available < to_end) ? available : to_end;
+}
 
-    pbuf_free(p);
-    return ERR_OK;
+void tcp_connection_consume(tcp_connection_t *conn, size_t length) {
+    if (!conn) {
+        return;
+    }
+    if (length > ring_available(conn)) {
+        length = ring_available(conn);
+    }
+    conn->recv_tail = (conn->recv_tail + length) & (TCP_RECV_RING_SIZE - 1);
+    recv_credit(conn, length);
+
+    // Move held data into the space just freed
+    if (conn->recv_pending != NULL) {
+        conn->recv_pending_offset += ring_store(conn, conn->recv_pending,
+                                                conn->recv_pending_offset);
+        if (conn->recv_pending_offset == conn->recv_pending->tot_len) {
+            pbuf_free(conn->recv_pending);
+            conn->recv_pending = NULL;
+        }
+    }
 }
 
+static void recv_discard(tcp_connection_t *conn) {
+    conn->recv_tail = conn->recv_head;
+    if (conn->recv_pending != NULL) {
+        pbuf_free(conn->recv_pending);
+        conn->recv_pending = NULL;
+    }
+}
+
+#endif // TCP_RECV_ZERO_COPY
+
 // lwIP TCP error callback
 static void tcp_err_callback(void *arg, err_t err) {
     tcp_connection_t *conn = (tcp_connection_t *)arg;
@@ -82,27 +252,12 @@ static err_t tcp_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err)
     }
 
     DEBUG_PRINT("TCP connection established");
+    conn->connected_us = time_us_64();
     conn->state = TCP_STATE_CONNECTED;
 
     return ERR_OK;
 }
 
-// DNS resolution callback
-static void tcp_dns_found_callback(const char *name, const ip_addr_t *ipaddr, void *arg) {
-    tcp_connection_t *conn = (tcp_connection_t *)arg;
-
-    if (ipaddr == NULL) {
-        DEBUG_PRINT("DNS lookup failed for %s", name);
-        conn->state = TCP_STATE_ERROR;
-        conn->error_code = TCP_ERR_DNS;
-        return;
-    }
-
-    DEBUG_PRINT("DNS resolved: %s", ip4addr_ntoa(ipaddr));
-    conn->resolved_ip = *ipaddr;
-    conn->state = TCP_STATE_DNS_RESOLVED;
-}
-
 int tcp_connection_init(tcp_connection_t *conn) {
     if (!conn) {
         return TCP_ERR_INVALID_PARAM;
@@ -111,23 +266,99 @@ int tcp_connection_init(tcp_connection_t *conn) {
     memset(conn, 0, sizeof(tcp_connection_t));
     conn->state = TCP_STATE_IDLE;
     conn->pcb = NULL;
-    conn->recv_head = 0;
-    conn->recv_tail = 0;
+    conn->peer_closed = false;
+    tcp_connection_set_recv_window(conn, TCP_RECV_WINDOW);
 
     return TCP_OK;
 }
 
-int tcp_connection_connect(tcp_connection_t *conn, const char *hostname, uint16_t port, uint32_t timeout_ms) {
+void tcp_connection_set_recv_window(tcp_connection_t *conn, uint16_t window) {
+    if (!conn) {
+        return;
+    }
+
+    if (window > TCP_WND) {
+        window = TCP_WND;
+    }
+#if !TCP_RECV_ZERO_COPY
+    if (window > TCP_RECV_RING_SIZE - 1) {
+        window = TCP_RECV_RING_SIZE - 1;
+    }
+#endif
+
+    conn->recv_window = window;
+    conn->recv_queue_pbufs = TCP_RECV_WINDOW_PBUFS(window);
+}
+
+// Abort an in-progress connect and release the PCB
+static void connect_fail(tcp_connection_t *conn, int error) {
+    if (conn->pcb) {
+        tcp_arg(conn->pcb, NULL);
+        tcp_recv(conn->pcb, NULL);
+        tcp_err(conn->pcb, NULL);
+        if (conn->pcb->unsent != NULL || conn->pcb->unacked != NULL ||
+            tcp_close(conn->pcb) != ERR_OK) {
+            // Segments queued by tcp_connection_writev() still point at the
+            // caller's buffers; a graceful close would keep retransmitting
+            // them after those buffers are reused
+            tcp_abort(conn->pcb);
+        }
+        conn->pcb = NULL;
+    }
+    conn->state = TCP_STATE_ERROR;
+    conn->error_code = error;
+}
+
+// Issue tcp_connect() once the server address is known
+static int connect_issue(tcp_connection_t *conn) {
+    DEBUG_PRINT("Connecting to %s:%d...", ip4addr_ntoa(&conn->resolved_ip), conn->port);
+    conn->state = TCP_STATE_CONNECTING;
+
+    err_t err = tcp_connect(conn->pcb, &conn->resolved_ip, conn->port, tcp_connected_callback);
+    if (err != ERR_OK) {
+        DEBUG_PRINT("tcp_connect failed: %d", err);
+        connect_fail(conn, TCP_ERR_CONNECT);
+        return TCP_ERR_CONNECT;
+    }
+
+    // tcp_connect() opens the window at TCP_WND; narrowing it before the
+    // handshake completes means the final ACK, and everything after it,
+    // advertises ours
+    conn->pcb->rcv_wnd = conn->recv_window;
+    conn->pcb->rcv_ann_wnd = conn->recv_window;
+
+    return TCP_OK;
+}
+
+// Look the server up in the DNS cache and connect once it has an address
+// Returns TCP_OK if connecting (or still resolving), error code on failure
+static int connect_resolve(tcp_connection_t *conn) {
+    int ret = dns_cache_lookup(conn->hostname, &conn->resolved_ip);
+    if (ret == DNS_CACHE_PENDING) {
+        return TCP_OK;
+    } else if (ret != DNS_CACHE_OK) {
+        connect_fail(conn, TCP_ERR_DNS);
+        return TCP_ERR_DNS;
+    }
+
+    conn->resolved_us = time_us_64();
+    return connect_issue(conn);
+}
+
+int tcp_connection_connect_start(tcp_connection_t *conn, const char *hostname, uint16_t port, uint32_t timeout_ms) {
     if (!conn || !hostname) {
         return TCP_ERR_INVALID_PARAM;
     }
 
-    err_t err;
-
-    // Create new TCP PCB
+    // Create new TCP PCB (lwIP recycles the oldest TIME_WAIT PCB itself
+    // if the pool is empty)
     conn->pcb = tcp_new();
     if (!conn->pcb) {
-        DEBUG_PRINT("Failed to allocate TCP PCB");
+        tcp_pcb_stats_t stats;
+        pcb_stats.alloc_failures++;
+        tcp_connection_get_pcb_stats(&stats);
+        DEBUG_PRINT("Failed to allocate TCP PCB (%u active, %u in TIME_WAIT of %u)",
+                    stats.active, stats.time_wait, stats.capacity);
         return TCP_ERR_MEMORY;
     }
 
@@ -136,91 +367,169 @@ int tcp_connection_connect(tcp_connection_t *conn, const char *hostname, uint16_
     tcp_recv(conn->pcb, tcp_recv_callback);
     tcp_err(conn->pcb, tcp_err_callback);
 
-    // Try to parse as IP address first
-    ip_addr_t server_ip;
-    if (ipaddr_aton(hostname, &server_ip)) {
-        // Direct IP address
-        conn->resolved_ip = server_ip;
-        conn->state = TCP_STATE_DNS_RESOLVED;
-    } else {
-        // Need DNS resolution
-        conn->state = TCP_STATE_DNS_RESOLVING;
-        conn->timeout = make_timeout_time_ms(timeout_ms);
-
-        DEBUG_PRINT("Resolving DNS for %s...", hostname);
-        err = dns_gethostbyname(hostname, &conn->resolved_ip, tcp_dns_found_callback, conn);
-
-        if (err == ERR_OK) {
-            // Cached, already resolved
-            conn->state = TCP_STATE_DNS_RESOLVED;
-        } else if (err == ERR_INPROGRESS) {
-            // Wait for DNS resolution
-            while (conn->state == TCP_STATE_DNS_RESOLVING) {
-                cyw43_arch_poll();
-                sleep_ms(10);
-
-                if (absolute_time_diff_us(get_absolute_time(), conn->timeout) < 0) {
-                    DEBUG_PRINT("DNS timeout");
-                    tcp_close(conn->pcb);
-                    conn->pcb = NULL;
-                    conn->state = TCP_STATE_ERROR;
-                    return TCP_ERR_TIMEOUT;
-                }
-            }
+    conn->hostname = hostname;
+    conn->port = port;
+    conn->timeout = make_timeout_time_ms(timeout_ms);
+    conn->connect_start_us = time_us_64();
+    conn->resolved_us = 0;
+    conn->connected_us = 0;
 
-            if (conn->state == TCP_STATE_ERROR) {
-                tcp_close(conn->pcb);
-                conn->pcb = NULL;
-                return TCP_ERR_DNS;
-            }
-        } else {
-            DEBUG_PRINT("DNS error: %d", err);
-            tcp_close(conn->pcb);
-            conn->pcb = NULL;
-            return TCP_ERR_DNS;
-        }
+    // Literal addresses and cached names connect right away
+    conn->state = TCP_STATE_DNS_RESOLVING;
+    return connect_resolve(conn);
+}
+
+int tcp_connection_connect_poll(tcp_connection_t *conn) {
+    if (!conn) {
+        return TCP_ERR_INVALID_PARAM;
     }
 
-    // Connect to server
-    DEBUG_PRINT("Connecting to %s:%d...", ip4addr_ntoa(&conn->resolved_ip), port);
-    conn->state = TCP_STATE_CONNECTING;
-    conn->timeout = make_timeout_time_ms(timeout_ms);
+    switch (conn->state) {
+        case TCP_STATE_CONNECTED:
+            return TCP_OK;
 
-    err = tcp_connect(conn->pcb, &conn->resolved_ip, port, tcp_connected_callback);
-    if (err != ERR_OK) {
-        DEBUG_PRINT("tcp_connect failed: %d", err);
-        tcp_close(conn->pcb);
-        conn->pcb = NULL;
-        return TCP_ERR_CONNECT;
+        case TCP_STATE_DNS_RESOLVING:
+            // Ask the cache again - the query may have finished
+            if (connect_resolve(conn) != TCP_OK) {
+                return conn->error_code;
+            }
+            if (conn->state != TCP_STATE_DNS_RESOLVING) {
+                return TCP_PENDING;
+            }
+            // Fall through - still resolving, check the timeout
+        case TCP_STATE_CONNECTING:
+            if (absolute_time_diff_us(get_absolute_time(), conn->timeout) < 0) {
+                DEBUG_PRINT("%s timeout",
+                            conn->state == TCP_STATE_DNS_RESOLVING ? "DNS" : "Connection");
+                connect_fail(conn, TCP_ERR_TIMEOUT);
+                return TCP_ERR_TIMEOUT;
+            }
+            return TCP_PENDING;
+
+        case TCP_STATE_ERROR:
+            // Error callbacks can't free the PCB themselves
+            connect_fail(conn, conn->error_code ? conn->error_code : TCP_ERR_CONNECT);
+            return conn->error_code;
+
+        default:
+            return TCP_ERR_CONNECT;
     }
+}
 
-    // Wait for connection
-    while (conn->state == TCP_STATE_CONNECTING) {
-        cyw43_arch_poll();
-        sleep_ms(10);
+int tcp_connection_connect(tcp_connection_t *conn, const char *hostname, uint16_t port, uint32_t timeout_ms) {
+    int ret = tcp_connection_connect_start(conn, hostname, port, timeout_ms);
+    if (ret != TCP_OK) {
+        return ret;
+    }
 
-        if (absolute_time_diff_us(get_absolute_time(), conn->timeout) < 0) {
-            DEBUG_PRINT("Connection timeout");
-            tcp_close(conn->pcb);
-            conn->pcb = NULL;
-            conn->state = TCP_STATE_ERROR;
-            return TCP_ERR_TIMEOUT;
-        }
+    // Wait for DNS and the TCP handshake
+    while ((ret = tcp_connection_connect_poll(conn)) == TCP_PENDING) {
+        net_wait_until(conn->timeout);
     }
 
-    if (conn->state != TCP_STATE_CONNECTED) {
+    if (ret != TCP_OK) {
         DEBUG_PRINT("Connection failed");
-        if (conn->pcb) {
-            tcp_close(conn->pcb);
-            conn->pcb = NULL;
-        }
-        return TCP_ERR_CONNECT;
+        return ret;
     }
 
     DEBUG_PRINT("Connection successful");
     return TCP_OK;
 }
 
+int tcp_connection_write(tcp_connection_t *conn, const uint8_t *data, size_t len) {
+    if (!conn || !data) {
+        return TCP_ERR_INVALID_PARAM;
+    }
+
+    if (!conn->pcb || conn->state != TCP_STATE_CONNECTED) {
+        return TCP_ERR_CLOSED;
+    }
+
+    // Queue as much as fits in the send buffer right now
+    uint16_t available = tcp_sndbuf(conn->pcb);
+    if (available == 0 || len == 0) {
+        return 0;
+    }
+
+    uint16_t to_send = len < available ? len : available;
+    err_t err = tcp_write(conn->pcb, data, to_send, TCP_WRITE_FLAG_COPY);
+
+    if (err == ERR_MEM) {
+        // Out of segments/pbufs, try again later
+        return 0;
+    } else if (err != ERR_OK) {
+        DEBUG_PRINT("tcp_write error: %d", err);
+        return TCP_ERR_SEND;
+    }
+
+    tcp_output(conn->pcb);
+    return to_send;
+}
+
+int tcp_connection_writev(tcp_connection_t *conn, const tcp_iovec_t *iov, int iovcnt,
+                          size_t offset) {
+    if (!conn || (!iov && iovcnt > 0)) {
+        return TCP_ERR_INVALID_PARAM;
+    }
+
+    if (!conn->pcb || conn->state != TCP_STATE_CONNECTED) {
+        return TCP_ERR_CLOSED;
+    }
+
+    // Skip the pieces queued by earlier calls
+    int i = 0;
+    while (i < iovcnt && offset >= iov[i].length) {
+        offset -= iov[i].length;
+        i++;
+    }
+
+    size_t queued = 0;
+    while (i < iovcnt) {
+        uint16_t available = tcp_sndbuf(conn->pcb);
+        if (available == 0) {
+            break;
+        }
+
+        const uint8_t *data = (const uint8_t *)iov[i].data + offset;
+        size_t remaining = iov[i].length - offset;
+        uint16_t to_send = remaining < available ? remaining : available;
+
+        // No TCP_WRITE_FLAG_COPY: lwIP chains a reference to our memory.
+        // MORE holds back PSH until the last byte of the list.
+        bool last = (i == iovcnt - 1) && (to_send == remaining);
+        err_t err = tcp_write(conn->pcb, data, to_send, last ? 0 : TCP_WRITE_FLAG_MORE);
+
+        if (err == ERR_MEM) {
+            // Out of segments/pbufs, try again later
+            break;
+        } else if (err != ERR_OK) {
+            DEBUG_PRINT("tcp_write error: %d", err);
+            return TCP_ERR_SEND;
+        }
+
+        queued += to_send;
+        offset += to_send;
+        if (offset == iov[i].length) {
+            offset = 0;
+            i++;
+        }
+    }
+
+    if (queued > 0) {
+        tcp_output(conn->pcb);
+    }
+    return queued;
+}
+
+bool tcp_connection_send_done(tcp_connection_t *conn) {
+    if (!conn || !conn->pcb) {
+        return true;
+    }
+
+    cyw43_arch_poll();
+    return conn->pcb->unsent == NULL && conn->pcb->unacked == NULL;
+}
+
 int tcp_connection_send(tcp_connection_t *conn, const uint8_t *data, size_t len, uint32_t timeout_ms) {
     if (!conn || !data || conn->state != TCP_STATE_CONNECTED) {
         return TCP_ERR_INVALID_PARAM;
@@ -230,50 +539,57 @@ int tcp_connection_send(tcp_connection_t *conn, const uint8_t *data, size_t len,
         return TCP_ERR_CLOSED;
     }
 
-    err_t err;
     size_t sent = 0;
     conn->timeout = make_timeout_time_ms(timeout_ms);
 
     while (sent < len) {
-        // Check available send buffer space
-        uint16_t available = tcp_sndbuf(conn->pcb);
-        if (available == 0) {
-            // Wait for send buffer space
-            cyw43_arch_poll();
-            sleep_ms(10);
+        int n = tcp_connection_write(conn, data + sent, len - sent);
+        if (n < 0) {
+            return n;
+        }
+        sent += n;
 
-            if (absolute_time_diff_us(get_absolute_time(), conn->timeout) < 0) {
+        if (sent < len) {
+            if (time_reached(conn->timeout)) {
                 DEBUG_PRINT("Send timeout");
                 return TCP_ERR_TIMEOUT;
             }
-            continue;
+
+            // Wait for ACKs to free send buffer space
+            net_wait_until(conn->timeout);
         }
+    }
 
-        // Send as much as possible
-        uint16_t to_send = (len - sent) < available ? (len - sent) : available;
-        err = tcp_write(conn->pcb, data + sent, to_send, TCP_WRITE_FLAG_COPY);
+    return sent;
+}
 
-        if (err == ERR_OK) {
-            sent += to_send;
-        } else if (err == ERR_MEM) {
-            // Out of memory, wait and retry
-            cyw43_arch_poll();
-            sleep_ms(10);
+int tcp_connection_read(tcp_connection_t *conn, uint8_t *buffer, size_t buffer_size) {
+    if (!conn || !buffer || buffer_size == 0) {
+        return TCP_ERR_INVALID_PARAM;
+    }
 
-            if (absolute_time_diff_us(get_absolute_time(), conn->timeout) < 0) {
-                DEBUG_PRINT("Send timeout");
-                return TCP_ERR_TIMEOUT;
+    // Copy whole contiguous spans (pbuf payloads or ring segments)
+    size_t received = 0;
+    while (received < buffer_size) {
+        const uint8_t *data;
+        int available = tcp_connection_peek(conn, &data);
+        if (available <= 0) {
+            if (received == 0) {
+                return available;
             }
-        } else {
-            DEBUG_PRINT("tcp_write error: %d", err);
-            return TCP_ERR_SEND;
+            break;
         }
-    }
 
-    // Flush output
-    tcp_output(conn->pcb);
+        size_t n = buffer_size - received;
+        if ((size_t)available < n) {
+            n = available;
+        }
+        memcpy(buffer + received, data, n);
+        tcp_connection_consume(conn, n);
+        received += n;
+    }
 
-    return sent;
+    return received;
 }
 
 int tcp_connection_recv(tcp_connection_t *conn, uint8_t *buffer, size_t buffer_size, uint32_t timeout_ms) {
@@ -286,31 +602,38 @@ int tcp_connection_recv(tcp_connection_t *conn, uint8_t *buffer, size_t buffer_s
     }
 
     conn->timeout = make_timeout_time_ms(timeout_ms);
-    size_t received = 0;
 
     // Wait for data or timeout
-    while (ring_is_empty(conn)) {
-        cyw43_arch_poll();
-        sleep_ms(10);
-
-        // Check if connection closed
-        if (conn->state != TCP_STATE_CONNECTED) {
+    while (true) {
+        int n = tcp_connection_read(conn, buffer, buffer_size);
+        if (n == TCP_ERR_CLOSED) {
             return 0;  // Connection closed
+        } else if (n != 0) {
+            return n;
         }
 
-        if (absolute_time_diff_us(get_absolute_time(), conn->timeout) < 0) {
-            // Timeout - return what we have
-            return received;
+        if (time_reached(conn->timeout)) {
+            return TCP_ERR_TIMEOUT;
         }
+        net_wait_until(conn->timeout);
     }
+}
 
-    // Read from ring buffer
-    while (received < buffer_size && !ring_is_empty(conn)) {
-        buffer[received++] = conn->recv_ring[conn->recv_tail];
-        conn->recv_tail = (conn->recv_tail + 1) & (TCP_RECV_RING_SIZE - 1);
+bool tcp_connection_is_alive(tcp_connection_t *conn) {
+    if (!conn || !conn->pcb) {
+        return false;
     }
 
-    return received;
+    // Give lwIP a chance to deliver a pending FIN/RST before we reuse the PCB
+    cyw43_arch_poll();
+
+    if (conn->state != TCP_STATE_CONNECTED || conn->peer_closed) {
+        return false;
+    }
+
+    // Unsolicited bytes on an idle keep-alive connection mean we lost track
+    // of the response framing; the connection can't be trusted any more
+    return recv_is_empty(conn);
 }
 
 void tcp_connection_close(tcp_connection_t *conn) {
@@ -322,16 +645,78 @@ void tcp_connection_close(tcp_connection_t *conn) {
         tcp_arg(conn->pcb, NULL);
         tcp_recv(conn->pcb, NULL);
         tcp_err(conn->pcb, NULL);
-        tcp_close(conn->pcb);
+        if (conn->peer_closed && conn->pcb->unsent == NULL && conn->pcb->unacked == NULL &&
+            tcp_close(conn->pcb) == ERR_OK) {
+            // The peer closed first, so our FIN ends in LAST_ACK and the
+            // PCB is freed once it is acknowledged
+            pcb_stats.closed_by_peer++;
+        } else {
+            // Closing first would hold the PCB in TIME_WAIT for 2*MSL, and
+            // MEMP_NUM_TCP_PCB is shared with the kubelet server. Nothing
+            // more is exchanged here, so reset instead; that is also the
+            // only way to make lwIP drop segments queued by
+            // tcp_connection_writev() that still point at the caller's buffers
+            tcp_abort(conn->pcb);
+            pcb_stats.closed_reset++;
+        }
         conn->pcb = NULL;
     }
+    recv_discard(conn);
 
     conn->state = TCP_STATE_CLOSED;
     DEBUG_PRINT("TCP connection closed");
 }
 
+// Count the PCBs on one of lwIP's lists
+static uint16_t pcb_count(const struct tcp_pcb *pcb) {
+    uint16_t count = 0;
+    for (; pcb != NULL; pcb = pcb->next) {
+        count++;
+    }
+    return count;
+}
+
+void tcp_connection_get_pcb_stats(tcp_pcb_stats_t *stats) {
+    *stats = pcb_stats;
+    stats->active = pcb_count(tcp_active_pcbs) + pcb_count(tcp_bound_pcbs);
+    stats->time_wait = pcb_count(tcp_tw_pcbs);
+    stats->listen = pcb_count(tcp_listen_pcbs.pcbs);
+    stats->capacity = MEMP_NUM_TCP_PCB;
+}
+
+int tcp_connection_format_pcb_metrics(char *buffer, size_t size) {
+    tcp_pcb_stats_t stats;
+    tcp_connection_get_pcb_stats(&stats);
+
+    int n = snprintf(buffer, size,
+                     "# HELP tcp_pcbs TCP PCBs in use by state.\n"
+                     "# TYPE tcp_pcbs gauge\n"
+                     "tcp_pcbs{state=\"active\"} %u\n"
+                     "tcp_pcbs{state=\"time_wait\"} %u\n"
+                     "tcp_pcbs{state=\"listen\"} %u\n"
+                     "# HELP tcp_pcbs_capacity TCP PCBs available for connections.\n"
+                     "# TYPE tcp_pcbs_capacity gauge\n"
+                     "tcp_pcbs_capacity %u\n"
+                     "# HELP tcp_pcb_alloc_failures_total Connects that found no free PCB.\n"
+                     "# TYPE tcp_pcb_alloc_failures_total counter\n"
+                     "tcp_pcb_alloc_failures_total %lu\n"
+                     "# HELP tcp_connection_closes_total Client connection closes by kind.\n"
+                     "# TYPE tcp_connection_closes_total counter\n"
+                     "tcp_connection_closes_total{kind=\"after_peer\"} %lu\n"
+                     "tcp_connection_closes_total{kind=\"reset\"} %lu\n",
+                     stats.active, stats.time_wait, stats.listen, stats.capacity,
+                     (unsigned long)stats.alloc_failures,
+                     (unsigned long)stats.closed_by_peer,
+                     (unsigned long)stats.closed_reset);
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
+
 const char *tcp_error_to_string(tcp_error_t error) {
     switch (error) {
+        case TCP_PENDING: return "In progress";
         case TCP_OK: return "OK";
         case TCP_ERR_INVALID_PARAM: return "Invalid parameter";
         case TCP_ERR_DNS: return "DNS resolution failed";
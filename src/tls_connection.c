@@ -1,25 +1,16 @@
 #include "tls_connection.h"
 #include "config.h"
-#include "pico/cyw43_arch.h"
-#include "lwip/dns.h"
-#include "lwip/tcp.h"
-#include "lwip/err.h"
-#include "lwip/netif.h"
-#include "lwip/ip4_addr.h"
+#include "net_wait.h"
+#include "crypto_worker.h"
 #include "mbedtls/error.h"
 #include "mbedtls/x509.h"
 #include <string.h>
 #include <stdio.h>
 
 // Forward declarations
-static err_t tcp_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err);
-static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
-static err_t tcp_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len);
-static void tcp_err_callback(void *arg, err_t err);
-static err_t tcp_poll_callback(void *arg, struct tcp_pcb *tpcb);
-static void dns_callback(const char *name, const ip_addr_t *ipaddr, void *arg);
 static int bio_send(void *ctx, const unsigned char *buf, size_t len);
 static int bio_recv(void *ctx, unsigned char *buf, size_t len);
+static int verify_callback(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags);
 
 // Error string conversion
 const char* tls_error_to_string(int error) {
@@ -35,10 +26,27 @@ const char* tls_error_to_string(int error) {
         case TLS_ERR_MEMORY: return "Out of memory";
         case TLS_ERR_CLOSED: return "Connection closed";
         case TLS_ERR_MBEDTLS: return "mbedtls error";
+        case TLS_WANT_READ: return "Waiting for data";
+        case TLS_WANT_WRITE: return "Waiting for send space";
         default: return "Unknown error";
     }
 }
 
+// Session cache
+void tls_session_cache_init(tls_session_cache_t *cache) {
+    memset(cache, 0, sizeof(tls_session_cache_t));
+    mbedtls_ssl_session_init(&cache->session);
+}
+
+void tls_session_cache_clear(tls_session_cache_t *cache) {
+    if (cache->valid) {
+        DEBUG_PRINT("Forgetting cached TLS session");
+    }
+    mbedtls_ssl_session_free(&cache->session);
+    mbedtls_ssl_session_init(&cache->session);
+    cache->valid = false;
+}
+
 // Initialize connection context
 int tls_connection_init(tls_connection_t *conn, mbedtls_ssl_context *ssl) {
     if (conn == NULL || ssl == NULL) {
@@ -47,15 +55,14 @@ int tls_connection_init(tls_connection_t *conn, mbedtls_ssl_context *ssl) {
 
     // Completely zero out the structure to clear any stale state
     memset(conn, 0, sizeof(tls_connection_t));
+    tcp_connection_init(&conn->tcp);
 
     conn->ssl = ssl;
     conn->state = TLS_STATE_IDLE;
     conn->last_error = TLS_OK;
-    conn->pcb = NULL;
+    conn->session_cache = NULL;
     conn->connection_closed = false;
     conn->handshake_complete = false;
-    conn->recv_head = 0;
-    conn->recv_tail = 0;
     conn->bytes_sent = 0;
     conn->bytes_received = 0;
 
@@ -64,432 +71,358 @@ int tls_connection_init(tls_connection_t *conn, mbedtls_ssl_context *ssl) {
     return TLS_OK;
 }
 
-// Get ring buffer available bytes
+void tls_connection_set_session_cache(tls_connection_t *conn, tls_session_cache_t *cache) {
+    if (conn != NULL) {
+        conn->session_cache = cache;
+    }
+}
+
+// Decrypted bytes waiting in mbedtls
 uint16_t tls_connection_available(tls_connection_t *conn) {
-    if (conn == NULL) {
+    if (conn == NULL || conn->ssl == NULL) {
         return 0;
     }
-    uint16_t head = conn->recv_head;
-    uint16_t tail = conn->recv_tail;
-    return (head - tail) & (TLS_RECV_RING_SIZE - 1);
+    size_t available = mbedtls_ssl_get_bytes_avail(conn->ssl);
+    return (available > UINT16_MAX) ? UINT16_MAX : (uint16_t)available;
 }
 
-// TCP connected callback
-static err_t tcp_connected_callback(void *arg, struct tcp_pcb *tpcb, err_t err) {
-    tls_connection_t *conn = (tls_connection_t *)arg;
+// mbedtls BIO send function - queues records on the TCP connection
+static int bio_send(void *ctx, const unsigned char *buf, size_t len) {
+    tls_connection_t *conn = (tls_connection_t *)ctx;
 
-    if (err != ERR_OK) {
-        DEBUG_PRINT("TCP connection failed: %d", err);
-        conn->state = TLS_STATE_ERROR;
-        conn->last_error = TLS_ERR_CONNECT;
-        return err;
+    int n = tcp_connection_write(&conn->tcp, buf, len);
+    if (n == TCP_ERR_CLOSED) {
+        DEBUG_PRINT("bio_send: connection closed");
+        return MBEDTLS_ERR_SSL_CONN_EOF;
+    } else if (n < 0) {
+        DEBUG_PRINT("bio_send: %s", tcp_error_to_string(n));
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    } else if (n == 0) {
+        // Send buffer full; lwIP frees it up as the server ACKs
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
     }
 
-    DEBUG_PRINT("TCP connected");
-    conn->state = TLS_STATE_CONNECTED;
-    return ERR_OK;
+    conn->bytes_sent += n;
+    return n;
 }
 
-// TCP receive callback - stores data in ring buffer
-static err_t tcp_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
-    tls_connection_t *conn = (tls_connection_t *)arg;
+// mbedtls BIO receive function - reads from the TCP receive queue
+static int bio_recv(void *ctx, unsigned char *buf, size_t len) {
+    tls_connection_t *conn = (tls_connection_t *)ctx;
 
-    if (err != ERR_OK || p == NULL) {
-        // Connection closed or error
-        if (p != NULL) {
-            pbuf_free(p);
-        }
+    int n = tcp_connection_read(&conn->tcp, buf, len);
+    if (n == TCP_ERR_CLOSED) {
         conn->connection_closed = true;
-        DEBUG_PRINT("TCP connection closed by peer");
-        return ERR_OK;
-    }
-
-    DEBUG_PRINT("TCP recv: %d bytes", p->tot_len);
-
-    // Copy data from pbuf chain to ring buffer
-    struct pbuf *q;
-    uint16_t head = conn->recv_head;
-    uint16_t copied = 0;
-
-    for (q = p; q != NULL; q = q->next) {
-        uint8_t *data = (uint8_t *)q->payload;
-        for (uint16_t i = 0; i < q->len; i++) {
-            uint16_t next_head = (head + 1) & (TLS_RECV_RING_SIZE - 1);
-            if (next_head == conn->recv_tail) {
-                // Ring buffer full - drop remaining data
-                DEBUG_PRINT("WARNING: Ring buffer full, dropping data");
-                break;
-            }
-            conn->recv_ring[head] = data[i];
-            head = next_head;
-            copied++;
-        }
+        return MBEDTLS_ERR_SSL_CONN_EOF;
+    } else if (n < 0) {
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    } else if (n == 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
     }
 
-    conn->recv_head = head;
-    conn->bytes_received += copied;
-
-    // Tell TCP that we received the data at TCP layer (must ACK full amount!)
-    // Even if we didn't copy everything to ring buffer, TCP needs the ACK
-    tcp_recved(tpcb, p->tot_len);
-    pbuf_free(p);
-
-    return ERR_OK;
+    conn->bytes_received += n;
+    return n;
 }
 
-// TCP sent callback
-static err_t tcp_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len) {
-    tls_connection_t *conn = (tls_connection_t *)arg;
-    conn->bytes_sent += len;
-    return ERR_OK;
+// Certificate verification callback - only runs when the server sends its
+// certificate chain, which a resumed handshake skips
+static int verify_callback(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    tls_connection_t *conn = (tls_connection_t *)ctx;
+    (void)crt;
+    (void)depth;
+    (void)flags;
+    conn->peer_verified = true;
+    return 0;
 }
 
-// TCP error callback
-static void tcp_err_callback(void *arg, err_t err) {
-    tls_connection_t *conn = (tls_connection_t *)arg;
-    DEBUG_PRINT("TCP error callback: err=%d, state was=%d", err, conn->state);
-
-    // Decode common error codes
-    const char *err_str = "UNKNOWN";
-    switch (err) {
-        case ERR_ABRT: err_str = "ERR_ABRT (Connection aborted)"; break;
-        case ERR_RST: err_str = "ERR_RST (Connection reset)"; break;
-        case ERR_CLSD: err_str = "ERR_CLSD (Connection closed)"; break;
-        case ERR_CONN: err_str = "ERR_CONN (Not connected)"; break;
-        case ERR_VAL: err_str = "ERR_VAL (Illegal value)"; break;
-        case ERR_ARG: err_str = "ERR_ARG (Illegal argument)"; break;
-        case ERR_USE: err_str = "ERR_USE (Address in use)"; break;
-        case ERR_ALREADY: err_str = "ERR_ALREADY (Already connecting)"; break;
-        case ERR_ISCONN: err_str = "ERR_ISCONN (Already connected)"; break;
-        case ERR_MEM: err_str = "ERR_MEM (Out of memory)"; break;
-        case ERR_BUF: err_str = "ERR_BUF (Buffer error)"; break;
-        case ERR_TIMEOUT: err_str = "ERR_TIMEOUT (Timeout)"; break;
-        case ERR_RTE: err_str = "ERR_RTE (Routing problem)"; break;
-        case ERR_INPROGRESS: err_str = "ERR_INPROGRESS (Operation in progress)"; break;
-    }
-    DEBUG_PRINT("  %s", err_str);
-
-    conn->state = TLS_STATE_ERROR;
-    conn->last_error = TLS_ERR_CONNECT;
-    conn->pcb = NULL;  // PCB is already freed by lwIP
+// Map a transport error to ours
+static int tls_error_from_tcp(int error) {
+    switch (error) {
+        case TCP_ERR_DNS: return TLS_ERR_DNS;
+        case TCP_ERR_TIMEOUT: return TLS_ERR_TIMEOUT;
+        case TCP_ERR_MEMORY: return TLS_ERR_MEMORY;
+        case TCP_ERR_INVALID_PARAM: return TLS_ERR_INVALID_PARAM;
+        default: return TLS_ERR_CONNECT;
+    }
 }
 
-// TCP poll callback
-static err_t tcp_poll_callback(void *arg, struct tcp_pcb *tpcb) {
-    // Nothing to do here, just maintain connection
-    return ERR_OK;
-}
+// Handshake done: count it and keep the session for the next connect
+static void handshake_succeeded(tls_connection_t *conn) {
+    tls_session_cache_t *cache = conn->session_cache;
+    uint32_t elapsed_ms = (uint32_t)((time_us_64() - conn->handshake_start_us) / 1000);
 
-// DNS resolution callback
-static void dns_callback(const char *name, const ip_addr_t *ipaddr, void *arg) {
-    tls_connection_t *conn = (tls_connection_t *)arg;
+    conn->resumed = conn->session_offered && !conn->peer_verified;
+    conn->state = TLS_STATE_READY;
+    conn->handshake_complete = true;
+    tls_heap_record_handshake(&conn->heap);
+    DEBUG_PRINT("TLS handshake complete (%s, %lu ms, main loop held up %lu ms, %lu bytes held)",
+                conn->resumed ? "resumed" : "full", (unsigned long)elapsed_ms,
+                (unsigned long)(conn->handshake_stall_us / 1000),
+                (unsigned long)conn->heap.current);
 
-    if (ipaddr == NULL) {
-        DEBUG_PRINT("DNS resolution failed for %s", name);
-        conn->state = TLS_STATE_ERROR;
-        conn->last_error = TLS_ERR_DNS;
+    if (cache == NULL) {
         return;
     }
 
-    DEBUG_PRINT("DNS resolved: %s -> %s", name, ipaddr_ntoa(ipaddr));
-    conn->resolved_ip = *ipaddr;
-    conn->state = TLS_STATE_DNS_RESOLVED;
-}
-
-// mbedtls BIO send function - writes to TCP
-static int bio_send(void *ctx, const unsigned char *buf, size_t len) {
-    tls_connection_t *conn = (tls_connection_t *)ctx;
-
-    if (conn->pcb == NULL || conn->connection_closed) {
-        DEBUG_PRINT("bio_send: connection closed or NULL PCB");
-        return MBEDTLS_ERR_SSL_CONN_EOF;
+    if (cache->first_handshake_ms == 0) {
+        cache->first_handshake_ms = to_ms_since_boot(get_absolute_time());
     }
-
-    // Check how much space is available in TCP send buffer
-    size_t available = tcp_sndbuf(conn->pcb);
-    if (available == 0) {
-        DEBUG_PRINT("bio_send: no send buffer space, WANT_WRITE");
-        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    cache->last_stall_ms = conn->handshake_stall_us / 1000;
+    if (conn->resumed) {
+        cache->resumed_handshakes++;
+        cache->last_resumed_ms = elapsed_ms;
+    } else {
+        cache->full_handshakes++;
+        cache->last_full_ms = elapsed_ms;
     }
 
-    // Limit to available space
-    size_t to_send = (len < available) ? len : available;
-
-    // Write to TCP
-    err_t err = tcp_write(conn->pcb, buf, to_send, TCP_WRITE_FLAG_COPY);
-    if (err != ERR_OK) {
-        DEBUG_PRINT("tcp_write failed: %d", err);
-        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    // Replace the cached session: a full handshake has a new one, and a
+    // resumed one may have brought a new ticket
+    tls_session_cache_clear(cache);
+    int ret = mbedtls_ssl_get_session(conn->ssl, &cache->session);
+    if (ret != 0) {
+        DEBUG_PRINT("Failed to save TLS session: -0x%04x", -ret);
+        return;
     }
+    cache->valid = true;
+}
 
-    // Flush the data
-    err = tcp_output(conn->pcb);
-    if (err != ERR_OK) {
-        DEBUG_PRINT("tcp_output failed: %d", err);
-        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+// Handshake failed: drop the connection, and the session in case the
+// server no longer accepts it
+static int handshake_failed(tls_connection_t *conn, int error) {
+    if (conn->session_cache != NULL) {
+        conn->session_cache->failed_handshakes++;
+        tls_session_cache_clear(conn->session_cache);
     }
-
-    DEBUG_PRINT("bio_send: sent %d bytes (requested %d)", (int)to_send, (int)len);
-    return (int)to_send;
+    tcp_connection_close(&conn->tcp);
+    conn->state = TLS_STATE_ERROR;
+    conn->last_error = error;
+    return error;
 }
 
-// mbedtls BIO receive function - reads from ring buffer
-static int bio_recv(void *ctx, unsigned char *buf, size_t len) {
-    tls_connection_t *conn = (tls_connection_t *)ctx;
-
-    uint16_t available = tls_connection_available(conn);
-    if (available == 0) {
-        if (conn->connection_closed) {
-            return MBEDTLS_ERR_SSL_CONN_EOF;
-        }
-        return MBEDTLS_ERR_SSL_WANT_READ;
+// Log why mbedtls gave up on the handshake
+static void log_handshake_error(tls_connection_t *conn, int ret) {
+    DEBUG_PRINT("TLS handshake failed: -0x%04x", -ret);
+
+    // Decode the specific error
+    if (ret == MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE) {
+        // Extract alert level and description from the error
+        // The lower byte contains the alert description
+        DEBUG_PRINT("Server sent fatal TLS alert");
+    } else if (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
+        DEBUG_PRINT("Certificate verification failed");
+    }
+
+    // Always print verification result to see if cert verification is the issue
+    uint32_t flags = mbedtls_ssl_get_verify_result(conn->ssl);
+    DEBUG_PRINT("Verification flags: 0x%08lx", flags);
+    if (flags != 0) {
+        DEBUG_PRINT("Certificate verification FAILED:");
+        if (flags & MBEDTLS_X509_BADCERT_EXPIRED) DEBUG_PRINT("  - Certificate expired");
+        if (flags & MBEDTLS_X509_BADCERT_REVOKED) DEBUG_PRINT("  - Certificate revoked");
+        if (flags & MBEDTLS_X509_BADCERT_CN_MISMATCH) DEBUG_PRINT("  - CN mismatch");
+        if (flags & MBEDTLS_X509_BADCERT_NOT_TRUSTED) DEBUG_PRINT("  - Not trusted");
+    } else {
+        DEBUG_PRINT("Certificate verification passed (server cert OK)");
+        DEBUG_PRINT("Server likely rejected OUR client certificate");
     }
+}
 
-    // Read from ring buffer
-    size_t to_read = (len < available) ? len : available;
-    uint16_t tail = conn->recv_tail;
+// TCP is up: hook mbedtls to it and offer the cached session
+static void handshake_begin(tls_connection_t *conn) {
+    DEBUG_PRINT("Starting TLS handshake...");
+    conn->state = TLS_STATE_HANDSHAKING;
+    conn->timeout = make_timeout_time_ms(TLS_HANDSHAKE_TIMEOUT_MS);
+    conn->handshake_start_us = time_us_64();
+    conn->handshake_stall_us = 0;
 
-    for (size_t i = 0; i < to_read; i++) {
-        buf[i] = conn->recv_ring[tail];
-        tail = (tail + 1) & (TLS_RECV_RING_SIZE - 1);
+    // Set BIO callbacks
+    mbedtls_ssl_set_bio(conn->ssl, conn, bio_send, bio_recv, NULL);
+    mbedtls_ssl_set_verify(conn->ssl, verify_callback, conn);
+
+    // Offer the cached session; the server either resumes it or falls
+    // back to a full handshake
+    conn->session_offered = false;
+    conn->peer_verified = false;
+    conn->resumed = false;
+    if (conn->session_cache != NULL && conn->session_cache->valid) {
+        tls_heap_scope_t scope;
+        tls_heap_enter(&scope, &conn->heap);
+        int ret = tls_heap_leave(&scope, mbedtls_ssl_set_session(conn->ssl,
+                                                                 &conn->session_cache->session));
+        if (ret == 0) {
+            conn->session_offered = true;
+        } else {
+            DEBUG_PRINT("Cached TLS session rejected: -0x%04x", -ret);
+            tls_session_cache_clear(conn->session_cache);
+        }
     }
-
-    conn->recv_tail = tail;
-    return (int)to_read;
 }
 
-// Connect with DNS resolution, TCP connection, and TLS handshake
-int tls_connection_connect(tls_connection_t *conn, const char *hostname,
-                          uint16_t port, uint32_t timeout_ms) {
+int tls_connection_connect_start(tls_connection_t *conn, const char *hostname,
+                                 uint16_t port, uint32_t timeout_ms) {
     if (conn == NULL || hostname == NULL || conn->ssl == NULL) {
         return TLS_ERR_INVALID_PARAM;
     }
 
     DEBUG_PRINT("Connecting to %s:%d", hostname, port);
-    conn->timeout = make_timeout_time_ms(timeout_ms);
 
-    // Phase 1: DNS Resolution
-    DEBUG_PRINT("Resolving DNS...");
-    conn->state = TLS_STATE_DNS_RESOLVING;
-
-    err_t err = dns_gethostbyname(hostname, &conn->resolved_ip, dns_callback, conn);
-    if (err == ERR_OK) {
-        // Already cached
-        DEBUG_PRINT("DNS cached: %s", ipaddr_ntoa(&conn->resolved_ip));
-        conn->state = TLS_STATE_DNS_RESOLVED;
-    } else if (err != ERR_INPROGRESS) {
-        DEBUG_PRINT("DNS lookup failed: %d", err);
-        return TLS_ERR_DNS;
-    }
-
-    // Poll until DNS resolves or timeout
-    while (conn->state == TLS_STATE_DNS_RESOLVING) {
-        cyw43_arch_poll();
-        if (time_reached(conn->timeout)) {
-            DEBUG_PRINT("DNS timeout");
-            return TLS_ERR_TIMEOUT;
-        }
-        sleep_ms(10);
+    // The server certificate must name the host we connect to: the server
+    // CA signs other certificates too (kubelet serving certificates). An
+    // IP literal is matched against the certificate's IP SANs.
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    int ret = tls_heap_leave(&scope, mbedtls_ssl_set_hostname(conn->ssl, hostname));
+    if (ret != 0) {
+        DEBUG_PRINT("mbedtls_ssl_set_hostname failed: -0x%04x", -ret);
+        conn->state = TLS_STATE_ERROR;
+        conn->last_error = TLS_ERR_MEMORY;
+        return conn->last_error;
     }
 
-    if (conn->state == TLS_STATE_ERROR) {
+    // Phase 1: DNS Resolution and TCP Connection
+    ret = tcp_connection_connect_start(&conn->tcp, hostname, port, timeout_ms);
+    if (ret != TCP_OK) {
+        DEBUG_PRINT("TCP connect failed: %s", tcp_error_to_string(ret));
+        conn->state = TLS_STATE_ERROR;
+        conn->last_error = tls_error_from_tcp(ret);
         return conn->last_error;
     }
 
-    // Phase 2: TCP Connection
-    DEBUG_PRINT("Creating TCP connection...");
-
-    // Check local network interface status
-    struct netif *netif = netif_default;
-    if (netif == NULL) {
-        DEBUG_PRINT("ERROR: No default network interface");
-        return TLS_ERR_CONNECT;
-    }
-    DEBUG_PRINT("Default netif: %s, IP: %s",
-                netif->name,
-                ipaddr_ntoa(&netif->ip_addr));
-    // Print gateway and netmask separately to avoid ipaddr_ntoa() static buffer issue
-    DEBUG_PRINT("Gateway: %s", ipaddr_ntoa(&netif->gw));
-    DEBUG_PRINT("Netmask: %s", ipaddr_ntoa(&netif->netmask));
-    DEBUG_PRINT("Netif flags: 0x%02x, link up: %d", netif->flags, netif_is_link_up(netif));
-
-    conn->pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
-    if (conn->pcb == NULL) {
-        DEBUG_PRINT("ERROR: Failed to create TCP PCB - out of memory");
-        return TLS_ERR_MEMORY;
-    }
-    DEBUG_PRINT("TCP PCB created successfully (IPv4)");
-    DEBUG_PRINT("PCB state: %d, local port: %d", conn->pcb->state, conn->pcb->local_port);
-
-    // Bind to any local port (helps in NO_SYS mode)
-    err = tcp_bind(conn->pcb, IP_ADDR_ANY, 0);
-    if (err != ERR_OK) {
-        DEBUG_PRINT("tcp_bind failed: %d", err);
-        tcp_abort(conn->pcb);
-        conn->pcb = NULL;
-        return TLS_ERR_CONNECT;
-    }
-    DEBUG_PRINT("TCP PCB bound to local port");
-
-    // Set up callbacks
-    tcp_arg(conn->pcb, conn);
-    tcp_err(conn->pcb, tcp_err_callback);
-    tcp_recv(conn->pcb, tcp_recv_callback);
-    tcp_sent(conn->pcb, tcp_sent_callback);
-    tcp_poll(conn->pcb, tcp_poll_callback, 4);
-    DEBUG_PRINT("TCP callbacks set");
-
-    // Connect
     conn->state = TLS_STATE_CONNECTING;
-    DEBUG_PRINT("Calling tcp_connect to %s:%d", ipaddr_ntoa(&conn->resolved_ip), port);
-    DEBUG_PRINT("IP address bytes: %d.%d.%d.%d",
-                ((uint8_t*)&conn->resolved_ip.addr)[0],
-                ((uint8_t*)&conn->resolved_ip.addr)[1],
-                ((uint8_t*)&conn->resolved_ip.addr)[2],
-                ((uint8_t*)&conn->resolved_ip.addr)[3]);
-
-    // Check if we're on the same subnet - this affects routing
-    ip4_addr_t our_ip = *netif_ip4_addr(netif);
-    ip4_addr_t their_ip;
-    ip4_addr_copy(their_ip, conn->resolved_ip);
-    bool same_subnet = ip4_addr_netcmp(&our_ip, &their_ip, netif_ip4_netmask(netif));
-    DEBUG_PRINT("Same subnet check: %d (our IP vs their IP)", same_subnet);
-
-    DEBUG_PRINT("About to call tcp_connect...");
-    err = tcp_connect(conn->pcb, &conn->resolved_ip, port, tcp_connected_callback);
-    DEBUG_PRINT("tcp_connect returned: %d (ERR_OK=%d)", err, ERR_OK);
-
-    if (err != ERR_OK) {
-        const char *err_str = "UNKNOWN";
-        switch (err) {
-            case ERR_VAL: err_str = "ERR_VAL (Invalid value)"; break;
-            case ERR_BUF: err_str = "ERR_BUF (Buffer error)"; break;
-            case ERR_MEM: err_str = "ERR_MEM (Out of memory)"; break;
-            case ERR_ISCONN: err_str = "ERR_ISCONN (Already connected)"; break;
-            case ERR_RTE: err_str = "ERR_RTE (Routing problem)"; break;
-            case ERR_USE: err_str = "ERR_USE (Address in use)"; break;
-        }
-        DEBUG_PRINT("tcp_connect failed immediately: %d - %s", err, err_str);
-        tcp_abort(conn->pcb);
-        conn->pcb = NULL;
-        return TLS_ERR_CONNECT;
-    }
-    DEBUG_PRINT("tcp_connect initiated, waiting for callback...");
-    DEBUG_PRINT("Initial state after tcp_connect: %d", conn->state);
-
-    // Aggressively poll immediately after tcp_connect to give lwIP time to send SYN
-    DEBUG_PRINT("Starting aggressive poll loop...");
-    for (int i = 0; i < 100; i++) {
-        cyw43_arch_poll();
-        if (conn->state != TLS_STATE_CONNECTING) {
-            DEBUG_PRINT("State changed during aggressive poll at iteration %d: state=%d", i, conn->state);
-            break;
-        }
-        sleep_us(100);  // Very short delay
-    }
+    conn->timeout = conn->tcp.timeout;
+    return TLS_OK;
+}
 
-    if (conn->state == TLS_STATE_CONNECTING) {
-        DEBUG_PRINT("Entering main polling loop, state still CONNECTING");
+int tls_connection_connect_poll(tls_connection_t *conn) {
+    if (conn == NULL) {
+        return TLS_ERR_INVALID_PARAM;
     }
 
-    // Poll until connected or timeout
-    int poll_count = 0;
-    while (conn->state == TLS_STATE_CONNECTING) {
-        cyw43_arch_poll();
-        poll_count++;
-
-        if (time_reached(conn->timeout)) {
-            DEBUG_PRINT("TCP connect timeout after %d polls", poll_count);
-            tcp_abort(conn->pcb);
-            conn->pcb = NULL;
-            return TLS_ERR_TIMEOUT;
+    if (conn->state == TLS_STATE_CONNECTING) {
+        int ret = tcp_connection_connect_poll(&conn->tcp);
+        if (ret == TCP_PENDING) {
+            return TLS_WANT_READ;
+        } else if (ret != TCP_OK) {
+            DEBUG_PRINT("TCP connect failed: %s", tcp_error_to_string(ret));
+            conn->state = TLS_STATE_ERROR;
+            conn->last_error = tls_error_from_tcp(ret);
+            return conn->last_error;
         }
-        sleep_ms(10);
-    }
 
-    if (conn->state == TLS_STATE_ERROR) {
-        if (conn->pcb != NULL) {
-            tcp_abort(conn->pcb);
-            conn->pcb = NULL;
-        }
-        return conn->last_error;
+        // Phase 2: TLS Handshake
+        handshake_begin(conn);
     }
 
-    // Phase 3: TLS Handshake
-    DEBUG_PRINT("Starting TLS handshake...");
-    conn->state = TLS_STATE_HANDSHAKING;
+    if (conn->state == TLS_STATE_READY) {
+        return TLS_OK;
+    } else if (conn->state != TLS_STATE_HANDSHAKING) {
+        return (conn->last_error != TLS_OK) ? conn->last_error : TLS_ERR_CLOSED;
+    }
 
-    // Don't set SNI when connecting to IP addresses (some servers reject IP addresses in SNI)
-    // For hostname-based connections, mbedtls_ssl_set_hostname() should be called before this
-    // mbedtls_ssl_set_hostname(conn->ssl, hostname);
+    // Run the handshake as far as the records received so far allow;
+    // mbedtls picks up where it stopped on the next call
+    // Time this step kept the main loop from the network: all of it, less
+    // what core0 spent polling while core1 did the math (K3S_TLS_OFFLOAD)
+    uint64_t step_start_us = time_us_64();
+    uint64_t waited_us = crypto_worker_waited_us();
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    int ret = tls_heap_leave(&scope, mbedtls_ssl_handshake(conn->ssl));
+    uint32_t stall_us = (uint32_t)((time_us_64() - step_start_us) -
+                                   (crypto_worker_waited_us() - waited_us));
+    if (stall_us > conn->handshake_stall_us) {
+        conn->handshake_stall_us = stall_us;
+    }
+    if (ret == 0) {
+        handshake_succeeded(conn);
+        return TLS_OK;
+    }
 
-    // Set BIO callbacks
-    mbedtls_ssl_set_bio(conn->ssl, conn, bio_send, bio_recv, NULL);
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        log_handshake_error(conn, ret);
+        return handshake_failed(conn, TLS_ERR_HANDSHAKE);
+    }
 
-    // Perform handshake
-    int ret;
-    int handshake_attempts = 0;
-    conn->timeout = make_timeout_time_ms(15000);  // 15s for handshake
-    while ((ret = mbedtls_ssl_handshake(conn->ssl)) != 0) {
-        // Poll lwIP BEFORE checking the error to process any pending packets
-        cyw43_arch_poll();
-
-        handshake_attempts++;
-        if (handshake_attempts % 100 == 0) {
-            uint16_t ring_avail = tls_connection_available(conn);
-            DEBUG_PRINT("Handshake loop: attempt %d, ret=-0x%04x, ring_avail=%d", handshake_attempts, -ret, ring_avail);
-        }
+    if (time_reached(conn->timeout)) {
+        DEBUG_PRINT("TLS handshake timeout");
+        return handshake_failed(conn, TLS_ERR_TIMEOUT);
+    }
 
-        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-            DEBUG_PRINT("TLS handshake failed: -0x%04x", -ret);
+    return (ret == MBEDTLS_ERR_SSL_WANT_WRITE) ? TLS_WANT_WRITE : TLS_WANT_READ;
+}
 
-            // Decode the specific error
-            if (ret == MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE) {
-                // Extract alert level and description from the error
-                // The lower byte contains the alert description
-                DEBUG_PRINT("Server sent fatal TLS alert");
-            } else if (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
-                DEBUG_PRINT("Certificate verification failed");
-            }
+// Connect with DNS resolution, TCP connection, and TLS handshake
+int tls_connection_connect(tls_connection_t *conn, const char *hostname,
+                          uint16_t port, uint32_t timeout_ms) {
+    int ret = tls_connection_connect_start(conn, hostname, port, timeout_ms);
+    if (ret != TLS_OK) {
+        return ret;
+    }
 
-            // Always print verification result to see if cert verification is the issue
-            uint32_t flags = mbedtls_ssl_get_verify_result(conn->ssl);
-            DEBUG_PRINT("Verification flags: 0x%08lx", flags);
-            if (flags != 0) {
-                DEBUG_PRINT("Certificate verification FAILED:");
-                if (flags & MBEDTLS_X509_BADCERT_EXPIRED) DEBUG_PRINT("  - Certificate expired");
-                if (flags & MBEDTLS_X509_BADCERT_REVOKED) DEBUG_PRINT("  - Certificate revoked");
-                if (flags & MBEDTLS_X509_BADCERT_CN_MISMATCH) DEBUG_PRINT("  - CN mismatch");
-                if (flags & MBEDTLS_X509_BADCERT_NOT_TRUSTED) DEBUG_PRINT("  - Not trusted");
-            } else {
-                DEBUG_PRINT("Certificate verification passed (server cert OK)");
-                DEBUG_PRINT("Server likely rejected OUR client certificate");
-            }
+    // mbedtls wants more records (or send space); sleep until lwIP has
+    // something for it instead of spinning
+    while ((ret = tls_connection_connect_poll(conn)) == TLS_WANT_READ ||
+           ret == TLS_WANT_WRITE) {
+        net_wait_until(conn->timeout);
+    }
+    return ret;
+}
 
-            tcp_abort(conn->pcb);
-            conn->pcb = NULL;
-            return TLS_ERR_HANDSHAKE;
-        }
+int tls_connection_write(tls_connection_t *conn, const uint8_t *data, size_t len) {
+    if (conn == NULL || data == NULL) {
+        return TLS_ERR_INVALID_PARAM;
+    }
+    if (conn->state != TLS_STATE_READY) {
+        return TLS_ERR_CLOSED;
+    }
 
-        // Poll lwIP again after handshake attempt
-        cyw43_arch_poll();
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    int ret = tls_heap_leave(&scope, mbedtls_ssl_write(conn->ssl, data, len));
+    if (ret >= 0) {
+        return ret;
+    } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return TLS_WANT_WRITE;
+    } else if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+        return TLS_WANT_READ;
+    }
 
-        if (time_reached(conn->timeout)) {
-            DEBUG_PRINT("TLS handshake timeout");
-            tcp_abort(conn->pcb);
-            conn->pcb = NULL;
-            return TLS_ERR_TIMEOUT;
-        }
+    DEBUG_PRINT("TLS send failed: -0x%04x", -ret);
+    conn->last_error = TLS_ERR_SEND;
+    return TLS_ERR_SEND;
+}
 
-        // Short sleep to avoid busy-waiting (reduced from 10ms to 1ms for better responsiveness)
-        sleep_ms(1);
+int tls_connection_read(tls_connection_t *conn, uint8_t *buffer, size_t buffer_size) {
+    if (conn == NULL || buffer == NULL || buffer_size == 0) {
+        return TLS_ERR_INVALID_PARAM;
+    }
+    if (conn->state != TLS_STATE_READY || conn->connection_closed) {
+        return TLS_ERR_CLOSED;
+    }
+
+    // Also where mbedtls answers a HelloRequest, so renegotiation needs no
+    // special handling here
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    int ret = tls_heap_leave(&scope, mbedtls_ssl_read(conn->ssl, buffer, buffer_size));
+    if (ret > 0) {
+        return ret;
+    } else if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+        return TLS_WANT_READ;
+    } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return TLS_WANT_WRITE;
+    } else if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ||
+               ret == MBEDTLS_ERR_SSL_CONN_EOF) {
+        // Connection closed gracefully
+        DEBUG_PRINT("Connection closed by peer");
+        conn->connection_closed = true;
+        return TLS_ERR_CLOSED;
     }
 
-    DEBUG_PRINT("TLS handshake complete");
-    conn->state = TLS_STATE_READY;
-    conn->handshake_complete = true;
-
-    return TLS_OK;
+    DEBUG_PRINT("TLS receive failed: -0x%04x", -ret);
+    conn->last_error = TLS_ERR_RECV;
+    return TLS_ERR_RECV;
 }
 
 // Send data over TLS
@@ -503,21 +436,19 @@ int tls_connection_send(tls_connection_t *conn, const uint8_t *data,
     size_t total_sent = 0;
 
     while (total_sent < len) {
-        int ret = mbedtls_ssl_write(conn->ssl, data + total_sent, len - total_sent);
+        int ret = tls_connection_write(conn, data + total_sent, len - total_sent);
 
-        if (ret > 0) {
+        if (ret >= 0) {
             total_sent += ret;
-        } else if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) {
-            // Need to poll and retry
-            cyw43_arch_poll();
+        } else if (ret == TLS_WANT_WRITE || ret == TLS_WANT_READ) {
+            // Wait for the network, then retry
             if (time_reached(conn->timeout)) {
                 DEBUG_PRINT("Send timeout");
                 return TLS_ERR_TIMEOUT;
             }
-            sleep_ms(10);
+            net_wait_until(conn->timeout);
         } else {
-            DEBUG_PRINT("TLS send failed: -0x%04x", -ret);
-            return TLS_ERR_SEND;
+            return ret;
         }
     }
 
@@ -534,30 +465,79 @@ int tls_connection_recv(tls_connection_t *conn, uint8_t *buffer,
     conn->timeout = make_timeout_time_ms(timeout_ms);
 
     while (true) {
-        int ret = mbedtls_ssl_read(conn->ssl, buffer, buffer_size);
+        int ret = tls_connection_read(conn, buffer, buffer_size);
 
         if (ret > 0) {
             return ret;
-        } else if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
-            // Need to poll and retry
-            cyw43_arch_poll();
+        } else if (ret == TLS_WANT_READ || ret == TLS_WANT_WRITE) {
+            // Wait for the network, then retry
             if (time_reached(conn->timeout)) {
-                DEBUG_PRINT("Receive timeout");
                 return TLS_ERR_TIMEOUT;
             }
-            sleep_ms(10);
-        } else if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
-            // Connection closed gracefully
-            DEBUG_PRINT("Connection closed by peer");
-            conn->connection_closed = true;
+            net_wait_until(conn->timeout);
+        } else if (ret == TLS_ERR_CLOSED) {
             return 0;
         } else {
-            DEBUG_PRINT("TLS receive failed: -0x%04x", -ret);
-            return TLS_ERR_RECV;
+            return ret;
         }
     }
 }
 
+// Check whether an idle connection can be reused
+bool tls_connection_is_alive(tls_connection_t *conn) {
+    if (conn == NULL || conn->state != TLS_STATE_READY || conn->connection_closed) {
+        return false;
+    }
+
+    // Decrypted or raw bytes nobody asked for mean the response framing
+    // was lost (or the server sent close_notify)
+    return tls_connection_available(conn) == 0 && tcp_connection_is_alive(&conn->tcp);
+}
+
+// Queue the close_notify alert, charged to the connection like every
+// other mbedtls call on it
+static int send_close_notify(tls_connection_t *conn) {
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    return tls_heap_leave(&scope, mbedtls_ssl_close_notify(conn->ssl));
+}
+
+// Graceful close without blocking
+int tls_connection_shutdown(tls_connection_t *conn) {
+    if (conn == NULL) {
+        return TLS_OK;
+    }
+
+    if (conn->state == TLS_STATE_READY && !conn->connection_closed) {
+        DEBUG_PRINT("Sending TLS close_notify");
+        conn->state = TLS_STATE_CLOSING;
+        conn->timeout = make_timeout_time_ms(TLS_SHUTDOWN_TIMEOUT_MS);
+    }
+    if (conn->state != TLS_STATE_CLOSING) {
+        tls_connection_close(conn);
+        return TLS_OK;
+    }
+
+    // Retried until the alert is fully handed to TCP
+    if (!conn->close_notify_sent) {
+        int ret = send_close_notify(conn);
+        if (ret == 0) {
+            conn->close_notify_sent = true;
+        } else if (ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) {
+            conn->close_notify_sent = true;     // Give up on it
+        }
+    }
+
+    // Done once the server has the alert; it may close its side too
+    if ((conn->close_notify_sent && tcp_connection_send_done(&conn->tcp)) ||
+        conn->tcp.peer_closed || conn->tcp.state != TCP_STATE_CONNECTED ||
+        time_reached(conn->timeout)) {
+        tls_connection_close(conn);
+        return TLS_OK;
+    }
+    return TLS_WANT_WRITE;
+}
+
 // Close connection
 void tls_connection_close(tls_connection_t *conn) {
     if (conn == NULL) {
@@ -566,25 +546,35 @@ void tls_connection_close(tls_connection_t *conn) {
 
     DEBUG_PRINT("Closing TLS connection");
 
-    // Close TLS session gracefully
-    if (conn->handshake_complete && conn->ssl != NULL) {
-        mbedtls_ssl_close_notify(conn->ssl);
+    // Close TLS session gracefully (best effort, not waited for)
+    if (conn->handshake_complete && !conn->close_notify_sent && conn->ssl != NULL) {
+        send_close_notify(conn);
+        conn->close_notify_sent = true;
     }
 
     // Close TCP connection
-    if (conn->pcb != NULL) {
-        tcp_arg(conn->pcb, NULL);
-        tcp_err(conn->pcb, NULL);
-        tcp_recv(conn->pcb, NULL);
-        tcp_sent(conn->pcb, NULL);
-        tcp_poll(conn->pcb, NULL, 0);
+    tcp_connection_close(&conn->tcp);
 
-        tcp_close(conn->pcb);
-        conn->pcb = NULL;
+    if (conn->handshake_complete) {
+        tls_heap_record_session(&conn->heap);
     }
-
     conn->state = TLS_STATE_CLOSED;
     conn->connection_closed = true;
+    conn->handshake_complete = false;
+}
+
+void tls_connection_free(tls_connection_t *conn) {
+    if (conn == NULL || conn->ssl == NULL) {
+        return;
+    }
+
+    // What the connection still holds goes back to the pool; its meter
+    // drops to what, if anything, was never charged to it
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    mbedtls_ssl_free(conn->ssl);
+    tls_heap_leave(&scope, 0);
+    conn->ssl = NULL;
 }
 
 // Get connection state
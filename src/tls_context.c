@@ -0,0 +1,160 @@
+#include "tls_context.h"
+#include "config.h"
+#include "certs_der.h"
+#include "crypto_worker.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/x509_crt.h"
+#include <stdio.h>
+#include <string.h>
+
+// Shared by every connection to the API server
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+static mbedtls_x509_crt server_ca;
+static mbedtls_x509_crt client_cert;
+static mbedtls_pk_context client_key;
+static mbedtls_ssl_config ssl_config;
+
+// Session of the last handshake, offered on reconnect
+static tls_session_cache_t session_cache;
+
+static bool context_initialized = false;
+
+int tls_context_init(void) {
+    // Before anything in mbedtls allocates
+    tls_heap_init();
+#if K3S_TLS_OFFLOAD
+    crypto_worker_init();
+#endif
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    mbedtls_x509_crt_init(&server_ca);
+    mbedtls_x509_crt_init(&client_cert);
+    mbedtls_pk_init(&client_key);
+    mbedtls_ssl_config_init(&ssl_config);
+    tls_session_cache_init(&session_cache);
+    uint64_t start_us = time_us_64();
+
+    // Entropy comes from mbedtls_hardware_poll() (pico_mbedtls)
+    int ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                    (const unsigned char *)K3S_NODE_NAME,
+                                    strlen(K3S_NODE_NAME));
+    if (ret != 0) {
+        printf("ERROR: TLS RNG seed failed: -0x%04x\n", -ret);
+        return -1;
+    }
+
+    // DER converted from certs.h at build time (certs/certs_to_der.py).
+    // The certificates are parsed in place: they live in flash for good,
+    // so mbedtls needn't copy them to the heap.
+    ret = mbedtls_x509_crt_parse_der_nocopy(&server_ca, server_ca_cert_der,
+                                            sizeof(server_ca_cert_der));
+    if (ret != 0) {
+        printf("ERROR: Failed to parse server CA certificate: -0x%04x\n", -ret);
+        return -1;
+    }
+
+    ret = mbedtls_x509_crt_parse_der_nocopy(&client_cert, client_kubelet_cert_der,
+                                            sizeof(client_kubelet_cert_der));
+    if (ret != 0) {
+        printf("ERROR: Failed to parse kubelet client certificate: -0x%04x\n", -ret);
+        return -1;
+    }
+
+    ret = mbedtls_pk_parse_key(&client_key, client_kubelet_key_der,
+                               sizeof(client_kubelet_key_der), NULL, 0,
+                               mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (ret != 0) {
+        printf("ERROR: Failed to parse kubelet client key: -0x%04x\n", -ret);
+        return -1;
+    }
+
+    ret = mbedtls_ssl_config_defaults(&ssl_config, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        printf("ERROR: TLS config defaults failed: -0x%04x\n", -ret);
+        return -1;
+    }
+
+    mbedtls_ssl_conf_authmode(&ssl_config, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&ssl_config, &server_ca, NULL);
+    mbedtls_ssl_conf_rng(&ssl_config, mbedtls_ctr_drbg_random, &ctr_drbg);
+
+    ret = mbedtls_ssl_conf_own_cert(&ssl_config, &client_cert, &client_key);
+    if (ret != 0) {
+        printf("ERROR: Failed to set kubelet client certificate: -0x%04x\n", -ret);
+        return -1;
+    }
+
+    // Ask for a ticket; Go's TLS server (k3s) resumes TLS 1.2 sessions by
+    // ticket only, other servers may still resume by session ID
+    mbedtls_ssl_conf_session_tickets(&ssl_config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    context_initialized = true;
+    DEBUG_PRINT("TLS context ready in %lu us (mTLS to %s:%d, session resumption on)",
+                (unsigned long)(time_us_64() - start_us), K3S_SERVER_IP, K3S_SERVER_PORT);
+    return 0;
+}
+
+int tls_context_setup(tls_connection_t *conn, mbedtls_ssl_context *ssl) {
+    tls_connection_init(conn, ssl);
+    mbedtls_ssl_init(ssl);
+    if (!context_initialized) {
+        return -1;
+    }
+
+    // The record buffers are most of what a connection holds
+    tls_heap_scope_t scope;
+    tls_heap_enter(&scope, &conn->heap);
+    int ret = tls_heap_leave(&scope, mbedtls_ssl_setup(ssl, &ssl_config));
+    if (ret != 0) {
+        printf("ERROR: TLS context setup failed: -0x%04x\n", -ret);
+        tls_connection_free(conn);
+        return -1;
+    }
+
+    tls_connection_set_session_cache(conn, &session_cache);
+    return 0;
+}
+
+tls_session_cache_t *tls_context_session_cache(void) {
+    return context_initialized ? &session_cache : NULL;
+}
+
+int tls_context_format_metrics(char *buffer, size_t size) {
+    int n = snprintf(buffer, size,
+                     "# HELP k3s_tls_handshakes_total TLS handshakes with the API server by outcome.\n"
+                     "# TYPE k3s_tls_handshakes_total counter\n"
+                     "k3s_tls_handshakes_total{type=\"full\"} %lu\n"
+                     "k3s_tls_handshakes_total{type=\"resumed\"} %lu\n"
+                     "k3s_tls_handshakes_total{type=\"failed\"} %lu\n"
+                     "# HELP k3s_tls_last_handshake_seconds Duration of the latest handshake by type.\n"
+                     "# TYPE k3s_tls_last_handshake_seconds gauge\n"
+                     "k3s_tls_last_handshake_seconds{type=\"full\"} %lu.%03lu\n"
+                     "k3s_tls_last_handshake_seconds{type=\"resumed\"} %lu.%03lu\n"
+                     "# HELP k3s_tls_first_handshake_seconds Uptime when the first handshake completed.\n"
+                     "# TYPE k3s_tls_first_handshake_seconds gauge\n"
+                     "k3s_tls_first_handshake_seconds %lu.%03lu\n"
+                     "# HELP k3s_tls_handshake_stall_seconds Longest the main loop was held up in the latest handshake.\n"
+                     "# TYPE k3s_tls_handshake_stall_seconds gauge\n"
+                     "k3s_tls_handshake_stall_seconds %lu.%03lu\n",
+                     (unsigned long)session_cache.full_handshakes,
+                     (unsigned long)session_cache.resumed_handshakes,
+                     (unsigned long)session_cache.failed_handshakes,
+                     (unsigned long)(session_cache.last_full_ms / 1000),
+                     (unsigned long)(session_cache.last_full_ms % 1000),
+                     (unsigned long)(session_cache.last_resumed_ms / 1000),
+                     (unsigned long)(session_cache.last_resumed_ms % 1000),
+                     (unsigned long)(session_cache.first_handshake_ms / 1000),
+                     (unsigned long)(session_cache.first_handshake_ms % 1000),
+                     (unsigned long)(session_cache.last_stall_ms / 1000),
+                     (unsigned long)(session_cache.last_stall_ms % 1000));
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
@@ -0,0 +1,187 @@
+#include "tls_heap.h"
+#include "config.h"
+#if K3S_TLS_OFFLOAD
+#include "crypto_worker.h"
+#endif
+#include "mbedtls/memory_buffer_alloc.h"
+#include "mbedtls/bignum.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// memory_buffer_alloc's header in front of every block (32-bit build)
+#define TLS_HEAP_BLOCK_HEADER 32
+
+// Every mbedtls allocation, for the whole uptime
+static uint8_t heap_pool[K3S_TLS_HEAP_SIZE] __attribute__((aligned(4)));
+
+static tls_heap_stats_t stats;
+
+void tls_heap_init(void) {
+    memset(&stats, 0, sizeof(stats));
+    stats.size = K3S_TLS_HEAP_SIZE;
+    mbedtls_memory_buffer_alloc_init(heap_pool, sizeof(heap_pool));
+    DEBUG_PRINT("mbedtls pool: %lu bytes", (unsigned long)sizeof(heap_pool));
+}
+
+// Whether core1 may be allocating from the pool right now. core0 can
+// serve /metrics meanwhile, and must not read the allocator's counters
+// halfway through an update.
+static bool pool_in_use_elsewhere(void) {
+#if K3S_TLS_OFFLOAD
+    return crypto_worker_busy();
+#else
+    return false;
+#endif
+}
+
+// Record the bytes and blocks in use, for reports while core1 allocates
+static void sample_pool(size_t used, size_t blocks) {
+    stats.used = (uint32_t)used;
+    stats.blocks = (uint32_t)blocks;
+}
+
+// Fold mbedtls' running maximum into ours before it is reset
+static void fold_peak(void) {
+    size_t peak, peak_blocks;
+    mbedtls_memory_buffer_alloc_max_get(&peak, &peak_blocks);
+    if (peak > stats.peak) {
+        stats.peak = (uint32_t)peak;
+    }
+    if (peak_blocks > stats.peak_blocks) {
+        stats.peak_blocks = (uint32_t)peak_blocks;
+    }
+}
+
+void tls_heap_enter(tls_heap_scope_t *scope, tls_heap_meter_t *meter) {
+    size_t used, blocks;
+    mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+    sample_pool(used, blocks);
+
+    // From here mbedtls' maximum covers just this call
+    fold_peak();
+    mbedtls_memory_buffer_alloc_max_reset();
+
+    scope->meter = meter;
+    scope->used = (uint32_t)used;
+    scope->charged = meter->current;
+}
+
+// mbedtls reports running out of memory with a module-specific code; the
+// low-level part (bignum) may come combined with a high-level one
+static bool is_alloc_failure(int ret) {
+    if (ret >= 0) {
+        return false;
+    }
+    int high = -(-ret & 0xFF80);
+    int low = -(-ret & 0x007F);
+    return high == MBEDTLS_ERR_SSL_ALLOC_FAILED || high == MBEDTLS_ERR_X509_ALLOC_FAILED ||
+           high == MBEDTLS_ERR_PK_ALLOC_FAILED || high == MBEDTLS_ERR_ECP_ALLOC_FAILED ||
+           low == MBEDTLS_ERR_MPI_ALLOC_FAILED;
+}
+
+int tls_heap_leave(tls_heap_scope_t *scope, int ret) {
+    size_t used, blocks, peak, peak_blocks;
+    mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+    mbedtls_memory_buffer_alloc_max_get(&peak, &peak_blocks);
+    sample_pool(used, blocks);
+    if (peak < scope->used) {
+        peak = scope->used;     // Nothing allocated since the reset
+    }
+
+    // Everything allocated or freed during the call was on the meter's behalf
+    tls_heap_meter_t *meter = scope->meter;
+    int64_t current = (int64_t)scope->charged + (int64_t)used - scope->used;
+    meter->current = (current > 0) ? (uint32_t)current : 0;
+    uint32_t call_peak = scope->charged + (uint32_t)(peak - scope->used);
+    if (call_peak > meter->peak) {
+        meter->peak = call_peak;
+    }
+
+    if (is_alloc_failure(ret)) {
+        uint32_t overhead = (uint32_t)(used + blocks * TLS_HEAP_BLOCK_HEADER);
+        stats.alloc_failures++;
+        stats.free_at_failure = (overhead < stats.size) ? stats.size - overhead : 0;
+        printf("ERROR: mbedtls pool exhausted (%lu bytes in %lu blocks, %lu free)\n",
+               (unsigned long)used, (unsigned long)blocks,
+               (unsigned long)stats.free_at_failure);
+    }
+    return ret;
+}
+
+void tls_heap_record_handshake(const tls_heap_meter_t *meter) {
+    if (meter->current > stats.established_peak) {
+        stats.established_peak = meter->current;
+    }
+    if (meter->peak > stats.handshake_peak) {
+        stats.handshake_peak = meter->peak;
+    }
+}
+
+void tls_heap_record_session(const tls_heap_meter_t *meter) {
+    if (meter->peak > stats.session_peak) {
+        stats.session_peak = meter->peak;
+    }
+}
+
+void tls_heap_get_stats(tls_heap_stats_t *out) {
+    // While core1 allocates, report the pool as the offloaded call found it
+    if (!pool_in_use_elsewhere()) {
+        size_t used, blocks;
+        mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+        sample_pool(used, blocks);
+        fold_peak();
+    }
+    *out = stats;
+}
+
+int tls_heap_format_metrics(char *buffer, size_t size) {
+    tls_heap_stats_t s;
+    tls_heap_get_stats(&s);
+
+    int n = snprintf(buffer, size,
+                     "# HELP k3s_tls_heap_bytes mbedtls pool size and bytes in use (now, most).\n"
+                     "# TYPE k3s_tls_heap_bytes gauge\n"
+                     "k3s_tls_heap_bytes{type=\"size\"} %lu\n"
+                     "k3s_tls_heap_bytes{type=\"used\"} %lu\n"
+                     "k3s_tls_heap_bytes{type=\"peak\"} %lu\n"
+                     "# HELP k3s_tls_heap_blocks mbedtls pool blocks in use (now, most).\n"
+                     "# TYPE k3s_tls_heap_blocks gauge\n"
+                     "k3s_tls_heap_blocks{type=\"used\"} %lu\n"
+                     "k3s_tls_heap_blocks{type=\"peak\"} %lu\n",
+                     (unsigned long)s.size, (unsigned long)s.used, (unsigned long)s.peak,
+                     (unsigned long)s.blocks, (unsigned long)s.peak_blocks);
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
+
+int tls_heap_format_sizing_metrics(char *buffer, size_t size) {
+    int n = snprintf(buffer, size,
+                     "# HELP k3s_tls_heap_alloc_failures_total mbedtls calls that ran out of pool.\n"
+                     "# TYPE k3s_tls_heap_alloc_failures_total counter\n"
+                     "k3s_tls_heap_alloc_failures_total %lu\n"
+                     "# HELP k3s_tls_heap_free_at_failure_bytes Pool free at the last failure (high: fragmented).\n"
+                     "# TYPE k3s_tls_heap_free_at_failure_bytes gauge\n"
+                     "k3s_tls_heap_free_at_failure_bytes %lu\n"
+                     "# HELP k3s_tls_connection_heap_bytes Most mbedtls pool one connection held: "
+                     "once established, during a handshake, over a session.\n"
+                     "# TYPE k3s_tls_connection_heap_bytes gauge\n"
+                     "k3s_tls_connection_heap_bytes{type=\"established\"} %lu\n"
+                     "k3s_tls_connection_heap_bytes{type=\"handshake\"} %lu\n"
+                     "k3s_tls_connection_heap_bytes{type=\"session\"} %lu\n",
+                     (unsigned long)stats.alloc_failures,
+                     (unsigned long)stats.free_at_failure,
+                     (unsigned long)stats.established_peak,
+                     (unsigned long)stats.handshake_peak,
+                     (unsigned long)stats.session_peak);
+    if (n < 0 || (size_t)n >= size) {
+        return 0;
+    }
+    return n;
+}
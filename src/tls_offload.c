@@ -0,0 +1,162 @@
+// Elliptic-curve operations of the TLS handshake, run on core1
+//
+// mbedtls_config.h replaces these mbedtls functions (MBEDTLS_*_ALT) with
+// the ones below when K3S_TLS_OFFLOAD is set. Each packs its arguments
+// and has crypto_worker run the same computation mbedtls would, built
+// from the public ECP and bignum API, while core0 keeps polling the
+// network. Signing (CertificateVerify) stays on core0: it is a single
+// fixed-base multiplication, and replacing it would mean redoing mbedtls'
+// nonce generation and blinding.
+
+#include "crypto_worker.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/bignum.h"
+
+typedef int (*rng_func_t)(void *, unsigned char *, size_t);
+
+// ECDHE: our key pair
+
+typedef struct {
+    mbedtls_ecp_group *grp;
+    mbedtls_mpi *d;
+    mbedtls_ecp_point *Q;
+    rng_func_t f_rng;
+    void *p_rng;
+} gen_public_job_t;
+
+static int gen_public_job(void *arg) {
+    gen_public_job_t *job = (gen_public_job_t *)arg;
+    return mbedtls_ecp_gen_keypair(job->grp, job->d, job->Q, job->f_rng, job->p_rng);
+}
+
+int mbedtls_ecdh_gen_public(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_point *Q,
+                            rng_func_t f_rng, void *p_rng) {
+    gen_public_job_t job = { grp, d, Q, f_rng, p_rng };
+    return crypto_worker_run(gen_public_job, &job);
+}
+
+// ECDHE: shared secret, the x coordinate of d * Q
+
+typedef struct {
+    mbedtls_ecp_group *grp;
+    mbedtls_mpi *z;
+    const mbedtls_ecp_point *Q;
+    const mbedtls_mpi *d;
+    rng_func_t f_rng;
+    void *p_rng;
+} compute_shared_job_t;
+
+static int compute_shared_job(void *arg) {
+    compute_shared_job_t *job = (compute_shared_job_t *)arg;
+    mbedtls_ecp_point P;
+    int ret;
+
+    mbedtls_ecp_point_init(&P);
+    MBEDTLS_MPI_CHK(mbedtls_ecp_mul(job->grp, &P, job->d, job->Q, job->f_rng, job->p_rng));
+    if (mbedtls_ecp_is_zero(&P)) {
+        ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+        goto cleanup;
+    }
+    MBEDTLS_MPI_CHK(mbedtls_mpi_copy(job->z, &P.MBEDTLS_PRIVATE(X)));
+
+cleanup:
+    mbedtls_ecp_point_free(&P);
+    return ret;
+}
+
+int mbedtls_ecdh_compute_shared(mbedtls_ecp_group *grp, mbedtls_mpi *z,
+                                const mbedtls_ecp_point *Q, const mbedtls_mpi *d,
+                                rng_func_t f_rng, void *p_rng) {
+    compute_shared_job_t job = { grp, z, Q, d, f_rng, p_rng };
+    return crypto_worker_run(compute_shared_job, &job);
+}
+
+// ECDSA verification (SEC1 4.1.4): the server's certificate and its
+// ServerKeyExchange signature
+
+typedef struct {
+    mbedtls_ecp_group *grp;
+    const unsigned char *buf;
+    size_t blen;
+    const mbedtls_ecp_point *Q;
+    const mbedtls_mpi *r;
+    const mbedtls_mpi *s;
+} verify_job_t;
+
+// The hash as an integer: its leftmost nbits bits, reduced mod n
+static int hash_to_mpi(mbedtls_mpi *x, const mbedtls_ecp_group *grp,
+                       const unsigned char *buf, size_t blen) {
+    size_t n_size = (grp->nbits + 7) / 8;
+    size_t use_size = (blen > n_size) ? n_size : blen;
+    int ret;
+
+    MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(x, buf, use_size));
+    if (use_size * 8 > grp->nbits) {
+        MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(x, use_size * 8 - grp->nbits));
+    }
+    if (mbedtls_mpi_cmp_mpi(x, &grp->N) >= 0) {
+        MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(x, x, &grp->N));
+    }
+
+cleanup:
+    return ret;
+}
+
+static int verify_job(void *arg) {
+    verify_job_t *job = (verify_job_t *)arg;
+    mbedtls_ecp_group *grp = job->grp;
+    mbedtls_ecp_point R;
+    mbedtls_mpi e, s_inv, u1, u2;
+    int ret;
+
+    if (!mbedtls_ecdsa_can_do(grp->id) || grp->nbits == 0) {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+    // r and s must be in [1, n-1]
+    if (mbedtls_mpi_cmp_int(job->r, 1) < 0 || mbedtls_mpi_cmp_mpi(job->r, &grp->N) >= 0 ||
+        mbedtls_mpi_cmp_int(job->s, 1) < 0 || mbedtls_mpi_cmp_mpi(job->s, &grp->N) >= 0) {
+        return MBEDTLS_ERR_ECP_VERIFY_FAILED;
+    }
+
+    mbedtls_ecp_point_init(&R);
+    mbedtls_mpi_init(&e);
+    mbedtls_mpi_init(&s_inv);
+    mbedtls_mpi_init(&u1);
+    mbedtls_mpi_init(&u2);
+
+    // u1 = e / s, u2 = r / s (mod n)
+    MBEDTLS_MPI_CHK(hash_to_mpi(&e, grp, job->buf, job->blen));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&s_inv, job->s, &grp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u1, &e, &s_inv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u1, &u1, &grp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u2, job->r, &s_inv));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u2, &u2, &grp->N));
+
+    // R = u1 G + u2 Q; valid if R isn't zero and its x mod n is r
+    MBEDTLS_MPI_CHK(mbedtls_ecp_muladd(grp, &R, &u1, &grp->G, &u2, job->Q));
+    if (mbedtls_ecp_is_zero(&R)) {
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+        goto cleanup;
+    }
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&R.MBEDTLS_PRIVATE(X), &R.MBEDTLS_PRIVATE(X), &grp->N));
+    if (mbedtls_mpi_cmp_mpi(&R.MBEDTLS_PRIVATE(X), job->r) != 0) {
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+    }
+
+cleanup:
+    mbedtls_mpi_free(&u2);
+    mbedtls_mpi_free(&u1);
+    mbedtls_mpi_free(&s_inv);
+    mbedtls_mpi_free(&e);
+    mbedtls_ecp_point_free(&R);
+    return ret;
+}
+
+int mbedtls_ecdsa_verify(mbedtls_ecp_group *grp, const unsigned char *buf, size_t blen,
+                         const mbedtls_ecp_point *Q, const mbedtls_mpi *r,
+                         const mbedtls_mpi *s) {
+    verify_job_t job = { grp, buf, blen, Q, r, s };
+    return crypto_worker_run(verify_job, &job);
+}
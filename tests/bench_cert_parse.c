@@ -0,0 +1,167 @@
+/**
+ * Host benchmark: parsing the embedded credentials as PEM vs DER
+ *
+ * tls_context_init() parses the server CA, the kubelet client certificate
+ * and its key before the first handshake. This times the three ways to do
+ * it with mbedtls:
+ *   pem          - PEM strings from certs.h (needs PEM and base64 support;
+ *                  decodes into a temporary buffer, then copies the DER)
+ *   der          - DER arrays from certs_der.h, copied to the heap
+ *   der-nocopy   - DER arrays parsed in place (what the firmware does;
+ *                  certificates only, the key is decoded either way)
+ *
+ * certs_der.h is generated from certs.h by certs/certs_to_der.py, the same
+ * as the firmware build does.
+ *
+ * Usage: ./bench_cert_parse [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/version.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000 && defined(MBEDTLS_PSA_CRYPTO_C)
+#include "psa/crypto.h"
+#endif
+
+#include "certs.h"
+#include "certs_der.h"
+
+typedef enum {
+    MODE_PEM,
+    MODE_DER,
+    MODE_DER_NOCOPY
+} parse_mode_t;
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void check(int ret, const char *what) {
+    if (ret != 0) {
+        printf("  %s failed: -0x%04x\n", what, (unsigned)-ret);
+        exit(1);
+    }
+}
+
+static int parse_key(mbedtls_pk_context *key, const unsigned char *data, size_t length) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    return mbedtls_pk_parse_key(key, data, length, NULL, 0, mbedtls_ctr_drbg_random, &ctr_drbg);
+#else
+    return mbedtls_pk_parse_key(key, data, length, NULL, 0);
+#endif
+}
+
+static int parse_cert(mbedtls_x509_crt *crt, parse_mode_t mode, const char *pem,
+                      size_t pem_length, const unsigned char *der, size_t der_length) {
+    switch (mode) {
+        case MODE_PEM:
+            return mbedtls_x509_crt_parse(crt, (const unsigned char *)pem, pem_length);
+        case MODE_DER:
+            return mbedtls_x509_crt_parse_der(crt, der, der_length);
+        default:
+            return mbedtls_x509_crt_parse_der_nocopy(crt, der, der_length);
+    }
+}
+
+// Parse everything tls_context_init() does; returns certificate bytes
+// mbedtls keeps on the heap
+static size_t parse_credentials(parse_mode_t mode) {
+    mbedtls_x509_crt server_ca, client_cert;
+    mbedtls_pk_context client_key;
+
+    mbedtls_x509_crt_init(&server_ca);
+    mbedtls_x509_crt_init(&client_cert);
+    mbedtls_pk_init(&client_key);
+
+    check(parse_cert(&server_ca, mode, server_ca_cert, sizeof(server_ca_cert),
+                     server_ca_cert_der, sizeof(server_ca_cert_der)), "server CA");
+    check(parse_cert(&client_cert, mode, client_kubelet_cert, sizeof(client_kubelet_cert),
+                     client_kubelet_cert_der, sizeof(client_kubelet_cert_der)), "client cert");
+    if (mode == MODE_PEM) {
+        check(parse_key(&client_key, (const unsigned char *)client_kubelet_key,
+                        sizeof(client_kubelet_key)), "client key");
+    } else {
+        check(parse_key(&client_key, client_kubelet_key_der,
+                        sizeof(client_kubelet_key_der)), "client key");
+    }
+
+    size_t copied = (mode == MODE_DER_NOCOPY) ? 0 : server_ca.raw.len + client_cert.raw.len;
+
+    mbedtls_pk_free(&client_key);
+    mbedtls_x509_crt_free(&client_cert);
+    mbedtls_x509_crt_free(&server_ca);
+    return copied;
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+
+    static const struct {
+        const char *name;
+        parse_mode_t mode;
+    } modes[] = {
+        { "pem", MODE_PEM },
+        { "der", MODE_DER },
+        { "der-nocopy", MODE_DER_NOCOPY },
+    };
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000 && defined(MBEDTLS_PSA_CRYPTO_C)
+    check((int)psa_crypto_init(), "PSA init");
+#endif
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    check(mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0),
+          "RNG seed");
+
+    size_t pem_bytes = sizeof(server_ca_cert) + sizeof(client_kubelet_cert) +
+                       sizeof(client_kubelet_key);
+    size_t der_bytes = sizeof(server_ca_cert_der) + sizeof(client_kubelet_cert_der) +
+                       sizeof(client_kubelet_key_der);
+
+    printf("========================================\n");
+    printf("  Credential Parsing Benchmark\n");
+    printf("========================================\n");
+    printf("  %s, server CA + kubelet client certificate and key\n", MBEDTLS_VERSION_STRING_FULL);
+    printf("  %d parses per mode\n\n", iterations);
+    printf("  %-11s %10s %12s %14s\n", "mode", "input", "parse us", "heap kept");
+
+    double baseline = 0;
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        size_t copied = parse_credentials(modes[m].mode);     // Warm up
+
+        double start = now_ns();
+        for (int i = 0; i < iterations; i++) {
+            parse_credentials(modes[m].mode);
+        }
+        double parse_us = (now_ns() - start) / iterations / 1000;
+        if (m == 0) {
+            baseline = parse_us;
+        }
+
+        printf("  %-11s %10zu %12.2f %14zu", modes[m].name,
+               modes[m].mode == MODE_PEM ? pem_bytes : der_bytes, parse_us, copied);
+        if (m > 0) {
+            printf("  %.1fx", baseline / parse_us);
+        }
+        printf("\n");
+    }
+
+    printf("\n  input is flash on the Pico; heap kept is certificate data mbedtls\n");
+    printf("  copies for the life of the context (the parsed structures come on top)\n");
+
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * Host benchmark: HTTP layer throughput over captured k3s responses
+ *
+ * Replays the response corpus (Node PATCH/PUT replies, ConfigMap GETs,
+ * a chunked ConfigMap watch stream, error Status bodies) through the two
+ * parsers the firmware uses:
+ *   - http_parse_response() on a whole buffered response (timed with the
+ *     copy it needs, since it decodes in place)
+ *   - http_framer_feed() in 1460-byte reads, as k3s_client receives them
+ * and reports ns per response and MB/s for each file and for the corpus.
+ *
+ * Usage: ./bench_http_corpus [iterations] [corpus directory]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+
+#include "http_client.h"
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR "corpus/http"
+#endif
+
+#define MAX_FILES 32
+#define MAX_RESPONSE 8192
+#define SEGMENT_SIZE 1460
+
+typedef struct {
+    char name[64];
+    char data[MAX_RESPONSE];
+    size_t length;
+} corpus_entry_t;
+
+static corpus_entry_t corpus[MAX_FILES];
+static int corpus_count = 0;
+static char work[MAX_RESPONSE + 1];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(((const corpus_entry_t *)a)->name, ((const corpus_entry_t *)b)->name);
+}
+
+static int load_corpus(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        printf("  Cannot open corpus directory %s\n", path);
+        return -1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && corpus_count < MAX_FILES) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char file[1024];
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        FILE *f = fopen(file, "rb");
+        if (f == NULL) {
+            continue;
+        }
+        corpus_entry_t *e = &corpus[corpus_count];
+        e->length = fread(e->data, 1, sizeof(e->data), f);
+        fclose(f);
+        snprintf(e->name, sizeof(e->name), "%.63s", entry->d_name);
+        corpus_count++;
+    }
+    closedir(dir);
+
+    // Report in a stable order whatever readdir() returns
+    qsort(corpus, corpus_count, sizeof(corpus[0]), compare_names);
+    return corpus_count > 0 ? 0 : -1;
+}
+
+// Whole-buffer parse; returns payload bytes
+static size_t parse_whole(const corpus_entry_t *e) {
+    http_response_t response;
+    memcpy(work, e->data, e->length);
+    work[e->length] = '\0';
+    if (http_parse_response(work, e->length, &response) != 0) {
+        return 0;
+    }
+    return response.body_length;
+}
+
+// Streaming framer in segment-sized reads; returns payload bytes
+static size_t frame_segments(const corpus_entry_t *e) {
+    http_framer_t framer;
+    size_t payload = 0;
+    http_framer_init(&framer);
+
+    for (size_t offset = 0; offset < e->length; offset += SEGMENT_SIZE) {
+        const char *data = e->data + offset;
+        size_t n = (e->length - offset < SEGMENT_SIZE) ? e->length - offset : SEGMENT_SIZE;
+        while (n > 0) {
+            size_t used;
+            const char *body;
+            size_t body_length;
+            http_frame_event_t event = http_framer_feed(&framer, data, n,
+                                                        &used, &body, &body_length);
+            data += used;
+            n -= used;
+            payload += body_length;
+            if (event == HTTP_FRAME_NEED_MORE || event == HTTP_FRAME_COMPLETE ||
+                event == HTTP_FRAME_ERROR) {
+                break;
+            }
+        }
+    }
+    return payload;
+}
+
+static double mb_per_s(size_t bytes, double ns) {
+    return (bytes / 1e6) / (ns / 1e9);
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 100000;
+    const char *path = (argc > 2) ? argv[2] : CORPUS_DIR;
+    volatile size_t sink = 0;
+
+    if (load_corpus(path) != 0) {
+        return 1;
+    }
+
+    printf("========================================\n");
+    printf("  HTTP Corpus Throughput Benchmark\n");
+    printf("========================================\n");
+    printf("  %d iterations, %d responses from %s\n\n", iterations, corpus_count, path);
+    printf("  %-32s %6s %9s %8s %9s %8s\n",
+           "response", "bytes", "parse ns", "MB/s", "frame ns", "MB/s");
+
+    size_t total_bytes = 0;
+    double total_parse_ns = 0;
+    double total_frame_ns = 0;
+
+    for (int i = 0; i < corpus_count; i++) {
+        const corpus_entry_t *e = &corpus[i];
+
+        // Both parsers must agree on the payload before timing them
+        if (parse_whole(e) != frame_segments(e)) {
+            printf("  %s: parsers disagree on the body length\n", e->name);
+            return 1;
+        }
+
+        double start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            sink += parse_whole(e);
+        }
+        double parse_ns = (now_ns() - start) / iterations;
+
+        start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            sink += frame_segments(e);
+        }
+        double frame_ns = (now_ns() - start) / iterations;
+
+        printf("  %-32s %6zu %9.0f %8.0f %9.0f %8.0f\n", e->name, e->length,
+               parse_ns, mb_per_s(e->length, parse_ns),
+               frame_ns, mb_per_s(e->length, frame_ns));
+
+        total_bytes += e->length;
+        total_parse_ns += parse_ns;
+        total_frame_ns += frame_ns;
+    }
+
+    printf("  %-32s %6zu %9.0f %8.0f %9.0f %8.0f\n", "corpus (per response)",
+           total_bytes / corpus_count,
+           total_parse_ns / corpus_count, mb_per_s(total_bytes, total_parse_ns),
+           total_frame_ns / corpus_count, mb_per_s(total_bytes, total_frame_ns));
+
+    printf("\n  (sink %zu)\n", (size_t)sink);
+    return 0;
+}
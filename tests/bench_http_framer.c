@@ -0,0 +1,148 @@
+/**
+ * Host benchmark: HTTP response framing cost
+ *
+ * Compares the original receive loop, which re-ran strstr() for the blank
+ * line and http_get_header() for Content-Length over the whole buffer after
+ * every read, with the resumable http_framer_t that looks at each byte once.
+ *
+ * Absolute numbers are for the host CPU; the ratio between the two is what
+ * carries over to the RP2040.
+ *
+ * Usage: ./bench_http_framer [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_client.h"
+
+#define RESPONSE_MAX 16384
+
+static char response[RESPONSE_MAX];
+static char scratch[RESPONSE_MAX];
+
+// Build a ConfigMap-sized response with typical proxy headers
+static size_t build_response(size_t body_size) {
+    int header_len = snprintf(response, sizeof(response),
+        "HTTP/1.1 200 OK\r\n"
+        "Server: nginx/1.24.0\r\n"
+        "Date: Thu, 01 Jan 2026 00:00:00 GMT\r\n"
+        "Content-Type: application/json\r\n"
+        "Connection: keep-alive\r\n"
+        "Audit-Id: 5b2e8f3c-6c1d-4f3e-9a8b-2d7c1e0f4a5b\r\n"
+        "Cache-Control: no-cache, private\r\n"
+        "X-Kubernetes-Pf-Flowschema-Uid: 0e6d5c4b-3a29-4817-a6f5-e4d3c2b1a098\r\n"
+        "X-Kubernetes-Pf-Prioritylevel-Uid: 1f7e6d5c-4b3a-4928-b7a6-f5e4d3c2b1a0\r\n"
+        "Content-Length: %zu\r\n"
+        "\r\n", body_size);
+
+    for (size_t i = 0; i < body_size; i++) {
+        response[header_len + i] = "{\"data\":0123456789}"[i % 19];
+    }
+    return header_len + body_size;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The pre-framer loop: append, then rescan from the start after every read
+static size_t frame_rescan(size_t length, size_t read_size) {
+    size_t received = 0;
+    char value[32];
+
+    while (received < length) {
+        size_t n = (length - received < read_size) ? length - received : read_size;
+        memcpy(scratch + received, response + received, n);
+        received += n;
+        scratch[received] = '\0';
+
+        char *header_end = strstr(scratch, "\r\n\r\n");
+        if (header_end != NULL &&
+            http_get_header(scratch, "Content-Length", value, sizeof(value)) == 0) {
+            size_t header_length = (header_end + 4) - scratch;
+            if (received >= header_length + (size_t)atol(value)) {
+                return received;
+            }
+        }
+    }
+    return received;
+}
+
+// The resumable framer: each read is fed once
+static size_t frame_incremental(size_t length, size_t read_size) {
+    http_framer_t framer;
+    size_t received = 0;
+    size_t body_bytes = 0;
+
+    http_framer_init(&framer);
+    while (received < length) {
+        size_t n = (length - received < read_size) ? length - received : read_size;
+        // Same copy out of the receive ring as the rescanning loop pays
+        memcpy(scratch, response + received, n);
+        const char *data = scratch;
+        received += n;
+
+        while (true) {
+            size_t used;
+            const char *body;
+            size_t body_length;
+            http_frame_event_t event = http_framer_feed(&framer, data, n,
+                                                        &used, &body, &body_length);
+            data += used;
+            n -= used;
+            if (event == HTTP_FRAME_BODY) {
+                body_bytes += body_length;
+            } else if (event == HTTP_FRAME_COMPLETE) {
+                return received;
+            } else if (event != HTTP_FRAME_HEADERS) {
+                break;
+            }
+        }
+    }
+    return received + body_bytes;
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    const size_t body_sizes[] = { 512, 4096, 12288 };
+    const size_t read_sizes[] = { 64, 536, 1460 };
+
+    printf("========================================\n");
+    printf("  HTTP Response Framing Benchmark\n");
+    printf("========================================\n");
+    printf("  %d iterations per case\n\n", iterations);
+    printf("  %6s %6s %14s %14s %8s\n", "body", "read", "rescan ns", "framer ns", "speedup");
+
+    for (size_t b = 0; b < sizeof(body_sizes) / sizeof(body_sizes[0]); b++) {
+        size_t length = build_response(body_sizes[b]);
+
+        for (size_t r = 0; r < sizeof(read_sizes) / sizeof(read_sizes[0]); r++) {
+            size_t read_size = read_sizes[r];
+            volatile size_t sink = 0;
+
+            double start = now_ns();
+            for (int i = 0; i < iterations; i++) {
+                sink += frame_rescan(length, read_size);
+            }
+            double rescan = (now_ns() - start) / iterations;
+
+            start = now_ns();
+            for (int i = 0; i < iterations; i++) {
+                sink += frame_incremental(length, read_size);
+            }
+            double framer = (now_ns() - start) / iterations;
+
+            printf("  %6zu %6zu %14.0f %14.0f %7.1fx\n",
+                   body_sizes[b], read_size, rescan, framer, rescan / framer);
+            (void)sink;
+        }
+    }
+
+    printf("========================================\n");
+    return 0;
+}
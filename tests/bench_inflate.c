@@ -0,0 +1,173 @@
+/**
+ * Host benchmark: gzip on the wire vs inflate cost
+ *
+ * Compresses representative API responses the way nginx would (host zlib,
+ * gzip wrapper, 8KB window) and reports the bytes saved on the wire
+ * together with the CPU time gzip_inflate_feed() spends per KB of JSON.
+ *
+ * The byte counts carry over to the Pico unchanged. The timings are for
+ * the host CPU; scale them by the host/RP2040 ratio seen in the other
+ * benchmarks to estimate the on-device cost.
+ *
+ * Usage: ./bench_inflate [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "inflate.h"
+
+#define BODY_MAX 65536
+#define SEGMENT_SIZE 1460           // Typical TCP MSS on WiFi
+
+static char body[BODY_MAX];
+static uint8_t packed[BODY_MAX + 1024];
+static gzip_inflater_t inflater;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// A Node object as returned by GET /api/v1/nodes/<name>
+static size_t build_node(void) {
+    return snprintf(body, sizeof(body),
+        "{\"kind\":\"Node\",\"apiVersion\":\"v1\",\"metadata\":{\"name\":\"pico-node-1\","
+        "\"uid\":\"6f1c2b3a-4d5e-4f60-8a7b-9c0d1e2f3a4b\",\"resourceVersion\":\"183742\","
+        "\"creationTimestamp\":\"2026-01-01T00:00:00Z\",\"labels\":{\"kubernetes.io/arch\":"
+        "\"arm\",\"kubernetes.io/hostname\":\"pico-node-1\",\"kubernetes.io/os\":\"rp2040\","
+        "\"node.kubernetes.io/instance-type\":\"pico-w\"},\"annotations\":{"
+        "\"node.alpha.kubernetes.io/ttl\":\"0\",\"volumes.kubernetes.io/controller-managed-attach-detach\":\"true\"}},"
+        "\"spec\":{\"taints\":[{\"key\":\"node.kubernetes.io/microcontroller\",\"effect\":\"NoSchedule\"}]},"
+        "\"status\":{\"capacity\":{\"cpu\":\"2\",\"memory\":\"264Ki\",\"pods\":\"0\"},"
+        "\"allocatable\":{\"cpu\":\"2\",\"memory\":\"200Ki\",\"pods\":\"0\"},"
+        "\"conditions\":[{\"type\":\"Ready\",\"status\":\"True\",\"lastHeartbeatTime\":"
+        "\"2026-01-01T00:10:00Z\",\"lastTransitionTime\":\"2026-01-01T00:00:00Z\","
+        "\"reason\":\"KubeletReady\",\"message\":\"kubelet is posting ready status\"},"
+        "{\"type\":\"MemoryPressure\",\"status\":\"False\",\"lastHeartbeatTime\":"
+        "\"2026-01-01T00:10:00Z\",\"lastTransitionTime\":\"2026-01-01T00:00:00Z\","
+        "\"reason\":\"KubeletHasSufficientMemory\",\"message\":\"kubelet has sufficient memory available\"}],"
+        "\"addresses\":[{\"type\":\"InternalIP\",\"address\":\"192.168.1.50\"},"
+        "{\"type\":\"Hostname\",\"address\":\"pico-node-1\"}],\"nodeInfo\":{"
+        "\"kubeletVersion\":\"v1.28.0-pico\",\"operatingSystem\":\"rp2040\",\"architecture\":\"arm\"}}}");
+}
+
+// A ConfigMap with n data keys
+static size_t build_configmap(int keys) {
+    size_t used = snprintf(body, sizeof(body),
+        "{\"kind\":\"ConfigMap\",\"apiVersion\":\"v1\",\"metadata\":{\"name\":\"pico-config\","
+        "\"namespace\":\"default\",\"resourceVersion\":\"183750\",\"managedFields\":[{"
+        "\"manager\":\"kubectl-client-side-apply\",\"operation\":\"Update\",\"apiVersion\":\"v1\","
+        "\"time\":\"2026-01-01T00:00:00Z\",\"fieldsType\":\"FieldsV1\"}]},\"data\":{");
+    for (int i = 0; i < keys && used < sizeof(body) - 128; i++) {
+        used += snprintf(body + used, sizeof(body) - used,
+                         "%s\"sensor-%03d.threshold\":\"%d\"", i ? "," : "", i, (i * 37) % 1000);
+    }
+    used += snprintf(body + used, sizeof(body) - used, "}}");
+    return used;
+}
+
+// A NodeList page with n items
+static size_t build_node_list(int items) {
+    size_t used = snprintf(body, sizeof(body),
+        "{\"kind\":\"NodeList\",\"apiVersion\":\"v1\",\"metadata\":{\"resourceVersion\":\"183760\"},\"items\":[");
+    for (int i = 0; i < items && used < sizeof(body) - 512; i++) {
+        used += snprintf(body + used, sizeof(body) - used,
+            "%s{\"metadata\":{\"name\":\"pico-node-%d\",\"uid\":\"%08x-4d5e-4f60-8a7b-9c0d1e2f3a4b\","
+            "\"labels\":{\"kubernetes.io/arch\":\"arm\",\"kubernetes.io/os\":\"rp2040\"}},"
+            "\"status\":{\"conditions\":[{\"type\":\"Ready\",\"status\":\"True\","
+            "\"lastHeartbeatTime\":\"2026-01-01T00:%02d:00Z\"}],\"addresses\":[{\"type\":"
+            "\"InternalIP\",\"address\":\"192.168.1.%d\"}]}}",
+            i ? "," : "", i, 0x6f1c2b3au + i, i % 60, 50 + i);
+    }
+    used += snprintf(body + used, sizeof(body) - used, "]}");
+    return used;
+}
+
+static size_t gzip_compress(size_t length, int level) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, level, Z_DEFLATED, INFLATE_WINDOW_BITS + 16, 8, Z_DEFAULT_STRATEGY);
+    zs.next_in = (Bytef *)body;
+    zs.avail_in = (uInt)length;
+    zs.next_out = packed;
+    zs.avail_out = sizeof(packed);
+    deflate(&zs, Z_FINISH);
+    size_t packed_length = zs.total_out;
+    deflateEnd(&zs);
+    return packed_length;
+}
+
+static int count_output(const uint8_t *data, size_t length, void *user_data) {
+    (void)data;
+    *(size_t *)user_data += length;
+    return 0;
+}
+
+// Inflate in MSS-sized pieces, as segments come off the socket
+static size_t inflate_segments(size_t packed_length) {
+    size_t produced = 0;
+    gzip_inflate_init(&inflater, count_output, &produced);
+    for (size_t offset = 0; offset < packed_length; offset += SEGMENT_SIZE) {
+        size_t n = (packed_length - offset < SEGMENT_SIZE) ? packed_length - offset : SEGMENT_SIZE;
+        if (gzip_inflate_feed(&inflater, packed + offset, n) != INFLATE_NEED_MORE) {
+            break;
+        }
+    }
+    return produced;
+}
+
+static size_t segments(size_t length) {
+    return (length + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+}
+
+static void run_case(const char *name, size_t length, int level, int iterations) {
+    size_t packed_length = gzip_compress(length, level);
+    volatile size_t sink = 0;
+
+    if (inflate_segments(packed_length) != length) {
+        printf("  %-14s inflate failed\n", name);
+        return;
+    }
+
+    double start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += inflate_segments(packed_length);
+    }
+    double ns = (now_ns() - start) / iterations;
+    (void)sink;
+
+    printf("  %-14s %2d %7zu %7zu %6.1f%% %4zu->%-3zu %10.0f\n",
+           name, level, length, packed_length,
+           100.0 * (double)(length - packed_length) / (double)length,
+           segments(length), segments(packed_length),
+           ns * 1024.0 / (double)length);
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    const int levels[] = { 1, 6 };  // nginx gzip_comp_level default, zlib default
+
+    printf("========================================\n");
+    printf("  gzip Inflate Benchmark\n");
+    printf("========================================\n");
+    printf("  %d iterations per case, %u-byte window, %d-byte segments\n",
+           iterations, INFLATE_WINDOW_SIZE, SEGMENT_SIZE);
+    printf("  inflater state: %zu bytes\n\n", sizeof(gzip_inflater_t));
+    printf("  %-14s %2s %7s %7s %7s %8s %10s\n",
+           "response", "lv", "plain", "gzip", "saved", "segments", "ns/KB");
+
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        run_case("node", build_node(), levels[l], iterations);
+        run_case("configmap-16", build_configmap(16), levels[l], iterations);
+        run_case("configmap-256", build_configmap(256), levels[l], iterations);
+        run_case("nodelist-100", build_node_list(100), levels[l], iterations / 10 + 1);
+    }
+
+    printf("========================================\n");
+    return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * Host benchmark: JSON vs Kubernetes protobuf
+ *
+ * Compares the two encodings on the traffic this node generates every few
+ * seconds: the Node status update it sends and the ConfigMap it polls.
+ * Reports body size (what goes over WiFi) and the CPU time to build or
+ * parse one body.
+ *
+ * The JSON side reproduces the firmware's code paths: the snprintf()
+ * template from node_status.c and the streaming key extractor from
+ * configmap_watcher.c.
+ *
+ * Usage: ./bench_k8s_encoding [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "k8s_protobuf.h"
+
+static char json[4096];
+static uint8_t proto[4096];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Same template as status_only_json_template in node_status.c
+static const char *status_json_template =
+    "{"
+    "  \"status\": {"
+    "    \"conditions\": ["
+    "      {\"type\": \"Ready\", \"status\": \"True\", \"lastHeartbeatTime\": \"%s\", \"lastTransitionTime\": \"%s\", \"reason\": \"KubeletReady\", \"message\": \"Pico node is ready\"},"
+    "      {\"type\": \"MemoryPressure\", \"status\": \"False\", \"lastHeartbeatTime\": \"%s\", \"lastTransitionTime\": \"%s\", \"reason\": \"KubeletHasSufficientMemory\"},"
+    "      {\"type\": \"DiskPressure\", \"status\": \"False\", \"lastHeartbeatTime\": \"%s\", \"lastTransitionTime\": \"%s\", \"reason\": \"KubeletHasNoDiskPressure\"},"
+    "      {\"type\": \"PIDPressure\", \"status\": \"False\", \"lastHeartbeatTime\": \"%s\", \"lastTransitionTime\": \"%s\", \"reason\": \"KubeletHasSufficientPID\"},"
+    "      {\"type\": \"NetworkUnavailable\", \"status\": \"False\", \"lastHeartbeatTime\": \"%s\", \"lastTransitionTime\": \"%s\", \"reason\": \"RouteCreated\"}"
+    "    ],"
+    "    \"addresses\": ["
+    "      {\"type\": \"InternalIP\", \"address\": \"%s\"},"
+    "      {\"type\": \"Hostname\", \"address\": \"%s\"}"
+    "    ],"
+    "    \"capacity\": {"
+    "      \"cpu\": \"1\","
+    "      \"memory\": \"256Ki\","
+    "      \"pods\": \"0\""
+    "    },"
+    "    \"allocatable\": {"
+    "      \"cpu\": \"1\","
+    "      \"memory\": \"256Ki\","
+    "      \"pods\": \"0\""
+    "    },"
+    "    \"nodeInfo\": {"
+    "      \"machineID\": \"rp2040-pico-wh\","
+    "      \"systemUUID\": \"rp2040-pico-wh\","
+    "      \"bootID\": \"rp2040-pico-wh\","
+    "      \"kernelVersion\": \"5.15.0-rp2040\","
+    "      \"osImage\": \"Pico SDK\","
+    "      \"containerRuntimeVersion\": \"mock://1.0.0\","
+    "      \"kubeletVersion\": \"v1.34.0\","
+    "      \"kubeProxyVersion\": \"v1.34.0\","
+    "      \"operatingSystem\": \"linux\","
+    "      \"architecture\": \"arm\""
+    "    },"
+    "    \"daemonEndpoints\": {"
+    "      \"kubeletEndpoint\": {"
+    "        \"Port\": %d"
+    "      }"
+    "    }"
+    "  }"
+    "}";
+
+static int build_status_json(void) {
+    const char *ts = "2026-01-01T00:00:00Z";
+    return snprintf(json, sizeof(json), status_json_template,
+                    ts, ts, ts, ts, ts, ts, ts, ts, ts, ts,
+                    "192.168.1.50", "pico-node-1", 10250);
+}
+
+static int build_status_proto(void) {
+    k8s_node_status_t status = {
+        .name = "pico-node-1",
+        .internal_ip = "192.168.1.50",
+        .hostname = "pico-node-1",
+        .heartbeat_time = 1767225600,
+        .transition_time = 1767225600,
+        .kubelet_port = 10250,
+    };
+    return k8s_pb_encode_node_status(proto, sizeof(proto), &status);
+}
+
+#define MEMORY_VALUES "0=0x42,1=0x43,2=0x44,3=0x45,4=0x46,5=0x47,6=0x48,7=0x49"
+
+// The ConfigMap as the API server returns it in each encoding
+static size_t build_configmap_json(void) {
+    return snprintf(json, sizeof(json),
+        "{\"kind\":\"ConfigMap\",\"apiVersion\":\"v1\",\"metadata\":{\"name\":\"pico-config\","
+        "\"namespace\":\"default\",\"uid\":\"6f1c2b3a-4d5e-4f60-8a7b-9c0d1e2f3a4b\","
+        "\"resourceVersion\":\"183750\",\"creationTimestamp\":\"2026-01-01T00:00:00Z\"},"
+        "\"data\":{\"memory_values\":\"" MEMORY_VALUES "\",\"poll_interval\":\"30\"}}\n");
+}
+
+static size_t build_configmap_proto(void) {
+    pb_writer_t w;
+    memcpy(proto, K8S_PROTOBUF_MAGIC, K8S_PROTOBUF_MAGIC_LEN);
+    pb_writer_init(&w, proto + K8S_PROTOBUF_MAGIC_LEN, sizeof(proto) - K8S_PROTOBUF_MAGIC_LEN);
+
+    size_t type_meta = pb_begin_message(&w, K8S_PB_UNKNOWN_TYPE_META);
+    pb_write_string(&w, K8S_PB_TYPE_META_API_VERSION, "v1");
+    pb_write_string(&w, K8S_PB_TYPE_META_KIND, "ConfigMap");
+    pb_end_message(&w, type_meta);
+
+    size_t raw = pb_begin_message(&w, K8S_PB_UNKNOWN_RAW);
+    size_t meta = pb_begin_message(&w, K8S_PB_CONFIGMAP_METADATA);
+    pb_write_string(&w, K8S_PB_META_NAME, "pico-config");
+    pb_write_string(&w, K8S_PB_META_NAMESPACE, "default");
+    pb_write_string(&w, 5, "6f1c2b3a-4d5e-4f60-8a7b-9c0d1e2f3a4b");    // uid
+    pb_write_string(&w, K8S_PB_META_RESOURCE_VERSION, "183750");
+    size_t created = pb_begin_message(&w, 8);                           // creationTimestamp
+    pb_write_varint(&w, K8S_PB_TIME_SECONDS, 1767225600);
+    pb_end_message(&w, created);
+    pb_end_message(&w, meta);
+
+    size_t entry = pb_begin_message(&w, K8S_PB_CONFIGMAP_DATA);
+    pb_write_string(&w, K8S_PB_MAP_KEY, "memory_values");
+    pb_write_string(&w, K8S_PB_MAP_VALUE, MEMORY_VALUES);
+    pb_end_message(&w, entry);
+    entry = pb_begin_message(&w, K8S_PB_CONFIGMAP_DATA);
+    pb_write_string(&w, K8S_PB_MAP_KEY, "poll_interval");
+    pb_write_string(&w, K8S_PB_MAP_VALUE, "30");
+    pb_end_message(&w, entry);
+    pb_end_message(&w, raw);
+
+    return K8S_PROTOBUF_MAGIC_LEN + w.length;
+}
+
+// Streaming "memory_values" extractor, as in configmap_watcher.c
+static size_t extract_json(const char *data, size_t length, char *value, size_t size) {
+    static const char key[] = "\"memory_values\"";
+    enum { KEY, COLON, VALUE, ESCAPE, DONE } state = KEY;
+    size_t matched = 0;
+    size_t value_len = 0;
+
+    for (size_t i = 0; i < length && state != DONE; i++) {
+        char c = data[i];
+        switch (state) {
+            case KEY:
+                if (c == key[matched]) {
+                    if (++matched == sizeof(key) - 1) {
+                        state = COLON;
+                    }
+                } else {
+                    matched = (c == '"') ? 1 : 0;
+                }
+                break;
+            case COLON:
+                if (c == '"') {
+                    state = VALUE;
+                } else if (c != ':' && c != ' ') {
+                    state = KEY;
+                    matched = 0;
+                }
+                break;
+            case VALUE:
+                if (c == '"') {
+                    state = DONE;
+                } else if (c == '\\') {
+                    state = ESCAPE;
+                } else if (value_len < size - 1) {
+                    value[value_len++] = c;
+                }
+                break;
+            case ESCAPE:
+                if (value_len < size - 1) {
+                    value[value_len++] = c;
+                }
+                state = VALUE;
+                break;
+            case DONE:
+                break;
+        }
+    }
+    value[value_len] = '\0';
+    return value_len;
+}
+
+static size_t extract_proto(const uint8_t *data, size_t length, char *value, size_t size) {
+    k8s_pb_configmap_t cm;
+    k8s_pb_configmap_init(&cm, "memory_values", value, size);
+    k8s_pb_configmap_feed(&cm, data, length);
+    return cm.found ? cm.value_len : 0;
+}
+
+static void report(const char *name, size_t json_size, size_t proto_size,
+                   double json_ns, double proto_ns) {
+    printf("  %-18s %6zu %6zu %5.0f%% %9.0f %9.0f %6.1fx\n",
+           name, json_size, proto_size,
+           100.0 * (double)(json_size - proto_size) / (double)json_size,
+           json_ns, proto_ns, json_ns / proto_ns);
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 100000;
+    volatile size_t sink = 0;
+    char value[256];
+
+    printf("========================================\n");
+    printf("  JSON vs Kubernetes Protobuf Benchmark\n");
+    printf("========================================\n");
+    printf("  %d iterations per case\n\n", iterations);
+    printf("  %-18s %6s %6s %6s %9s %9s %7s\n",
+           "body", "json", "proto", "saved", "json ns", "proto ns", "speedup");
+
+    // Node status: build the body
+    size_t json_size = build_status_json();
+    size_t proto_size = build_status_proto();
+    double start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += build_status_json();
+    }
+    double json_ns = (now_ns() - start) / iterations;
+    start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += build_status_proto();
+    }
+    double proto_ns = (now_ns() - start) / iterations;
+    report("node status encode", json_size, proto_size, json_ns, proto_ns);
+
+    // ConfigMap: extract memory_values from the body
+    json_size = build_configmap_json();
+    proto_size = build_configmap_proto();
+    if (extract_json(json, json_size, value, sizeof(value)) !=
+        extract_proto(proto, proto_size, value, sizeof(value))) {
+        printf("  ConfigMap extractors disagree\n");
+        return 1;
+    }
+    start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += extract_json(json, json_size, value, sizeof(value));
+    }
+    json_ns = (now_ns() - start) / iterations;
+    start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += extract_proto(proto, proto_size, value, sizeof(value));
+    }
+    proto_ns = (now_ns() - start) / iterations;
+    report("configmap decode", json_size, proto_size, json_ns, proto_ns);
+
+    (void)sink;
+    printf("========================================\n");
+    return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * Host benchmark: TCP receive path
+ *
+ * Moves a 64 KB HTTP response from lwIP-style pbuf chains (1460-byte
+ * segments in 512-byte pool pbufs) into http_framer_feed() three ways:
+ *   byte ring - the old path, one byte at a time into the ring buffer in
+ *               the receive callback and one at a time out of it again
+ *   bulk ring - TCP_RECV_ZERO_COPY=0, a memcpy per pbuf into the ring and
+ *               framing straight from the ring segments
+ *   pbuf peek - TCP_RECV_ZERO_COPY=1, framing from the pbuf payloads
+ *
+ * The pbuf, ring and peek/consume code are simplified copies of
+ * tcp_connection.c; lwIP itself is not linked.
+ *
+ * Usage: ./bench_recv [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_client.h"
+
+#define BODY_SIZE (64 * 1024)
+#define SEGMENT_SIZE 1460
+#define PBUF_POOL_BUFSIZE 512
+#define RING_SIZE 2048
+#define READ_SIZE 1024
+
+// Just enough of struct pbuf for a chain
+typedef struct pbuf {
+    struct pbuf *next;
+    char *payload;
+    size_t len;
+    size_t tot_len;
+} pbuf_t;
+
+#define MAX_PBUFS ((BODY_SIZE + 256) / PBUF_POOL_BUFSIZE + 4 * ((BODY_SIZE + 256) / SEGMENT_SIZE + 1))
+
+static char response[BODY_SIZE + 256];
+static size_t response_length;
+static pbuf_t pbufs[MAX_PBUFS];
+static pbuf_t *segments[(BODY_SIZE + 256) / SEGMENT_SIZE + 2];
+static int segment_count;
+
+static uint8_t ring[RING_SIZE];
+static char read_buffer[READ_SIZE];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Split the response into segments, each a chain of pool-sized pbufs
+static void build_segments(void) {
+    int used = 0;
+    response_length = sprintf(response, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                              "Content-Length: %d\r\n\r\n", BODY_SIZE);
+    for (int i = 0; i < BODY_SIZE; i++) {
+        response[response_length + i] = 'a' + (i % 26);
+    }
+    response_length += BODY_SIZE;
+
+    for (size_t offset = 0; offset < response_length; offset += SEGMENT_SIZE) {
+        size_t seg = (response_length - offset < SEGMENT_SIZE) ? response_length - offset
+                                                               : SEGMENT_SIZE;
+        pbuf_t *prev = NULL;
+        for (size_t o = 0; o < seg; o += PBUF_POOL_BUFSIZE) {
+            pbuf_t *p = &pbufs[used++];
+            p->payload = response + offset + o;
+            p->len = (seg - o < PBUF_POOL_BUFSIZE) ? seg - o : PBUF_POOL_BUFSIZE;
+            p->tot_len = seg - o;
+            p->next = NULL;
+            if (prev) {
+                prev->next = p;
+            } else {
+                segments[segment_count++] = p;
+            }
+            prev = p;
+        }
+    }
+}
+
+// Feed one span to the framer; returns false once the response is done
+static bool frame(http_framer_t *framer, const char *data, size_t length, size_t *body) {
+    while (length > 0) {
+        size_t used;
+        const char *out;
+        size_t out_length;
+        http_frame_event_t event = http_framer_feed(framer, data, length, &used, &out, &out_length);
+        data += used;
+        length -= used;
+        if (event == HTTP_FRAME_BODY) {
+            *body += out_length;
+        } else if (event == HTTP_FRAME_COMPLETE || event == HTTP_FRAME_ERROR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Old path: byte-at-a-time ring write in the callback, byte-at-a-time read
+static size_t run_byte_ring(void) {
+    http_framer_t framer;
+    uint16_t head = 0, tail = 0;
+    size_t body = 0;
+
+    http_framer_init(&framer);
+    for (int s = 0; s < segment_count; s++) {
+        for (pbuf_t *q = segments[s]; q != NULL; q = q->next) {
+            for (size_t i = 0; i < q->len; i++) {
+                uint16_t next = (head + 1) & (RING_SIZE - 1);
+                if (next == tail) {
+                    break;
+                }
+                ring[head] = (uint8_t)q->payload[i];
+                head = next;
+            }
+        }
+
+        while (head != tail) {
+            size_t n = 0;
+            while (n < READ_SIZE && tail != head) {
+                read_buffer[n++] = (char)ring[tail];
+                tail = (tail + 1) & (RING_SIZE - 1);
+            }
+            if (!frame(&framer, read_buffer, n, &body)) {
+                return body;
+            }
+        }
+    }
+    return body;
+}
+
+// TCP_RECV_ZERO_COPY=0: one memcpy per pbuf in, framed from the ring
+static size_t run_bulk_ring(void) {
+    http_framer_t framer;
+    uint16_t head = 0, tail = 0;
+    size_t body = 0;
+
+    http_framer_init(&framer);
+    for (int s = 0; s < segment_count; s++) {
+        for (pbuf_t *q = segments[s]; q != NULL; q = q->next) {
+            size_t first = RING_SIZE - head;
+            if (first > q->len) {
+                first = q->len;
+            }
+            memcpy(ring + head, q->payload, first);
+            memcpy(ring, q->payload + first, q->len - first);
+            head = (head + q->len) & (RING_SIZE - 1);
+        }
+
+        while (head != tail) {
+            uint16_t available = (head - tail) & (RING_SIZE - 1);
+            uint16_t to_end = RING_SIZE - tail;
+            uint16_t n = (available < to_end) ? available : to_end;
+            if (!frame(&framer, (const char *)ring + tail, n, &body)) {
+                return body;
+            }
+            tail = (tail + n) & (RING_SIZE - 1);
+        }
+    }
+    return body;
+}
+
+// TCP_RECV_ZERO_COPY=1: the chain is queued, framed from each payload
+static size_t run_pbuf_peek(void) {
+    http_framer_t framer;
+    size_t body = 0;
+
+    http_framer_init(&framer);
+    for (int s = 0; s < segment_count; s++) {
+        for (pbuf_t *q = segments[s]; q != NULL; q = q->next) {
+            if (!frame(&framer, q->payload, q->len, &body)) {
+                return body;
+            }
+        }
+    }
+    return body;
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    volatile size_t sink = 0;
+
+    static const struct {
+        const char *name;
+        size_t (*run)(void);
+        int copies;
+    } paths[] = {
+        { "byte ring", run_byte_ring, 2 },
+        { "bulk ring", run_bulk_ring, 1 },
+        { "pbuf peek", run_pbuf_peek, 0 },
+    };
+
+    build_segments();
+
+    printf("========================================\n");
+    printf("  TCP Receive Path Benchmark\n");
+    printf("========================================\n");
+    printf("  %zu-byte response in %d segments of %d bytes, %d-byte pbufs\n",
+           response_length, segment_count, SEGMENT_SIZE, PBUF_POOL_BUFSIZE);
+    printf("  %d iterations per path\n\n", iterations);
+    printf("  %-10s %8s %10s %10s %10s\n", "path", "copies", "ns/KB", "MB/s", "ring RAM");
+
+    double baseline = 0;
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        if (paths[p].run() != BODY_SIZE) {
+            printf("  %s: framed the wrong number of body bytes\n", paths[p].name);
+            return 1;
+        }
+
+        double start = now_ns();
+        for (int i = 0; i < iterations; i++) {
+            sink += paths[p].run();
+        }
+        double ns = (now_ns() - start) / iterations;
+        if (p == 0) {
+            baseline = ns;
+        }
+
+        printf("  %-10s %8d %10.1f %10.0f %10d", paths[p].name, paths[p].copies,
+               ns / (response_length / 1024.0), (response_length / 1e6) / (ns / 1e9),
+               paths[p].copies ? RING_SIZE : 0);
+        if (p > 0) {
+            printf("  %.1fx", baseline / ns);
+        }
+        printf("\n");
+    }
+
+    printf("\n  (sink %zu)\n", (size_t)sink);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * Host benchmark: byte loops vs SWAR delimiter scanning
+ *
+ * Splits a typical API server response head into lines and header names
+ * the way http_parse_response() does, once with the byte-at-a-time loops
+ * the parser used before and once with scan_crlf()/scan_byte(). Also
+ * times a long header value, where the word loop does most of the work.
+ *
+ * Host libc memchr/strstr are vectorized and would hide the difference
+ * that matters on the Cortex-M0+, so the baseline is a plain byte loop;
+ * compare the ratios, not the absolute numbers.
+ *
+ * Usage: ./bench_scan [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scan.h"
+
+static const char response_head[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Audit-Id: 3f8e0c2a-6d1b-4a7e-9c55-0b8f2d1e7a44\r\n"
+    "Cache-Control: no-cache, private\r\n"
+    "Content-Type: application/json\r\n"
+    "X-Kubernetes-Pf-Flowschema-Uid: 9b2f4c1e-3a5d-4e6f-8a7b-1c2d3e4f5a6b\r\n"
+    "X-Kubernetes-Pf-Prioritylevel-Uid: 7e6d5c4b-3a2f-4e1d-9c8b-7a6f5e4d3c2b\r\n"
+    "Date: Wed, 21 Oct 2026 07:28:00 GMT\r\n"
+    "Content-Length: 1843\r\n"
+    "\r\n";
+
+static char long_value[1024];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Byte loops, as the parser did before
+static const char *loop_crlf(const char *data, size_t length) {
+    for (size_t i = 0; i + 1 < length; i++) {
+        if (data[i] == '\r' && data[i + 1] == '\n') {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+
+static const char *loop_byte(const char *data, size_t length, char c) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == c) {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+
+typedef const char *(*crlf_fn)(const char *, size_t);
+typedef const char *(*byte_fn)(const char *, size_t, char);
+
+// Walk the head line by line, finding each colon; returns bytes of names
+static size_t split_head(const char *head, size_t length, crlf_fn find_crlf, byte_fn find_byte) {
+    const char *end = head + length;
+    const char *line = head;
+    size_t names = 0;
+
+    while (line < end) {
+        const char *line_end = find_crlf(line, end - line);
+        if (line_end == NULL || line_end == line) {
+            break;
+        }
+        const char *colon = find_byte(line, line_end - line, ':');
+        if (colon != NULL) {
+            names += colon - line;
+        }
+        line = line_end + 2;
+    }
+    return names;
+}
+
+static void report(const char *name, size_t bytes, double loop_ns, double scan_ns) {
+    printf("  %-20s %6zu %10.0f %10.0f %7.1fx\n", name, bytes, loop_ns, scan_ns,
+           loop_ns / scan_ns);
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 1000000;
+    volatile size_t sink = 0;
+    size_t head_len = sizeof(response_head) - 1;
+
+    memset(long_value, 'x', sizeof(long_value) - 2);
+    memcpy(long_value + sizeof(long_value) - 2, "\r\n", 2);
+
+    if (split_head(response_head, head_len, loop_crlf, loop_byte) !=
+        split_head(response_head, head_len, scan_crlf, scan_byte)) {
+        printf("  Scanners disagree\n");
+        return 1;
+    }
+
+    printf("========================================\n");
+    printf("  SWAR Delimiter Scanning Benchmark\n");
+    printf("========================================\n");
+    printf("  %d iterations per case\n\n", iterations);
+    printf("  %-20s %6s %10s %10s %8s\n", "input", "bytes", "loop ns", "swar ns", "speedup");
+
+    double start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += split_head(response_head, head_len, loop_crlf, loop_byte);
+    }
+    double loop_ns = (now_ns() - start) / iterations;
+    start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += split_head(response_head, head_len, scan_crlf, scan_byte);
+    }
+    double scan_ns = (now_ns() - start) / iterations;
+    report("response head", head_len, loop_ns, scan_ns);
+
+    start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += loop_crlf(long_value + (i & 3), sizeof(long_value) - (i & 3)) - long_value;
+    }
+    loop_ns = (now_ns() - start) / iterations;
+    start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        sink += scan_crlf(long_value + (i & 3), sizeof(long_value) - (i & 3)) - long_value;
+    }
+    scan_ns = (now_ns() - start) / iterations;
+    report("1 KB line, CRLF", sizeof(long_value), loop_ns, scan_ns);
+
+    printf("\n  (sink %zu)\n", (size_t)sink);
+    return 0;
+}
@@ -0,0 +1,326 @@
+/**
+ * Host benchmark: full vs resumed TLS handshakes
+ *
+ * Runs the client side the way tls_context.c configures it (mTLS with the
+ * kubelet client certificate from certs.h, server CA pinned, TLS 1.2)
+ * against a local mbedtls stand-in for the k3s API server that accepts
+ * the client CA and resumes sessions by ID (session cache) and by RFC 5077
+ * ticket. Client and server are stepped alternately in one thread over
+ * in-memory pipes, so the client time is measured without the server's.
+ *
+ * Three ways to reconnect:
+ *   full     - no cached session: ECDHE, certificate chain check, and an
+ *              ECDSA CertificateVerify signature from the client
+ *   id       - the cached session offered by session ID
+ *   ticket   - the cached session offered as a ticket (how Go's TLS
+ *              server, and so k3s, resumes)
+ *
+ * Resumption is detected like tls_connection.c does: the certificate
+ * verify callback only runs in a full handshake.
+ *
+ * The stand-in serves the RSA kubelet serving certificate (the API server
+ * uses ECDSA P-256), so the client checks it against that certificate's
+ * name where the firmware checks the API server's IP (K3S_SERVER_IP).
+ * Certificate dates are not checked so the bench keeps working after the
+ * embedded certificates expire.
+ *
+ * Usage: ./bench_tls_resume [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/version.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000 && defined(MBEDTLS_PSA_CRYPTO_C)
+#include "psa/crypto.h"
+#endif
+
+#include "certs.h"
+
+#define PIPE_SIZE (32 * 1024)
+#define MAX_ROUNDS 100
+
+// One direction of the in-memory connection
+typedef struct {
+    unsigned char data[PIPE_SIZE];
+    size_t length;
+    size_t total;       // Bytes ever written
+} pipe_t;
+
+typedef struct {
+    pipe_t *in;
+    pipe_t *out;
+} endpoint_t;
+
+static pipe_t to_server, to_client;
+static endpoint_t client_end = { &to_client, &to_server };
+static endpoint_t server_end = { &to_server, &to_client };
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+static mbedtls_x509_crt server_ca, client_ca, client_cert, server_cert;
+static mbedtls_pk_context client_key, server_key;
+static mbedtls_ssl_config server_config, client_config, client_config_id;
+static mbedtls_ssl_cache_context session_cache;
+static mbedtls_ssl_ticket_context ticket_keys;
+static mbedtls_ssl_context client, server;
+
+static int peer_verified;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int pipe_send(void *ctx, const unsigned char *buf, size_t len) {
+    pipe_t *out = ((endpoint_t *)ctx)->out;
+    size_t space = PIPE_SIZE - out->length;
+    if (space == 0) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    if (len > space) {
+        len = space;
+    }
+    memcpy(out->data + out->length, buf, len);
+    out->length += len;
+    out->total += len;
+    return (int)len;
+}
+
+static int pipe_recv(void *ctx, unsigned char *buf, size_t len) {
+    pipe_t *in = ((endpoint_t *)ctx)->in;
+    if (in->length == 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > in->length) {
+        len = in->length;
+    }
+    memcpy(buf, in->data, len);
+    memmove(in->data, in->data + len, in->length - len);
+    in->length -= len;
+    return (int)len;
+}
+
+static int ignore_dates(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    (void)ctx;
+    (void)crt;
+    (void)depth;
+    *flags &= ~(MBEDTLS_X509_BADCERT_EXPIRED | MBEDTLS_X509_BADCERT_FUTURE);
+    return 0;
+}
+
+// Client side: only called when the server sends its certificate chain
+static int client_verify(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    peer_verified = 1;
+    return ignore_dates(ctx, crt, depth, flags);
+}
+
+static void check(int ret, const char *what) {
+    if (ret != 0) {
+        printf("  %s failed: -0x%04x\n", what, (unsigned)-ret);
+        exit(1);
+    }
+}
+
+static int parse_key(mbedtls_pk_context *key, const char *pem, size_t length) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    return mbedtls_pk_parse_key(key, (const unsigned char *)pem, length, NULL, 0,
+                                mbedtls_ctr_drbg_random, &ctr_drbg);
+#else
+    return mbedtls_pk_parse_key(key, (const unsigned char *)pem, length, NULL, 0);
+#endif
+}
+
+static void setup_client_config(mbedtls_ssl_config *conf, int tickets) {
+    mbedtls_ssl_config_init(conf);
+    check(mbedtls_ssl_config_defaults(conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT), "client defaults");
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    mbedtls_ssl_conf_max_tls_version(conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#endif
+    mbedtls_ssl_conf_authmode(conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(conf, &server_ca, NULL);
+    mbedtls_ssl_conf_rng(conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+    check(mbedtls_ssl_conf_own_cert(conf, &client_cert, &client_key), "client certificate");
+    mbedtls_ssl_conf_session_tickets(conf, tickets ? MBEDTLS_SSL_SESSION_TICKETS_ENABLED
+                                                   : MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+}
+
+static void setup(void) {
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    check(mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, NULL, 0), "DRBG seed");
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000 && defined(MBEDTLS_PSA_CRYPTO_C)
+    check((int)psa_crypto_init(), "PSA init");
+#endif
+
+    mbedtls_x509_crt_init(&server_ca);
+    mbedtls_x509_crt_init(&client_ca);
+    mbedtls_x509_crt_init(&client_cert);
+    mbedtls_x509_crt_init(&server_cert);
+    mbedtls_pk_init(&client_key);
+    mbedtls_pk_init(&server_key);
+    check(mbedtls_x509_crt_parse(&server_ca, (const unsigned char *)server_ca_cert,
+                                 sizeof(server_ca_cert)), "server CA");
+    check(mbedtls_x509_crt_parse(&client_ca, (const unsigned char *)client_ca_cert,
+                                 sizeof(client_ca_cert)), "client CA");
+    check(mbedtls_x509_crt_parse(&client_cert, (const unsigned char *)client_kubelet_cert,
+                                 sizeof(client_kubelet_cert)), "client certificate");
+    check(mbedtls_x509_crt_parse(&server_cert, (const unsigned char *)serving_kubelet_cert,
+                                 sizeof(serving_kubelet_cert)), "server certificate");
+    check(parse_key(&client_key, client_kubelet_key, sizeof(client_kubelet_key)), "client key");
+    check(parse_key(&server_key, serving_kubelet_key, sizeof(serving_kubelet_key)), "server key");
+
+    // Stand-in API server: requires a client certificate, resumes by
+    // session ID and by ticket
+    mbedtls_ssl_config_init(&server_config);
+    check(mbedtls_ssl_config_defaults(&server_config, MBEDTLS_SSL_IS_SERVER,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT), "server defaults");
+    mbedtls_ssl_conf_authmode(&server_config, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&server_config, &client_ca, NULL);
+    mbedtls_ssl_conf_verify(&server_config, ignore_dates, NULL);
+    mbedtls_ssl_conf_rng(&server_config, mbedtls_ctr_drbg_random, &ctr_drbg);
+    check(mbedtls_ssl_conf_own_cert(&server_config, &server_cert, &server_key),
+          "server certificate");
+
+    mbedtls_ssl_cache_init(&session_cache);
+    mbedtls_ssl_conf_session_cache(&server_config, &session_cache,
+                                   mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+
+    mbedtls_ssl_ticket_init(&ticket_keys);
+    check(mbedtls_ssl_ticket_setup(&ticket_keys, mbedtls_ctr_drbg_random, &ctr_drbg,
+                                   MBEDTLS_CIPHER_AES_256_GCM, 86400), "ticket keys");
+    mbedtls_ssl_conf_session_tickets_cb(&server_config, mbedtls_ssl_ticket_write,
+                                        mbedtls_ssl_ticket_parse, &ticket_keys);
+
+    setup_client_config(&client_config, 1);
+    setup_client_config(&client_config_id, 0);
+
+    mbedtls_ssl_init(&server);
+    check(mbedtls_ssl_setup(&server, &server_config), "server setup");
+    mbedtls_ssl_set_bio(&server, &server_end, pipe_send, pipe_recv, NULL);
+}
+
+// Fresh connection: new client context (as k3s_client sets one up per
+// pooled connection), server reset
+static void reconnect(const mbedtls_ssl_config *conf) {
+    mbedtls_ssl_free(&client);
+    mbedtls_ssl_init(&client);
+    check(mbedtls_ssl_setup(&client, conf), "client setup");
+    mbedtls_ssl_set_bio(&client, &client_end, pipe_send, pipe_recv, NULL);
+    mbedtls_ssl_set_verify(&client, client_verify, NULL);
+    check(mbedtls_ssl_set_hostname(&client, "pico-node-1"), "hostname");
+    check(mbedtls_ssl_session_reset(&server), "server reset");
+    to_server.length = to_client.length = 0;
+    to_server.total = to_client.total = 0;
+    peer_verified = 0;
+}
+
+static int step(mbedtls_ssl_context *ssl, int *done, double *ns) {
+    if (*done) {
+        return 0;
+    }
+    double start = now_ns();
+    int ret = mbedtls_ssl_handshake(ssl);
+    *ns += now_ns() - start;
+    if (ret == 0) {
+        *done = 1;
+    } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return ret;
+    }
+    return 0;
+}
+
+// Run both sides until the handshake completes
+static void handshake(double *client_ns, double *server_ns) {
+    int client_done = 0, server_done = 0;
+    for (int round = 0; round < MAX_ROUNDS && !(client_done && server_done); round++) {
+        check(step(&client, &client_done, client_ns), "client handshake");
+        check(step(&server, &server_done, server_ns), "server handshake");
+    }
+    if (!(client_done && server_done)) {
+        printf("  handshake did not complete\n");
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 50;
+
+    static const struct {
+        const char *name;
+        int resume;
+        int tickets;
+    } modes[] = {
+        { "full",   0, 1 },
+        { "id",     1, 0 },
+        { "ticket", 1, 1 },
+    };
+
+    setup();
+
+    printf("========================================\n");
+    printf("  TLS Handshake Resumption Benchmark\n");
+    printf("========================================\n");
+    printf("  %s, mTLS with the kubelet client certificate\n", MBEDTLS_VERSION_STRING_FULL);
+    printf("  %d handshakes per mode\n\n", iterations);
+    printf("  %-8s %12s %12s %10s %10s\n", "mode", "client us", "server us", "bytes out", "bytes in");
+
+    double baseline = 0;
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        const mbedtls_ssl_config *conf = modes[m].tickets ? &client_config : &client_config_id;
+        mbedtls_ssl_session session;
+        mbedtls_ssl_session_init(&session);
+
+        if (modes[m].resume) {
+            // One full handshake to get a session to resume
+            double ignored = 0;
+            reconnect(conf);
+            handshake(&ignored, &ignored);
+            check(mbedtls_ssl_get_session(&client, &session), "get session");
+        }
+
+        double client_ns = 0, server_ns = 0;
+        size_t sent = 0, received = 0;
+        for (int i = 0; i < iterations; i++) {
+            reconnect(conf);
+            if (modes[m].resume) {
+                check(mbedtls_ssl_set_session(&client, &session), "set session");
+            }
+            handshake(&client_ns, &server_ns);
+            if (peer_verified == modes[m].resume) {
+                printf("  %s: handshake was %s\n", modes[m].name,
+                       peer_verified ? "full" : "resumed");
+                return 1;
+            }
+            sent += to_server.total;
+            received += to_client.total;
+        }
+        mbedtls_ssl_session_free(&session);
+
+        double client_us = client_ns / iterations / 1000;
+        if (m == 0) {
+            baseline = client_us;
+        }
+        printf("  %-8s %12.1f %12.1f %10zu %10zu", modes[m].name, client_us,
+               server_ns / iterations / 1000, sent / iterations, received / iterations);
+        if (m > 0) {
+            printf("  %.1fx", baseline / client_us);
+        }
+        printf("\n");
+    }
+
+    printf("\n  client us is what the Pico would spend; scale by the RP2040/host ratio\n");
+    return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * Fuzz target for the HTTP response parser
+ *
+ * Runs arbitrary bytes through http_parse_response(), http_get_header()
+ * and the response framer. Besides memory errors (under ASan), it aborts
+ * when a parsed body or indexed header points outside the input, or when
+ * the framer's result depends on how the input was split into reads.
+ *
+ * libFuzzer:  cmake -DK3S_FUZZ=ON -DCMAKE_C_COMPILER=clang ..
+ *             ./fuzz_http_parser ../corpus/http
+ * AFL:        CC=afl-clang-fast cmake ..
+ *             afl-fuzz -i ../corpus/http -o findings -- ./fuzz_http_parser @@
+ *
+ * Without K3S_FUZZ the same target is built with a small driver that runs
+ * it once per file (directories are expanded, stdin if no arguments).
+ * ctest uses that to replay the corpus.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "http_client.h"
+
+#define MAX_INPUT 8192
+
+static char buffer[MAX_INPUT + 1];
+
+// What the framer made of one input
+typedef struct {
+    http_frame_event_t last;
+    int status_code;
+    size_t header_length;
+    size_t body_length;
+    uint32_t body_hash;
+    uint8_t headers_present;
+} frame_outcome_t;
+
+// Feed data in reads of at most piece bytes
+static void frame_input(const uint8_t *data, size_t size, size_t piece,
+                        frame_outcome_t *outcome) {
+    http_framer_t framer;
+    size_t offset = 0;
+
+    memset(outcome, 0, sizeof(*outcome));
+    outcome->last = HTTP_FRAME_NEED_MORE;
+    outcome->body_hash = 2166136261u;
+    http_framer_init(&framer);
+
+    while (offset < size && outcome->last == HTTP_FRAME_NEED_MORE) {
+        const char *chunk = (const char *)data + offset;
+        size_t n = (size - offset < piece) ? size - offset : piece;
+        offset += n;
+
+        while (true) {
+            size_t used;
+            const char *body;
+            size_t body_length;
+            http_frame_event_t event = http_framer_feed(&framer, chunk, n,
+                                                        &used, &body, &body_length);
+            chunk += used;
+            n -= used;
+
+            if (event == HTTP_FRAME_BODY) {
+                for (size_t i = 0; i < body_length; i++) {
+                    outcome->body_hash = (outcome->body_hash ^ (uint8_t)body[i]) * 16777619u;
+                }
+                outcome->body_length += body_length;
+            } else if (event != HTTP_FRAME_HEADERS) {
+                outcome->last = event;
+                break;
+            }
+        }
+    }
+
+    outcome->status_code = framer.status_code;
+    outcome->header_length = framer.header_length;
+    outcome->headers_present = framer.headers.present;
+}
+
+// Abort if a span isn't inside buffer[0..size]
+static void check_span(const char *start, size_t length, size_t size, const char *what) {
+    if (start < buffer || start + length > buffer + size) {
+        fprintf(stderr, "%s outside the input\n", what);
+        abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size > MAX_INPUT) {
+        return 0;
+    }
+
+    // Both parsers want a writable, NUL-terminated copy
+    memcpy(buffer, data, size);
+    buffer[size] = '\0';
+
+    http_response_t response;
+    if (http_parse_response(buffer, size, &response) == 0) {
+        if (response.body != NULL) {
+            check_span(response.body, response.body_length, size, "Body");
+        }
+        for (int id = 0; id < HTTP_HEADER_COUNT; id++) {
+            size_t length;
+            const char *value = http_header_find(&response.headers, buffer,
+                                                 (http_header_id_t)id, &length);
+            if (value != NULL) {
+                check_span(value, length, size, "Header value");
+            }
+        }
+    }
+
+    memcpy(buffer, data, size);
+    buffer[size] = '\0';
+    char value[64];
+    http_get_header(buffer, "Date", value, sizeof(value));
+    http_get_header(buffer, "Content-Length", value, sizeof(value));
+    http_get_header(buffer, "transfer-encoding", value, 1);
+
+    // Framing must not depend on read boundaries
+    frame_outcome_t whole;
+    frame_outcome_t split;
+    frame_input(data, size, size > 0 ? size : 1, &whole);
+    frame_input(data, size, 1, &split);
+    if (memcmp(&whole, &split, sizeof(whole)) != 0) {
+        fprintf(stderr, "Framer result depends on read size\n");
+        abort();
+    }
+
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+static uint8_t input[MAX_INPUT];
+static int inputs_run = 0;
+
+static int run_file(const char *path) {
+    FILE *f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return -1;
+    }
+    size_t size = fread(input, 1, sizeof(input), f);
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    LLVMFuzzerTestOneInput(input, size);
+    inputs_run++;
+    return 0;
+}
+
+static int run_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return run_file(path);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return -1;
+    }
+    int result = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char file[1024];
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if (run_file(file) != 0) {
+            result = -1;
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    int result = 0;
+
+    if (argc < 2) {
+        result = run_file("-");
+    }
+    for (int i = 1; i < argc; i++) {
+        if (run_path(argv[i]) != 0) {
+            result = -1;
+        }
+    }
+
+    printf("fuzz_http_parser: %d inputs, no failures\n", inputs_run);
+    return (result == 0 && inputs_run > 0) ? 0 : 1;
+}
+
+#endif // FUZZ_STANDALONE
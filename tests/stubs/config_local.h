@@ -0,0 +1,10 @@
+#ifndef CONFIG_LOCAL_H
+#define CONFIG_LOCAL_H
+
+// Placeholder credentials for host builds of sources that include
+// config.h; the firmware uses include/config_local.h (gitignored)
+#define WIFI_SSID                "test-ssid"
+#define WIFI_PASSWORD            "test-password"
+#define K3S_SERVER_IP            "192.168.1.100"
+
+#endif // CONFIG_LOCAL_H
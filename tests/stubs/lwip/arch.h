@@ -0,0 +1,29 @@
+#ifndef STUB_LWIP_ARCH_H
+#define STUB_LWIP_ARCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t u8_t;
+typedef int8_t s8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t err_t;
+
+// lwipopts.h values the sources depend on
+#define TCP_MSS            1460
+#define TCP_WND            (4 * TCP_MSS)
+#define PBUF_POOL_SIZE     32
+#define PBUF_POOL_BUFSIZE  512
+#define MEMP_NUM_TCP_PCB   5
+
+// lwIP's own header sizes (opt.h, pbuf.h)
+#define PBUF_LINK_HLEN     14
+#define PBUF_IP_HLEN       20
+#define PBUF_TCP_HLEN      20
+
+#define ERR_OK    0
+#define ERR_MEM  -1
+#define ERR_ABRT -13
+
+#endif // STUB_LWIP_ARCH_H
@@ -0,0 +1,12 @@
+#ifndef STUB_LWIP_IP_ADDR_H
+#define STUB_LWIP_IP_ADDR_H
+
+#include "lwip/arch.h"
+
+typedef struct {
+    u32_t addr;
+} ip_addr_t;
+
+char *ip4addr_ntoa(const ip_addr_t *addr);
+
+#endif // STUB_LWIP_IP_ADDR_H
@@ -0,0 +1,19 @@
+#ifndef STUB_LWIP_PBUF_H
+#define STUB_LWIP_PBUF_H
+
+#include "lwip/arch.h"
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+u8_t pbuf_free(struct pbuf *p);
+u16_t pbuf_clen(const struct pbuf *p);
+void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+
+#endif // STUB_LWIP_PBUF_H
@@ -0,0 +1,15 @@
+#ifndef STUB_LWIP_TCP_PRIV_H
+#define STUB_LWIP_TCP_PRIV_H
+
+#include "lwip/tcp.h"
+
+union tcp_listen_pcbs_t {
+    struct tcp_pcb *pcbs;
+};
+
+extern struct tcp_pcb *tcp_active_pcbs;
+extern struct tcp_pcb *tcp_bound_pcbs;
+extern struct tcp_pcb *tcp_tw_pcbs;
+extern union tcp_listen_pcbs_t tcp_listen_pcbs;
+
+#endif // STUB_LWIP_TCP_PRIV_H
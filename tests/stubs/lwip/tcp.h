@@ -0,0 +1,36 @@
+#ifndef STUB_LWIP_TCP_H
+#define STUB_LWIP_TCP_H
+
+#include "lwip/arch.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+
+struct tcp_pcb {
+    struct tcp_pcb *next;
+    struct pbuf *unsent;
+    struct pbuf *unacked;
+    u16_t rcv_wnd;
+    u16_t rcv_ann_wnd;
+};
+
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+struct tcp_pcb *tcp_new(void);
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
+                  tcp_connected_fn connected);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+u16_t tcp_sndbuf(struct tcp_pcb *pcb);
+err_t tcp_close(struct tcp_pcb *pcb);
+void tcp_abort(struct tcp_pcb *pcb);
+
+#endif // STUB_LWIP_TCP_H
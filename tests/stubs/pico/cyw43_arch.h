@@ -0,0 +1,8 @@
+#ifndef STUB_PICO_CYW43_ARCH_H
+#define STUB_PICO_CYW43_ARCH_H
+
+#include "pico/stdlib.h"
+
+void cyw43_arch_poll(void);
+
+#endif // STUB_PICO_CYW43_ARCH_H
@@ -0,0 +1,16 @@
+#ifndef STUB_PICO_STDLIB_H
+#define STUB_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+absolute_time_t get_absolute_time(void);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+bool time_reached(absolute_time_t t);
+
+#endif // STUB_PICO_STDLIB_H
@@ -0,0 +1,101 @@
+/**
+ * Unit tests for the fixed-size arena allocator
+ *
+ * The k3s client carves its request and response-header buffers out of
+ * per-slot arenas; these tests pin down alignment, exhaustion, shrinking
+ * and high-water accounting.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+static uint8_t memory[256] __attribute__((aligned(4)));
+
+// Test: Allocation and alignment
+void test_alloc() {
+    printf("\n[TEST] Allocation and alignment\n");
+
+    arena_t arena;
+    arena_init(&arena, memory, sizeof(memory));
+
+    uint8_t *a = arena_alloc(&arena, 3);
+    uint8_t *b = arena_alloc(&arena, 8);
+    TEST_ASSERT(a == memory, "First block at start of arena");
+    TEST_ASSERT(b == memory + 4, "Second block 4-byte aligned");
+    TEST_ASSERT(arena.used == 12, "Usage tracked");
+}
+
+// Test: Exhaustion
+void test_exhaustion() {
+    printf("\n[TEST] Exhaustion\n");
+
+    arena_t arena;
+    arena_init(&arena, memory, sizeof(memory));
+
+    TEST_ASSERT(arena_alloc(&arena, sizeof(memory)) != NULL, "Exact fit succeeds");
+    TEST_ASSERT(arena_alloc(&arena, 1) == NULL, "Full arena refuses");
+    TEST_ASSERT(arena.failures == 1, "Failure counted");
+
+    arena_reset(&arena);
+    TEST_ASSERT(arena_alloc(&arena, sizeof(memory) + 1) == NULL, "Oversized request refused");
+    TEST_ASSERT(arena_alloc(&arena, 16) == memory, "Reset releases everything");
+}
+
+// Test: Shrinking and high-water mark
+void test_shrink_high_water() {
+    printf("\n[TEST] Shrink and high-water mark\n");
+
+    arena_t arena;
+    arena_init(&arena, memory, sizeof(memory));
+
+    // Worst-case request buffer that only needed 40 bytes
+    uint8_t *request = arena_alloc(&arena, 200);
+    arena_shrink(&arena, request, 40);
+    uint8_t *response = arena_alloc(&arena, 64);
+    TEST_ASSERT(response == memory + 40, "Shrunk tail reused");
+    TEST_ASSERT(arena_high_water(&arena) == 104, "High-water counts shrunk size");
+
+    arena_shrink(&arena, request, 10);
+    TEST_ASSERT(arena.used == 104, "Only the last block can shrink");
+
+    arena_reset(&arena);
+    arena_alloc(&arena, 16);
+    TEST_ASSERT(arena_high_water(&arena) == 104, "High-water survives reset");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  Arena Allocator Unit Tests\n");
+    printf("========================================\n");
+
+    test_alloc();
+    test_exhaustion();
+    test_shrink_high_water();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
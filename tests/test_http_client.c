@@ -10,6 +10,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
 // Mock config.h definitions
 #define DEBUG_ENABLE 1
@@ -22,7 +23,18 @@ extern int http_build_request(char *buffer, size_t buffer_size,
                               const char *host, unsigned short port,
                               const char *path,
                               const char *body,
-                              const char *content_type);
+                              const char *content_type,
+                              bool keep_alive);
+
+extern int http_build_request_head(char *buffer, size_t buffer_size,
+                                   int method,
+                                   const char *host, unsigned short port,
+                                   const char *path,
+                                   const char *content_type,
+                                   const char *accept,
+                                   long content_length,
+                                   bool keep_alive,
+                                   bool accept_gzip);
 
 extern int http_parse_response(char *response_buffer, size_t response_length,
                                void *response);
@@ -32,11 +44,83 @@ extern int http_get_header(const char *response_buffer, const char *header_name,
 
 extern const char* http_status_string(int status_code);
 
+extern void http_framer_init_chunked(void *framer);
+
+extern int http_framer_dechunk(void *framer, char *data, size_t length, size_t *decoded);
+
+// Constant request headers (mirrors http_header_block_t)
+typedef struct {
+    char data[128];
+    size_t length;
+} test_header_block_t;
+
+extern int http_header_block_init(void *block, const char *host, unsigned short port);
+
+extern int http_build_request_head_cached(char *buffer, size_t buffer_size,
+                                          const void *headers,
+                                          int method,
+                                          const char *path,
+                                          const char *content_type,
+                                          const char *accept,
+                                          long content_length,
+                                          bool keep_alive,
+                                          bool accept_gzip);
+
+// Header index (mirrors http_header_index_t and http_header_id_t)
+typedef struct {
+    unsigned short offset[7];
+    unsigned short length[7];
+    unsigned char present;
+} test_header_index_t;
+
+enum {
+    HTTP_HEADER_DATE,
+    HTTP_HEADER_CONTENT_LENGTH,
+    HTTP_HEADER_TRANSFER_ENCODING,
+    HTTP_HEADER_CONNECTION,
+    HTTP_HEADER_ETAG,
+    HTTP_HEADER_CONTENT_ENCODING,
+    HTTP_HEADER_CONTENT_TYPE,
+    HTTP_HEADER_UNKNOWN
+};
+
+extern int http_header_lookup(const char *name, size_t length);
+
+extern const char *http_header_find(const void *index, const char *response_buffer,
+                                    int id, size_t *length);
+
+extern int http_header_copy(const void *index, const char *response_buffer,
+                            int id, char *value_buffer, size_t value_buffer_size);
+
+// Parsed response (mirrors http_response_t)
+typedef struct {
+    int status_code;
+    char *body;
+    size_t body_length;
+    size_t content_length;
+    bool chunked;
+    test_header_index_t headers;
+} test_response_t;
+
+// http_framer_dechunk() results (mirrors http_frame_event_t)
+enum {
+    HTTP_FRAME_NEED_MORE = 0,
+    HTTP_FRAME_COMPLETE = 3,
+    HTTP_FRAME_ERROR = 4
+};
+
+// Opaque storage for an http_framer_t (well above its size)
+typedef union {
+    long long align;
+    char bytes[256];
+} test_framer_t;
+
 // HTTP method enum
 typedef enum {
     HTTP_METHOD_GET = 0,
     HTTP_METHOD_POST = 1,
-    HTTP_METHOD_PATCH = 2
+    HTTP_METHOD_PATCH = 2,
+    HTTP_METHOD_PUT = 3
 } http_method_t;
 
 // Test counters
@@ -65,7 +149,8 @@ void test_build_get_request() {
         "192.168.86.232", 6080,
         "/api/v1/nodes",
         NULL,
-        NULL
+        NULL,
+        false
     );
 
     TEST_ASSERT(len > 0, "Request built successfully");
@@ -77,6 +162,26 @@ void test_build_get_request() {
     printf("  Request preview:\n%.*s\n", len > 200 ? 200 : len, buffer);
 }
 
+// Test: Build keep-alive GET request
+void test_build_keepalive_request() {
+    printf("\n[TEST] Building keep-alive GET request\n");
+
+    char buffer[1024];
+    int len = http_build_request(
+        buffer, sizeof(buffer),
+        HTTP_METHOD_GET,
+        "192.168.86.232", 6080,
+        "/api/v1/namespaces/default/configmaps/pico-config",
+        NULL,
+        NULL,
+        true
+    );
+
+    TEST_ASSERT(len > 0, "Request built successfully");
+    TEST_ASSERT(strstr(buffer, "Connection: keep-alive") != NULL, "Keep-alive header present");
+    TEST_ASSERT(strstr(buffer, "Connection: close") == NULL, "No Connection: close header");
+}
+
 // Test: Build POST request with body
 void test_build_post_request() {
     printf("\n[TEST] Building POST request with JSON body\n");
@@ -90,7 +195,8 @@ void test_build_post_request() {
         "192.168.86.232", 6080,
         "/api/v1/nodes",
         body,
-        "application/json"
+        "application/json",
+        false
     );
 
     TEST_ASSERT(len > 0, "Request built successfully");
@@ -103,6 +209,135 @@ void test_build_post_request() {
     TEST_ASSERT(strstr(buffer, body) != NULL, "Body included in request");
 }
 
+// Test: Request head matches the headers of a full request
+void test_build_request_head() {
+    printf("\n[TEST] Building request head for scatter-gather send\n");
+
+    char full[2048];
+    char head[512];
+    const char *body = "{\"status\":{\"conditions\":[{\"type\":\"Ready\"}]}}";
+
+    int full_len = http_build_request(full, sizeof(full), HTTP_METHOD_PATCH,
+                                      "192.168.86.232", 6080, "/api/v1/nodes/pico-node-1/status",
+                                      body, "application/strategic-merge-patch+json", true);
+    int head_len = http_build_request_head(head, sizeof(head), HTTP_METHOD_PATCH,
+                                           "192.168.86.232", 6080, "/api/v1/nodes/pico-node-1/status",
+                                           "application/strategic-merge-patch+json", NULL,
+                                           (long)strlen(body), true, false);
+
+    TEST_ASSERT(head_len > 0, "Request head built successfully");
+    TEST_ASSERT(full_len == head_len + (int)strlen(body), "Head plus body is the full request");
+    TEST_ASSERT(memcmp(full, head, head_len) == 0, "Head matches full request headers");
+    TEST_ASSERT(memcmp(full + head_len, body, strlen(body)) == 0, "Body follows the head");
+
+    // Bodies beyond the old 2KB request buffer only need room for headers
+    head_len = http_build_request_head(head, sizeof(head), HTTP_METHOD_POST,
+                                       "192.168.86.232", 6080, "/api/v1/nodes",
+                                       NULL, NULL, 65536, true, false);
+    TEST_ASSERT(head_len > 0 && strstr(head, "Content-Length: 65536\r\n") != NULL,
+                "Large body length in head");
+
+    head_len = http_build_request_head(head, sizeof(head), HTTP_METHOD_GET,
+                                       "192.168.86.232", 6080, "/api/v1/nodes",
+                                       NULL, NULL, -1, true, false);
+    TEST_ASSERT(head_len > 0 && strstr(head, "Content-Length") == NULL,
+                "No Content-Length without a body");
+    TEST_ASSERT(strstr(head, "Accept-Encoding") == NULL, "No Accept-Encoding unless asked");
+
+    head_len = http_build_request_head(head, sizeof(head), HTTP_METHOD_GET,
+                                       "192.168.86.232", 6080, "/api/v1/nodes",
+                                       NULL, NULL, -1, true, true);
+    TEST_ASSERT(head_len > 0 && strstr(head, "Accept-Encoding: gzip\r\n") != NULL,
+                "Accept-Encoding: gzip when asked");
+    TEST_ASSERT(strstr(head, "Accept: application/json\r\n") != NULL, "Accept defaults to JSON");
+
+    // Protobuf status update: PUT with the same media type both ways
+    head_len = http_build_request_head(head, sizeof(head), HTTP_METHOD_PUT,
+                                       "192.168.86.232", 6080, "/api/v1/nodes/pico-node-1/status",
+                                       "application/vnd.kubernetes.protobuf",
+                                       "application/vnd.kubernetes.protobuf",
+                                       625, true, false);
+    TEST_ASSERT(head_len > 0 && strncmp(head, "PUT /api/v1/nodes/pico-node-1/status ", 37) == 0,
+                "PUT request line");
+    TEST_ASSERT(strstr(head, "Accept: application/vnd.kubernetes.protobuf\r\n") != NULL,
+                "Accept: protobuf");
+    TEST_ASSERT(strstr(head, "Content-Type: application/vnd.kubernetes.protobuf\r\n") != NULL,
+                "Content-Type: protobuf");
+}
+
+// Test: Heads built from a prebuilt header block match the full builder
+void test_build_request_head_cached() {
+    printf("\n[TEST] Building request head from a prebuilt header block\n");
+
+    test_header_block_t headers;
+    char expected[512];
+    char head[512];
+
+    TEST_ASSERT(http_header_block_init(&headers, "192.168.86.232", 6080) == 0,
+                "Header block built");
+    TEST_ASSERT(strcmp(headers.data, "Host: 192.168.86.232:6080\r\n"
+                                     "User-Agent: k3s-pico-node/1.0\r\n") == 0,
+                "Header block holds Host and User-Agent");
+
+    // Content-Length digits across the formatter's branches
+    static const long lengths[] = { -1, 0, 7, 10, 99, 100, 625, 12345, 65536, 4294967295L };
+    bool all_match = true;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        int expected_len = http_build_request_head(expected, sizeof(expected), HTTP_METHOD_PATCH,
+                                                   "192.168.86.232", 6080,
+                                                   "/api/v1/nodes/pico-node-1/status",
+                                                   "application/strategic-merge-patch+json",
+                                                   NULL, lengths[i], true, (i % 2) == 0);
+        int head_len = http_build_request_head_cached(head, sizeof(head), &headers,
+                                                      HTTP_METHOD_PATCH,
+                                                      "/api/v1/nodes/pico-node-1/status",
+                                                      "application/strategic-merge-patch+json",
+                                                      NULL, lengths[i], true, (i % 2) == 0);
+        if (head_len <= 0 || head_len != expected_len || strcmp(head, expected) != 0) {
+            printf("    Content-Length %ld differs\n", lengths[i]);
+            all_match = false;
+        }
+        if (lengths[i] >= 0) {
+            char line[64];
+            snprintf(line, sizeof(line), "\r\nContent-Length: %ld\r\n\r\n", lengths[i]);
+            if (strstr(head, line) == NULL) {
+                printf("    Content-Length %ld formatted wrong\n", lengths[i]);
+                all_match = false;
+            }
+        }
+    }
+    TEST_ASSERT(all_match, "Cached heads match the full builder");
+
+    int head_len = http_build_request_head_cached(head, sizeof(head), &headers, HTTP_METHOD_GET,
+                                                  "/api/v1/nodes", NULL,
+                                                  "application/vnd.kubernetes.protobuf",
+                                                  -1, false, false);
+    TEST_ASSERT(head_len > 0 &&
+                strcmp(head, "GET /api/v1/nodes HTTP/1.1\r\n"
+                             "Host: 192.168.86.232:6080\r\n"
+                             "User-Agent: k3s-pico-node/1.0\r\n"
+                             "Accept: application/vnd.kubernetes.protobuf\r\n"
+                             "Connection: close\r\n"
+                             "\r\n") == 0,
+                "GET head is byte-exact");
+
+    // Errors: too small a buffer, unset block, host too long
+    head_len = http_build_request_head_cached(head, 40, &headers, HTTP_METHOD_GET,
+                                              "/api/v1/nodes", NULL, NULL, -1, true, false);
+    TEST_ASSERT(head_len == -1, "Too small a buffer fails");
+
+    test_header_block_t empty = { .length = 0 };
+    head_len = http_build_request_head_cached(head, sizeof(head), &empty, HTTP_METHOD_GET,
+                                              "/api/v1/nodes", NULL, NULL, -1, true, false);
+    TEST_ASSERT(head_len == -1, "Uninitialized header block fails");
+
+    char long_host[200];
+    memset(long_host, 'h', sizeof(long_host) - 1);
+    long_host[sizeof(long_host) - 1] = '\0';
+    TEST_ASSERT(http_header_block_init(&empty, long_host, 6080) == -1 && empty.length == 0,
+                "Host too long for the block fails");
+}
+
 // Test: Build PATCH request
 void test_build_patch_request() {
     printf("\n[TEST] Building PATCH request\n");
@@ -116,7 +351,8 @@ void test_build_patch_request() {
         "192.168.86.232", 6080,
         "/api/v1/nodes/pico-node-1/status",
         body,
-        "application/strategic-merge-patch+json"
+        "application/strategic-merge-patch+json",
+        false
     );
 
     TEST_ASSERT(len > 0, "Request built successfully");
@@ -192,7 +428,8 @@ void test_buffer_overflow_protection() {
         "192.168.86.232", 6080,
         "/api/v1/nodes",
         large_body,
-        "application/json"
+        "application/json",
+        false
     );
 
     TEST_ASSERT(len < 0, "Overflow detected and request building failed safely");
@@ -240,19 +477,221 @@ void test_chunked_response() {
     TEST_ASSERT(strstr(value_buffer, "chunked") != NULL, "Chunked encoding detected");
 }
 
+// Test: Header names hash to the right index slot
+void test_header_lookup() {
+    printf("\n[TEST] Header name lookup\n");
+
+    static const struct {
+        const char *name;
+        int id;
+    } names[] = {
+        { "Date", HTTP_HEADER_DATE },
+        { "content-length", HTTP_HEADER_CONTENT_LENGTH },
+        { "TRANSFER-ENCODING", HTTP_HEADER_TRANSFER_ENCODING },
+        { "Connection", HTTP_HEADER_CONNECTION },
+        { "ETag", HTTP_HEADER_ETAG },
+        { "Content-Encoding", HTTP_HEADER_CONTENT_ENCODING },
+        { "Content-Type", HTTP_HEADER_CONTENT_TYPE },
+        // Same slot or length as an indexed name, but not one
+        { "Dave", HTTP_HEADER_UNKNOWN },
+        { "Content-Lengtx", HTTP_HEADER_UNKNOWN },
+        { "Server", HTTP_HEADER_UNKNOWN },
+        { "Cache-Control", HTTP_HEADER_UNKNOWN },
+        { "Audit-Id", HTTP_HEADER_UNKNOWN },
+        { "", HTTP_HEADER_UNKNOWN },
+    };
+
+    bool all_ok = true;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        int id = http_header_lookup(names[i].name, strlen(names[i].name));
+        if (id != names[i].id) {
+            printf("    %s: got %d, expected %d\n", names[i].name, id, names[i].id);
+            all_ok = false;
+        }
+    }
+    TEST_ASSERT(all_ok, "Indexed names found, others rejected");
+    TEST_ASSERT(http_header_lookup("Date: Mon", 4) == HTTP_HEADER_DATE,
+                "Name needs no terminator");
+}
+
+// Test: http_parse_response() indexes headers for later lookups
+void test_parse_header_index() {
+    printf("\n[TEST] Header index from http_parse_response\n");
+
+    char response[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Audit-Id: 8c1e\r\n"
+        "Content-Type:application/json\r\n"
+        "date:   Wed, 21 Oct 2026 07:28:00 GMT  \r\n"
+        "ETag: \"abc\"\r\n"
+        "Content-Length: 2\r\n"
+        "Date: Thu, 01 Jan 1970 00:00:00 GMT\r\n"
+        "\r\n"
+        "{}";
+    test_response_t parsed;
+    char value[64];
+    size_t length;
+
+    TEST_ASSERT(http_parse_response(response, strlen(response), &parsed) == 0,
+                "Response parsed");
+    TEST_ASSERT(parsed.content_length == 2, "Content-Length read from the index");
+
+    TEST_ASSERT(http_header_copy(&parsed.headers, response, HTTP_HEADER_DATE,
+                                 value, sizeof(value)) == 0 &&
+                strcmp(value, "Wed, 21 Oct 2026 07:28:00 GMT") == 0,
+                "Date trimmed, first one wins");
+
+    const char *etag = http_header_find(&parsed.headers, response, HTTP_HEADER_ETAG, &length);
+    TEST_ASSERT(etag != NULL && length == 5 && memcmp(etag, "\"abc\"", 5) == 0,
+                "ETag points into the buffer");
+
+    TEST_ASSERT(http_header_copy(&parsed.headers, response, HTTP_HEADER_CONTENT_TYPE,
+                                 value, 5) == 0 && strcmp(value, "appl") == 0,
+                "Copy truncates to the buffer");
+    TEST_ASSERT(http_header_find(&parsed.headers, response, HTTP_HEADER_CONNECTION,
+                                 &length) == NULL,
+                "Missing header not found");
+    TEST_ASSERT(http_header_copy(&parsed.headers, response, HTTP_HEADER_UNKNOWN,
+                                 value, sizeof(value)) == -1,
+                "Unknown id not found");
+}
+
+// Test: Chunked bodies are decoded in place by http_parse_response()
+void test_parse_chunked_body() {
+    printf("\n[TEST] Parsing a chunked body in place\n");
+
+    char response[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Content-Type: application/json\r\n"
+        "\r\n"
+        "b\r\n"
+        "{\"chunked\":\r\n"
+        "B;name=value\r\n"
+        "\"response\"}\r\n"
+        "0\r\n"
+        "X-Trailer: ignored\r\n"
+        "\r\n";
+    test_response_t parsed;
+
+    int result = http_parse_response(response, strlen(response), &parsed);
+    TEST_ASSERT(result == 0, "Chunked response parsed");
+    TEST_ASSERT(parsed.status_code == 200 && parsed.chunked, "Status and chunked flag");
+    TEST_ASSERT(parsed.body_length == 22, "Body length counts only the payload");
+    TEST_ASSERT(parsed.body != NULL && strcmp(parsed.body, "{\"chunked\":\"response\"}") == 0,
+                "Chunk-size lines, extension and trailer stripped");
+
+    char truncated[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "10\r\n"
+        "0123456789";
+    result = http_parse_response(truncated, strlen(truncated), &parsed);
+    TEST_ASSERT(result == 0 && parsed.body_length == 10 &&
+                strcmp(parsed.body, "0123456789") == 0,
+                "Truncated body yields the payload received so far");
+
+    char malformed[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "xyz\r\n"
+        "{}\r\n";
+    result = http_parse_response(malformed, strlen(malformed), &parsed);
+    TEST_ASSERT(result != 0, "Bad chunk size rejected");
+}
+
+// Test: Chunk framing split across reads decodes the same
+void test_dechunk_split_reads() {
+    printf("\n[TEST] Resumable dechunking across reads\n");
+
+    const char *chunked =
+        "5\r\nhello\r\n"
+        "1;ext\r\n \r\n"
+        "1A\r\nabcdefghijklmnopqrstuvwxyz\r\n"
+        "0\r\n\r\n";
+    const char *expected = "hello abcdefghijklmnopqrstuvwxyz";
+    size_t length = strlen(chunked);
+
+    // Two reads, split at every offset
+    bool all_ok = true;
+    for (size_t split = 0; split <= length; split++) {
+        char buffer[128];
+        char output[128];
+        test_framer_t framer;
+        size_t first;
+        size_t second;
+
+        memcpy(buffer, chunked, length);
+        http_framer_init_chunked(&framer);
+        int r1 = http_framer_dechunk(&framer, buffer, split, &first);
+        int r2 = http_framer_dechunk(&framer, buffer + split, length - split, &second);
+
+        memcpy(output, buffer, first);
+        memcpy(output + first, buffer + split, second);
+        output[first + second] = '\0';
+
+        if (r1 == HTTP_FRAME_ERROR || r2 != HTTP_FRAME_COMPLETE || strcmp(output, expected) != 0) {
+            printf("    split at %zu: got \"%s\" (%d, %d)\n", split, output, r1, r2);
+            all_ok = false;
+        }
+    }
+    TEST_ASSERT(all_ok, "Every two-read split decodes to the payload");
+
+    // One byte per read
+    char buffer[128];
+    char output[128];
+    size_t out_len = 0;
+    test_framer_t framer;
+    int r = HTTP_FRAME_NEED_MORE;
+    memcpy(buffer, chunked, length);
+    http_framer_init_chunked(&framer);
+    for (size_t i = 0; i < length; i++) {
+        size_t decoded;
+        r = http_framer_dechunk(&framer, buffer + i, 1, &decoded);
+        memcpy(output + out_len, buffer + i, decoded);
+        out_len += decoded;
+    }
+    output[out_len] = '\0';
+    TEST_ASSERT(r == HTTP_FRAME_COMPLETE && strcmp(output, expected) == 0,
+                "Byte-at-a-time reads decode to the payload");
+
+    // Bytes after the last chunk are left alone
+    char pipelined[] = "2\r\n{}\r\n0\r\n\r\nHTTP/1.1 200 OK\r\n";
+    size_t decoded;
+    http_framer_init_chunked(&framer);
+    r = http_framer_dechunk(&framer, pipelined, strlen(pipelined), &decoded);
+    TEST_ASSERT(r == HTTP_FRAME_COMPLETE && decoded == 2 && memcmp(pipelined, "{}", 2) == 0,
+                "Stops at the end of the body");
+
+    // Incomplete input asks for more
+    char partial[] = "4\r\nab";
+    http_framer_init_chunked(&framer);
+    r = http_framer_dechunk(&framer, partial, strlen(partial), &decoded);
+    TEST_ASSERT(r == HTTP_FRAME_NEED_MORE && decoded == 2, "Partial chunk needs more");
+}
+
 int main() {
     printf("========================================\n");
     printf("  HTTP Client Unit Tests\n");
     printf("========================================\n");
 
     test_build_get_request();
+    test_build_keepalive_request();
     test_build_post_request();
     test_build_patch_request();
+    test_build_request_head();
+    test_build_request_head_cached();
     test_parse_200_response();
     test_parse_error_response();
     test_buffer_overflow_protection();
     test_header_extraction_edge_cases();
     test_chunked_response();
+    test_header_lookup();
+    test_parse_header_index();
+    test_parse_chunked_body();
+    test_dechunk_split_reads();
 
     printf("\n========================================\n");
     printf("  Test Results\n");
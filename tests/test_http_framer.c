@@ -0,0 +1,325 @@
+/**
+ * Unit tests for the incremental HTTP response framer
+ *
+ * Feeds canned responses through http_framer_feed() in every possible
+ * split, the way TCP segments arrive on the Pico, and checks that the
+ * framing result never depends on where the reads were cut.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "http_client.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+// Outcome of framing one response
+typedef struct {
+    http_frame_event_t last;
+    int headers_events;
+    char body[512];
+    size_t body_length;
+    size_t leftover;            // Input left unconsumed after completion
+} frame_result_t;
+
+// Feed a response in pieces of at most piece bytes
+static void frame_response(const char *response, size_t length, size_t piece,
+                           bool close_at_end, http_framer_t *framer,
+                           frame_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    http_framer_init(framer);
+    result->last = HTTP_FRAME_NEED_MORE;
+
+    size_t offset = 0;
+    while (offset < length) {
+        size_t n = (length - offset < piece) ? length - offset : piece;
+        const char *data = response + offset;
+        offset += n;
+
+        while (true) {
+            size_t used;
+            const char *body;
+            size_t body_length;
+            http_frame_event_t event = http_framer_feed(framer, data, n,
+                                                        &used, &body, &body_length);
+            data += used;
+            n -= used;
+
+            if (event == HTTP_FRAME_HEADERS) {
+                result->headers_events++;
+            } else if (event == HTTP_FRAME_BODY) {
+                if (result->body_length + body_length < sizeof(result->body)) {
+                    memcpy(result->body + result->body_length, body, body_length);
+                    result->body_length += body_length;
+                }
+            } else {
+                result->last = event;
+                break;
+            }
+        }
+
+        if (result->last == HTTP_FRAME_COMPLETE || result->last == HTTP_FRAME_ERROR) {
+            result->leftover = n + (length - offset);
+            return;
+        }
+    }
+
+    if (close_at_end) {
+        result->last = http_framer_finish(framer) ? HTTP_FRAME_COMPLETE : HTTP_FRAME_ERROR;
+    }
+}
+
+// Frame a response at every piece size and check each one agrees
+static bool frame_all_splits(const char *response, bool close_at_end,
+                             const char *expected_body, int expected_status,
+                             http_frame_event_t expected_last) {
+    size_t length = strlen(response);
+
+    for (size_t piece = 1; piece <= length; piece++) {
+        http_framer_t framer;
+        frame_result_t result;
+        frame_response(response, length, piece, close_at_end, &framer, &result);
+
+        if (result.last != expected_last) {
+            printf("    piece %zu: event %d, expected %d\n", piece, result.last, expected_last);
+            return false;
+        }
+        if (expected_last != HTTP_FRAME_COMPLETE) {
+            continue;
+        }
+        if (result.headers_events != 1 || framer.status_code != expected_status ||
+            result.body_length != strlen(expected_body) ||
+            memcmp(result.body, expected_body, result.body_length) != 0) {
+            printf("    piece %zu: status %d, body '%.*s'\n", piece,
+                   framer.status_code, (int)result.body_length, result.body);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Test: Content-Length delimited body
+void test_content_length() {
+    printf("\n[TEST] Content-Length framing\n");
+
+    const char *response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "content-length: 26\r\n"
+        "\r\n"
+        "{\"kind\":\"Node\",\"items\":[]}";
+
+    TEST_ASSERT(frame_all_splits(response, false, "{\"kind\":\"Node\",\"items\":[]}",
+                                 200, HTTP_FRAME_COMPLETE),
+                "Body framed identically at every split");
+
+    http_framer_t framer;
+    frame_result_t result;
+    frame_response(response, strlen(response), 7, false, &framer, &result);
+    TEST_ASSERT(framer.content_length == 26, "Content-Length parsed");
+    TEST_ASSERT(!framer.chunked, "Not chunked");
+    TEST_ASSERT(!framer.gzip, "Not gzip");
+    TEST_ASSERT(framer.header_length == strlen(response) - 26, "Header length counted");
+}
+
+// Test: Header values indexed during framing, at every read size
+void test_header_index() {
+    printf("\n[TEST] Header index built while framing\n");
+
+    const char *response =
+        "HTTP/1.1 200 OK\r\n"
+        "Date: Wed, 21 Oct 2026 07:28:00 GMT\r\n"
+        "X-Long-Unindexed-Header-Name: ignored\r\n"
+        "etag:\"42\"\r\n"
+        "Content-Type: application/vnd.kubernetes.protobuf\r\n"
+        "Content-Length: 2\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "{}";
+    size_t length = strlen(response);
+
+    bool all_ok = true;
+    for (size_t piece = 1; piece <= length; piece++) {
+        http_framer_t framer;
+        frame_result_t result;
+        char date[64];
+        size_t value_len;
+
+        frame_response(response, length, piece, false, &framer, &result);
+        const char *etag = http_header_find(&framer.headers, response, HTTP_HEADER_ETAG,
+                                            &value_len);
+        bool ok = result.last == HTTP_FRAME_COMPLETE &&
+                  http_header_copy(&framer.headers, response, HTTP_HEADER_DATE,
+                                   date, sizeof(date)) == 0 &&
+                  strcmp(date, "Wed, 21 Oct 2026 07:28:00 GMT") == 0 &&
+                  etag != NULL && value_len == 4 && memcmp(etag, "\"42\"", 4) == 0 &&
+                  http_header_find(&framer.headers, response, HTTP_HEADER_CONTENT_TYPE,
+                                   &value_len) != NULL &&
+                  value_len == strlen("application/vnd.kubernetes.protobuf") &&
+                  http_header_find(&framer.headers, response, HTTP_HEADER_CONTENT_ENCODING,
+                                   &value_len) == NULL &&
+                  framer.content_length == 2 && !framer.connection_close;
+        if (!ok) {
+            printf("    piece %zu: index wrong\n", piece);
+            all_ok = false;
+            break;
+        }
+    }
+    TEST_ASSERT(all_ok, "Date, ETag and Content-Type indexed at every split");
+}
+
+// Test: Response followed by bytes of the next one on the same connection
+void test_pipelined_leftover() {
+    printf("\n[TEST] Stops at the end of the message\n");
+
+    const char *response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 2\r\n"
+        "\r\n"
+        "{}HTTP/1.1 200 OK\r\n";
+
+    http_framer_t framer;
+    frame_result_t result;
+    frame_response(response, strlen(response), strlen(response), false, &framer, &result);
+    TEST_ASSERT(result.last == HTTP_FRAME_COMPLETE, "Message complete");
+    TEST_ASSERT(result.body_length == 2, "Body stops at Content-Length");
+    TEST_ASSERT(result.leftover == strlen("HTTP/1.1 200 OK\r\n"), "Following bytes not consumed");
+}
+
+// Test: Chunked body with extensions and trailers
+void test_chunked() {
+    printf("\n[TEST] Chunked framing\n");
+
+    const char *response =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Date: Thu, 01 Jan 2026 00:00:00 GMT\r\n"
+        "\r\n"
+        "7\r\n"
+        "{\"kind\"\r\n"
+        "B;name=value\r\n"
+        ":\"ConfigMap\r\n"
+        "1\r\n"
+        "}\r\n"
+        "0\r\n"
+        "X-Trailer: yes\r\n"
+        "\r\n";
+
+    TEST_ASSERT(frame_all_splits(response, false, "{\"kind\":\"ConfigMap}",
+                                 200, HTTP_FRAME_COMPLETE),
+                "Chunk framing stripped at every split");
+
+    const char *empty =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: gzip, Chunked\r\n"
+        "\r\n"
+        "0\r\n"
+        "\r\n";
+
+    TEST_ASSERT(frame_all_splits(empty, false, "", 200, HTTP_FRAME_COMPLETE),
+                "Empty chunked body completes");
+
+    const char *encoded =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Encoding: GZIP\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "3\r\n"
+        "abc\r\n"
+        "0\r\n"
+        "\r\n";
+
+    http_framer_t framer;
+    frame_result_t result;
+    frame_response(encoded, strlen(encoded), 3, false, &framer, &result);
+    TEST_ASSERT(result.last == HTTP_FRAME_COMPLETE && framer.gzip,
+                "Content-Encoding: gzip detected, body passed through");
+}
+
+// Test: Bodies without a length
+void test_no_length() {
+    printf("\n[TEST] Close-delimited and empty bodies\n");
+
+    const char *closed =
+        "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "{\"ok\":true}";
+
+    TEST_ASSERT(frame_all_splits(closed, true, "{\"ok\":true}", 200, HTTP_FRAME_COMPLETE),
+                "Close-delimited body completes on close");
+
+    http_framer_t framer;
+    frame_result_t result;
+    frame_response(closed, strlen(closed), 5, true, &framer, &result);
+    TEST_ASSERT(framer.connection_close, "Connection: close detected");
+
+    const char *no_content =
+        "HTTP/1.1 204 No Content\r\n"
+        "\r\n";
+
+    TEST_ASSERT(frame_all_splits(no_content, false, "", 204, HTTP_FRAME_COMPLETE),
+                "204 completes without a body");
+
+    const char *truncated =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 100\r\n"
+        "\r\n"
+        "{\"partial\":";
+
+    frame_response(truncated, strlen(truncated), 4, true, &framer, &result);
+    TEST_ASSERT(result.last == HTTP_FRAME_ERROR, "Close before Content-Length is an error");
+}
+
+// Test: Malformed responses
+void test_malformed() {
+    printf("\n[TEST] Malformed responses\n");
+
+    TEST_ASSERT(frame_all_splits("HTTP/1.1 OK\r\n\r\n", false, "", 0, HTTP_FRAME_ERROR),
+                "Missing status code rejected");
+    TEST_ASSERT(frame_all_splits("HTTP/1.1 200 OK\r\nContent-Length: 1x\r\n\r\n",
+                                 false, "", 0, HTTP_FRAME_ERROR),
+                "Bad Content-Length rejected");
+    TEST_ASSERT(frame_all_splits("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                 "zz\r\n", false, "", 0, HTTP_FRAME_ERROR),
+                "Bad chunk size rejected");
+    TEST_ASSERT(frame_all_splits("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                 "FFFFFFFF\r\n", false, "", 0, HTTP_FRAME_ERROR),
+                "Oversized chunk rejected");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  HTTP Framer Unit Tests\n");
+    printf("========================================\n");
+
+    test_content_length();
+    test_header_index();
+    test_pipelined_leftover();
+    test_chunked();
+    test_no_length();
+    test_malformed();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
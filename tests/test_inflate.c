@@ -0,0 +1,282 @@
+/**
+ * Unit tests for the streaming gzip inflater
+ *
+ * Streams are produced with the host zlib (deflateInit2 with gzip
+ * wrapping) at the window sizes nginx can be configured with, then
+ * inflated in arbitrary splits the way TCP segments arrive.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <zlib.h>
+
+#include "inflate.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define PLAIN_MAX 65536
+
+static gzip_inflater_t inflater;
+static uint8_t plain[PLAIN_MAX];
+static uint8_t packed[PLAIN_MAX + 1024];
+static uint8_t output[PLAIN_MAX];
+
+// Collects inflated output
+typedef struct {
+    size_t length;
+    size_t calls;
+    size_t abort_after;     // Abort once this many bytes were delivered (0 = never)
+} sink_t;
+
+static int sink_output(const uint8_t *data, size_t length, void *user_data) {
+    sink_t *sink = (sink_t *)user_data;
+    if (sink->length + length <= sizeof(output)) {
+        memcpy(output + sink->length, data, length);
+    }
+    sink->length += length;
+    sink->calls++;
+    return (sink->abort_after > 0 && sink->length >= sink->abort_after) ? 1 : 0;
+}
+
+// gzip-compress with zlib; window_bits 9..15, strategy as for deflateInit2
+static size_t gzip_compress(const uint8_t *data, size_t length,
+                            int level, int window_bits, int strategy) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, level, Z_DEFLATED, window_bits + 16, 8, strategy);
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)length;
+    zs.next_out = packed;
+    zs.avail_out = sizeof(packed);
+    deflate(&zs, Z_FINISH);
+    size_t packed_length = zs.total_out;
+    deflateEnd(&zs);
+    return packed_length;
+}
+
+// Inflate packed[0..length) in pieces of at most piece bytes
+static inflate_result_t inflate_pieces(size_t length, size_t piece, sink_t *sink) {
+    inflate_result_t result = INFLATE_NEED_MORE;
+
+    memset(sink, 0, sizeof(*sink));
+    gzip_inflate_init(&inflater, sink_output, sink);
+
+    for (size_t offset = 0; offset < length; offset += piece) {
+        size_t n = (length - offset < piece) ? length - offset : piece;
+        result = gzip_inflate_feed(&inflater, packed + offset, n);
+        if (result != INFLATE_NEED_MORE) {
+            break;
+        }
+    }
+    return result;
+}
+
+// Generate JSON-like text with enough repetition to compress well
+static size_t make_json(size_t length) {
+    size_t used = 0;
+    int item = 0;
+    while (used < length) {
+        char line[128];
+        int n = snprintf(line, sizeof(line),
+                         "{\"name\":\"pod-%d\",\"phase\":\"Running\",\"restarts\":%d},",
+                         item, (item * 7) % 13);
+        for (int i = 0; i < n && used < length; i++) {
+            plain[used++] = (uint8_t)line[i];
+        }
+        item++;
+    }
+    return used;
+}
+
+static bool round_trip(size_t plain_length, int level, int window_bits,
+                       int strategy, size_t piece) {
+    size_t packed_length = gzip_compress(plain, plain_length, level, window_bits, strategy);
+    sink_t sink;
+    inflate_result_t result = inflate_pieces(packed_length, piece, &sink);
+    if (result != INFLATE_DONE || sink.length != plain_length ||
+        memcmp(output, plain, plain_length) != 0) {
+        printf("    level %d window %d piece %zu: %s, %zu of %zu bytes\n",
+               level, window_bits, piece, inflate_result_string(result),
+               sink.length, plain_length);
+        return false;
+    }
+    return true;
+}
+
+// Test: Small body at every split
+void test_every_split() {
+    printf("\n[TEST] Small body inflated at every split\n");
+
+    size_t plain_length = make_json(300);
+    size_t packed_length = gzip_compress(plain, plain_length, 9, 13, Z_DEFAULT_STRATEGY);
+
+    bool ok = true;
+    for (size_t piece = 1; piece <= packed_length && ok; piece++) {
+        ok = round_trip(plain_length, 9, 13, Z_DEFAULT_STRATEGY, piece);
+    }
+    TEST_ASSERT(ok, "Dynamic-Huffman stream identical at every split");
+
+    ok = true;
+    for (size_t piece = 1; piece <= 64 && ok; piece++) {
+        ok = round_trip(plain_length, 9, 13, Z_FIXED, piece);
+    }
+    TEST_ASSERT(ok, "Fixed-Huffman stream identical at every split");
+
+    ok = true;
+    for (size_t piece = 1; piece <= 64 && ok; piece++) {
+        ok = round_trip(plain_length, 0, 13, Z_DEFAULT_STRATEGY, piece);
+    }
+    TEST_ASSERT(ok, "Stored stream identical at every split");
+
+    TEST_ASSERT(round_trip(0, 6, 13, Z_DEFAULT_STRATEGY, 7), "Empty body inflates");
+}
+
+// Test: Bodies larger than the window
+void test_large_bodies() {
+    printf("\n[TEST] Bodies larger than the window\n");
+
+    size_t plain_length = make_json(PLAIN_MAX);
+    TEST_ASSERT(round_trip(plain_length, 6, 13, Z_DEFAULT_STRATEGY, 1460),
+                "64KB body with an 8KB window");
+    TEST_ASSERT(round_trip(plain_length, 1, 9, Z_DEFAULT_STRATEGY, 536),
+                "64KB body with a 512-byte window");
+
+    // Incompressible data forces stored blocks that span several feeds
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < PLAIN_MAX; i++) {
+        seed = seed * 1103515245 + 12345;
+        plain[i] = (uint8_t)(seed >> 16);
+    }
+    TEST_ASSERT(round_trip(PLAIN_MAX, 6, 13, Z_DEFAULT_STRATEGY, 1000),
+                "Incompressible body passes through stored blocks");
+
+    sink_t sink;
+    plain_length = make_json(20000);
+    size_t packed_length = gzip_compress(plain, plain_length, 6, 13, Z_DEFAULT_STRATEGY);
+    inflate_pieces(packed_length, packed_length, &sink);
+    TEST_ASSERT(sink.calls >= plain_length / INFLATE_WINDOW_SIZE,
+                "Output delivered once per window, not held until the end");
+}
+
+// Test: Streams the bounded window cannot handle
+void test_window_limit() {
+    printf("\n[TEST] Window limit\n");
+
+    // Random data whose first 4KB repeats 16KB later: only a 32KB window
+    // can reach back that far
+    uint32_t seed = 99;
+    for (size_t i = 0; i < 16384; i++) {
+        seed = seed * 1103515245 + 12345;
+        plain[i] = (uint8_t)(seed >> 16);
+    }
+    memcpy(plain + 16384, plain, 4096);
+
+    sink_t sink;
+    size_t packed_length = gzip_compress(plain, 20480, 9, 15, Z_DEFAULT_STRATEGY);
+    inflate_result_t result = inflate_pieces(packed_length, 512, &sink);
+    TEST_ASSERT(result == INFLATE_ERR_WINDOW, "32KB-window stream reports ERR_WINDOW");
+
+    packed_length = gzip_compress(plain, 20480, 9, 13, Z_DEFAULT_STRATEGY);
+    result = inflate_pieces(packed_length, 512, &sink);
+    TEST_ASSERT(result == INFLATE_DONE && sink.length == 20480,
+                "Same data compressed with an 8KB window inflates");
+}
+
+// Test: Corrupt and truncated streams
+void test_corrupt() {
+    printf("\n[TEST] Corrupt streams\n");
+
+    size_t plain_length = make_json(2000);
+    size_t packed_length = gzip_compress(plain, plain_length, 6, 13, Z_DEFAULT_STRATEGY);
+    sink_t sink;
+
+    packed[0] = 0x1E;
+    TEST_ASSERT(inflate_pieces(packed_length, 100, &sink) == INFLATE_ERR_DATA,
+                "Bad magic rejected");
+
+    packed_length = gzip_compress(plain, plain_length, 6, 13, Z_DEFAULT_STRATEGY);
+    packed[packed_length - 6] ^= 0x01;
+    TEST_ASSERT(inflate_pieces(packed_length, 100, &sink) == INFLATE_ERR_CHECKSUM,
+                "CRC mismatch detected");
+
+    packed_length = gzip_compress(plain, plain_length, 6, 13, Z_DEFAULT_STRATEGY);
+    TEST_ASSERT(inflate_pieces(packed_length - 3, 100, &sink) == INFLATE_NEED_MORE,
+                "Truncated stream still needs more");
+
+    // 0xFF after the header is a final block with reserved type 3
+    packed_length = gzip_compress(plain, plain_length, 6, 13, Z_DEFAULT_STRATEGY);
+    packed[10] = 0xFF;
+    TEST_ASSERT(inflate_pieces(packed_length, 100, &sink) == INFLATE_ERR_DATA,
+                "Reserved block type rejected");
+}
+
+// Test: Optional gzip header fields and consumer abort
+void test_header_and_abort() {
+    printf("\n[TEST] Header fields and abort\n");
+
+    // Hand-built member: FNAME + FCOMMENT + FEXTRA, then a stored block
+    const uint8_t member[] = {
+        0x1F, 0x8B, 8, 0x1C, 0, 0, 0, 0, 0, 3,
+        2, 0, 'x', 'y',                     // FEXTRA
+        'a', '.', 'j', 's', 'o', 'n', 0,    // FNAME
+        'h', 'i', 0,                        // FCOMMENT
+        0x01, 2, 0, 0xFD, 0xFF, '{', '}',   // Final stored block "{}"
+        0x43, 0xBF, 0xA6, 0xA3,             // CRC32("{}") = 0xA3A6BF43
+        2, 0, 0, 0
+    };
+    memcpy(packed, member, sizeof(member));
+
+    sink_t sink;
+    bool ok = true;
+    for (size_t piece = 1; piece <= sizeof(member) && ok; piece++) {
+        ok = inflate_pieces(sizeof(member), piece, &sink) == INFLATE_DONE &&
+             sink.length == 2 && memcmp(output, "{}", 2) == 0;
+    }
+    TEST_ASSERT(ok, "FEXTRA, FNAME and FCOMMENT skipped at every split");
+
+    size_t plain_length = make_json(30000);
+    size_t packed_length = gzip_compress(plain, plain_length, 6, 13, Z_DEFAULT_STRATEGY);
+    memset(&sink, 0, sizeof(sink));
+    sink.abort_after = 1;
+    gzip_inflate_init(&inflater, sink_output, &sink);
+    inflate_result_t result = gzip_inflate_feed(&inflater, packed, packed_length);
+    TEST_ASSERT(result == INFLATE_ERR_ABORTED, "Consumer abort stops inflating");
+    TEST_ASSERT(sink.calls == 1, "No output after abort");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  gzip Inflate Unit Tests\n");
+    printf("========================================\n");
+
+    test_every_split();
+    test_large_bodies();
+    test_window_limit();
+    test_corrupt();
+    test_header_and_abort();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("  (inflater state: %zu bytes)\n", sizeof(gzip_inflater_t));
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,403 @@
+/**
+ * Unit tests for the Kubernetes protobuf encoder and streaming decoder
+ *
+ * Encodes with pb_writer_t, decodes with k8s_pb_decoder_t fed in every
+ * possible split, and checks the two agree with each other and with the
+ * wire format the API server uses.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "k8s_protobuf.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+static uint8_t body[4096];
+
+// Feed body[0..length) in pieces of at most piece bytes
+static int feed_pieces(k8s_pb_decoder_t *d, size_t length, size_t piece) {
+    for (size_t offset = 0; offset < length; offset += piece) {
+        size_t n = (length - offset < piece) ? length - offset : piece;
+        int result = k8s_pb_feed(d, body + offset, n);
+        if (result != K8S_PB_OK) {
+            return result;
+        }
+    }
+    return K8S_PB_OK;
+}
+
+// Build a ConfigMap body the way the API server serializes one
+static size_t build_configmap(const char *memory_values) {
+    pb_writer_t w;
+    memcpy(body, K8S_PROTOBUF_MAGIC, K8S_PROTOBUF_MAGIC_LEN);
+    pb_writer_init(&w, body + K8S_PROTOBUF_MAGIC_LEN, sizeof(body) - K8S_PROTOBUF_MAGIC_LEN);
+
+    size_t type_meta = pb_begin_message(&w, K8S_PB_UNKNOWN_TYPE_META);
+    pb_write_string(&w, K8S_PB_TYPE_META_API_VERSION, "v1");
+    pb_write_string(&w, K8S_PB_TYPE_META_KIND, "ConfigMap");
+    pb_end_message(&w, type_meta);
+
+    size_t raw = pb_begin_message(&w, K8S_PB_UNKNOWN_RAW);
+    size_t meta = pb_begin_message(&w, K8S_PB_CONFIGMAP_METADATA);
+    pb_write_string(&w, K8S_PB_META_NAME, "pico-config");
+    pb_write_string(&w, K8S_PB_META_NAMESPACE, "default");
+    pb_write_string(&w, K8S_PB_META_RESOURCE_VERSION, "183750");
+    pb_end_message(&w, meta);
+
+    const char *entries[][2] = {
+        { "memory", "decoy" },                  // Prefix of the wanted key
+        { "memory_values_old", "decoy" },       // Wanted key is a prefix
+        { "memory_values", memory_values },
+        { "zzz", "after" },
+    };
+    for (size_t i = 0; i < 4; i++) {
+        size_t entry = pb_begin_message(&w, K8S_PB_CONFIGMAP_DATA);
+        pb_write_string(&w, K8S_PB_MAP_KEY, entries[i][0]);
+        pb_write_string(&w, K8S_PB_MAP_VALUE, entries[i][1]);
+        pb_end_message(&w, entry);
+    }
+    pb_end_message(&w, raw);
+
+    pb_write_string(&w, 4, "");     // Unknown.contentType, empty
+    return w.overflow ? 0 : K8S_PROTOBUF_MAGIC_LEN + w.length;
+}
+
+// Test: Writer output matches the protobuf wire format
+void test_writer() {
+    printf("\n[TEST] Writer\n");
+
+    uint8_t buffer[512];
+    pb_writer_t w;
+    pb_writer_init(&w, buffer, sizeof(buffer));
+    pb_write_varint(&w, 1, 150);
+    pb_write_string(&w, 2, "hi");
+    const uint8_t expected[] = { 0x08, 0x96, 0x01, 0x12, 0x02, 'h', 'i' };
+    TEST_ASSERT(w.length == sizeof(expected) && memcmp(buffer, expected, w.length) == 0,
+                "Varint and string fields encoded");
+
+    // A 200-byte nested message needs a two-byte length
+    pb_writer_init(&w, buffer, sizeof(buffer));
+    size_t mark = pb_begin_message(&w, 3);
+    char filler[197];
+    memset(filler, 'x', sizeof(filler));
+    pb_write_bytes(&w, 1, filler, sizeof(filler));
+    pb_end_message(&w, mark);
+    TEST_ASSERT(w.length == 203 && buffer[0] == 0x1A && buffer[1] == 0xC8 && buffer[2] == 0x01 &&
+                buffer[3] == 0x0A && buffer[4] == 0xC5 && buffer[5] == 0x01,
+                "Long nested message moved up for its length");
+
+    pb_writer_init(&w, buffer, 8);
+    pb_write_string(&w, 1, "this does not fit");
+    TEST_ASSERT(w.overflow, "Overflow reported instead of writing past the end");
+}
+
+// Walks an encoded Node and records what it finds
+typedef struct {
+    char kind[16];
+    char name[32];
+    int conditions;
+    int addresses;
+    uint64_t heartbeat;
+    uint64_t port;
+    char architecture[16];
+} node_seen_t;
+
+static bool node_enter(k8s_pb_decoder_t *d, uint32_t field) {
+    if (d->depth == 0) {
+        return true;                                            // TypeMeta, raw
+    }
+    if (d->path[0] != K8S_PB_UNKNOWN_RAW) {
+        return false;
+    }
+    if (d->depth == 1) {
+        return true;                                            // metadata, status
+    }
+    if (d->depth == 2) {
+        if (d->path[1] != K8S_PB_NODE_STATUS) {
+            return false;                                       // metadata strings
+        }
+        node_seen_t *seen = (node_seen_t *)d->user_data;
+        if (field == K8S_PB_NODE_STATUS_CONDITIONS) seen->conditions++;
+        if (field == K8S_PB_NODE_STATUS_ADDRESSES) seen->addresses++;
+        return true;                                            // Every status field
+    }
+    if (d->depth == 3) {
+        switch (d->path[2]) {
+            case K8S_PB_NODE_STATUS_CAPACITY:
+            case K8S_PB_NODE_STATUS_ALLOCATABLE:
+                return field == K8S_PB_MAP_VALUE;               // Quantity
+            case K8S_PB_NODE_STATUS_CONDITIONS:
+                return field == K8S_PB_CONDITION_HEARTBEAT ||
+                       field == K8S_PB_CONDITION_TRANSITION;
+            case K8S_PB_NODE_STATUS_DAEMON_EP:
+                return true;
+        }
+    }
+    return false;
+}
+
+static void copy_field(char *dest, size_t size, const uint8_t *data, size_t length) {
+    size_t used = strlen(dest);
+    if (used + length < size) {
+        memcpy(dest + used, data, length);
+        dest[used + length] = '\0';
+    }
+}
+
+static int node_bytes(k8s_pb_decoder_t *d, uint32_t field,
+                      const uint8_t *data, size_t length, bool last) {
+    node_seen_t *seen = (node_seen_t *)d->user_data;
+    (void)last;
+
+    if (d->depth == 1 && d->path[0] == K8S_PB_UNKNOWN_TYPE_META &&
+        field == K8S_PB_TYPE_META_KIND) {
+        copy_field(seen->kind, sizeof(seen->kind), data, length);
+    } else if (d->depth == 2 && d->path[1] == K8S_PB_NODE_METADATA &&
+               field == K8S_PB_META_NAME) {
+        copy_field(seen->name, sizeof(seen->name), data, length);
+    } else if (d->depth == 3 && d->path[2] == K8S_PB_NODE_STATUS_NODE_INFO && field == 10) {
+        copy_field(seen->architecture, sizeof(seen->architecture), data, length);
+    }
+    return 0;
+}
+
+static int node_varint(k8s_pb_decoder_t *d, uint32_t field, uint64_t value) {
+    node_seen_t *seen = (node_seen_t *)d->user_data;
+
+    if (d->depth == 4 && d->path[3] == K8S_PB_CONDITION_HEARTBEAT &&
+        field == K8S_PB_TIME_SECONDS) {
+        seen->heartbeat = value;
+    } else if (d->depth == 4 && d->path[2] == K8S_PB_NODE_STATUS_DAEMON_EP &&
+               field == K8S_PB_DAEMON_EP_PORT) {
+        seen->port = value;
+    }
+    return 0;
+}
+
+static const k8s_pb_handlers_t node_handlers = { node_enter, node_bytes, node_varint };
+
+// Test: Node status round trip
+void test_node_status() {
+    printf("\n[TEST] Node status encoding\n");
+
+    k8s_node_status_t status = {
+        .name = "pico-node-1",
+        .internal_ip = "192.168.1.50",
+        .hostname = "pico-node-1",
+        .heartbeat_time = 1767225600,
+        .transition_time = 1767225600,
+        .kubelet_port = 10250,
+    };
+
+    int length = k8s_pb_encode_node_status(body, sizeof(body), &status);
+    TEST_ASSERT(length > 0 && length < 1024, "Node status encoded under 1KB");
+    TEST_ASSERT(memcmp(body, "k8s\0", 4) == 0, "Body starts with the k8s magic");
+    printf("    (%d bytes)\n", length);
+
+    bool ok = true;
+    for (size_t piece = 1; piece <= (size_t)length && ok; piece++) {
+        node_seen_t seen;
+        memset(&seen, 0, sizeof(seen));
+        k8s_pb_decoder_t d;
+        k8s_pb_decoder_init(&d, &node_handlers, &seen);
+        ok = feed_pieces(&d, length, piece) == K8S_PB_OK && k8s_pb_finish(&d) &&
+             strcmp(seen.kind, "Node") == 0 && strcmp(seen.name, "pico-node-1") == 0 &&
+             seen.conditions == 5 && seen.addresses == 2 &&
+             seen.heartbeat == 1767225600 && seen.port == 10250 &&
+             strcmp(seen.architecture, "arm") == 0;
+        if (!ok) {
+            printf("    piece %zu: kind '%s' name '%s' conditions %d port %llu\n",
+                   piece, seen.kind, seen.name, seen.conditions,
+                   (unsigned long long)seen.port);
+        }
+    }
+    TEST_ASSERT(ok, "Decodes back identically at every split");
+
+    TEST_ASSERT(k8s_pb_encode_node_status(body, 200, &status) == -1,
+                "Too-small buffer rejected");
+}
+
+// Test: ConfigMap value extraction
+void test_configmap() {
+    printf("\n[TEST] ConfigMap extraction\n");
+
+    size_t length = build_configmap("0=0x42,1=0x43,2=0x44");
+    TEST_ASSERT(length > 0, "ConfigMap built");
+
+    bool ok = true;
+    for (size_t piece = 1; piece <= length && ok; piece++) {
+        char value[64];
+        k8s_pb_configmap_t cm;
+        k8s_pb_configmap_init(&cm, "memory_values", value, sizeof(value));
+        for (size_t offset = 0; offset < length && ok; offset += piece) {
+            size_t n = (length - offset < piece) ? length - offset : piece;
+            ok = k8s_pb_configmap_feed(&cm, body + offset, n) == K8S_PB_OK;
+        }
+        ok = ok && cm.found && strcmp(value, "0=0x42,1=0x43,2=0x44") == 0 &&
+             k8s_pb_finish(&cm.decoder);
+        if (!ok) {
+            printf("    piece %zu: found %d value '%s'\n", piece, cm.found, value);
+        }
+    }
+    TEST_ASSERT(ok, "memory_values found at every split, decoy keys skipped");
+
+    char small[8];
+    k8s_pb_configmap_t cm;
+    k8s_pb_configmap_init(&cm, "memory_values", small, sizeof(small));
+    k8s_pb_configmap_feed(&cm, body, length);
+    TEST_ASSERT(cm.found && strcmp(small, "0=0x42,") == 0, "Long value truncated to fit");
+
+    k8s_pb_configmap_init(&cm, "missing", small, sizeof(small));
+    k8s_pb_configmap_feed(&cm, body, length);
+    TEST_ASSERT(!cm.found && small[0] == '\0', "Absent key not found");
+}
+
+// Lease fields of interest
+typedef struct {
+    char holder[32];
+    uint64_t duration;
+    uint64_t renew_seconds;
+} lease_seen_t;
+
+static bool lease_enter(k8s_pb_decoder_t *d, uint32_t field) {
+    return (d->depth == 0 && field == K8S_PB_UNKNOWN_RAW) ||
+           (d->depth == 1 && field == K8S_PB_LEASE_SPEC) ||
+           (d->depth == 2 && field == K8S_PB_LEASE_RENEW_TIME);
+}
+
+static int lease_bytes(k8s_pb_decoder_t *d, uint32_t field,
+                       const uint8_t *data, size_t length, bool last) {
+    lease_seen_t *seen = (lease_seen_t *)d->user_data;
+    (void)last;
+    if (d->depth == 2 && field == K8S_PB_LEASE_HOLDER_IDENTITY) {
+        copy_field(seen->holder, sizeof(seen->holder), data, length);
+    }
+    return 0;
+}
+
+static int lease_varint(k8s_pb_decoder_t *d, uint32_t field, uint64_t value) {
+    lease_seen_t *seen = (lease_seen_t *)d->user_data;
+    if (d->depth == 2 && field == K8S_PB_LEASE_DURATION_SECONDS) {
+        seen->duration = value;
+    } else if (d->depth == 3 && field == K8S_PB_TIME_SECONDS) {
+        seen->renew_seconds = value;
+    }
+    return 0;
+}
+
+// Test: Lease decoding with a caller-supplied schema
+void test_lease() {
+    printf("\n[TEST] Lease decoding\n");
+
+    pb_writer_t w;
+    memcpy(body, K8S_PROTOBUF_MAGIC, K8S_PROTOBUF_MAGIC_LEN);
+    pb_writer_init(&w, body + K8S_PROTOBUF_MAGIC_LEN, sizeof(body) - K8S_PROTOBUF_MAGIC_LEN);
+    size_t raw = pb_begin_message(&w, K8S_PB_UNKNOWN_RAW);
+    size_t meta = pb_begin_message(&w, K8S_PB_LEASE_METADATA);
+    pb_write_string(&w, K8S_PB_META_NAME, "pico-node-1");
+    pb_end_message(&w, meta);
+    size_t spec = pb_begin_message(&w, K8S_PB_LEASE_SPEC);
+    pb_write_string(&w, K8S_PB_LEASE_HOLDER_IDENTITY, "pico-node-1");
+    pb_write_varint(&w, K8S_PB_LEASE_DURATION_SECONDS, 40);
+    size_t renew = pb_begin_message(&w, K8S_PB_LEASE_RENEW_TIME);
+    pb_write_varint(&w, K8S_PB_TIME_SECONDS, 1767225600);
+    pb_write_varint(&w, K8S_PB_TIME_NANOS, 123456);
+    pb_end_message(&w, renew);
+    pb_end_message(&w, spec);
+    pb_end_message(&w, raw);
+    size_t length = K8S_PROTOBUF_MAGIC_LEN + w.length;
+
+    static const k8s_pb_handlers_t handlers = { lease_enter, lease_bytes, lease_varint };
+    lease_seen_t seen;
+    memset(&seen, 0, sizeof(seen));
+    k8s_pb_decoder_t d;
+    k8s_pb_decoder_init(&d, &handlers, &seen);
+    TEST_ASSERT(feed_pieces(&d, length, 3) == K8S_PB_OK && k8s_pb_finish(&d),
+                "Lease decoded");
+    TEST_ASSERT(strcmp(seen.holder, "pico-node-1") == 0 && seen.duration == 40 &&
+                seen.renew_seconds == 1767225600,
+                "Holder, duration and renew time extracted");
+}
+
+static bool enter_all(k8s_pb_decoder_t *d, uint32_t field) {
+    (void)d;
+    (void)field;
+    return true;
+}
+
+// Test: Malformed bodies
+void test_malformed() {
+    printf("\n[TEST] Malformed bodies\n");
+
+    static const k8s_pb_handlers_t none = { NULL, NULL, NULL };
+    static const k8s_pb_handlers_t all = { enter_all, NULL, NULL };
+    k8s_pb_decoder_t d;
+
+    size_t length = build_configmap("x");
+
+    k8s_pb_decoder_init(&d, &none, NULL);
+    TEST_ASSERT(k8s_pb_feed(&d, (const uint8_t *)"{\"kind\"", 7) == K8S_PB_ERROR,
+                "JSON body rejected by the magic check");
+
+    k8s_pb_decoder_init(&d, &none, NULL);
+    TEST_ASSERT(k8s_pb_feed(&d, body, length - 3) == K8S_PB_OK && !k8s_pb_finish(&d),
+                "Truncated body is not finished");
+
+    // Inner length larger than the enclosing message
+    const uint8_t overrun[] = { 'k', '8', 's', 0, 0x12, 0x03, 0x0A, 0x05, 'a', 'b', 'c' };
+    k8s_pb_decoder_init(&d, &all, NULL);
+    TEST_ASSERT(k8s_pb_feed(&d, overrun, sizeof(overrun)) == K8S_PB_ERROR,
+                "Field overrunning its message rejected");
+
+    // Nine nested messages exceed K8S_PB_MAX_DEPTH
+    uint8_t deep[4 + 2 * 9];
+    memcpy(deep, "k8s\0", 4);
+    for (int i = 0; i < 9; i++) {
+        deep[4 + 2 * i] = 0x12;
+        deep[5 + 2 * i] = (uint8_t)(2 * (8 - i));
+    }
+    k8s_pb_decoder_init(&d, &all, NULL);
+    TEST_ASSERT(k8s_pb_feed(&d, deep, sizeof(deep)) == K8S_PB_ERROR,
+                "Nesting beyond the depth limit rejected");
+
+    const uint8_t group[] = { 'k', '8', 's', 0, 0x0B };
+    k8s_pb_decoder_init(&d, &all, NULL);
+    TEST_ASSERT(k8s_pb_feed(&d, group, sizeof(group)) == K8S_PB_ERROR,
+                "Group wire type rejected");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  Kubernetes Protobuf Unit Tests\n");
+    printf("========================================\n");
+
+    test_writer();
+    test_node_status();
+    test_configmap();
+    test_lease();
+    test_malformed();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
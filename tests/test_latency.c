@@ -0,0 +1,135 @@
+/**
+ * Unit tests for the request latency histograms
+ *
+ * Checks bucket placement at the bounds, percentile estimates, and the
+ * Prometheus text lines the kubelet /metrics endpoint streams.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "latency.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+// Test: Samples land in the right bucket, bounds inclusive
+void test_buckets() {
+    printf("\n[TEST] Bucket placement\n");
+
+    latency_histogram_t h;
+    latency_reset(&h);
+
+    latency_record(&h, 0);
+    latency_record(&h, 5000);           // Exactly 5 ms: first bucket
+    latency_record(&h, 5001);           // Just over: second bucket
+    latency_record(&h, 10000000);       // 10 s: last finite bucket
+    latency_record(&h, 10000001);       // Beyond every bound: +Inf
+
+    TEST_ASSERT(h.buckets[0] == 2, "0 and 5 ms in the 5 ms bucket");
+    TEST_ASSERT(h.buckets[1] == 1, "5.001 ms in the 10 ms bucket");
+    TEST_ASSERT(h.buckets[LATENCY_BUCKETS - 2] == 1, "10 s in the 10 s bucket");
+    TEST_ASSERT(h.buckets[LATENCY_BUCKETS - 1] == 1, "Slower samples in +Inf");
+    TEST_ASSERT(h.count == 5, "Count");
+    TEST_ASSERT(h.sum_us == 20010002ULL, "Sum");
+    TEST_ASSERT(h.max_us == 10000001, "Max");
+
+    latency_reset(&h);
+    TEST_ASSERT(h.count == 0 && h.buckets[0] == 0 && h.sum_us == 0, "Reset empties it");
+}
+
+// Test: Percentiles report the bucket bound that holds the rank
+void test_percentiles() {
+    printf("\n[TEST] Percentiles\n");
+
+    latency_histogram_t h;
+    latency_reset(&h);
+    TEST_ASSERT(latency_percentile_ms(&h, 50) == 0, "Empty histogram reports 0");
+
+    // 98 fast heartbeats, one slow, one very slow
+    for (int i = 0; i < 98; i++) {
+        latency_record(&h, 30000);      // 30 ms
+    }
+    latency_record(&h, 800000);         // 800 ms
+    latency_record(&h, 42000000);       // 42 s
+
+    TEST_ASSERT(latency_percentile_ms(&h, 50) == 50, "p50 in the 50 ms bucket");
+    TEST_ASSERT(latency_percentile_ms(&h, 98) == 50, "p98 still fast");
+    TEST_ASSERT(latency_percentile_ms(&h, 99) == 1000, "p99 in the 1 s bucket");
+    TEST_ASSERT(latency_percentile_ms(&h, 100) == 42000, "p100 beyond the bounds is the max");
+}
+
+// Test: Prometheus text lines
+void test_format() {
+    printf("\n[TEST] Prometheus text format\n");
+
+    latency_histogram_t h;
+    latency_reset(&h);
+    latency_record(&h, 3000);
+    latency_record(&h, 120000);
+    latency_record(&h, 1500000);
+
+    const char *labels = "endpoint=\"node-status\",phase=\"ttfb\"";
+    char line[160];
+
+    int n = latency_format_line(line, sizeof(line), "k3s_request_duration_seconds", labels, &h, 0);
+    TEST_ASSERT(n > 0 && strcmp(line,
+        "k3s_request_duration_seconds_bucket{endpoint=\"node-status\",phase=\"ttfb\",le=\"0.005\"} 1\n") == 0,
+        "First bucket with seconds bound");
+    TEST_ASSERT(n == (int)strlen(line), "Returns the line length");
+
+    latency_format_line(line, sizeof(line), "m", labels, &h, 5);
+    TEST_ASSERT(strstr(line, "le=\"0.250\"} 2\n") != NULL, "Buckets are cumulative");
+
+    latency_format_line(line, sizeof(line), "m", labels, &h, 8);
+    TEST_ASSERT(strstr(line, "le=\"2.500\"} 3\n") != NULL, "Bound above one second");
+
+    latency_format_line(line, sizeof(line), "m", labels, &h, LATENCY_BUCKETS - 1);
+    TEST_ASSERT(strstr(line, "le=\"+Inf\"} 3\n") != NULL, "+Inf bucket holds every sample");
+
+    latency_format_line(line, sizeof(line), "m", labels, &h, LATENCY_BUCKETS);
+    TEST_ASSERT(strcmp(line, "m_sum{endpoint=\"node-status\",phase=\"ttfb\"} 1.623000\n") == 0,
+                "Sum in seconds");
+
+    latency_format_line(line, sizeof(line), "m", labels, &h, LATENCY_BUCKETS + 1);
+    TEST_ASSERT(strcmp(line, "m_count{endpoint=\"node-status\",phase=\"ttfb\"} 3\n") == 0,
+                "Count");
+
+    TEST_ASSERT(latency_format_line(line, sizeof(line), "m", labels, &h, LATENCY_LINES) == -1,
+                "Past the last line");
+    TEST_ASSERT(latency_format_line(line, 20, "m", labels, &h, 0) == -1,
+                "Line that doesn't fit is refused");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  Latency Histogram Unit Tests\n");
+    printf("========================================\n");
+
+    test_buckets();
+    test_percentiles();
+    test_format();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
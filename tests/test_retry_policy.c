@@ -0,0 +1,137 @@
+/**
+ * Unit tests for the k3s API retry policy
+ *
+ * Walks an endpoint through an outage and recovery with a simulated
+ * clock: backoff growth and jitter bounds, the circuit breaker opening,
+ * half-open probing, and the shared retry budget.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "retry_policy.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+static const retry_config_t config = {
+    .base_delay_ms = 1000,
+    .max_delay_ms = 16000,
+    .failure_threshold = 4,
+    .open_ms = 10000
+};
+
+// Test: Backoff grows and jitter stays within [delay/2, delay]
+void test_backoff() {
+    printf("\n[TEST] Jittered exponential backoff\n");
+
+    retry_policy_t policy;
+    retry_policy_init(&policy, "test", &config);
+    uint32_t now = 5000;
+
+    TEST_ASSERT(retry_policy_allow(&policy, NULL, now), "First attempt allowed");
+
+    retry_policy_failure(&policy, now, 0);
+    TEST_ASSERT(policy.backoff_ms == 1000, "First failure uses base delay");
+    TEST_ASSERT(retry_policy_wait_ms(&policy, now) == 500, "Minimum jitter is half the delay");
+    TEST_ASSERT(!retry_policy_allow(&policy, NULL, now + 499), "Attempt refused while backing off");
+    TEST_ASSERT(retry_policy_allow(&policy, NULL, now + 500), "Attempt allowed after backoff");
+
+    retry_policy_failure(&policy, now, 0xFFFFFFFF);
+    TEST_ASSERT(policy.backoff_ms == 2000, "Second failure doubles the delay");
+    TEST_ASSERT(retry_policy_wait_ms(&policy, now) <= 2000, "Jitter never exceeds the delay");
+    TEST_ASSERT(policy.state == CIRCUIT_CLOSED, "Circuit still closed below threshold");
+    TEST_ASSERT(policy.rejected == 1, "Rejected attempt counted");
+
+    retry_policy_success(&policy, now);
+    TEST_ASSERT(policy.consecutive_failures == 0 && policy.backoff_ms == 0,
+                "Success clears backoff");
+    TEST_ASSERT(retry_policy_allow(&policy, NULL, now), "Attempt allowed after success");
+}
+
+// Test: Breaker opens, probes once, and closes or reopens
+void test_circuit_breaker() {
+    printf("\n[TEST] Circuit breaker with half-open probing\n");
+
+    retry_policy_t policy;
+    retry_policy_init(&policy, "test", &config);
+    uint32_t now = 0;
+
+    for (uint32_t i = 0; i < config.failure_threshold; i++) {
+        retry_policy_failure(&policy, now, 0);
+    }
+    TEST_ASSERT(policy.state == CIRCUIT_OPEN, "Circuit opens at threshold");
+    TEST_ASSERT(!retry_policy_allow(&policy, NULL, now + 4999), "Open circuit rejects");
+
+    now += 5000;
+    TEST_ASSERT(retry_policy_allow(&policy, NULL, now), "Probe allowed after open timeout");
+    TEST_ASSERT(policy.state == CIRCUIT_HALF_OPEN, "Circuit half-open during probe");
+    TEST_ASSERT(!retry_policy_allow(&policy, NULL, now), "Only one probe at a time");
+
+    retry_policy_failure(&policy, now, 0);
+    TEST_ASSERT(policy.state == CIRCUIT_OPEN, "Failed probe reopens the circuit");
+    TEST_ASSERT(policy.backoff_ms == 16000, "Reopened for longer (capped)");
+
+    now += 16000;
+    TEST_ASSERT(retry_policy_allow(&policy, NULL, now), "Second probe allowed");
+    retry_policy_abandon(&policy);
+    TEST_ASSERT(retry_policy_allow(&policy, NULL, now), "Cancelled probe frees the slot");
+    retry_policy_success(&policy, now);
+    TEST_ASSERT(policy.state == CIRCUIT_CLOSED, "Successful probe closes the circuit");
+}
+
+// Test: Budget limits retries across endpoints
+void test_retry_budget() {
+    printf("\n[TEST] Shared retry budget\n");
+
+    retry_budget_t budget;
+    retry_budget_init(&budget, 2, 1000, 0);
+
+    retry_policy_t a, b;
+    retry_policy_init(&a, "a", &config);
+    retry_policy_init(&b, "b", &config);
+
+    TEST_ASSERT(retry_policy_allow(&a, &budget, 0), "First attempt free");
+    TEST_ASSERT(budget.tokens == 2, "First attempts don't spend tokens");
+
+    retry_policy_failure(&a, 0, 0);
+    retry_policy_failure(&b, 0, 0);
+    TEST_ASSERT(retry_policy_allow(&a, &budget, 500), "Retry spends a token");
+    TEST_ASSERT(retry_policy_allow(&b, &budget, 500), "Other endpoint spends the last token");
+    TEST_ASSERT(!retry_policy_allow(&a, &budget, 500), "Retry refused when budget is empty");
+    TEST_ASSERT(budget.exhausted == 1, "Exhaustion counted");
+    TEST_ASSERT(retry_policy_allow(&a, &budget, 1000), "Budget refills over time");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  Retry Policy Unit Tests\n");
+    printf("========================================\n");
+
+    test_backoff();
+    test_circuit_breaker();
+    test_retry_budget();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+/**
+ * Unit tests for the SWAR delimiter scanner
+ *
+ * Compares scan_byte(), scan_byte2() and scan_crlf() with plain byte loops
+ * at every start alignment, length and match position, including bytes
+ * with the high bit set that trip naive has-zero-byte tests.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scan.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+#define MAX_LEN 40
+
+// Word-aligned so offsets 0-3 cover every alignment
+static uint32_t storage[(MAX_LEN + 8) / 4];
+
+static const char *reference_byte2(const char *data, size_t length, char a, char b) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == a || data[i] == b) {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+
+static const char *reference_crlf(const char *data, size_t length) {
+    for (size_t i = 0; i + 1 < length; i++) {
+        if (data[i] == '\r' && data[i + 1] == '\n') {
+            return data + i;
+        }
+    }
+    return NULL;
+}
+
+// Fill with bytes that neighbour the delimiters and have the high bit set
+static void fill_noise(char *data, size_t length) {
+    static const char noise[] = { 'a', (char)0x8D, (char)0xFF, '\x0c', (char)0x80,
+                                  ';', '\x0b', (char)0xBA, '9', '\x01' };
+    for (size_t i = 0; i < length; i++) {
+        data[i] = noise[i % sizeof(noise)];
+    }
+}
+
+// Test: Single byte at every position, alignment and length
+void test_scan_byte() {
+    printf("\n[TEST] scan_byte at every alignment\n");
+
+    bool all_ok = true;
+    for (size_t offset = 0; offset < 4 && all_ok; offset++) {
+        char *data = (char *)storage + offset;
+        for (size_t length = 0; length <= MAX_LEN && all_ok; length++) {
+            // No match, then a match at each position (plus a later one)
+            for (size_t pos = 0; pos <= length && all_ok; pos++) {
+                fill_noise(data, MAX_LEN + 4 - offset);
+                if (pos < length) {
+                    data[pos] = ':';
+                    if (pos + 5 < length) {
+                        data[pos + 5] = ':';
+                    }
+                }
+                // A match just past the end must not be found
+                data[length] = ':';
+
+                const char *expected = (pos < length) ? data + pos : NULL;
+                if (scan_byte(data, length, ':') != expected ||
+                    (length > 0 && scan_byte(data, length, data[0]) != data)) {
+                    printf("    offset %zu, length %zu, pos %zu\n", offset, length, pos);
+                    all_ok = false;
+                }
+            }
+        }
+    }
+    TEST_ASSERT(all_ok, "Matches a byte loop, never reads past the length");
+
+    char zeros[8] = { 0 };
+    TEST_ASSERT(scan_byte(zeros, sizeof(zeros), '\0') == zeros, "Finds NUL bytes");
+    char high[8];
+    memset(high, 0xFF, sizeof(high));
+    high[6] = (char)0x7F;
+    TEST_ASSERT(scan_byte(high, sizeof(high), (char)0x7F) == high + 6, "Finds 0x7F among 0xFF");
+    TEST_ASSERT(scan_byte(high, 6, (char)0x7F) == NULL, "No false match in high bytes");
+}
+
+// Test: Either of two bytes
+void test_scan_byte2() {
+    printf("\n[TEST] scan_byte2 at every alignment\n");
+
+    bool all_ok = true;
+    for (size_t offset = 0; offset < 4 && all_ok; offset++) {
+        char *data = (char *)storage + offset;
+        for (size_t length = 0; length <= MAX_LEN && all_ok; length++) {
+            for (size_t pos = 0; pos <= length && all_ok; pos++) {
+                fill_noise(data, MAX_LEN + 4 - offset);
+                if (pos < length) {
+                    data[pos] = (pos % 2) ? '\r' : '\n';
+                }
+                if (pos + 2 < length) {
+                    data[pos + 2] = (pos % 2) ? '\n' : '\r';
+                }
+
+                if (scan_byte2(data, length, '\r', '\n') !=
+                    reference_byte2(data, length, '\r', '\n')) {
+                    printf("    offset %zu, length %zu, pos %zu\n", offset, length, pos);
+                    all_ok = false;
+                }
+            }
+        }
+    }
+    TEST_ASSERT(all_ok, "Matches a byte loop for CR or LF");
+}
+
+// Test: CRLF with lone CRs and LFs around it
+void test_scan_crlf() {
+    printf("\n[TEST] scan_crlf\n");
+
+    static const char *const cases[] = {
+        "", "\r", "\n", "\r\n", "\n\r", "ab\r", "a\rb\nc\r\n",
+        "\r\r\r\n", "\n\n\r\r", "Date: Wed\r\nEtag: x\r\n\r\n",
+        "HTTP/1.1 200 OK\r\n", "no line ending at all here, just text",
+    };
+
+    bool all_ok = true;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        size_t length = strlen(cases[c]);
+        for (size_t offset = 0; offset < 4; offset++) {
+            char *data = (char *)storage + offset;
+            memcpy(data, cases[c], length);
+            // Truncations too: a CR as the last byte has no LF to pair with
+            for (size_t n = 0; n <= length; n++) {
+                if (scan_crlf(data, n) != reference_crlf(data, n)) {
+                    printf("    case %zu, offset %zu, length %zu\n", c, offset, n);
+                    all_ok = false;
+                }
+            }
+        }
+    }
+    TEST_ASSERT(all_ok, "Matches a byte loop, including split CRLFs");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  SWAR Scanning Unit Tests\n");
+    printf("========================================\n");
+
+    test_scan_byte();
+    test_scan_byte2();
+    test_scan_crlf();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
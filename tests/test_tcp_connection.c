@@ -0,0 +1,372 @@
+/**
+ * Unit tests for the TCP connection receive queue
+ *
+ * Builds src/tcp_connection.c against the headers in stubs/ and drives
+ * the lwIP receive callback, tcp_connection_peek() and
+ * tcp_connection_consume() with hand-made pbuf chains. The pbuf functions
+ * below behave like lwIP's for chains whose pbufs each hold one reference;
+ * tcp_connect() and tcp_recved() keep the PCB's window as lwIP does.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "tcp_connection.h"
+#include "lwip/priv/tcp_priv.h"
+
+// Test counters
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (condition) { \
+            printf("  ✓ %s\n", message); \
+            tests_passed++; \
+        } else { \
+            printf("  ✗ %s\n", message); \
+            tests_failed++; \
+        } \
+    } while(0)
+
+// pbufs handed out by make_pbuf() and not freed yet
+#define MAX_PBUFS 32
+static struct pbuf pbufs[MAX_PBUFS];
+static int pbufs_used = 0;
+static int pbufs_live = 0;
+
+static u32_t window_credited = 0;
+static struct tcp_pcb pcb;
+static tcp_recv_fn recv_callback = NULL;
+
+static void reset_pbufs(void) {
+    memset(pbufs, 0, sizeof(pbufs));
+    pbufs_used = 0;
+    pbufs_live = 0;
+    window_credited = 0;
+    memset(&pcb, 0, sizeof(pcb));
+}
+
+static struct pbuf *make_pbuf(const char *data) {
+    struct pbuf *p = &pbufs[pbufs_used++];
+    p->payload = (void *)data;
+    p->len = (u16_t)strlen(data);
+    p->tot_len = p->len;
+    p->next = NULL;
+    pbufs_live++;
+    return p;
+}
+
+// Chain pbufs made from each string (an empty string is a zero-length pbuf)
+static struct pbuf *make_chain(const char **parts, int count) {
+    struct pbuf *head = NULL;
+    for (int i = 0; i < count; i++) {
+        struct pbuf *p = make_pbuf(parts[i]);
+        if (head == NULL) {
+            head = p;
+        } else {
+            pbuf_cat(head, p);
+        }
+    }
+    return head;
+}
+
+static void init_connected(tcp_connection_t *conn, struct pbuf *queue) {
+    tcp_connection_init(conn);
+    conn->pcb = &pcb;
+    conn->state = TCP_STATE_CONNECTED;
+    conn->recv_queue = queue;
+    conn->recv_queued = queue ? queue->tot_len : 0;
+}
+
+// Read everything queued through peek/consume, in steps of at most step bytes
+static int drain(tcp_connection_t *conn, char *out, size_t out_size, size_t step) {
+    size_t total = 0;
+    for (int guard = 0; guard < 64; guard++) {
+        const uint8_t *data;
+        int n = tcp_connection_peek(conn, &data);
+        if (n <= 0) {
+            return (n == 0 || n == TCP_ERR_CLOSED) ? (int)total : n;
+        }
+        size_t take = ((size_t)n < step) ? (size_t)n : step;
+        if (total + take > out_size) {
+            return -1;
+        }
+        memcpy(out + total, data, take);
+        total += take;
+        tcp_connection_consume(conn, take);
+    }
+    return -1;   // peek kept returning data without the queue advancing
+}
+
+// Test: Zero-length pbuf at the head of the queue
+void test_empty_head() {
+    printf("\n[TEST] Zero-length pbuf at the head\n");
+    reset_pbufs();
+
+    const char *parts[] = { "", "abc", "def" };
+    tcp_connection_t conn;
+    init_connected(&conn, make_chain(parts, 3));
+
+    const uint8_t *data = NULL;
+    int n = tcp_connection_peek(&conn, &data);
+    TEST_ASSERT(n == 3, "Peek skips the empty pbuf");
+    TEST_ASSERT(data != NULL && memcmp(data, "abc", 3) == 0, "Peek returns the next payload");
+    TEST_ASSERT(pbufs_live == 2, "Empty pbuf freed");
+    TEST_ASSERT(conn.recv_queued == 6, "Queued byte count unchanged");
+
+    char out[16];
+    n = drain(&conn, out, sizeof(out), 64);
+    TEST_ASSERT(n == 6 && memcmp(out, "abcdef", 6) == 0, "Rest of the chain read in order");
+    TEST_ASSERT(pbufs_live == 0, "Every pbuf freed");
+    TEST_ASSERT(window_credited == 6, "Window credited for the bytes read");
+}
+
+// Test: Zero-length pbufs reached by a consume, and a queue of only those
+void test_empty_after_consume() {
+    printf("\n[TEST] Zero-length pbufs reached by a consume\n");
+    reset_pbufs();
+
+    const char *parts[] = { "ab", "", "", "cd", "" };
+    tcp_connection_t conn;
+    init_connected(&conn, make_chain(parts, 5));
+
+    char out[16];
+    int n = drain(&conn, out, sizeof(out), 1);
+    TEST_ASSERT(n == 4 && memcmp(out, "abcd", 4) == 0, "Byte-by-byte reads cross the empty pbufs");
+    TEST_ASSERT(pbufs_live == 0, "Every pbuf freed");
+
+    const char *empty[] = { "", "" };
+    init_connected(&conn, make_chain(empty, 2));
+    const uint8_t *data;
+    TEST_ASSERT(tcp_connection_peek(&conn, &data) == 0, "Only empty pbufs: nothing to read");
+    TEST_ASSERT(conn.recv_queue == NULL && pbufs_live == 0, "Empty pbufs freed");
+
+    init_connected(&conn, make_chain(empty, 1));
+    conn.peer_closed = true;
+    TEST_ASSERT(tcp_connection_peek(&conn, &data) == TCP_ERR_CLOSED, "Close reported once drained");
+}
+
+// Test: The window the PCB advertises from the handshake on
+void test_recv_window() {
+    printf("\n[TEST] Advertised receive window\n");
+    reset_pbufs();
+
+    tcp_connection_t conn;
+    tcp_connection_init(&conn);
+    TEST_ASSERT(tcp_connection_connect_start(&conn, "10.0.0.1", 80, 1000) == TCP_OK,
+                "Connect started");
+    TEST_ASSERT(pcb.rcv_ann_wnd == TCP_RECV_WINDOW, "Default window advertised");
+    TEST_ASSERT(TCP_RECV_WINDOW_PBUFS(pcb.rcv_ann_wnd) <= conn.recv_queue_pbufs,
+                "Advertised window fits the queue cap");
+    conn.state = TCP_STATE_CONNECTED;
+
+    // A full window of full-sized segments, three pool pbufs each
+    const char *segment[] = { "aaaa", "bbbb", "cc" };
+    int accepted = 0;
+    for (int i = 0; i < TCP_RECV_WINDOW / TCP_MSS; i++) {
+        if (recv_callback(&conn, &pcb, make_chain(segment, 3), ERR_OK) == ERR_OK) {
+            accepted++;
+        }
+    }
+    TEST_ASSERT(accepted == TCP_RECV_WINDOW / TCP_MSS, "Full window queued without refusals");
+    tcp_connection_close(&conn);
+    TEST_ASSERT(pbufs_live == 0, "Every pbuf freed");
+
+    reset_pbufs();
+    tcp_connection_init(&conn);
+    tcp_connection_set_recv_window(&conn, 2 * TCP_MSS);
+    TEST_ASSERT(tcp_connection_connect_start(&conn, "10.0.0.1", 80, 1000) == TCP_OK,
+                "Connect started with a smaller window");
+    TEST_ASSERT(pcb.rcv_wnd == 2 * TCP_MSS && pcb.rcv_ann_wnd == 2 * TCP_MSS,
+                "Smaller window advertised from the handshake on");
+    conn.state = TCP_STATE_CONNECTED;
+
+    struct pbuf *p = make_chain(segment, 3);
+    pcb.rcv_wnd = (u16_t)(pcb.rcv_wnd - p->tot_len);
+    recv_callback(&conn, &pcb, p, ERR_OK);
+    char out[16];
+    TEST_ASSERT(drain(&conn, out, sizeof(out), 64) == 10, "Segment read");
+    TEST_ASSERT(pcb.rcv_wnd == 2 * TCP_MSS, "Consuming reopens the window to ours, not past it");
+    tcp_connection_close(&conn);
+}
+
+// Test: The receive callback caps the pbufs a connection queues
+void test_queue_cap() {
+    printf("\n[TEST] Queued pbufs capped at the window's share of the pool\n");
+    reset_pbufs();
+
+    tcp_connection_t conn;
+    tcp_connection_init(&conn);
+    tcp_connection_set_recv_window(&conn, TCP_MSS);
+    TEST_ASSERT(tcp_connection_connect_start(&conn, "10.0.0.1", 80, 1000) == TCP_OK,
+                "Connect started");
+    TEST_ASSERT(recv_callback != NULL, "Receive callback registered");
+    conn.state = TCP_STATE_CONNECTED;
+
+    // Segments of three pool pbufs, as a full-sized one arrives
+    const char *segment[] = { "aaaa", "bbbb", "cc" };
+    const char *big[] = { "1", "2", "3", "4", "5", "6" };
+
+    struct pbuf *first = make_chain(segment, 3);
+    TEST_ASSERT(recv_callback(&conn, &pcb, first, ERR_OK) == ERR_OK, "First segment queued");
+
+    struct pbuf *second = make_chain(segment, 3);
+    TEST_ASSERT(recv_callback(&conn, &pcb, second, ERR_OK) == ERR_MEM,
+                "Segment past the cap refused");
+    TEST_ASSERT(conn.recv_queued == 10 && pbuf_clen(conn.recv_queue) == 3,
+                "Refused segment not queued");
+
+    tcp_connection_consume(&conn, 10);
+    TEST_ASSERT(recv_callback(&conn, &pcb, second, ERR_OK) == ERR_OK,
+                "Refused segment taken once the queue drained");
+    tcp_connection_consume(&conn, 10);
+
+    struct pbuf *oversized = make_chain(big, 6);
+    TEST_ASSERT(recv_callback(&conn, &pcb, oversized, ERR_OK) == ERR_OK,
+                "Chain over the cap still taken by an empty queue");
+    tcp_connection_close(&conn);
+    TEST_ASSERT(pbufs_live == 0, "Every pbuf freed");
+}
+
+int main() {
+    printf("========================================\n");
+    printf("  TCP Connection Unit Tests\n");
+    printf("========================================\n");
+
+    test_empty_head();
+    test_empty_after_consume();
+    test_recv_window();
+    test_queue_cap();
+
+    printf("\n========================================\n");
+    printf("  Test Results\n");
+    printf("========================================\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return tests_failed == 0 ? 0 : 1;
+}
+
+// lwIP pbuf functions, as lwIP implements them for single-reference pbufs
+
+u8_t pbuf_free(struct pbuf *p) {
+    u8_t count = 0;
+    while (p != NULL) {
+        struct pbuf *next = p->next;
+        p->next = NULL;
+        p->payload = NULL;
+        pbufs_live--;
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+u16_t pbuf_clen(const struct pbuf *p) {
+    u16_t len = 0;
+    for (; p != NULL; p = p->next) {
+        len++;
+    }
+    return len;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail) {
+    struct pbuf *p = head;
+    for (; p->next != NULL; p = p->next) {
+        p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+    }
+    p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+    p->next = tail;
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size) {
+    struct pbuf *p = q;
+    u16_t free_left = size;
+    while (free_left && p) {
+        if (free_left >= p->len) {
+            struct pbuf *f = p;
+            free_left = (u16_t)(free_left - p->len);
+            p = p->next;
+            f->next = NULL;
+            pbuf_free(f);
+        } else {
+            p->payload = (uint8_t *)p->payload + free_left;
+            p->len = (u16_t)(p->len - free_left);
+            p->tot_len = (u16_t)(p->tot_len - free_left);
+            free_left = 0;
+        }
+    }
+    return p;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset) {
+    u16_t copied = 0;
+    for (; p != NULL && copied < len; p = p->next) {
+        if (offset >= p->len) {
+            offset = (u16_t)(offset - p->len);
+            continue;
+        }
+        u16_t n = (u16_t)(p->len - offset);
+        if (n > len - copied) {
+            n = (u16_t)(len - copied);
+        }
+        memcpy((uint8_t *)dataptr + copied, (uint8_t *)p->payload + offset, n);
+        copied = (u16_t)(copied + n);
+        offset = 0;
+    }
+    return copied;
+}
+
+// The rest of what tcp_connection.c links against; connects succeed at once
+
+struct tcp_pcb *tcp_active_pcbs, *tcp_bound_pcbs, *tcp_tw_pcbs;
+union tcp_listen_pcbs_t tcp_listen_pcbs;
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+    window_credited += len;
+    u32_t wnd = pcb->rcv_wnd + len;
+    pcb->rcv_wnd = (u16_t)((wnd > TCP_WND) ? TCP_WND : wnd);
+    pcb->rcv_ann_wnd = pcb->rcv_wnd;
+}
+struct tcp_pcb *tcp_new(void) { return &pcb; }
+void tcp_arg(struct tcp_pcb *pcb, void *arg) { (void)pcb; (void)arg; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) {
+    (void)pcb;
+    if (recv != NULL) {
+        recv_callback = recv;
+    }
+}
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) { (void)pcb; (void)err; }
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
+                  tcp_connected_fn connected) {
+    (void)ipaddr; (void)port; (void)connected;
+    pcb->rcv_wnd = TCP_WND;
+    pcb->rcv_ann_wnd = TCP_WND;
+    return ERR_OK;
+}
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+    (void)pcb; (void)dataptr; (void)len; (void)apiflags;
+    return ERR_OK;
+}
+err_t tcp_output(struct tcp_pcb *pcb) { (void)pcb; return ERR_OK; }
+u16_t tcp_sndbuf(struct tcp_pcb *pcb) { (void)pcb; return 0; }
+err_t tcp_close(struct tcp_pcb *pcb) { (void)pcb; return ERR_OK; }
+void tcp_abort(struct tcp_pcb *pcb) { (void)pcb; }
+char *ip4addr_ntoa(const ip_addr_t *addr) { (void)addr; return "0.0.0.0"; }
+int dns_cache_lookup(const char *hostname, ip_addr_t *addr) {
+    (void)hostname;
+    addr->addr = 0x0100000a;
+    return 0;
+}
+void net_wait_until(absolute_time_t deadline) { (void)deadline; }
+void cyw43_arch_poll(void) {}
+uint64_t time_us_64(void) { return 0; }
+absolute_time_t get_absolute_time(void) { return 0; }
+absolute_time_t make_timeout_time_ms(uint32_t ms) { return ms * 1000ULL; }
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+bool time_reached(absolute_time_t t) { return t == 0; }